@@ -10,6 +10,15 @@ namespace
 
 const int LINE_MAX_LENGTH = 10000;
 
+// exits if the mapped file is shorter than size bytes
+void CheckMappedSize(const MmapFile &mmap, size_t size, const std::string &fileName)
+{
+  if (mmap.GetSize() < size) {
+    std::cerr << "Error: " << fileName << " is truncated" << std::endl;
+    exit(1);
+  }
+}
+
 } // namespace
 
 using namespace std;
@@ -92,6 +101,7 @@ Alignment::Alignment()
 
 Alignment::~Alignment()
 {
+  if (m_mmap.IsMapped()) return;
   if (m_array != NULL) {
     free(m_array);
   }
@@ -125,7 +135,7 @@ vector<string> Alignment::Tokenize( const char input[] )
 bool Alignment::PhraseAlignment( INDEX sentence, int target_length,
                                  int source_start, int source_end,
                                  int &target_start, int &target_end,
-                                 int &pre_null, int &post_null )
+                                 int &pre_null, int &post_null ) const
 {
   // get index for first alignment point
   INDEX sentenceStart = 0;
@@ -160,23 +170,24 @@ bool Alignment::PhraseAlignment( INDEX sentence, int target_length,
   }
 
   // create array for unaligned words
+  bool unaligned[ 256 ];
   for( int i=0; i<target_length; i++ ) {
-    m_unaligned[i] = true;
+    unaligned[i] = true;
   }
   for(INDEX ap = sentenceStart; ap <= m_sentenceEnd[ sentence ]; ap += 2 ) {
     int target =  m_array[ ap+1 ];
-    m_unaligned[ target ] = false;
+    unaligned[ target ] = false;
   }
 
   // prior unaligned words
   pre_null = 0;
-  for(int target = target_start-1; target >= 0 && m_unaligned[ target ]; target--) {
+  for(int target = target_start-1; target >= 0 && unaligned[ target ]; target--) {
     pre_null++;
   }
 
   // post unaligned words;
   post_null = 0;
-  for(int target = target_end+1; target < target_length && m_unaligned[ target ]; target++) {
+  for(int target = target_end+1; target < target_length && unaligned[ target ]; target++) {
     post_null++;
   }
   return true;
@@ -198,8 +209,27 @@ void Alignment::Save(const string& fileName ) const
   fclose( pFile );
 }
 
-void Alignment::Load(const string& fileName )
+void Alignment::Load(const string& fileName, bool mapped )
 {
+  if (mapped) {
+    // same layout as below, every field is 4-byte aligned
+    cerr << "mapping " << fileName << ".align" << endl;
+    const char *data = m_mmap.Map( fileName + ".align" );
+    // check each count before reading it or anything past it
+    CheckMappedSize(m_mmap, sizeof(INDEX), fileName + ".align");
+    m_size = *(const INDEX*) data;
+    const size_t countOffset = sizeof(INDEX) + m_size*(2*sizeof(int));
+    CheckMappedSize(m_mmap, countOffset + sizeof(INDEX), fileName + ".align");
+    m_array = (int*) (data + sizeof(INDEX));
+    data += countOffset;
+    m_sentenceCount = *(const INDEX*) data;
+    m_sentenceEnd = (INDEX*) (data + sizeof(INDEX));
+    CheckMappedSize(m_mmap, countOffset + sizeof(INDEX) + m_sentenceCount*sizeof(INDEX), fileName + ".align");
+    cerr << "alignment points in corpus: " << m_size << endl;
+    cerr << "sentences in corpus: " << m_sentenceCount << endl;
+    return;
+  }
+
   FILE *pFile = fopen ( (fileName + ".align").c_str() , "r" );
   if (pFile == NULL) {
     cerr << "no such file or directory: " << fileName << ".align" << endl;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vocabulary.h"
+#include "MmapFile.h"
 
 class Alignment
 {
@@ -12,7 +13,7 @@ private:
   INDEX *m_sentenceEnd;
   INDEX m_size;
   INDEX m_sentenceCount;
-  char m_unaligned[ 256 ]; // here for speed (local to PhraseAlignment)
+  MmapFile m_mmap;
 
   // No copying allowed.
   Alignment(const Alignment&);
@@ -26,8 +27,8 @@ public:
   bool PhraseAlignment( INDEX sentence, int target_length,
                         int source_start, int source_end,
                         int &target_start, int &target_end,
-                        int &pre_null, int &post_null );
-  void Load(const std::string& fileName );
+                        int &pre_null, int &post_null ) const;
+  void Load(const std::string& fileName, bool mapped = false );
   void Save(const std::string& fileName ) const;
   std::vector<std::string> Tokenize( const char input[] );
 
@@ -0,0 +1,54 @@
+#include "MmapFile.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+MmapFile::MmapFile()
+  : m_data(NULL),
+    m_size(0) {}
+
+MmapFile::~MmapFile()
+{
+  Unmap();
+}
+
+const char *MmapFile::Map(const string& fileName )
+{
+  Unmap();
+  int fd = open( fileName.c_str(), O_RDONLY );
+  if (fd == -1) {
+    cerr << "no such file or directory " << fileName << endl;
+    exit(1);
+  }
+
+  struct stat st;
+  if (fstat( fd, &st ) == -1) {
+    cerr << "cannot stat " << fileName << endl;
+    exit(1);
+  }
+  m_size = st.st_size;
+
+  void *data = mmap( NULL, m_size, PROT_READ, MAP_SHARED, fd, 0 );
+  close( fd );
+  if (data == MAP_FAILED) {
+    cerr << "Error: cannot mmap " << fileName << endl;
+    exit(1);
+  }
+  m_data = data;
+  return (const char*) m_data;
+}
+
+void MmapFile::Unmap()
+{
+  if (m_data != NULL) {
+    munmap( m_data, m_size );
+    m_data = NULL;
+    m_size = 0;
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+/** read-only memory mapping of a whole file, used to load saved
+ * indexes without copying them into the heap; the pages are shared
+ * between all processes that map the same file */
+class MmapFile
+{
+private:
+  void *m_data;
+  size_t m_size;
+
+  // No copying allowed.
+  MmapFile(const MmapFile&);
+  void operator=(const MmapFile&);
+
+public:
+  MmapFile();
+  ~MmapFile();
+
+  const char *Map(const std::string& fileName );
+  void Unmap();
+  bool IsMapped() const {
+    return m_data != NULL;
+  }
+  size_t GetSize() const {
+    return m_size;
+  }
+};
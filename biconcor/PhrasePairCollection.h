@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <string>
+#include <iostream>
 
 class Alignment;
 class PhrasePair;
@@ -34,8 +35,8 @@ public:
   ~PhrasePairCollection ();
 
   int GetCollection( const std::vector<std::string >& sourceString );
-  void Print(bool pretty) const;
-  void PrintHTML() const;
+  void Print(bool pretty, std::ostream &out = std::cout) const;
+  void PrintHTML(std::ostream &out = std::cout) const;
 };
 
 // sorting helper
@@ -10,6 +10,12 @@ namespace
 
 const int LINE_MAX_LENGTH = 10000;
 
+// the first INDEX of a saved file is the corpus size in the original
+// format; this value marks the current format, which keeps all INDEX
+// arrays aligned so that the file can be memory mapped
+const SuffixArray::INDEX FILE_MAGIC = (SuffixArray::INDEX) -1;
+const SuffixArray::INDEX FILE_VERSION = 1;
+
 } // namespace
 
 using namespace std;
@@ -27,6 +33,7 @@ SuffixArray::SuffixArray()
 
 SuffixArray::~SuffixArray()
 {
+  if (m_mmap.IsMapped()) return;
   free(m_array);
   free(m_index);
   free(m_wordInSentence);
@@ -250,6 +257,8 @@ SuffixArray::INDEX SuffixArray::FindFirst( const vector< WORD > &phrase, INDEX &
 
 int SuffixArray::Match( const vector< WORD > &phrase, INDEX index )
 {
+  // FindLast probes one beyond either end of the array
+  if (index >= m_size) return 1;
   INDEX pos = m_index[ index ];
   for(INDEX i=0; i<phrase.size() && i+pos<m_size; i++) {
     int match = CompareWord( m_vcb.GetWordID( phrase[i] ), m_array[ pos+i ] );
@@ -280,20 +289,21 @@ void SuffixArray::Save(const string& fileName ) const
     exit(1);
   }
 
+  fwrite( &FILE_MAGIC, sizeof(INDEX), 1, pFile );
+  fwrite( &FILE_VERSION, sizeof(INDEX), 1, pFile );
   fwrite( &m_size, sizeof(INDEX), 1, pFile );
+  fwrite( &m_sentenceCount, sizeof(INDEX), 1, pFile );
   fwrite( m_array, sizeof(WORD_ID), m_size, pFile ); // corpus
   fwrite( m_index, sizeof(INDEX), m_size, pFile );   // suffix array
-  fwrite( m_wordInSentence, sizeof(char), m_size, pFile); // word index
   fwrite( m_sentence, sizeof(INDEX), m_size, pFile); // sentence index
-
-  fwrite( &m_sentenceCount, sizeof(INDEX), 1, pFile );
+  fwrite( m_wordInSentence, sizeof(char), m_size, pFile); // word index
   fwrite( m_sentenceLength, sizeof(char), m_sentenceCount, pFile); // sentence length
   fclose( pFile );
 
   m_vcb.Save( fileName + ".src-vcb" );
 }
 
-void SuffixArray::Load(const string& fileName )
+void SuffixArray::Load(const string& fileName, bool mapped )
 {
   FILE *pFile = fopen ( fileName.c_str() , "r" );
   if (pFile == NULL) {
@@ -303,8 +313,51 @@ void SuffixArray::Load(const string& fileName )
 
   cerr << "loading from " << fileName << endl;
 
-  fread( &m_size, sizeof(INDEX), 1, pFile );
+  INDEX header[4];
+  fread( header, sizeof(INDEX), 1, pFile );
+  bool oldFormat = (header[0] != FILE_MAGIC);
+  if (!oldFormat) {
+    fread( header+1, sizeof(INDEX), 3, pFile );
+    if (header[1] != FILE_VERSION) {
+      cerr << "Error: unknown file version " << header[1] << " in " << fileName << endl;
+      exit(1);
+    }
+    m_size = header[2];
+    m_sentenceCount = header[3];
+  } else {
+    m_size = header[0];
+    if (mapped) {
+      cerr << "warning: " << fileName << " was saved in the old format and cannot be mapped, "
+           << "reading it into memory (save it again to map it)" << endl;
+      mapped = false;
+    }
+  }
   cerr << "words in corpus: " << m_size << endl;
+
+  if (mapped) {
+    fclose( pFile );
+    const char *data = m_mmap.Map( fileName );
+    size_t expected = 4*sizeof(INDEX) + m_size*(sizeof(WORD_ID) + 2*sizeof(INDEX) + sizeof(char))
+                      + m_sentenceCount*sizeof(char);
+    if (m_mmap.GetSize() < expected) {
+      cerr << "Error: " << fileName << " is truncated" << endl;
+      exit(1);
+    }
+    data += 4*sizeof(INDEX);
+    m_array = (WORD_ID*) data;
+    data += m_size*sizeof(WORD_ID);
+    m_index = (INDEX*) data;
+    data += m_size*sizeof(INDEX);
+    m_sentence = (INDEX*) data;
+    data += m_size*sizeof(INDEX);
+    m_wordInSentence = (char*) data;
+    data += m_size*sizeof(char);
+    m_sentenceLength = (char*) data;
+    cerr << "sentences in corpus: " << m_sentenceCount << endl;
+    m_vcb.Load( fileName + ".src-vcb" );
+    return;
+  }
+
   m_array = (WORD_ID*) calloc( sizeof( WORD_ID ), m_size );
   m_index = (INDEX*) calloc( sizeof( INDEX ), m_size );
   m_wordInSentence = (char*) calloc( sizeof( char ), m_size );
@@ -330,12 +383,19 @@ void SuffixArray::Load(const string& fileName )
     exit(1);
   }
 
-  fread( m_array, sizeof(WORD_ID), m_size, pFile ); // corpus
-  fread( m_index, sizeof(INDEX), m_size, pFile );   // suffix array
-  fread( m_wordInSentence, sizeof(char), m_size, pFile); // word index
-  fread( m_sentence, sizeof(INDEX), m_size, pFile); // sentence index
+  if (oldFormat) {
+    fread( m_array, sizeof(WORD_ID), m_size, pFile ); // corpus
+    fread( m_index, sizeof(INDEX), m_size, pFile );   // suffix array
+    fread( m_wordInSentence, sizeof(char), m_size, pFile); // word index
+    fread( m_sentence, sizeof(INDEX), m_size, pFile); // sentence index
+    fread( &m_sentenceCount, sizeof(INDEX), 1, pFile );
+  } else {
+    fread( m_array, sizeof(WORD_ID), m_size, pFile ); // corpus
+    fread( m_index, sizeof(INDEX), m_size, pFile );   // suffix array
+    fread( m_sentence, sizeof(INDEX), m_size, pFile); // sentence index
+    fread( m_wordInSentence, sizeof(char), m_size, pFile); // word index
+  }
 
-  fread( &m_sentenceCount, sizeof(INDEX), 1, pFile );
   cerr << "sentences in corpus: " << m_sentenceCount << endl;
   m_sentenceLength = (char*) calloc( sizeof( char ), m_sentenceCount );
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vocabulary.h"
+#include "MmapFile.h"
 
 class SuffixArray
 {
@@ -18,6 +19,7 @@ private:
   Vocabulary m_vcb;
   INDEX m_size;
   INDEX m_sentenceCount;
+  MmapFile m_mmap;
 
   // No copying allowed.
   SuffixArray(const SuffixArray&);
@@ -55,9 +57,16 @@ public:
   inline INDEX GetSize() const {
     return m_size;
   }
+  inline INDEX GetSentenceCount() const {
+    return m_sentenceCount;
+  }
+  inline const Vocabulary &GetVocabulary() const {
+    return m_vcb;
+  }
   inline WORD GetWord( INDEX position ) const {
     return m_vcb.GetWord( m_array[position] );
   }
   void Save(const std::string& fileName ) const;
-  void Load(const std::string& fileName );
+  // mapped: use the saved arrays in place instead of reading them into memory
+  void Load(const std::string& fileName, bool mapped = false );
 };
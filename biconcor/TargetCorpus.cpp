@@ -10,6 +10,15 @@ namespace
 
 const int LINE_MAX_LENGTH = 10000;
 
+// exits if the mapped file is shorter than size bytes
+void CheckMappedSize(const MmapFile &mmap, size_t size, const std::string &fileName)
+{
+  if (mmap.GetSize() < size) {
+    std::cerr << "Error: " << fileName << " is truncated" << std::endl;
+    exit(1);
+  }
+}
+
 } // namespace
 
 using namespace std;
@@ -23,6 +32,7 @@ TargetCorpus::TargetCorpus()
 
 TargetCorpus::~TargetCorpus()
 {
+  if (m_mmap.IsMapped()) return;
   free(m_array);
   free(m_sentenceEnd);
 }
@@ -137,8 +147,28 @@ void TargetCorpus::Save(const string& fileName ) const
   m_vcb.Save( fileName + ".tgt-vcb" );
 }
 
-void TargetCorpus::Load(const string& fileName )
+void TargetCorpus::Load(const string& fileName, bool mapped )
 {
+  if (mapped) {
+    // same layout as below, every field is 4-byte aligned
+    cerr << "mapping " << fileName << ".tgt" << endl;
+    const char *data = m_mmap.Map( fileName + ".tgt" );
+    // check each count before reading it or anything past it
+    CheckMappedSize(m_mmap, sizeof(INDEX), fileName + ".tgt");
+    m_size = *(const INDEX*) data;
+    const size_t countOffset = sizeof(INDEX) + m_size*sizeof(WORD_ID);
+    CheckMappedSize(m_mmap, countOffset + sizeof(INDEX), fileName + ".tgt");
+    m_array = (WORD_ID*) (data + sizeof(INDEX));
+    data += countOffset;
+    m_sentenceCount = *(const INDEX*) data;
+    m_sentenceEnd = (INDEX*) (data + sizeof(INDEX));
+    CheckMappedSize(m_mmap, countOffset + sizeof(INDEX) + m_sentenceCount*sizeof(INDEX), fileName + ".tgt");
+    cerr << "words in corpus: " << m_size << endl;
+    cerr << "sentences in corpus: " << m_sentenceCount << endl;
+    m_vcb.Load( fileName + ".tgt-vcb" );
+    return;
+  }
+
   FILE *pFile = fopen ( (fileName + ".tgt").c_str() , "r" );
   if (pFile == NULL) {
     cerr << "Cannot open " << fileName << endl;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vocabulary.h"
+#include "MmapFile.h"
 
 class TargetCorpus
 {
@@ -13,6 +14,7 @@ private:
   Vocabulary m_vcb;
   INDEX m_size;
   INDEX m_sentenceCount;
+  MmapFile m_mmap;
 
   // No copying allowed.
   TargetCorpus(const TargetCorpus&);
@@ -27,6 +29,6 @@ public:
   WORD GetWord( INDEX sentence, int word ) const;
   WORD_ID GetWordId( INDEX sentence, int word ) const;
   char GetSentenceLength( INDEX sentence ) const;
-  void Load(const std::string& fileName );
+  void Load(const std::string& fileName, bool mapped = false );
   void Save(const std::string& fileName ) const;
 };
@@ -5,8 +5,223 @@
 #include <getopt.h>
 #include "base64.h"
 
+#include <cstring>
+#include <deque>
+#include <map>
+#include <sstream>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
 using namespace std;
 
+namespace
+{
+
+const char *START_MARKER = "-|||- BICONCOR START -|||-";
+const char *END_MARKER = "-|||- BICONCOR END -|||-";
+
+// answers queries against a loaded (possibly memory mapped) model;
+// the model is only read, so one instance can serve many threads
+class QueryService
+{
+private:
+  SuffixArray *m_suffixArray;
+  TargetCorpus *m_targetCorpus;
+  Alignment *m_alignment;
+  int m_max_translation;
+  int m_max_example;
+  bool m_html;
+  bool m_pretty;
+
+public:
+  QueryService( SuffixArray *sa, TargetCorpus *tc, Alignment *a, int max_translation, int max_example, bool html, bool pretty )
+    :m_suffixArray(sa)
+    ,m_targetCorpus(tc)
+    ,m_alignment(a)
+    ,m_max_translation(max_translation)
+    ,m_max_example(max_example)
+    ,m_html(html)
+    ,m_pretty(pretty) {}
+
+  // full response to one query, including the end marker
+  string Answer( const string &query ) const {
+    vector< string > queryString = m_alignment->Tokenize( query.c_str() );
+    PhrasePairCollection ppCollection( m_suffixArray, m_targetCorpus, m_alignment, m_max_translation, m_max_example );
+    int total = ppCollection.GetCollection( queryString );
+    ostringstream out;
+    out << "TOTAL: " << total << endl;
+    if (m_html) {
+      ppCollection.PrintHTML( out );
+    } else {
+      ppCollection.Print( m_pretty, out );
+    }
+    out << END_MARKER << endl;
+    return out.str();
+  }
+};
+
+#ifdef WITH_THREADS
+// answers queries from STDIN with several worker threads; responses
+// are still written in the order in which the queries arrived, each
+// as soon as it and all queries before it are done
+class ConcurrentStdio
+{
+private:
+  const QueryService &m_service;
+  boost::mutex m_mutex;
+  boost::condition_variable m_queryReady, m_answerReady;
+  deque< pair< size_t, string > > m_queries;
+  map< size_t, string > m_answers;
+  size_t m_read;
+  bool m_eof;
+
+public:
+  ConcurrentStdio( const QueryService &service )
+    :m_service(service)
+    ,m_read(0)
+    ,m_eof(false) {}
+
+  void Run( int threads ) {
+    boost::thread_group workers;
+    for(int i=0; i<threads; i++) {
+      workers.create_thread( boost::bind( &ConcurrentStdio::Work, this ) );
+    }
+    boost::thread reader( boost::bind( &ConcurrentStdio::Read, this ) );
+
+    for(size_t next = 0; ; next++) {
+      string answer;
+      {
+        boost::mutex::scoped_lock lock(m_mutex);
+        while(m_answers.find( next ) == m_answers.end() && !(m_eof && next == m_read)) {
+          m_answerReady.wait( lock );
+        }
+        if (m_eof && next == m_read) break;
+        answer.swap( m_answers[ next ] );
+        m_answers.erase( next );
+      }
+      cout << answer << flush;
+    }
+    reader.join();
+    workers.join_all();
+  }
+
+private:
+  void Read() {
+    string query;
+    while(!getline(cin, query, '\n').eof()) {
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_queries.push_back( make_pair( m_read++, query ) );
+      m_queryReady.notify_one();
+    }
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_eof = true;
+    m_queryReady.notify_all();
+    m_answerReady.notify_all();
+  }
+
+  void Work() {
+    while(true) {
+      pair< size_t, string > query;
+      {
+        boost::mutex::scoped_lock lock(m_mutex);
+        while(m_queries.empty() && !m_eof) {
+          m_queryReady.wait( lock );
+        }
+        if (m_queries.empty()) return;
+        query = m_queries.front();
+        m_queries.pop_front();
+      }
+      string answer = m_service.Answer( query.second );
+      boost::mutex::scoped_lock lock(m_mutex);
+      m_answers[ query.first ] = answer;
+      m_answerReady.notify_all();
+    }
+  }
+};
+#endif
+
+bool WriteAll( int fd, const string &data )
+{
+  size_t done = 0;
+  while(done < data.size()) {
+    ssize_t written = write( fd, data.data() + done, data.size() - done );
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return false;
+    done += written;
+  }
+  return true;
+}
+
+// one client of the socket server: same line protocol as --stdio
+void ServeConnection( const QueryService *service, int fd )
+{
+  if (WriteAll( fd, string(START_MARKER) + "\n" )) {
+    string buffer;
+    char chunk[ 4096 ];
+    bool open = true;
+    while(open) {
+      ssize_t received = read( fd, chunk, sizeof(chunk) );
+      if (received < 0 && errno == EINTR) continue;
+      if (received <= 0) break;
+      buffer.append( chunk, received );
+      size_t start = 0, end;
+      while(open && (end = buffer.find( '\n', start )) != string::npos) {
+        open = WriteAll( fd, service->Answer( buffer.substr( start, end-start ) ) );
+        start = end+1;
+      }
+      buffer.erase( 0, start );
+    }
+  }
+  close( fd );
+}
+
+// listens on a local (unix domain) socket; every connection gets its
+// own thread, all of them sharing the loaded model
+void RunSocketServer( const QueryService &service, const string &path )
+{
+  int server = socket( AF_UNIX, SOCK_STREAM, 0 );
+  struct sockaddr_un address;
+  memset( &address, 0, sizeof(address) );
+  address.sun_family = AF_UNIX;
+  if (server == -1 || path.size() >= sizeof(address.sun_path)) {
+    cerr << "error: cannot create socket " << path << endl;
+    exit(1);
+  }
+  strcpy( address.sun_path, path.c_str() );
+  unlink( path.c_str() );
+  if (bind( server, (struct sockaddr*) &address, sizeof(address) ) == -1
+      || listen( server, 64 ) == -1) {
+    cerr << "error: cannot listen on socket " << path << endl;
+    exit(1);
+  }
+  signal( SIGPIPE, SIG_IGN );
+  cerr << "listening on " << path << endl;
+
+  while(true) {
+    int client = accept( server, NULL, NULL );
+    if (client == -1) {
+      if (errno == EINTR) continue;
+      cerr << "error: accept failed on " << path << endl;
+      exit(1);
+    }
+#ifdef WITH_THREADS
+    boost::thread( boost::bind( &ServeConnection, &service, client ) ).detach();
+#else
+    ServeConnection( &service, client );
+#endif
+  }
+}
+
+} // namespace
+
 int main(int argc, char* argv[])
 {
   // handle parameters
@@ -22,9 +237,12 @@ int main(int argc, char* argv[])
   int htmlFlag = false;   // output as HTML
   int prettyFlag = false; // output readable on screen
   int stdioFlag = false;  // receive requests from STDIN, respond to STDOUT
+  int mmapFlag = false;   // map saved model instead of reading it
+  int threads = 1;        // workers answering --stdio queries
+  string socketPath = ""; // serve requests on a local socket
   int max_translation = 20;
   int max_example = 50;
-  string info = "usage: biconcor\n\t[--load model-file]\n\t[--save model-file]\n\t[--create source-corpus]\n\t[--query string]\n\t[--target target-corpus]\n\t[--alignment file]\n\t[--translations count]\n\t[--examples count]\n\t[--html]\n\t[--stdio]\n";
+  string info = "usage: biconcor\n\t[--load model-file]\n\t[--save model-file]\n\t[--create source-corpus]\n\t[--query string]\n\t[--target target-corpus]\n\t[--alignment file]\n\t[--translations count]\n\t[--examples count]\n\t[--html]\n\t[--stdio]\n\t[--threads count]\n\t[--socket path]\n\t[--mmap]\n";
   while(1) {
     static struct option long_options[] = {
       {"load", required_argument, 0, 'l'},
@@ -38,10 +256,13 @@ int main(int argc, char* argv[])
       {"stdio", no_argument, 0, 'i'},
       {"translations", required_argument, 0, 'o'},
       {"examples", required_argument, 0, 'e'},
+      {"threads", required_argument, 0, 'j'},
+      {"socket", required_argument, 0, 'u'},
+      {"mmap", no_argument, 0, 'm'},
       {0, 0, 0, 0}
     };
     int option_index = 0;
-    int c = getopt_long (argc, argv, "l:s:c:q:Q:t:a:hpio:e:", long_options, &option_index);
+    int c = getopt_long (argc, argv, "l:s:c:q:Q:t:a:hpio:e:j:u:m", long_options, &option_index);
     if (c == -1) break;
     switch (c) {
     case 'l':
@@ -85,12 +306,21 @@ int main(int argc, char* argv[])
     case 'i':
       stdioFlag = true;
       break;
+    case 'j':
+      threads = atoi(optarg);
+      break;
+    case 'u':
+      socketPath = string(optarg);
+      break;
+    case 'm':
+      mmapFlag = true;
+      break;
     default:
       cerr << info;
       exit(1);
     }
   }
-  if (stdioFlag) {
+  if (stdioFlag || socketPath != "") {
     queryFlag = true;
   }
 
@@ -111,6 +341,10 @@ int main(int argc, char* argv[])
     cerr << "error: i have no target corpus or alignment\n" << info;
     exit(1);
   }
+  if (mmapFlag && !loadFlag) {
+    cerr << "error: can only map a saved model\n" << info;
+    exit(1);
+  }
 
   // do your thing
   SuffixArray suffixArray;
@@ -133,27 +367,28 @@ int main(int argc, char* argv[])
   }
   if (loadFlag) {
     cerr << "will load from " << fileNameSuffix << endl;
-    suffixArray.Load( fileNameSuffix );
-    targetCorpus.Load( fileNameSuffix );
-    alignment.Load( fileNameSuffix );
+    suffixArray.Load( fileNameSuffix, mmapFlag );
+    targetCorpus.Load( fileNameSuffix, mmapFlag );
+    alignment.Load( fileNameSuffix, mmapFlag );
   }
-  if (stdioFlag) {
-    cout << "-|||- BICONCOR START -|||-" << endl << flush;
+  QueryService service( &suffixArray, &targetCorpus, &alignment, max_translation, max_example, htmlFlag, prettyFlag );
+  if (socketPath != "") {
+    RunSocketServer( service, socketPath );
+  } else if (stdioFlag) {
+    cout << START_MARKER << endl << flush;
+#ifdef WITH_THREADS
+    if (threads > 1) {
+      ConcurrentStdio concurrent( service );
+      concurrent.Run( threads );
+      return 0;
+    }
+#endif
     while(true) {
       string query;
       if (getline(cin, query, '\n').eof()) {
         return 0;
       }
-      vector< string > queryString = alignment.Tokenize( query.c_str() );
-      PhrasePairCollection ppCollection( &suffixArray, &targetCorpus, &alignment, max_translation, max_example );
-      int total = ppCollection.GetCollection( queryString );
-      cout << "TOTAL: " << total << endl;
-      if (htmlFlag) {
-        ppCollection.PrintHTML();
-      } else {
-        ppCollection.Print(prettyFlag);
-      }
-      cout << "-|||- BICONCOR END -|||-" << endl << flush;
+      cout << service.Answer( query ) << flush;
     }
   } else if (queryFlag) {
     cerr << "query is " << query << endl;
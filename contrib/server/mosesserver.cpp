@@ -3,6 +3,18 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
 
 
 #include "moses/ChartManager.h"
@@ -220,6 +232,16 @@ public:
     int nbest_size = (si == params.end()) ? 0 : int(xmlrpc_c::value_int(si->second));
     si = params.find("nbest-distinct");
     bool nbest_distinct = (si != params.end());
+    si = params.find("time-out");
+    double timeout = 0;
+    if (si != params.end()) {
+      // clients may send whole seconds as an int
+      if (si->second.type() == xmlrpc_c::value::TYPE_INT) {
+        timeout = int(xmlrpc_c::value_int(si->second));
+      } else {
+        timeout = double(xmlrpc_c::value_double(si->second));
+      }
+    }
 
     vector<float> multiModelWeights;
     si = params.find("weight-t-multimodel");
@@ -266,6 +288,10 @@ public:
         sentence.Read(in,inputFactorOrder);
 	size_t lineNumber = 0; // TODO: Include sentence request number here?
         Manager manager(lineNumber, sentence, staticData.GetSearchAlgorithm());
+        if (timeout > 0) {
+          // per-request deadline, replacing -time-out
+          manager.GetDeadline().Reset(timeout);
+        }
         manager.ProcessSentence();
         const Hypothesis* hypo = manager.GetBestHypothesis();
 
@@ -445,6 +471,107 @@ public:
 };
 
 
+namespace
+{
+
+//! worker processes with --server-processes, see main()
+std::vector<pid_t> workers;
+
+//! SIGTERM or SIGINT received by the supervising process, 0 if none
+volatile sig_atomic_t stopSignal = 0;
+
+void RequestStop(int sig)
+{
+  stopSignal = sig;
+}
+
+//! only there to interrupt sigsuspend() when a worker exits
+void ChildExited(int)
+{
+}
+
+void SetHandler(int sig, void (*handler)(int))
+{
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handler;
+  sigemptyset(&action.sa_mask);
+  sigaction(sig, &action, NULL);
+}
+
+//! socket shared by all worker processes, so the kernel hands each connection to one of them
+int OpenListener(int port)
+{
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0) {
+    perror("Cannot create socket");
+    exit(1);
+  }
+  int one = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0
+      || listen(listener, 64) < 0) {
+    perror("Cannot listen");
+    exit(1);
+  }
+  return listener;
+}
+
+//! serve requests on port, or on listener if it is not negative; never returns
+void RunServer(xmlrpc_c::registry &registry, int port, int listener, const char *logfile, bool isSerial)
+{
+  xmlrpc_c::serverAbyss::constrOpt options;
+  options.registryP(&registry).logFileName(logfile);
+  if (listener >= 0) {
+    options.socketFd(listener);
+  } else {
+    options.portNumber(port);
+  }
+  xmlrpc_c::serverAbyss myAbyssServer(options);
+
+  if (isSerial) {
+    while(1) {
+      myAbyssServer.runOnce();
+    }
+  } else {
+    myAbyssServer.run();
+  }
+  // xmlrpc_c::serverAbyss.run() never returns
+  CHECK(false);
+}
+
+//! signals is the mask of the supervising process before it blocked SIGCHLD, SIGTERM and SIGINT
+pid_t StartWorker(xmlrpc_c::registry &registry, int listener, const char *logfile, bool isSerial, const sigset_t &signals)
+{
+  const pid_t parent = getpid();
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    exit(1);
+  }
+  if (pid == 0) {
+    SetHandler(SIGTERM, SIG_DFL);
+    SetHandler(SIGINT, SIG_DFL);
+    SetHandler(SIGCHLD, SIG_DFL);
+    sigprocmask(SIG_SETMASK, &signals, NULL);
+#ifdef __linux__
+    // do not outlive the supervising process
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+    if (getppid() != parent) _exit(1);
+    RunServer(registry, 0, listener, logfile, isSerial);
+    _exit(1);
+  }
+  return pid;
+}
+
+}
+
 int main(int argc, char** argv)
 {
 
@@ -454,6 +581,7 @@ int main(int argc, char** argv)
   int port = 8080;
   const char* logfile = "/dev/null";
   bool isSerial = false;
+  int numProcesses = 0;
 
   for (int i = 0; i < argc; ++i) {
     if (!strcmp(argv[i],"--server-port")) {
@@ -472,6 +600,14 @@ int main(int argc, char** argv)
       } else {
         logfile = argv[i];
       }
+    } else if (!strcmp(argv[i],"--server-processes")) {
+      ++i;
+      if (i >= argc) {
+        cerr << "Error: Missing argument to --server-processes" << endl;
+        exit(1);
+      } else {
+        numProcesses = atoi(argv[i]);
+      }
     } else if (!strcmp(argv[i], "--serial")) {
       cerr << "Running single-threaded server" << endl;
       isSerial = true;
@@ -504,21 +640,73 @@ int main(int argc, char** argv)
   myRegistry.addMethod("updater", updater);
   myRegistry.addMethod("optimize", optimizer);
 
-  xmlrpc_c::serverAbyss myAbyssServer(
-    myRegistry,
-    port,              // TCP port on which to listen
-    logfile
-  );
+  if (numProcesses <= 0) {
+    cerr << "Listening on port " << port << endl;
+    RunServer(myRegistry, port, -1, logfile, isSerial);
+    return 0;
+  }
 
-  cerr << "Listening on port " << port << endl;
-  if (isSerial) {
-    while(1) {
-      myAbyssServer.runOnce();
+  // Pre-fork mode: the models loaded above are shared copy-on-write by
+  // all workers. A worker that dies is replaced by a new fork of this
+  // process, which does not load anything again. Updates through
+  // "updater" and "optimize" only reach the worker that handles them.
+  // The signal handlers only set a flag. The signals are blocked outside
+  // sigsuspend(), so none is lost between checking the flag and waiting.
+  int listener = OpenListener(port);
+  cerr << "Listening on port " << port << " with " << numProcesses << " worker processes" << endl;
+  sigset_t blocked, signals;
+  sigemptyset(&blocked);
+  sigaddset(&blocked, SIGCHLD);
+  sigaddset(&blocked, SIGTERM);
+  sigaddset(&blocked, SIGINT);
+  sigprocmask(SIG_BLOCK, &blocked, &signals);
+  SetHandler(SIGCHLD, ChildExited);
+  SetHandler(SIGTERM, RequestStop);
+  SetHandler(SIGINT, RequestStop);
+
+  std::vector<time_t> started;
+  for (int i = 0; i < numProcesses; ++i) {
+    workers.push_back(StartWorker(myRegistry, listener, logfile, isSerial, signals));
+    started.push_back(time(NULL));
+  }
+
+  while (!stopSignal) {
+    int status;
+    pid_t pid = waitpid(-1, &status, WNOHANG);
+    if (pid < 0) {
+      perror("waitpid");
+      return 1;
     }
-  } else {
-    myAbyssServer.run();
+    if (pid == 0) {
+      sigsuspend(&signals);
+      continue;
+    }
+    size_t worker = std::find(workers.begin(), workers.end(), pid) - workers.begin();
+    if (worker == workers.size()) continue;
+
+    if (WIFSIGNALED(status)) {
+      cerr << "Worker " << pid << " killed by signal " << WTERMSIG(status);
+    } else {
+      cerr << "Worker " << pid << " exited with status " << WEXITSTATUS(status);
+    }
+    cerr << ", restarting" << endl;
+    // do not spin if workers die right away
+    if (time(NULL) - started[worker] < 1) sleep(1);
+    workers[worker] = StartWorker(myRegistry, listener, logfile, isSerial, signals);
+    started[worker] = time(NULL);
   }
-  // xmlrpc_c::serverAbyss.run() never returns
-  CHECK(false);
-  return 0;
+
+  for (size_t i = 0; i < workers.size(); ++i) {
+    kill(workers[i], SIGTERM);
+  }
+  for (size_t i = 0; i < workers.size(); ++i) {
+    while (waitpid(workers[i], NULL, 0) < 0 && errno == EINTR) {
+    }
+  }
+  // terminate the way the signal would have
+  const int sig = stopSignal;
+  SetHandler(sig, SIG_DFL);
+  sigprocmask(SIG_SETMASK, &signals, NULL);
+  raise(sig);
+  return 1;
 }
@@ -0,0 +1,566 @@
+// Significance filtering of phrase tables (Johnson et al. 2007) using the
+// suffix array implementation in biconcor/ instead of SALM.
+//
+// Phrase pairs are read from stdin in blocks of source phrase groups; the
+// groups of a block are scored by worker threads and written to stdout in
+// input order, so the table is streamed and never held in memory.
+
+#include <cstring>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+#include <unistd.h>
+
+#include "biconcor/SuffixArray.h"
+
+typedef std::vector<SuffixArray::INDEX> SentIdSet;
+typedef boost::shared_ptr<const SentIdSet> SentIdSetPtr;
+
+// constants
+const size_t MINIMUM_SIZE_TO_KEEP = 10000;     // only cache occurrence sets at least this large
+const std::string SEPARATOR       = " ||| ";
+
+const double ALPHA_PLUS_EPS  = -1000.0;        // dummy value
+const double ALPHA_MINUS_EPS = -2000.0;        // dummy value
+
+// configuration params
+size_t pfe_filter_limit = 0;            // 0 = don't filter anything based on P(f|e)
+bool print_cooc_counts = false;         // add cooc counts to phrase table?
+bool print_neglog_significance = false; // add -log(p) to phrase table?
+double sig_filter_limit = 0;            // keep phrase pairs with -log(sig) > sig_filter_limit
+//    higher = filter-more
+bool pef_filter_only = false;           // only filter based on pef
+bool hierarchical = false;
+size_t max_cache = 0;
+size_t num_threads = 1;
+size_t block_size = 10000;              // source phrase groups scored per batch
+
+// globals
+double p_111 = 0.0;                     // alpha
+int num_lines;
+
+void usage()
+{
+  std::cerr << "\nFilter phrase table using significance testing as described\n"
+            << "in H. Johnson, et al. (2007) Improving Translation Quality\n"
+            << "by Discarding Most of the Phrasetable. EMNLP 2007.\n"
+            << "\nUsage:\n"
+            << "\n  filter-pt-native -e english -f french\n"
+            << "      [-c] [-p] [-l threshold] [-n num] [-t threads] < PHRASE-TABLE > FILTERED-PHRASE-TABLE\n\n"
+            << "   -e, -f        target and source side of the training corpus: either a plain\n"
+            << "                 text corpus or a suffix array saved with biconcor --save\n"
+            << "   [-l threshold] >0.0, a+e, or a-e: keep values that have a -log significance > this\n"
+            << "   [-n num      ] 0, 1...: 0=no filtering, >0 sort by P(e|f) and keep the top num elements\n"
+            << "   [-i index    ] index of P(e|f) among the phrase table scores (default 2)\n"
+            << "   [-c          ] add the cooccurence counts to the phrase table\n"
+            << "   [-p          ] add -log(significance) to the phrasetable\n"
+            << "   [-h          ] filter hierarchical rule table\n"
+            << "   [-m num      ] limit cache to num most recent phrases\n"
+            << "   [-t num      ] number of worker threads (default 1)\n"
+            << "   [-b num      ] number of source phrases scored per batch (default 10000)\n";
+  exit(1);
+}
+
+struct PTEntry {
+  PTEntry(const std::string& str, int index);
+  std::string f_phrase;
+  std::string e_phrase;
+  std::string extra;
+  std::string scores;
+  float pfe;
+  int cf;
+  int ce;
+  int cfe;
+  float nlog_pte;
+  void set_cooc_stats(int _cef, int _cf, int _ce, float nlp) {
+    cfe = _cef;
+    cf = _cf;
+    ce = _ce;
+    nlog_pte = nlp;
+  }
+
+};
+
+PTEntry::PTEntry(const std::string& str, int index) :
+  cf(0), ce(0), cfe(0), nlog_pte(0.0)
+{
+  size_t pos = 0;
+  std::string::size_type nextPos = str.find(SEPARATOR, pos);
+  this->f_phrase = str.substr(pos,nextPos);
+
+  pos = nextPos + SEPARATOR.size();
+  nextPos = str.find(SEPARATOR, pos);
+  this->e_phrase = str.substr(pos,nextPos-pos);
+
+  pos = nextPos + SEPARATOR.size();
+  nextPos = str.find(SEPARATOR, pos);
+  if (nextPos < str.size()) {
+    this->scores = str.substr(pos,nextPos-pos);
+
+    pos = nextPos + SEPARATOR.size();
+    this->extra = str.substr(pos);
+  } else {
+    this->scores = str.substr(pos,str.size()-pos);
+  }
+
+  int c = 0;
+  std::string::iterator i=scores.begin();
+  if (index > 0) {
+    for (; i != scores.end(); ++i) {
+      if ((*i) == ' ') {
+        c++;
+        if (c == index) break;
+      }
+    }
+  }
+  if (i != scores.end()) {
+    ++i;
+  }
+  std::string::iterator end = i;
+  while (end != scores.end() && *end != ' ') ++end;
+  this->pfe = atof(std::string(i, end).c_str());
+}
+
+struct PfeComparer {
+  bool operator()(const PTEntry* a, const PTEntry* b) const {
+    return a->pfe > b->pfe;
+  }
+};
+
+struct NlogSigThresholder {
+  NlogSigThresholder(float threshold) : t(threshold) {}
+  float t;
+  bool operator()(const PTEntry* a) const {
+    if (a->nlog_pte < t) {
+      delete a;
+      return true;
+    } else return false;
+  }
+};
+
+std::ostream& operator << (std::ostream& os, const PTEntry& pp)
+{
+  os << pp.f_phrase << " ||| " << pp.e_phrase;
+  os << " ||| " << pp.scores;
+  if (pp.extra.size()>0) os << " ||| " << pp.extra;
+  if (print_cooc_counts) os << " ||| " << pp.cfe << " " << pp.cf << " " << pp.ce;
+  if (print_neglog_significance) os << " ||| " << pp.nlog_pte;
+  return os;
+}
+
+// 2x2 (one-sided) Fisher's exact test
+// see B. Moore. (2004) On Log Likelihood and the Significance of Rare Events
+double fisher_exact(int cfe, int ce, int cf)
+{
+  assert(cfe <= ce);
+  assert(cfe <= cf);
+
+  int a = cfe;
+  int b = (cf - cfe);
+  int c = (ce - cfe);
+  int d = (num_lines - ce - cf + cfe);
+  int n = a + b + c + d;
+
+  double cp = exp(lgamma(1+a+c) + lgamma(1+b+d) + lgamma(1+a+b) + lgamma(1+c+d) - lgamma(1+n) - lgamma(1+a) - lgamma(1+b) - lgamma(1+c) - lgamma(1+d));
+  double total_p = 0.0;
+  int tc = std::min(b,c);
+  for (int i=0; i<=tc; i++) {
+    total_p += cp;
+    double coef = (double)(b)*(double)(c)/(double)(a+1)/(double)(d+1);
+    cp *= coef;
+    ++a;
+    --c;
+    ++d;
+    --b;
+  }
+  return total_p;
+}
+
+// load a saved biconcor suffix array, or build one from a text corpus
+void load_suffix_array(SuffixArray &sa, const std::string &fileName)
+{
+  std::ifstream vcb((fileName + ".src-vcb").c_str());
+  if (vcb) {
+    sa.Load(fileName);
+  } else {
+    std::cerr << "no saved suffix array for " << fileName << ", indexing it as a text corpus\n";
+    sa.Create(fileName);
+  }
+}
+
+/** Sentence ids in which phrases occur, shared by all worker threads.
+ * Only large sets are kept since they are expensive to collect; the least
+ * recently used ones are dropped once there are more than max_cache.
+ */
+class SentIdCache
+{
+public:
+  SentIdCache(SuffixArray &sa, const Vocabulary &vcb) : m_sa(sa), m_vcb(vcb), m_clock(0) {}
+
+  SentIdSetPtr Get(const std::string &phrase) {
+    {
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(m_mutex);
+#endif
+      Cache::iterator iter = m_cache.find(phrase);
+      if (iter != m_cache.end()) {
+        iter->second.second = ++m_clock;
+        return iter->second.first;
+      }
+    }
+
+    SentIdSetPtr occurrences(Lookup(phrase));
+    if (occurrences->size() >= MINIMUM_SIZE_TO_KEEP) {
+#ifdef WITH_THREADS
+      boost::mutex::scoped_lock lock(m_mutex);
+#endif
+      m_cache[phrase] = std::make_pair(occurrences, ++m_clock);
+    }
+    return occurrences;
+  }
+
+  void Prune() {
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_mutex);
+#endif
+    if (!max_cache || m_cache.size() <= max_cache) return;
+    std::vector<size_t> clocks;
+    for (Cache::const_iterator iter = m_cache.begin(); iter != m_cache.end(); ++iter)
+      clocks.push_back(iter->second.second);
+    std::nth_element(clocks.begin(), clocks.begin() + (clocks.size() - max_cache), clocks.end());
+    size_t out = clocks[clocks.size() - max_cache];
+    for (Cache::iterator iter = m_cache.begin(); iter != m_cache.end(); ) {
+      if (iter->second.second < out) m_cache.erase(iter++);
+      else ++iter;
+    }
+  }
+
+private:
+  typedef std::map<std::string, std::pair<SentIdSetPtr, size_t> > Cache;
+
+  SuffixArray &m_sa;
+  const Vocabulary &m_vcb;
+  Cache m_cache;
+  size_t m_clock;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+
+  SentIdSet *Lookup(const std::string &phrase) const {
+    SentIdSet *occur_set = new SentIdSet;
+
+    std::vector<WORD> words;
+    size_t pos = 0;
+    while (pos < phrase.size()) {
+      size_t next = phrase.find(' ', pos);
+      if (next == std::string::npos) next = phrase.size();
+      if (next > pos) {
+        words.push_back(phrase.substr(pos, next - pos));
+        // a word that is not in the corpus can't match anything
+        if (m_vcb.lookup.find(words.back()) == m_vcb.lookup.end()) return occur_set;
+      }
+      pos = next + 1;
+    }
+    if (words.empty()) return occur_set;
+
+    SuffixArray::INDEX first = 0, last = 0;
+    if (m_sa.FindMatches(words, first, last) == 0) return occur_set;
+    for (SuffixArray::INDEX i = first; i <= last; ++i) {
+      occur_set->push_back(m_sa.GetSentence(m_sa.GetPosition(i)));
+    }
+
+    std::sort(occur_set->begin(), occur_set->end());
+    occur_set->erase(std::unique(occur_set->begin(), occur_set->end()), occur_set->end());
+    return occur_set;
+  }
+};
+
+// slight simplicifaction: we consider all sentences in which "a" and "b" occur to be instances of the rule "a [X][X] b".
+SentIdSetPtr lookup_multiple_phrases(const std::vector<std::string> &phrases, SentIdCache &cache)
+{
+  if (phrases.empty()) return SentIdSetPtr(new SentIdSet);
+
+  SentIdSetPtr main_set = cache.Get(phrases.front());
+  for (std::vector<std::string>::const_iterator phrase=phrases.begin()+1; phrase != phrases.end(); ++phrase) {
+    SentIdSetPtr temp_set = cache.Get(*phrase);
+    SentIdSet *intersection = new SentIdSet;
+    std::set_intersection(main_set->begin(), main_set->end(), temp_set->begin(), temp_set->end(),
+                          std::back_inserter(*intersection));
+    main_set.reset(intersection);
+  }
+  return main_set;
+}
+
+SentIdSetPtr find_occurrences(const std::string& rule, SentIdCache &cache)
+{
+  if (!hierarchical) return cache.Get(rule);
+
+  // we search for hierarchical rules by stripping away NT and looking for terminals sequences
+  // if a rule contains multiple sequences of terminals, we intersect their occurrences.
+  int pos = 0;
+  int NTStartPos, NTEndPos;
+  std::vector<std::string> phrases;
+  while (rule.find("] ", pos) < rule.size()) {
+    NTStartPos = rule.find("[",pos) - 1; // -1 to cut space before NT
+    NTEndPos = rule.find("] ",pos);
+    if (NTStartPos < pos) { // no space: NT at start of rule (or two consecutive NTs)
+      pos = NTEndPos + 2;
+      continue;
+    }
+    phrases.push_back(rule.substr(pos,NTStartPos-pos));
+    pos = NTEndPos + 2;
+  }
+
+  NTStartPos = rule.find("[",pos) - 1; // LHS of rule
+  if (NTStartPos > pos) {
+    phrases.push_back(rule.substr(pos,NTStartPos-pos));
+  }
+
+  return lookup_multiple_phrases(phrases, cache);
+}
+
+size_t count_intersection(const SentIdSet &fset, const SentIdSet &eset)
+{
+  size_t cef = 0;
+  if (eset.size() < fset.size()) {
+    for (SentIdSet::const_iterator i=eset.begin(); i != eset.end(); ++i) {
+      if (std::binary_search(fset.begin(), fset.end(), *i)) cef++;
+    }
+  } else {
+    for (SentIdSet::const_iterator i=fset.begin(); i != fset.end(); ++i) {
+      if (std::binary_search(eset.begin(), eset.end(), *i)) cef++;
+    }
+  }
+  return cef;
+}
+
+//! translation options of one source phrase, and how many of them were removed
+struct PhraseGroup {
+  PhraseGroup() : nremoved_pfefilter(0), nremoved_sigfilter(0) {}
+  std::vector<PTEntry*> options;
+  size_t nremoved_pfefilter;
+  size_t nremoved_sigfilter;
+};
+
+// input: unordered list of translation options for a single source phrase
+void compute_cooc_stats_and_filter(PhraseGroup &group, SentIdCache &fsets, SentIdCache &esets)
+{
+  std::vector<PTEntry*> &options = group.options;
+  if (pfe_filter_limit>0 && options.size() > pfe_filter_limit) {
+    group.nremoved_pfefilter += (options.size() - pfe_filter_limit);
+    std::nth_element(options.begin(), options.begin()+pfe_filter_limit, options.end(), PfeComparer());
+    for (std::vector<PTEntry*>::iterator i=options.begin()+pfe_filter_limit; i != options.end(); ++i)
+      delete *i;
+    options.erase(options.begin()+pfe_filter_limit,options.end());
+  }
+  if (pef_filter_only) return;
+
+  // source occurrences are looked up once for all its translations
+  SentIdSetPtr fset = find_occurrences(options.front()->f_phrase, fsets);
+  size_t cf = fset->size();
+  for (std::vector<PTEntry*>::iterator i=options.begin(); i != options.end(); ++i) {
+    SentIdSetPtr eset = find_occurrences((*i)->e_phrase, esets);
+    size_t ce = eset->size();
+    size_t cef = count_intersection(*fset, *eset);
+    double nlp = -log(fisher_exact(cef, cf, ce));
+    (*i)->set_cooc_stats(cef, cf, ce, nlp);
+  }
+  std::vector<PTEntry*>::iterator new_end =
+    std::remove_if(options.begin(), options.end(), NlogSigThresholder(sig_filter_limit));
+  group.nremoved_sigfilter += (options.end() - new_end);
+  options.erase(new_end,options.end());
+}
+
+// worker: score every num_threads-th group of the block, starting at offset
+void filter_groups(std::vector<PhraseGroup> *block, size_t offset, SentIdCache *fsets, SentIdCache *esets)
+{
+  for (size_t i = offset; i < block->size(); i += num_threads) {
+    compute_cooc_stats_and_filter((*block)[i], *fsets, *esets);
+  }
+}
+
+void filter_block(std::vector<PhraseGroup> &block, SentIdCache &fsets, SentIdCache &esets,
+                  size_t &nremoved_pfefilter, size_t &nremoved_sigfilter)
+{
+#ifdef WITH_THREADS
+  boost::thread_group workers;
+  for (size_t t = 1; t < num_threads; ++t) {
+    workers.create_thread(boost::bind(&filter_groups, &block, t, &fsets, &esets));
+  }
+  filter_groups(&block, 0, &fsets, &esets);
+  workers.join_all();
+#else
+  filter_groups(&block, 0, &fsets, &esets);
+#endif
+
+  for (std::vector<PhraseGroup>::iterator group = block.begin(); group != block.end(); ++group) {
+    nremoved_pfefilter += group->nremoved_pfefilter;
+    nremoved_sigfilter += group->nremoved_sigfilter;
+    for (std::vector<PTEntry*>::iterator i=group->options.begin(); i != group->options.end(); ++i) {
+      std::cout << **i << "\n";
+      delete *i;
+    }
+  }
+  block.clear();
+
+  fsets.Prune();
+  esets.Prune();
+}
+
+int main(int argc, char * argv[])
+{
+  int c;
+  const char* efile=0;
+  const char* ffile=0;
+  int pfe_index = 2;
+  while ((c = getopt(argc, argv, "cpf:e:i:n:l:m:t:b:h")) != -1) {
+    switch (c) {
+    case 'e':
+      efile = optarg;
+      break;
+    case 'f':
+      ffile = optarg;
+      break;
+    case 'i':  // index of pfe in phrase table
+      pfe_index = atoi(optarg);
+      break;
+    case 'n':  // keep only the top n entries in phrase table sorted by p(f|e) (0=all)
+      pfe_filter_limit = atoi(optarg);
+      std::cerr << "P(f|e) filter limit: " << pfe_filter_limit << std::endl;
+      break;
+    case 'c':
+      print_cooc_counts = true;
+      break;
+    case 'p':
+      print_neglog_significance = true;
+      break;
+    case 'h':
+      hierarchical = true;
+      break;
+    case 'm':
+      max_cache = atoi(optarg);
+      break;
+    case 't':
+      num_threads = atoi(optarg);
+      if (num_threads < 1) usage();
+#ifndef WITH_THREADS
+      if (num_threads > 1) {
+        std::cerr << "filter-pt-native was built without thread support\n";
+        exit(1);
+      }
+#endif
+      break;
+    case 'b':
+      block_size = atoi(optarg);
+      if (block_size < 1) usage();
+      break;
+    case 'l':
+      std::cerr << "-l = " << optarg << "\n";
+      if (strcmp(optarg,"a+e") == 0) {
+        sig_filter_limit = ALPHA_PLUS_EPS;
+      } else if (strcmp(optarg,"a-e") == 0) {
+        sig_filter_limit = ALPHA_MINUS_EPS;
+      } else {
+        char *x;
+        sig_filter_limit = strtod(optarg, &x);
+        if (sig_filter_limit < 0.0) {
+          std::cerr << "Filter limit (-l) must be either 'a+e', 'a-e' or a real number >= 0.0\n";
+          usage();
+        }
+      }
+      break;
+    default:
+      usage();
+    }
+  }
+  if (sig_filter_limit == 0.0) pef_filter_only = true;
+  //-----------------------------------------------------------------------------
+  if (optind != argc || ((!efile || !ffile) && !pef_filter_only)) {
+    usage();
+  }
+
+  SuffixArray e_sa;
+  SuffixArray f_sa;
+  if (!pef_filter_only) {
+    load_suffix_array(e_sa, efile);
+    load_suffix_array(f_sa, ffile);
+    size_t elines = e_sa.GetSentenceCount();
+    size_t flines = f_sa.GetSentenceCount();
+    if (elines != flines) {
+      std::cerr << "Number of lines in e-corpus != number of lines in f-corpus!\n";
+      usage();
+    } else {
+      std::cerr << "Training corpus: " << elines << " lines\n";
+      num_lines = elines;
+    }
+    p_111 = -log(fisher_exact(1,1,1));
+    std::cerr << "\\alpha = " << p_111 << "\n";
+    if (sig_filter_limit == ALPHA_MINUS_EPS) {
+      sig_filter_limit = p_111 - 0.001;
+    } else if (sig_filter_limit == ALPHA_PLUS_EPS) {
+      sig_filter_limit = p_111 + 0.001;
+    }
+    std::cerr << "Sig filter threshold is = " << sig_filter_limit << "\n";
+  } else {
+    std::cerr << "Filtering using P(e|f) only. n=" << pfe_filter_limit << std::endl;
+  }
+
+  SentIdCache esets(e_sa, e_sa.GetVocabulary());
+  SentIdCache fsets(f_sa, f_sa.GetVocabulary());
+
+  std::ios_base::sync_with_stdio(false);
+  std::string line;
+  std::vector<PhraseGroup> block;
+  size_t pt_lines = 0;
+  size_t nremoved_sigfilter = 0;
+  size_t nremoved_pfefilter = 0;
+  while (std::getline(std::cin, line)) {
+    if(++pt_lines%10000==0) {
+      std::cerr << ".";
+      if(pt_lines%500000==0)
+        std::cerr << "[n:"<<pt_lines<<"]\n";
+    }
+    if (line.empty()) continue;
+
+    PTEntry* pp = new PTEntry(line, pfe_index);
+    if (block.empty() || block.back().options.front()->f_phrase != pp->f_phrase) {
+      // the previous source phrase is complete; score once a block is full
+      if (block.size() == block_size) {
+        filter_block(block, fsets, esets, nremoved_pfefilter, nremoved_sigfilter);
+      }
+      block.push_back(PhraseGroup());
+    }
+    block.back().options.push_back(pp);
+  }
+  filter_block(block, fsets, esets, nremoved_pfefilter, nremoved_sigfilter);
+  std::cout.flush();
+
+  float pfefper = (100.0*(float)nremoved_pfefilter)/(float)pt_lines;
+  float sigfper = (100.0*(float)nremoved_sigfilter)/(float)pt_lines;
+  std::cerr << "\n\n------------------------------------------------------\n"
+            << "  unfiltered phrases pairs: " << pt_lines << "\n"
+            << "\n"
+            << "     P(f|e) filter [first]: " << nremoved_pfefilter << "   (" << pfefper << "%)\n"
+            << "       significance filter: " << nremoved_sigfilter << "   (" << sigfper << "%)\n"
+            << "            TOTAL FILTERED: " << (nremoved_pfefilter + nremoved_sigfilter) << "   (" << (sigfper + pfefper) << "%)\n"
+            << "\n"
+            << "     FILTERED phrase pairs: " << (pt_lines - nremoved_pfefilter - nremoved_sigfilter) << "   (" << (100.0-sigfper - pfefper) << "%)\n"
+            << "------------------------------------------------------\n";
+
+  return 0;
+}
@@ -29,6 +29,11 @@ public:
   virtual void prepareStats(std::size_t sid, const std::string& text, ScoreStats& entry);
   virtual statscore_t calculateScore(const std::vector<int>& comps) const;
 
+  // prepareStats() adds the words of the hypotheses to the vocabulary
+  virtual bool prepareStatsIsThreadSafe() const {
+    return false;
+  }
+
   int CalcReferenceLength(std::size_t doc_id, std::size_t sentence_id, std::size_t length);
 
   // NOTE: this function is used for unit testing.
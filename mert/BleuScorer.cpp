@@ -150,9 +150,39 @@ bool BleuScorer::OpenReferenceStream(istream* is, size_t file_id)
     }
     ++sid;
   }
+  IndexReferences();
   return true;
 }
 
+void BleuScorer::IndexReferences()
+{
+  m_ngram_ids.clear();
+  m_ngram_orders.clear();
+  m_ngram_counts.clear();
+  m_ngram_counts.resize(m_references.size());
+  for (size_t sid = 0; sid < m_references.size(); ++sid) {
+    const NgramCounts& counts = *m_references[sid]->get_counts();
+    vector<pair<int, int> >& ids = m_ngram_counts[sid];
+    for (NgramCounts::const_iterator ci = counts.begin(); ci != counts.end(); ++ci) {
+      const NgramCounts::Key& ngram = ci->first;
+      int id = -1;
+      for (size_t i = 0; i < ngram.size(); ++i) {
+        const pair<int, int> key(id, ngram[i]);
+        boost::unordered_map<pair<int, int>, int>::const_iterator it = m_ngram_ids.find(key);
+        if (it == m_ngram_ids.end()) {
+          id = m_ngram_orders.size();
+          m_ngram_ids[key] = id;
+          m_ngram_orders.push_back(i + 1);
+        } else {
+          id = it->second;
+        }
+      }
+      ids.push_back(make_pair(id, ci->second));
+    }
+    sort(ids.begin(), ids.end());
+  }
+}
+
 void BleuScorer::prepareStats(size_t sid, const string& text, ScoreStats& entry)
 {
   if (sid >= m_references.size()) {
@@ -160,28 +190,51 @@ void BleuScorer::prepareStats(size_t sid, const string& text, ScoreStats& entry)
     msg << "Sentence id (" << sid << ") not found in reference set";
     throw runtime_error(msg.str());
   }
-  NgramCounts testcounts;
   // stats for this line
   vector<ScoreStatsType> stats(kBleuNgramOrder * 2);
   string sentence = preprocessSentence(text);
-  const size_t length = CountNgrams(sentence, testcounts, kBleuNgramOrder, true);
+  vector<int> encoded_tokens;
+  TokenizeAndEncodeTesting(sentence, encoded_tokens);
+  const size_t length = encoded_tokens.size();
 
   const int reference_len = CalcReferenceLength(sid, length);
   stats.push_back(reference_len);
 
+  // ids of the n-grams of the hypothesis that occur in some reference;
+  // an n-gram can only occur if its prefix does
+  vector<int> ngrams;
+  ngrams.reserve(length * kBleuNgramOrder);
+  for (size_t i = 0; i < length; ++i) {
+    int id = -1;
+    for (size_t k = 0; k < kBleuNgramOrder && i + k < length; ++k) {
+      boost::unordered_map<pair<int, int>, int>::const_iterator it
+        = m_ngram_ids.find(make_pair(id, encoded_tokens[i + k]));
+      if (it == m_ngram_ids.end()) {
+        break;
+      }
+      id = it->second;
+      ngrams.push_back(id);
+    }
+  }
+  sort(ngrams.begin(), ngrams.end());
+
   //precision on each ngram type
-  for (NgramCounts::const_iterator testcounts_it = testcounts.begin();
-       testcounts_it != testcounts.end(); ++testcounts_it) {
-    const NgramCounts::Value guess = testcounts_it->second;
-    const size_t len = testcounts_it->first.size();
-    NgramCounts::Value correct = 0;
-
-    NgramCounts::Value v = 0;
-    if (m_references[sid]->get_counts()->Lookup(testcounts_it->first, &v)) {
-      correct = min(v, guess);
+  for (size_t len = 1; len <= kBleuNgramOrder && len <= length; ++len) {
+    stats[len * 2 - 1] = length - len + 1;
+  }
+  const vector<pair<int, int> >& reference_counts = m_ngram_counts[sid];
+  for (size_t i = 0; i < ngrams.size();) {
+    size_t end = i + 1;
+    while (end < ngrams.size() && ngrams[end] == ngrams[i]) {
+      ++end;
+    }
+    const NgramCounts::Value guess = end - i;
+    vector<pair<int, int> >::const_iterator ref = lower_bound(
+          reference_counts.begin(), reference_counts.end(), make_pair(ngrams[i], 0));
+    if (ref != reference_counts.end() && ref->first == ngrams[i]) {
+      stats[m_ngram_orders[ngrams[i]] * 2 - 2] += min(ref->second, guess);
     }
-    stats[len * 2 - 2] += correct;
-    stats[len * 2 - 1] += guess;
+    i = end;
   }
   entry.set(stats);
 }
@@ -3,8 +3,11 @@
 
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <boost/unordered_map.hpp>
+
 #include "Types.h"
 #include "ScoreData.h"
 #include "StatisticsBasedScorer.h"
@@ -42,6 +45,11 @@ public:
     return 2 * kBleuNgramOrder + 1;
   }
 
+  // prepareStats() only reads the references and the vocabulary
+  virtual bool prepareStatsIsThreadSafe() const {
+    return !hasFilter();
+  }
+
   int CalcReferenceLength(std::size_t sentence_id, std::size_t length);
 
   ReferenceLengthType GetReferenceLengthType() const {
@@ -74,6 +82,17 @@ protected:
   // reference translations.
   ScopedVector<Reference> m_references;
 
+  // Integer ids of the reference n-grams. The id of an n-gram is found
+  // from the id of its prefix (-1 for unigrams) and its last word, so the
+  // n-grams of a hypothesis are looked up without building keys.
+  boost::unordered_map<std::pair<int, int>, int> m_ngram_ids;
+  std::vector<int> m_ngram_orders;
+  // reference counts of each sentence, as (n-gram id, count) sorted by id
+  std::vector<std::vector<std::pair<int, int> > > m_ngram_counts;
+
+  // builds the n-gram ids and counts from m_references
+  void IndexReferences();
+
   // constructor used by subclasses
   BleuScorer(const std::string& name, const std::string& config): StatisticsBasedScorer(name,config) {}
 
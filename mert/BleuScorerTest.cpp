@@ -3,8 +3,10 @@
 #define BOOST_TEST_MODULE MertBleuScorer
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
 #include <cmath>
 #include "Ngram.h"
+#include "Reference.h"
 #include "Vocabulary.h"
 #include "Util.h"
 
@@ -121,6 +123,24 @@ void SetUpReferences(BleuScorer& scorer)
   }
 }
 
+// Clipped n-gram matches computed from the NgramCounts of the hypothesis,
+// the way prepareStats() did before the reference n-grams were indexed.
+std::vector<int> CountMatches(BleuScorer& scorer, std::size_t sid,
+                              const std::string& line)
+{
+  NgramCounts counts;
+  scorer.CountNgrams(line, counts, kBleuNgramOrder, true);
+  NgramCounts* reference = scorer.GetReferences()[sid]->get_counts();
+  std::vector<int> matches(kBleuNgramOrder);
+  for (NgramCounts::const_iterator it = counts.begin(); it != counts.end(); ++it) {
+    NgramCounts::Value count = 0;
+    if (reference->Lookup(it->first, &count)) {
+      matches[it->first.size() - 1] += std::min(count, it->second);
+    }
+  }
+  return matches;
+}
+
 } // namespace
 
 BOOST_AUTO_TEST_CASE(bleu_reference_type)
@@ -288,3 +308,38 @@ BOOST_AUTO_TEST_CASE(sentence_level_bleu)
   BOOST_CHECK_CLOSE(0.5624f, smoothedSentenceBleu(stats, 0.5), 0.01 );
   BOOST_CHECK_CLOSE(0.5067f, smoothedSentenceBleu(stats, 1.0, true), 0.01);
 }
+
+BOOST_AUTO_TEST_CASE(bleu_indexed_counts)
+{
+  BleuScorer scorer;
+  {
+    std::stringstream ref1;
+    ref1 << "the cat sat on the mat" << std::endl
+         << "a b a b a b c" << std::endl;
+    BOOST_CHECK(scorer.OpenReferenceStream(&ref1, 0));
+  }
+  {
+    std::stringstream ref2;
+    ref2 << "there is a cat on the mat on the mat" << std::endl
+         << "a b c a b" << std::endl;
+    BOOST_CHECK(scorer.OpenReferenceStream(&ref2, 1));
+  }
+
+  const char* lines[][2] = {
+    {"the the the the the the the", "a a a a"},
+    {"the cat on the mat on the mat", "a b a b a b a b"},
+    {"on the mat the cat sat", "c a b a b c"},
+    {"dog", "b c a b a b c d"},
+    {"", "x y z"}
+  };
+  for (std::size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i) {
+    for (std::size_t sid = 0; sid < 2; ++sid) {
+      ScoreStats entry;
+      scorer.prepareStats(sid, lines[i][sid], entry);
+      const std::vector<int> matches = CountMatches(scorer, sid, lines[i][sid]);
+      for (std::size_t k = 0; k < kBleuNgramOrder; ++k) {
+        BOOST_CHECK_EQUAL(entry.get(2 * k), matches[k]);
+      }
+    }
+  }
+}
@@ -8,7 +8,11 @@
 
 #include <algorithm>
 #include <cmath>
+#include <deque>
 #include <fstream>
+#include <stdexcept>
+
+#include <boost/scoped_ptr.hpp>
 
 #include "Data.h"
 #include "Scorer.h"
@@ -21,6 +25,10 @@
 #include "util/string_piece.hh"
 #include "FeatureDataIterator.h"
 
+#ifdef WITH_THREADS
+#include "moses/ThreadPool.h"
+#endif
+
 using namespace std;
 
 namespace MosesTuning
@@ -135,58 +143,183 @@ void Data::load(const std::string &featfile, const std::string &scorefile)
   m_score_data->load(scorefile);
 }
 
-void Data::loadNBest(const string &file)
+namespace
 {
-  TRACE_ERR("loading nbest from " << file << endl);
-  util::FilePiece in(file.c_str());
 
-  ScoreStats scoreentry;
-  string sentence, feature_str, alignment;
+//! the fields of an n-best line that are scored and stored
+struct NBestEntry {
   int sentence_index;
+  string sentence;
+  string feature_str;
+  ScoreStats scores;
+};
 
-  while (true) {
-    try {
-      StringPiece line = in.ReadLine();
-      if (line.empty()) continue;
-      // adding statistics for error measures
-      scoreentry.clear();
+void ParseNBestLine(const StringPiece& line, bool use_alignment, NBestEntry& entry)
+{
+  util::TokenIter<util::MultiCharacter> it(line, util::MultiCharacter("|||"));
 
-      util::TokenIter<util::MultiCharacter> it(line, util::MultiCharacter("|||"));
+  entry.sentence_index = ParseInt(*it);
+  ++it;
+  entry.sentence = it->as_string();
+  ++it;
+  entry.feature_str = it->as_string();
+  ++it;
 
-      sentence_index = ParseInt(*it);
-      ++it;
-      sentence = it->as_string();
-      ++it;
-      feature_str = it->as_string();
-      ++it;
+  string alignment;
+  if (it) {
+    ++it;                             // skip model score.
 
+    if (it) {
+      ++it;
+      alignment = it->as_string(); //fifth field (if present) is either phrase or word alignment
       if (it) {
-        ++it;                             // skip model score.
-
-        if (it) {
-          ++it;
-          alignment = it->as_string(); //fifth field (if present) is either phrase or word alignment
-          if (it) {
-            ++it;
-            alignment = it->as_string(); //sixth field (if present) is word alignment
-          }
-        }
+        ++it;
+        alignment = it->as_string(); //sixth field (if present) is word alignment
       }
-      //TODO check alignment exists if scorers need it
+    }
+  }
+  //TODO check alignment exists if scorers need it
+
+  if (use_alignment) {
+    entry.sentence += "|||";
+    entry.sentence += alignment;
+  }
+}
+
+//! store a scored entry; called in file order since feature names are shared
+void AddNBestEntry(Data& data, const NBestEntry& entry)
+{
+  data.getScoreData()->add(entry.scores, entry.sentence_index);
+
+  // examine first line for name of features
+  if (!data.existsFeatureNames()) {
+    data.InitFeatureMap(entry.feature_str);
+  }
+  data.AddFeatures(entry.feature_str, entry.sentence_index);
+}
+
+#ifdef WITH_THREADS
+//! n-best lines per block scored by one task, blocks end at sentence boundaries
+const size_t kNBestBlockSize = 1000;
+
+//! consecutive n-best entries whose score statistics are computed by a worker
+class NBestBlock : public Moses::Task
+{
+public:
+  explicit NBestBlock(Scorer& scorer) : m_scorer(scorer), m_done(false) {}
 
-      if (m_scorer->useAlignment()) {
-        sentence += "|||";
-        sentence += alignment;
+  void Run() {
+    try {
+      for (size_t i = 0; i < m_entries.size(); ++i) {
+        NBestEntry& entry = m_entries[i];
+        entry.scores.clear();
+        m_scorer.prepareStats(entry.sentence_index, entry.sentence, entry.scores);
       }
-      m_scorer->prepareStats(sentence_index, sentence, scoreentry);
+    } catch (const std::exception& e) {
+      m_error = e.what();
+      if (m_error.empty()) m_error = "error while scoring n-best list";
+    }
+    boost::mutex::scoped_lock lock(m_mutex);
+    m_done = true;
+    m_cond.notify_all();
+  }
+
+  //! owned by loadNBest(), which reads the entries after the task ran
+  bool DeleteAfterExecution() {
+    return false;
+  }
+
+  //! block until Run() finished, rethrowing its error
+  void Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (!m_done) m_cond.wait(lock);
+    if (!m_error.empty()) throw runtime_error(m_error);
+  }
+
+  std::vector<NBestEntry> m_entries;
 
-      m_score_data->add(scoreentry, sentence_index);
+private:
+  Scorer& m_scorer;
+  bool m_done;
+  string m_error;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+};
 
-      // examine first line for name of features
-      if (!existsFeatureNames()) {
-        InitFeatureMap(feature_str);
+void FinishNBestBlock(Data& data, std::deque<NBestBlock*>& pending)
+{
+  boost::scoped_ptr<NBestBlock> block(pending.front());
+  pending.pop_front();
+  block->Wait();
+  for (size_t i = 0; i < block->m_entries.size(); ++i) {
+    AddNBestEntry(data, block->m_entries[i]);
+  }
+}
+#endif
+
+} // namespace
+
+void Data::loadNBest(const string &file, size_t num_threads)
+{
+  TRACE_ERR("loading nbest from " << file << endl);
+  util::FilePiece in(file.c_str());
+  const bool use_alignment = m_scorer->useAlignment();
+
+#ifdef WITH_THREADS
+  // Scoring dominates; score blocks of sentences in parallel but store them
+  // in file order.
+  if (num_threads > 1 && m_scorer->prepareStatsIsThreadSafe()) {
+    Moses::ThreadPool pool(num_threads);
+    std::deque<NBestBlock*> pending;
+    NBestBlock* block = new NBestBlock(*m_scorer);
+    pending.push_back(block);
+    try {
+      while (true) {
+        StringPiece line;
+        try {
+          line = in.ReadLine();
+        } catch (util::EndOfFileException &e) {
+          break;
+        }
+        if (line.empty()) continue;
+        NBestEntry entry;
+        ParseNBestLine(line, use_alignment, entry);
+        if (block->m_entries.size() >= kNBestBlockSize
+            && entry.sentence_index != block->m_entries.back().sentence_index) {
+          pool.Submit(block);
+          while (pending.size() > 2 * num_threads) {
+            FinishNBestBlock(*this, pending);
+          }
+          block = new NBestBlock(*m_scorer);
+          pending.push_back(block);
+        }
+        block->m_entries.push_back(entry);
+      }
+      pool.Submit(block);
+      while (!pending.empty()) {
+        FinishNBestBlock(*this, pending);
       }
-      AddFeatures(feature_str, sentence_index);
+    } catch (...) {
+      // let the workers finish with the blocks before freeing them
+      pool.Stop(true);
+      for (size_t i = 0; i < pending.size(); ++i) delete pending[i];
+      throw;
+    }
+    PrintUserTime("Loaded N-best lists");
+    return;
+  }
+#endif
+
+  NBestEntry entry;
+  while (true) {
+    try {
+      StringPiece line = in.ReadLine();
+      if (line.empty()) continue;
+      ParseNBestLine(line, use_alignment, entry);
+      // adding statistics for error measures
+      entry.scores.clear();
+      m_scorer->prepareStats(entry.sentence_index, entry.sentence, entry.scores);
+      AddNBestEntry(*this, entry);
     } catch (util::EndOfFileException &e) {
       PrintUserTime("Loaded N-best lists");
       break;
@@ -67,7 +67,12 @@ public:
     m_feature_data->Features(f);
   }
 
-  void loadNBest(const std::string &file);
+  /**
+   * Score and add the entries of an n-best list. With num_threads > 1 and a
+   * scorer whose prepareStats() is thread safe, the score statistics are
+   * computed in parallel.
+   */
+  void loadNBest(const std::string &file, std::size_t num_threads = 1);
 
   void load(const std::string &featfile, const std::string &scorefile);
 
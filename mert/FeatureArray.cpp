@@ -8,6 +8,9 @@
 
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <stdexcept>
+#include <stdint.h>
 #include "FeatureArray.h"
 #include "FileStream.h"
 #include "Util.h"
@@ -17,6 +20,23 @@ using namespace std;
 namespace MosesTuning
 {
 
+namespace
+{
+
+void WriteUInt32(ostream* os, uint32_t value)
+{
+  os->write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+uint32_t ReadUInt32(istream* is)
+{
+  uint32_t value = 0;
+  is->read(reinterpret_cast<char*>(&value), sizeof(value));
+  return value;
+}
+
+}
+
 
 FeatureArray::FeatureArray()
   : m_index(0), m_num_features(0) {}
@@ -36,11 +56,52 @@ void FeatureArray::savetxt(ostream* os)
 
 void FeatureArray::savebin(ostream* os)
 {
-  *os << FEATURES_BIN_BEGIN << " " << m_index << " " << m_array.size()
+  // the sparse format is only used if needed, older readers understand the other
+  bool with_sparse = false;
+  for (featarray_t::const_iterator i = m_array.begin(); i != m_array.end(); ++i) {
+    if (i->getSparse().size()) {
+      with_sparse = true;
+      break;
+    }
+  }
+  *os << (with_sparse ? FEATURES_BIN_SPARSE_BEGIN : FEATURES_BIN_BEGIN)
+      << " " << m_index << " " << m_array.size()
       << " " << m_num_features << " " << m_features << endl;
   for (featarray_t::iterator i = m_array.begin(); i != m_array.end(); ++i)
     i->savebin(os);
 
+  if (with_sparse) {
+    // number the sparse features of this array in order of appearance
+    map<size_t, uint32_t> index;
+    vector<size_t> ids;
+    for (featarray_t::const_iterator i = m_array.begin(); i != m_array.end(); ++i) {
+      const vector<size_t> feats = i->getSparse().feats();
+      for (size_t j = 0; j < feats.size(); ++j) {
+        if (index.insert(make_pair(feats[j], (uint32_t) ids.size())).second)
+          ids.push_back(feats[j]);
+      }
+    }
+    WriteUInt32(os, ids.size());
+    for (size_t j = 0; j < ids.size(); ++j) {
+      // the names of n-best sparse features end with '=', which the text
+      // format drops when it is read back
+      string name = SparseVector::decode(ids[j]);
+      if (!name.empty() && name[name.size() - 1] == '=') name.erase(name.size() - 1);
+      WriteUInt32(os, name.size());
+      os->write(name.data(), name.size());
+    }
+    for (featarray_t::const_iterator i = m_array.begin(); i != m_array.end(); ++i) {
+      const SparseVector& sparse = i->getSparse();
+      const vector<size_t> feats = sparse.feats();
+      WriteUInt32(os, feats.size());
+      for (size_t j = 0; j < feats.size(); ++j) {
+        const FeatureStatsType value = sparse.get(feats[j]);
+        WriteUInt32(os, index[feats[j]]);
+        os->write(reinterpret_cast<const char*>(&value), sizeof(value));
+      }
+    }
+  }
+
   *os << FEATURES_BIN_END << endl;
 }
 
@@ -72,13 +133,37 @@ void FeatureArray::save(bool bin)
   save(&cout, bin);
 }
 
-void FeatureArray::loadbin(istream* is, size_t n)
+void FeatureArray::loadbin(istream* is, const SparseVector& sparseWeights, size_t n, bool with_sparse)
 {
+  const size_t first = m_array.size();
   FeatureStats entry(m_num_features);
   for (size_t i = 0 ; i < n; i++) {
     entry.loadbin(is);
     add(entry);
   }
+  if (!with_sparse) return;
+
+  vector<size_t> ids(ReadUInt32(is));
+  string name;
+  for (size_t j = 0; j < ids.size(); ++j) {
+    name.resize(ReadUInt32(is));
+    if (!name.empty()) is->read(&name[0], name.size());
+    ids[j] = SparseVector::encode(name);
+  }
+  for (size_t i = first; i < m_array.size(); ++i) {
+    FeatureStats& stats = m_array[i];
+    const uint32_t count = ReadUInt32(is);
+    for (uint32_t j = 0; j < count; ++j) {
+      const uint32_t name_index = ReadUInt32(is);
+      FeatureStatsType value;
+      is->read(reinterpret_cast<char*>(&value), sizeof(value));
+      if (name_index >= ids.size()) {
+        throw runtime_error("FeatureArray::loadbin(): sparse feature index out of range");
+      }
+      stats.addSparse(ids[name_index], value);
+    }
+    stats.mergeSparse(sparseWeights);
+  }
 }
 
 void FeatureArray::loadtxt(istream* is, const SparseVector& sparseWeights, size_t n)
@@ -95,6 +180,7 @@ void FeatureArray::load(istream* is, const SparseVector& sparseWeights)
 {
   size_t number_of_entries = 0;
   bool binmode = false;
+  bool with_sparse = false;
 
   string substring, stringBuf;
   string::size_type loc;
@@ -109,6 +195,9 @@ void FeatureArray::load(istream* is, const SparseVector& sparseWeights)
       binmode = false;
     } else if ((loc = stringBuf.find(FEATURES_BIN_BEGIN)) == 0) {
       binmode = true;
+    } else if ((loc = stringBuf.find(FEATURES_BIN_SPARSE_BEGIN)) == 0) {
+      binmode = true;
+      with_sparse = true;
     } else {
       TRACE_ERR("ERROR: FeatureArray::load(): Wrong header");
       return;
@@ -124,7 +213,7 @@ void FeatureArray::load(istream* is, const SparseVector& sparseWeights)
   }
 
   if (binmode) {
-    loadbin(is, number_of_entries);
+    loadbin(is, sparseWeights, number_of_entries, with_sparse);
   } else {
     loadtxt(is, sparseWeights, number_of_entries);
   }
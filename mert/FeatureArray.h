@@ -21,6 +21,13 @@ const char FEATURES_TXT_BEGIN[] = "FEATURES_TXT_BEGIN_0";
 const char FEATURES_TXT_END[] = "FEATURES_TXT_END_0";
 const char FEATURES_BIN_BEGIN[] = "FEATURES_BIN_BEGIN_0";
 const char FEATURES_BIN_END[] = "FEATURES_BIN_END_0";
+/**
+ * Binary entries followed by a sparse section: the number of sparse feature
+ * names, each name as its length and bytes, then per entry the number of
+ * its sparse features and (name index, value) pairs. Counts and indexes are
+ * uint32_t in host byte order, values FeatureStatsType.
+ */
+const char FEATURES_BIN_SPARSE_BEGIN[] = "FEATURES_BIN_BEGIN_1";
 
 class FeatureArray
 {
@@ -96,7 +103,7 @@ public:
   void save(bool bin=false);
 
   void loadtxt(std::istream* is, const SparseVector& sparseWeights, std::size_t n);
-  void loadbin(std::istream* is, std::size_t n);
+  void loadbin(std::istream* is, const SparseVector& sparseWeights, std::size_t n, bool with_sparse);
   void load(std::istream* is, const SparseVector& sparseWeights);
 
   bool check_consistency() const;
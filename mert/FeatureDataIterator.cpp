@@ -17,9 +17,11 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 #include <iostream>
+#include <cstring>
 #include <sstream>
 #include <boost/functional/hash.hpp>
 
+#include "util/file.hh"
 #include "util/file_piece.hh"
 #include "util/tokenize_piece.hh"
 
@@ -55,9 +57,52 @@ float ParseFloat(const StringPiece& str)
   return value;
 }
 
+bool FileStartsWith(const string& filename, const string& prefix)
+{
+  ifstream in(filename.c_str(), ios::in | ios::binary);
+  string start(prefix.size(), '\0');
+  in.read(&start[0], start.size());
+  return in && start == prefix;
+}
+
+MappedDataFile::MappedDataFile(const string& filename)
+  : m_filename(filename), m_offset(0)
+{
+  scoped_fd fd(OpenReadOrThrow(filename.c_str()));
+  uint64_t size = SizeOrThrow(fd.get());
+  if (size) MapRead(LAZY, fd.get(), 0, size, m_mem);
+}
+
+StringPiece MappedDataFile::ReadLine()
+{
+  if (m_offset >= m_mem.size()) throw EndOfFileException();
+  const char* begin = m_mem.begin() + m_offset;
+  const char* end = static_cast<const char*>(memchr(begin, '\n', m_mem.size() - m_offset));
+  if (!end) end = m_mem.end();
+  m_offset = min<size_t>(end + 1 - m_mem.begin(), m_mem.size());
+  return StringPiece(begin, end - begin);
+}
+
+const char* MappedDataFile::Read(size_t bytes)
+{
+  if (bytes > m_mem.size() - m_offset) {
+    throw FileFormatException(m_filename, "<truncated binary data>");
+  }
+  const char* ret = m_mem.begin() + m_offset;
+  m_offset += bytes;
+  return ret;
+}
+
+uint32_t MappedDataFile::ReadUInt32()
+{
+  uint32_t value;
+  memcpy(&value, Read(sizeof(value)), sizeof(value));
+  return value;
+}
+
 bool operator==(FeatureDataItem const& item1, FeatureDataItem const& item2)
 {
-  return item1.dense==item1.dense && item1.sparse==item1.sparse;
+  return item1.dense==item2.dense && item1.sparse==item2.sparse;
 }
 
 size_t hash_value(FeatureDataItem const& item)
@@ -73,7 +118,12 @@ FeatureDataIterator::FeatureDataIterator() {}
 
 FeatureDataIterator::FeatureDataIterator(const string& filename)
 {
-  m_in.reset(new FilePiece(filename.c_str()));
+  // FEATURES_BIN_BEGIN and FEATURES_BIN_SPARSE_BEGIN share this prefix
+  if (FileStartsWith(filename, "FEATURES_BIN_BEGIN_")) {
+    m_bin.reset(new MappedDataFile(filename));
+  } else {
+    m_in.reset(new FilePiece(filename.c_str()));
+  }
   readNext();
 }
 
@@ -81,6 +131,10 @@ FeatureDataIterator::~FeatureDataIterator() {}
 
 void FeatureDataIterator::readNext()
 {
+  if (m_bin) {
+    readNextBinary();
+    return;
+  }
   m_next.clear();
   try {
     StringPiece marker = m_in->ReadDelimited();
@@ -123,6 +177,63 @@ void FeatureDataIterator::readNext()
   }
 }
 
+void FeatureDataIterator::readNextBinary()
+{
+  m_next.clear();
+  StringPiece header;
+  try {
+    header = m_bin->ReadLine();
+  } catch (EndOfFileException &e) {
+    m_bin.reset();
+    return;
+  }
+  TokenIter<SingleCharacter, true> token(header, ' ');
+  const bool with_sparse = (*token == StringPiece(FEATURES_BIN_SPARSE_BEGIN));
+  if (!with_sparse && *token != StringPiece(FEATURES_BIN_BEGIN)) {
+    throw FileFormatException(m_bin->FileName(), header.as_string());
+  }
+  size_t fields[3];
+  for (size_t i = 0; i < 3; ++i) {
+    if (!++token) throw FileFormatException(m_bin->FileName(), header.as_string());
+    fields[i] = ParseInt(*token);
+  }
+  const size_t count = fields[1];
+  const size_t length = fields[2];
+
+  const size_t bytes = length * sizeof(FeatureStatsType);
+  const char* dense = m_bin->Read(count * bytes);
+  m_next.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    m_next[i].dense.resize(length);
+    if (length) memcpy(&m_next[i].dense[0], dense + i * bytes, bytes);
+  }
+
+  if (with_sparse) {
+    vector<size_t> ids(m_bin->ReadUInt32());
+    for (size_t j = 0; j < ids.size(); ++j) {
+      size_t name_length = m_bin->ReadUInt32();
+      ids[j] = SparseVector::encode(string(m_bin->Read(name_length), name_length));
+    }
+    for (size_t i = 0; i < count; ++i) {
+      const uint32_t sparse_count = m_bin->ReadUInt32();
+      for (uint32_t j = 0; j < sparse_count; ++j) {
+        const uint32_t name_index = m_bin->ReadUInt32();
+        FeatureStatsType value;
+        memcpy(&value, m_bin->Read(sizeof(value)), sizeof(value));
+        if (name_index >= ids.size()) {
+          throw FileFormatException(m_bin->FileName(), header.as_string());
+        }
+        m_next[i].sparse.set(ids[name_index], value);
+      }
+    }
+  }
+
+  StringPiece line = m_bin->ReadLine();
+  if (line != StringPiece(FEATURES_BIN_END)) {
+    throw FileFormatException(m_bin->FileName(), line.as_string());
+  }
+}
+
 void FeatureDataIterator::increment()
 {
   readNext();
@@ -130,6 +241,11 @@ void FeatureDataIterator::increment()
 
 bool FeatureDataIterator::equal(const FeatureDataIterator& rhs) const
 {
+  if (m_bin || rhs.m_bin) {
+    return m_bin && rhs.m_bin &&
+           m_bin->FileName() == rhs.m_bin->FileName() &&
+           m_bin->Offset() == rhs.m_bin->Offset();
+  }
   if (!m_in && !rhs.m_in) {
     return true;
   } else if (!m_in) {
@@ -28,11 +28,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <map>
 #include <stdexcept>
 #include <vector>
+#include <stdint.h>
 
 #include <boost/iterator/iterator_facade.hpp>
 #include <boost/shared_ptr.hpp>
 
 #include "util/exception.hh"
+#include "util/mmap.hh"
 #include "util/string_piece.hh"
 
 #include "FeatureStats.h"
@@ -61,6 +63,39 @@ int ParseInt(const StringPiece& str );
 /** Assumes a delimiter, so only apply to tokens */
 float ParseFloat(const StringPiece& str);
 
+/** Whether the file starts with prefix; used to recognise binary files */
+bool FileStartsWith(const std::string& filename, const std::string& prefix);
+
+/**
+ * A memory mapped binary feature or score file (see FeatureArray::savebin()
+ * and ScoreArray::savebin()), read from the front without copying it.
+ */
+class MappedDataFile
+{
+public:
+  explicit MappedDataFile(const std::string& filename);
+
+  const std::string& FileName() const {
+    return m_filename;
+  }
+  std::size_t Offset() const {
+    return m_offset;
+  }
+
+  /** Next line without its newline; throws util::EndOfFileException at the end */
+  StringPiece ReadLine();
+
+  /** Next bytes; throws FileFormatException if the file ends before */
+  const char* Read(std::size_t bytes);
+
+  uint32_t ReadUInt32();
+
+private:
+  std::string m_filename;
+  util::scoped_memory m_mem;
+  std::size_t m_offset;
+};
+
 
 class FeatureDataItem
 {
@@ -95,8 +130,10 @@ private:
   const std::vector<FeatureDataItem>& dereference() const;
 
   void readNext();
+  void readNextBinary();
 
   boost::shared_ptr<util::FilePiece> m_in;
+  boost::shared_ptr<MappedDataFile> m_bin;
   std::vector<FeatureDataItem> m_next;
 };
 
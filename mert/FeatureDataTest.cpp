@@ -1,8 +1,11 @@
 #include "FeatureData.h"
+#include "FeatureDataIterator.h"
 
 #define BOOST_TEST_MODULE FeatureData
 #include <boost/test/unit_test.hpp>
 
+#include <cstdio>
+#include <fstream>
 #include <sstream>
 
 using namespace MosesTuning;
@@ -43,3 +46,105 @@ BOOST_AUTO_TEST_CASE(set_feature_map)
   BOOST_CHECK_EQUAL(feature_data.getFeatureIndex("w_0"), (std::size_t)cnt);
   BOOST_CHECK_EQUAL(feature_data.getFeatureName(cnt).c_str(), "w_0");
 }
+
+BOOST_AUTO_TEST_CASE(binary_sparse_features)
+{
+  FeatureArray array;
+  array.setIndex(3);
+  array.NumberOfFeatures(2);
+  array.Features("a_0 b_0");
+  std::string line("1 2 sparse_x=0.5 sparse_y=-1");
+  FeatureStats first(2);
+  first.set(line, SparseVector());
+  line = "3 4 sparse_y=2";
+  FeatureStats second(2);
+  second.set(line, SparseVector());
+  array.add(first);
+  array.add(second);
+
+  const char* file = "feature_data_test.bin";
+  {
+    std::ofstream out(file, std::ios::out | std::ios::binary);
+    array.save(&out, true);
+  }
+
+  FeatureData loaded;
+  loaded.load(file, SparseVector());
+  BOOST_REQUIRE_EQUAL(loaded.size(), (std::size_t)1);
+  const FeatureArray& loaded_array = loaded.get(0);
+  BOOST_CHECK_EQUAL(loaded_array.getIndex(), 3);
+  BOOST_REQUIRE_EQUAL(loaded_array.size(), (std::size_t)2);
+  BOOST_CHECK(loaded_array.get(0) == first);
+  BOOST_CHECK(loaded_array.get(0).getSparse() == first.getSparse());
+  BOOST_CHECK(loaded_array.get(1).getSparse() == second.getSparse());
+
+  FeatureDataIterator it(file);
+  BOOST_REQUIRE(it != FeatureDataIterator::end());
+  BOOST_REQUIRE_EQUAL(it->size(), (std::size_t)2);
+  BOOST_CHECK_EQUAL(it->at(1).dense.at(0), 3);
+  BOOST_CHECK_EQUAL(it->at(1).dense.at(1), 4);
+  BOOST_CHECK_EQUAL(it->at(0).sparse.get("sparse_x"), 0.5);
+  BOOST_CHECK_EQUAL(it->at(0).sparse.get("sparse_y"), -1);
+  BOOST_CHECK_EQUAL(it->at(1).sparse.get("sparse_x"), 0);
+  BOOST_CHECK_EQUAL(it->at(1).sparse.get("sparse_y"), 2);
+  ++it;
+  BOOST_CHECK(it == FeatureDataIterator::end());
+
+  std::remove(file);
+}
+
+BOOST_AUTO_TEST_CASE(binary_text_sparse_round_trip)
+{
+  FeatureArray array;
+  array.setIndex(0);
+  array.NumberOfFeatures(1);
+  array.Features("a_0");
+  // sparse feature names end with '=' as in the n-best lists
+  FeatureStats entry;
+  entry.add(0.25);
+  entry.addSparse("s_1=", 1);
+  entry.addSparse("s_2=", 2);
+  array.add(entry);
+  entry.reset();
+  entry.add(-1);
+  array.add(entry);
+  entry.reset();
+  entry.add(7);
+  entry.addSparse("s_3=", 0.125);
+  entry.addSparse("s_1=", -4);
+  array.add(entry);
+
+  const char* text_file = "feature_data_test.txt";
+  const char* bin_file = "feature_data_test_round_trip.bin";
+  {
+    std::ofstream text(text_file);
+    array.save(&text, false);
+    std::ofstream bin(bin_file, std::ios::out | std::ios::binary);
+    array.save(&bin, true);
+  }
+
+  SparseVector weights;
+  weights.set("s_1", 0.5);
+  FeatureData from_text, from_bin;
+  from_text.load(text_file, weights);
+  from_bin.load(bin_file, weights);
+  BOOST_REQUIRE_EQUAL(from_bin.size(), (std::size_t)1);
+  BOOST_REQUIRE_EQUAL(from_bin.get(0).size(), from_text.get(0).size());
+  for (std::size_t i = 0; i < from_text.get(0).size(); ++i) {
+    const FeatureStats& text = from_text.get(0).get(i);
+    const FeatureStats& bin = from_bin.get(0).get(i);
+    BOOST_CHECK(bin == text);
+    BOOST_CHECK(bin.getSparse() == text.getSparse());
+  }
+
+  FeatureDataIterator text_it(text_file), bin_it(bin_file);
+  BOOST_REQUIRE(text_it != FeatureDataIterator::end());
+  BOOST_REQUIRE(bin_it != FeatureDataIterator::end());
+  BOOST_REQUIRE_EQUAL(bin_it->size(), text_it->size());
+  for (std::size_t i = 0; i < text_it->size(); ++i) {
+    BOOST_CHECK(bin_it->at(i) == text_it->at(i));
+  }
+
+  std::remove(text_file);
+  std::remove(bin_file);
+}
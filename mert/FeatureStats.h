@@ -31,6 +31,7 @@ public:
   FeatureStatsType get(const std::string& name) const;
   FeatureStatsType get(std::size_t id) const;
   void set(const std::string& name, FeatureStatsType value);
+  void set(std::size_t id, FeatureStatsType value);
   void clear();
   void load(const std::string& file);
   std::size_t size() const {
@@ -87,6 +88,11 @@ public:
   void expand();
   void add(FeatureStatsType v);
   void addSparse(const std::string& name, FeatureStatsType v);
+  void addSparse(std::size_t id, FeatureStatsType v);
+
+  // Replace the sparse features by their dot product with sparseWeights,
+  // if it is not empty
+  void mergeSparse(const SparseVector& sparseWeights);
 
   void clear() {
     memset((void*)m_array, 0, GetArraySizeWithBytes());
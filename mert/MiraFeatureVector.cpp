@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 
@@ -90,6 +91,19 @@ ValType MiraFeatureVector::sqrNorm() const
   return toRet;
 }
 
+ValType MiraFeatureVector::innerProduct(const vector<ValType>& weights) const
+{
+  // Walk the dense values, then the ascending sparse indexes until the first
+  // one without a weight
+  ValType toRet = 0.0;
+  const size_t numDense = min(m_dense.size(), weights.size());
+  for(size_t i=0; i<numDense; i++)
+    toRet += weights[i] * m_dense[i];
+  for(size_t i=0; i<m_sparseFeats.size() && m_sparseFeats[i] < weights.size(); i++)
+    toRet += weights[m_sparseFeats[i]] * m_sparseVals[i];
+  return toRet;
+}
+
 MiraFeatureVector operator-(const MiraFeatureVector& a, const MiraFeatureVector& b)
 {
   // Dense subtraction
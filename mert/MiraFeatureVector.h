@@ -37,6 +37,12 @@ public:
   std::size_t size() const;
   ValType sqrNorm() const;
 
+  /**
+   * Inner product with a weight array indexed like feat(), weights past
+   * its end count as zero
+   */
+  ValType innerProduct(const std::vector<ValType>& weights) const;
+
   friend MiraFeatureVector operator-(const MiraFeatureVector& a,
                                      const MiraFeatureVector& b);
 
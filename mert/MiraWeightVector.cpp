@@ -58,15 +58,11 @@ void MiraWeightVector::tick()
  */
 ValType MiraWeightVector::score(const MiraFeatureVector& fv) const
 {
-  ValType toRet = 0.0;
-  for(size_t i=0; i<fv.size(); i++) {
-    toRet += weight(fv.feat(i)) * fv.val(i);
-  }
-  return toRet;
+  return fv.innerProduct(m_weights);
 }
 
 /**
- * Return an averaged view of this weight vector
+ * Return the average of this weight vector over all updates so far
  */
 AvgWeightVector MiraWeightVector::avg()
 {
@@ -123,8 +119,13 @@ ValType MiraWeightVector::sqrNorm() const
 }
 
 AvgWeightVector::AvgWeightVector(const MiraWeightVector& wv)
-  :m_wv(wv)
-{}
+  :m_weights(wv.m_weights)
+{
+  if(wv.m_numUpdates>0) {
+    for(size_t i=0; i<m_weights.size(); i++)
+      m_weights[i] = wv.m_totals[i] / wv.m_numUpdates;
+  }
+}
 
 ostream& operator<<(ostream& o, const MiraWeightVector& e)
 {
@@ -139,28 +140,21 @@ ostream& operator<<(ostream& o, const MiraWeightVector& e)
 
 ValType AvgWeightVector::weight(size_t index) const
 {
-  if(m_wv.m_numUpdates==0) return m_wv.weight(index);
-  else {
-    if(index < m_wv.m_totals.size()) {
-      return m_wv.m_totals[index] / m_wv.m_numUpdates;
-    } else {
-      return 0;
-    }
+  if(index < m_weights.size()) {
+    return m_weights[index];
+  } else {
+    return 0;
   }
 }
 
 ValType AvgWeightVector::score(const MiraFeatureVector& fv) const
 {
-  ValType toRet = 0.0;
-  for(size_t i=0; i<fv.size(); i++) {
-    toRet += weight(fv.feat(i)) * fv.val(i);
-  }
-  return toRet;
+  return fv.innerProduct(m_weights);
 }
 
 size_t AvgWeightVector::size() const
 {
-  return m_wv.m_weights.size();
+  return m_weights.size();
 }
 
 // --Emacs trickery--
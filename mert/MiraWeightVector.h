@@ -59,7 +59,7 @@ public:
   ValType sqrNorm() const;
 
   /**
-   * Return an averaged view of this weight vector
+   * Return the average of this weight vector over all updates so far
    */
   AvgWeightVector avg();
 
@@ -90,7 +90,7 @@ private:
 };
 
 /**
- * Averaged view of a weight vector
+ * Averaged copy of a weight vector, taken when it is constructed
  */
 class AvgWeightVector
 {
@@ -100,7 +100,7 @@ public:
   ValType weight(std::size_t index) const;
   std::size_t size() const;
 private:
-  const MiraWeightVector& m_wv;
+  std::vector<ValType> m_weights;
 };
 
 
@@ -18,6 +18,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 ***********************************************************************/
 #include <iostream>
 
+#include <cstring>
+
 #include "util/file_piece.hh"
 #include "util/tokenize_piece.hh"
 
@@ -35,7 +37,11 @@ ScoreDataIterator::ScoreDataIterator() {}
 
 ScoreDataIterator::ScoreDataIterator(const string& filename)
 {
-  m_in.reset(new FilePiece(filename.c_str()));
+  if (FileStartsWith(filename, SCORES_BIN_BEGIN)) {
+    m_bin.reset(new MappedDataFile(filename));
+  } else {
+    m_in.reset(new FilePiece(filename.c_str()));
+  }
   readNext();
 }
 
@@ -43,6 +49,10 @@ ScoreDataIterator::~ScoreDataIterator() {}
 
 void ScoreDataIterator::readNext()
 {
+  if (m_bin) {
+    readNextBinary();
+    return;
+  }
   m_next.clear();
   try {
     StringPiece marker = m_in->ReadDelimited();
@@ -73,6 +83,47 @@ void ScoreDataIterator::readNext()
   }
 }
 
+void ScoreDataIterator::readNextBinary()
+{
+  m_next.clear();
+  StringPiece header;
+  try {
+    header = m_bin->ReadLine();
+  } catch (EndOfFileException& e) {
+    m_bin.reset();
+    return;
+  }
+  TokenIter<SingleCharacter, true> token(header, ' ');
+  if (*token != StringPiece(SCORES_BIN_BEGIN)) {
+    throw FileFormatException(m_bin->FileName(), header.as_string());
+  }
+  size_t fields[3];
+  for (size_t i = 0; i < 3; ++i) {
+    if (!++token) throw FileFormatException(m_bin->FileName(), header.as_string());
+    fields[i] = ParseInt(*token);
+  }
+  const size_t count = fields[1];
+  const size_t length = fields[2];
+
+  const char* data = m_bin->Read(count * length * sizeof(ScoreStatsType));
+  m_next.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    ScoreDataItem& item = m_next[i];
+    item.resize(length);
+    for (size_t j = 0; j < length; ++j) {
+      ScoreStatsType value;
+      memcpy(&value, data, sizeof(value));
+      data += sizeof(value);
+      item[j] = value;
+    }
+  }
+
+  StringPiece line = m_bin->ReadLine();
+  if (line != StringPiece(SCORES_BIN_END)) {
+    throw FileFormatException(m_bin->FileName(), line.as_string());
+  }
+}
+
 void ScoreDataIterator::increment()
 {
   readNext();
@@ -81,6 +132,11 @@ void ScoreDataIterator::increment()
 
 bool ScoreDataIterator::equal(const ScoreDataIterator& rhs) const
 {
+  if (m_bin || rhs.m_bin) {
+    return m_bin && rhs.m_bin &&
+           m_bin->FileName() == rhs.m_bin->FileName() &&
+           m_bin->Offset() == rhs.m_bin->Offset();
+  }
   if (!m_in && !rhs.m_in) {
     return true;
   } else if (!m_in) {
@@ -67,8 +67,10 @@ private:
   const std::vector<ScoreDataItem>& dereference() const;
 
   void readNext();
+  void readNextBinary();
 
   boost::shared_ptr<util::FilePiece> m_in;
+  boost::shared_ptr<MappedDataFile> m_bin;
   std::vector<ScoreDataItem> m_next;
 };
 
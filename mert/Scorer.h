@@ -113,6 +113,14 @@ public:
     return false;
   };
 
+  /**
+   * The scorer returns if prepareStats() may be called for several
+   * sentences at the same time, once the references are loaded
+   **/
+  virtual bool prepareStatsIsThreadSafe() const {
+    return false;
+  }
+
   /**
    * Set the factors, which should be used for this metric
    */
@@ -162,6 +170,13 @@ protected:
     }
   }
 
+  /**
+   * Return true iff a unix filter preprocesses the sentences
+   */
+  bool hasFilter() const {
+    return m_filter != NULL;
+  }
+
   /**
    * Tokenise line and encode.
    * Note: We assume that all tokens are separated by whitespaces.
@@ -39,6 +39,9 @@ void usage()
   cerr << "[--factors|-f] list of factors passed to the scorer (e.g. 0|2)" << endl;
   cerr << "[--filter|-l] filter command used to preprocess the sentences" << endl;
   cerr << "[--allow-duplicates|-d] omit the duplicate removal step" << endl;
+#ifdef WITH_THREADS
+  cerr << "[--threads|-T] score the nbest entries with multiple threads (default 1)" << endl;
+#endif
   cerr << "[-v] verbose level" << endl;
   cerr << "[--help|-h] print this message and exit" << endl;
   exit(1);
@@ -59,6 +62,9 @@ static struct option long_options[] = {
   {"verbose", required_argument, 0, 'v'},
   {"help", no_argument, 0, 'h'},
   {"allow-duplicates", no_argument, 0, 'd'},
+#ifdef WITH_THREADS
+  {"threads", required_argument, 0, 'T'},
+#endif
   {0, 0, 0, 0}
 };
 
@@ -77,6 +83,7 @@ struct ProgramOption {
   bool binmode;
   bool allowDuplicates;
   int verbosity;
+  size_t num_threads;
 
   ProgramOption()
     : scorerType("BLEU"),
@@ -91,7 +98,8 @@ struct ProgramOption {
       prevFeatureDataFile(""),
       binmode(false),
       allowDuplicates(false),
-      verbosity(0) { }
+      verbosity(0),
+      num_threads(1) { }
 };
 
 void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
@@ -99,7 +107,7 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
   int c;
   int option_index;
 
-  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:hbd", long_options, &option_index)) != -1) {
+  while ((c = getopt_long(argc, argv, "s:r:f:l:n:S:F:R:E:v:T:hbd", long_options, &option_index)) != -1) {
     switch (c) {
     case 's':
       opt->scorerType = string(optarg);
@@ -140,6 +148,17 @@ void ParseCommandOptions(int argc, char** argv, ProgramOption* opt)
     case 'd':
       opt->allowDuplicates = true;
       break;
+#ifdef WITH_THREADS
+    case 'T': {
+      const long threads = strtol(optarg, NULL, 10);
+      if (threads < 1) {
+        cerr << "Error: --threads must be at least 1" << endl;
+        exit(1);
+      }
+      opt->num_threads = threads;
+      break;
+    }
+#endif
     default:
       usage();
     }
@@ -227,7 +246,7 @@ int main(int argc, char** argv)
 
     // computing score statistics of each nbest file
     for (size_t i = 0; i < nbestFiles.size(); i++) {
-      data.loadNBest(nbestFiles.at(i));
+      data.loadNBest(nbestFiles.at(i), option.num_threads);
     }
 
 //    PrintUserTime("Nbest entries loaded and scored");
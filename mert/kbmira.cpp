@@ -44,38 +44,283 @@ de recherches du Canada
 #include "MiraFeatureVector.h"
 #include "MiraWeightVector.h"
 
+#ifdef WITH_THREADS
+#include "moses/ThreadPool.h"
+#endif
+
 using namespace std;
 using namespace MosesTuning;
 
 namespace po = boost::program_options;
 
-ValType evaluate(HypPackEnumerator* train, const AvgWeightVector& wv)
+namespace
 {
-  vector<ValType> stats(kBleuNgramOrder*2+1,0);
-  for(train->reset(); !train->finished(); train->next()) {
-    // Find max model
+
+const ValType BLEU_RATIO = 5;
+
+//! sentences per batch when evaluating n-best lists that are kept in memory
+const size_t kEvaluateBatchSize = 1000;
+
+/**
+ * The hypotheses of one sentence. Points into the enumerator, so it is only
+ * valid until the enumerator moves past the sentence (streaming) or is
+ * reset (in memory).
+ */
+struct HypPack {
+  std::size_t id;
+  std::vector<const MiraFeatureVector*> features;
+  std::vector<const ScoreDataItem*> scores;
+
+  void load(HypPackEnumerator& train) {
+    id = train.cur_id();
+    features.resize(train.cur_size());
+    scores.resize(train.cur_size());
+    for(size_t i=0; i<features.size(); i++) {
+      features[i] = &train.featuresAt(i);
+      scores[i] = &train.scoresAt(i);
+    }
+  }
+};
+
+/**
+ * Load the current sentence and up to packs.size()-1 following ones. The
+ * enumerator is left on the last sentence loaded. Returns their number.
+ */
+size_t loadBatch(HypPackEnumerator& train, vector<HypPack>& packs)
+{
+  size_t n = 0;
+  while(true) {
+    packs[n++].load(train);
+    if(n==packs.size()) break;
+    train.next();
+    if(train.finished()) break;
+  }
+  return n;
+}
+
+//! work done for each sentence of a batch, possibly in parallel
+class PackProcessor
+{
+public:
+  virtual ~PackProcessor() {}
+  virtual void process(size_t k) = 0;
+};
+
+#ifdef WITH_THREADS
+//! lets the main thread wait for the tasks of a batch
+class TaskCounter
+{
+public:
+  TaskCounter() : m_count(0) {}
+  void add() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    ++m_count;
+  }
+  void done() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if(--m_count==0) m_cond.notify_all();
+  }
+  void wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while(m_count>0) m_cond.wait(lock);
+  }
+private:
+  size_t m_count;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+};
+
+//! processes sentences [begin,end) of a batch
+class SliceTask : public Moses::Task
+{
+public:
+  SliceTask(PackProcessor& processor, size_t begin, size_t end, TaskCounter& counter)
+    : m_processor(processor), m_begin(begin), m_end(end), m_counter(counter) {}
+  void Run() {
+    for(size_t k=m_begin; k<m_end; k++) m_processor.process(k);
+    m_counter.done();
+  }
+private:
+  PackProcessor& m_processor;
+  size_t m_begin, m_end;
+  TaskCounter& m_counter;
+};
+#endif
+
+//! runs a PackProcessor over the sentences of a batch, split across threads
+class PackRunner
+{
+public:
+  explicit PackRunner(size_t threads) : m_threads(threads) {
+#ifdef WITH_THREADS
+    if(m_threads>1) m_pool.reset(new Moses::ThreadPool(m_threads));
+#endif
+  }
+
+  void run(PackProcessor& processor, size_t n) {
+#ifdef WITH_THREADS
+    if(m_pool && n>1) {
+      TaskCounter counter;
+      const size_t slices = min(m_threads, n);
+      for(size_t s=0; s<slices; s++) {
+        counter.add();
+        m_pool->Submit(new SliceTask(processor, n*s/slices, n*(s+1)/slices, counter));
+      }
+      counter.wait();
+      return;
+    }
+#endif
+    for(size_t k=0; k<n; k++) processor.process(k);
+  }
+
+private:
+  size_t m_threads;
+#ifdef WITH_THREADS
+  boost::scoped_ptr<Moses::ThreadPool> m_pool;
+#endif
+};
+
+//! finds the hypothesis with the highest model score
+class ModelBestFinder : public PackProcessor
+{
+public:
+  ModelBestFinder(const AvgWeightVector& wv, const vector<HypPack>& packs, vector<size_t>& best)
+    : m_wv(wv), m_packs(packs), m_best(best) {}
+
+  void process(size_t k) {
+    const HypPack& pack = m_packs[k];
     size_t max_index=0;
     ValType max_score=0;
-    for(size_t i=0; i<train->cur_size(); i++) {
-      MiraFeatureVector vec(train->featuresAt(i));
-      ValType score = wv.score(vec);
+    for(size_t i=0; i<pack.features.size(); i++) {
+      ValType score = m_wv.score(*pack.features[i]);
       if(i==0 || score > max_score) {
         max_index = i;
         max_score = score;
       }
     }
+    m_best[k] = max_index;
+  }
+
+private:
+  const AvgWeightVector& m_wv;
+  const vector<HypPack>& m_packs;
+  vector<size_t>& m_best;
+};
+
+//! hope, fear and model hypotheses of a sentence and the update they ask for
+struct MiraUpdate {
+  size_t hope_index, fear_index, model_index;
+  ValType hope_scale;
+  ValType hopeBleu, fearBleu;
+  MiraFeatureVector diff;
+  ValType diff_score;
+  ValType loss;
+
+  MiraUpdate() : diff(vector<ValType>(), vector<size_t>(), vector<ValType>()) {}
+};
+
+/**
+ * Hope/fear decoding against fixed weights and background corpus, so the
+ * sentences of a batch can be decoded in parallel
+ */
+class HopeFearDecoder : public PackProcessor
+{
+public:
+  HopeFearDecoder(const MiraWeightVector& wv, const vector<ValType>& bg, bool safe_hope,
+                  const vector<HypPack>& packs, vector<MiraUpdate>& updates)
+    : m_wv(wv), m_bg(bg), m_safe_hope(safe_hope), m_packs(packs), m_updates(updates) {}
+
+  void process(size_t k) {
+    const HypPack& pack = m_packs[k];
+    MiraUpdate& update = m_updates[k];
+    // Hope / fear decode
+    ValType hope_scale = 1.0;
+    size_t hope_index=0, fear_index=0, model_index=0;
+    ValType hope_score=0, fear_score=0, model_score=0;
+    for(size_t safe_loop=0; safe_loop<2; safe_loop++) {
+      ValType hope_bleu, hope_model;
+      for(size_t i=0; i< pack.features.size(); i++) {
+        const MiraFeatureVector& vec=*pack.features[i];
+        ValType score = m_wv.score(vec);
+        ValType bleu = sentenceLevelBackgroundBleu(*pack.scores[i],m_bg);
+        // Hope
+        if(i==0 || (hope_scale*score + bleu) > hope_score) {
+          hope_score = hope_scale*score + bleu;
+          hope_index = i;
+          hope_bleu = bleu;
+          hope_model = score;
+        }
+        // Fear
+        if(i==0 || (score - bleu) > fear_score) {
+          fear_score = score - bleu;
+          fear_index = i;
+        }
+        // Model
+        if(i==0 || score > model_score) {
+          model_score = score;
+          model_index = i;
+        }
+      }
+      // Outer loop rescales the contribution of model score to 'hope' in antagonistic cases
+      // where model score is having far more influence than BLEU
+      hope_bleu *= BLEU_RATIO; // We only care about cases where model has MUCH more influence than BLEU
+      if(m_safe_hope && safe_loop==0 && abs(hope_model)>1e-8 && abs(hope_bleu)/abs(hope_model)<hope_scale)
+        hope_scale = abs(hope_bleu) / abs(hope_model);
+      else break;
+    }
+    update.hope_index = hope_index;
+    update.fear_index = fear_index;
+    update.model_index = model_index;
+    update.hope_scale = hope_scale;
+    if(hope_index!=fear_index) {
+      // Vector difference
+      const MiraFeatureVector& hope=*pack.features[hope_index];
+      const MiraFeatureVector& fear=*pack.features[fear_index];
+      update.diff = hope - fear;
+      // Bleu difference
+      update.hopeBleu = sentenceLevelBackgroundBleu(*pack.scores[hope_index], m_bg);
+      update.fearBleu = sentenceLevelBackgroundBleu(*pack.scores[fear_index], m_bg);
+      assert(update.hopeBleu + 1e-8 >= update.fearBleu);
+      ValType delta = update.hopeBleu - update.fearBleu;
+      // Loss
+      update.diff_score = m_wv.score(update.diff);
+      update.loss = delta - update.diff_score;
+    }
+  }
+
+private:
+  const MiraWeightVector& m_wv;
+  const vector<ValType>& m_bg;
+  bool m_safe_hope;
+  const vector<HypPack>& m_packs;
+  vector<MiraUpdate>& m_updates;
+};
+
+ValType evaluate(HypPackEnumerator* train, const AvgWeightVector& wv, PackRunner& runner, size_t batch_size)
+{
+  vector<ValType> stats(kBleuNgramOrder*2+1,0);
+  vector<HypPack> packs(batch_size);
+  vector<size_t> best(batch_size);
+  ModelBestFinder finder(wv, packs, best);
+  for(train->reset(); !train->finished(); train->next()) {
+    // Find max model
+    size_t n = loadBatch(*train, packs);
+    runner.run(finder, n);
     // Update stats
-    const vector<float>& sent = train->scoresAt(max_index);
-    for(size_t i=0; i<sent.size(); i++) {
-      stats[i]+=sent[i];
+    for(size_t k=0; k<n; k++) {
+      const vector<float>& sent = *packs[k].scores[best[k]];
+      for(size_t i=0; i<sent.size(); i++) {
+        stats[i]+=sent[i];
+      }
     }
   }
   return unsmoothedBleu(stats);
 }
 
+}
+
 int main(int argc, char** argv)
 {
-  const ValType BLEU_RATIO = 5;
   bool help;
   string denseInitFile;
   string sparseInitFile;
@@ -91,6 +336,8 @@ int main(int argc, char** argv)
   bool model_bg = false; // Use model for background corpus
   bool verbose = false; // Verbose updates
   bool safe_hope = false; // Model score cannot have more than BLEU_RATIO times more influence than BLEU
+  size_t batch_size = 1; // Sentences decoded with the same weights
+  size_t threads = 1; // Threads for decoding a batch and for evaluation
 
   // Command-line processing follows pro.cpp
   po::options_description desc("Allowed options");
@@ -110,6 +357,8 @@ int main(int argc, char** argv)
   ("model-bg", po::value(&model_bg)->zero_tokens()->default_value(false), "Use model instead of hope for BLEU background")
   ("verbose", po::value(&verbose)->zero_tokens()->default_value(false), "Verbose updates")
   ("safe-hope", po::value(&safe_hope)->zero_tokens()->default_value(false), "Mode score's influence on hope decoding is limited")
+  ("batch-size,b", po::value<size_t>(&batch_size), "Number of sentences hope/fear decoded with the same weights before their updates are applied in order (default 1)")
+  ("threads,T", po::value<size_t>(&threads), "Number of threads for hope/fear decoding of a batch and for evaluation (default 1)")
   ;
 
   po::options_description cmdline_options;
@@ -126,6 +375,21 @@ int main(int argc, char** argv)
 
   cerr << "kbmira with c=" << c << " decay=" << decay << " no_shuffle=" << no_shuffle << endl;
 
+  if(batch_size<1) batch_size = 1;
+  if(threads<1) threads = 1;
+#ifndef WITH_THREADS
+  if(threads>1) {
+    cerr << "Compiled without threads, using one thread" << endl;
+    threads = 1;
+  }
+#endif
+  if(streaming && batch_size>1) {
+    cerr << "Error: --batch-size requires n-best lists in memory, not --streaming" << endl;
+    exit(1);
+  }
+  if(threads>1 && batch_size==1)
+    cerr << "Warning: only evaluation uses several threads unless --batch-size is set" << endl;
+
   if (vm.count("random-seed")) {
     cerr << "Initialising random seed to " << seed << endl;
     srand(seed);
@@ -194,95 +458,60 @@ int main(int argc, char** argv)
     train.reset(new StreamingHypPackEnumerator(featureFiles, scoreFiles));
   else
     train.reset(new RandomAccessHypPackEnumerator(featureFiles, scoreFiles, no_shuffle));
-  cerr << "Initial BLEU = " << evaluate(train.get(), wv.avg()) << endl;
+  PackRunner runner(threads);
+  const size_t eval_batch_size = streaming ? 1 : kEvaluateBatchSize;
+  cerr << "Initial BLEU = " << evaluate(train.get(), wv.avg(), runner, eval_batch_size) << endl;
   ValType bestBleu = 0;
+  vector<HypPack> packs(batch_size);
+  vector<MiraUpdate> updates(batch_size);
+  HopeFearDecoder decoder(wv, bg, safe_hope, packs, updates);
   for(int j=0; j<n_iters; j++) {
     // MIRA train for one epoch
-    int iNumHyps = 0;
     int iNumExamples = 0;
     int iNumUpdates = 0;
     ValType totalLoss = 0.0;
     for(train->reset(); !train->finished(); train->next()) {
-      // Hope / fear decode
-      ValType hope_scale = 1.0;
-      size_t hope_index=0, fear_index=0, model_index=0;
-      ValType hope_score=0, fear_score=0, model_score=0;
-      int iNumHypsBackup = iNumHyps;
-      for(size_t safe_loop=0; safe_loop<2; safe_loop++) {
-        iNumHyps = iNumHypsBackup;
-        ValType hope_bleu, hope_model;
-        for(size_t i=0; i< train->cur_size(); i++) {
-          const MiraFeatureVector& vec=train->featuresAt(i);
-          ValType score = wv.score(vec);
-          ValType bleu = sentenceLevelBackgroundBleu(train->scoresAt(i),bg);
-          // Hope
-          if(i==0 || (hope_scale*score + bleu) > hope_score) {
-            hope_score = hope_scale*score + bleu;
-            hope_index = i;
-            hope_bleu = bleu;
-            hope_model = score;
+      // Hope / fear decode the batch
+      size_t n = loadBatch(*train, packs);
+      runner.run(decoder, n);
+      for(size_t b=0; b<n; b++) {
+        const HypPack& pack = packs[b];
+        const MiraUpdate& update = updates[b];
+        // Update weights
+        if(update.hope_index!=update.fear_index) {
+          const MiraFeatureVector& hope=*pack.features[update.hope_index];
+          const MiraFeatureVector& fear=*pack.features[update.fear_index];
+          const MiraFeatureVector& diff=update.diff;
+          const vector<float>& hope_stats = *pack.scores[update.hope_index];
+          ValType delta = update.hopeBleu - update.fearBleu;
+          ValType loss = update.loss;
+          if(verbose) {
+            cerr << "Updating sent " << pack.id << endl;
+            cerr << "Wght: " << wv << endl;
+            cerr << "Hope: " << hope << " BLEU:" << update.hopeBleu << " Score:" << wv.score(hope) << endl;
+            cerr << "Fear: " << fear << " BLEU:" << update.fearBleu << " Score:" << wv.score(fear) << endl;
+            cerr << "Diff: " << diff << " BLEU:" << delta << " Score:" << update.diff_score << endl;
+            cerr << "Loss: " << loss << " Scale: " << update.hope_scale << endl;
+            cerr << endl;
           }
-          // Fear
-          if(i==0 || (score - bleu) > fear_score) {
-            fear_score = score - bleu;
-            fear_index = i;
+          if(loss > 0) {
+            ValType eta = min(c, loss / diff.sqrNorm());
+            wv.update(diff,eta);
+            totalLoss+=loss;
+            iNumUpdates++;
           }
-          // Model
-          if(i==0 || score > model_score) {
-            model_score = score;
-            model_index = i;
+          // Update BLEU statistics
+          const vector<float>& model_stats = *pack.scores[update.model_index];
+          for(size_t k=0; k<bg.size(); k++) {
+            bg[k]*=decay;
+            if(model_bg)
+              bg[k]+=model_stats[k];
+            else
+              bg[k]+=hope_stats[k];
           }
-          iNumHyps++;
-        }
-        // Outer loop rescales the contribution of model score to 'hope' in antagonistic cases
-        // where model score is having far more influence than BLEU
-        hope_bleu *= BLEU_RATIO; // We only care about cases where model has MUCH more influence than BLEU
-        if(safe_hope && safe_loop==0 && abs(hope_model)>1e-8 && abs(hope_bleu)/abs(hope_model)<hope_scale)
-          hope_scale = abs(hope_bleu) / abs(hope_model);
-        else break;
-      }
-      // Update weights
-      if(hope_index!=fear_index) {
-        // Vector difference
-        const MiraFeatureVector& hope=train->featuresAt(hope_index);
-        const MiraFeatureVector& fear=train->featuresAt(fear_index);
-        MiraFeatureVector diff = hope - fear;
-        // Bleu difference
-        const vector<float>& hope_stats = train->scoresAt(hope_index);
-        ValType hopeBleu = sentenceLevelBackgroundBleu(hope_stats, bg);
-        const vector<float>& fear_stats = train->scoresAt(fear_index);
-        ValType fearBleu = sentenceLevelBackgroundBleu(fear_stats, bg);
-        assert(hopeBleu + 1e-8 >= fearBleu);
-        ValType delta = hopeBleu - fearBleu;
-        // Loss and update
-        ValType diff_score = wv.score(diff);
-        ValType loss = delta - diff_score;
-        if(verbose) {
-          cerr << "Updating sent " << train->cur_id() << endl;
-          cerr << "Wght: " << wv << endl;
-          cerr << "Hope: " << hope << " BLEU:" << hopeBleu << " Score:" << wv.score(hope) << endl;
-          cerr << "Fear: " << fear << " BLEU:" << fearBleu << " Score:" << wv.score(fear) << endl;
-          cerr << "Diff: " << diff << " BLEU:" << delta << " Score:" << diff_score << endl;
-          cerr << "Loss: " << loss << " Scale: " << hope_scale << endl;
-          cerr << endl;
-        }
-        if(loss > 0) {
-          ValType eta = min(c, loss / diff.sqrNorm());
-          wv.update(diff,eta);
-          totalLoss+=loss;
-          iNumUpdates++;
-        }
-        // Update BLEU statistics
-        const vector<float>& model_stats = train->scoresAt(model_index);
-        for(size_t k=0; k<bg.size(); k++) {
-          bg[k]*=decay;
-          if(model_bg)
-            bg[k]+=model_stats[k];
-          else
-            bg[k]+=hope_stats[k];
         }
+        iNumExamples++;
       }
-      iNumExamples++;
     }
     // Training Epoch summary
     cerr << iNumUpdates << "/" << iNumExamples << " updates"
@@ -291,7 +520,7 @@ int main(int argc, char** argv)
 
     // Evaluate current average weights
     AvgWeightVector avg = wv.avg();
-    ValType bleu = evaluate(train.get(), avg);
+    ValType bleu = evaluate(train.get(), avg, runner, eval_batch_size);
     cerr << ", BLEU = " << bleu << endl;
     if(bleu > bestBleu) {
       size_t num_dense = train->num_dense();
@@ -0,0 +1,403 @@
+// Filters a phrase table or a lexical reordering table to the source phrases
+// that occur in an input text, like scripts/training/filter-model-given-input.pl
+// does for a single table. Text tables (optionally gzipped) are streamed and
+// filtered in chunks on several threads. Compact tables (.minphr, .minlexr)
+// are filtered into a compact table directly, see CompactTableFilter.
+
+#include <iostream>
+#include <string>
+#include <deque>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
+#include "moses/InputFileStream.h"
+#include "moses/ThreadPool.h"
+#include "moses/Util.h"
+#include "moses/TranslationModel/CompactPT/CompactTableFilter.h"
+
+using namespace Moses;
+
+namespace
+{
+
+// Number of table lines filtered together by one thread.
+const size_t kBlockLines = 10000;
+
+void printHelp(char **argv)
+{
+  std::cerr << "Usage " << argv[0] << ":\n"
+            "  options: \n"
+            "\t-input string     -- input text, may be gzipped\n"
+            "\t-in string        -- table to filter: text table (may be gzipped),\n"
+            "\t                     compact phrase table (.minphr) or compact\n"
+            "\t                     reordering table (.minlexr)\n"
+            "\t-out string       -- filtered table, gzipped if it ends in .gz\n"
+            "\t-factors string   -- input factors of the table, e.g. 0,1 (default 0)\n"
+            "\t-max-length int   -- longest source phrase considered (default 10)\n"
+            "\t-min-score string -- id:threshold[,id:threshold]*, drop phrase pairs\n"
+            "\t                     with lower scores (text phrase tables only)\n"
+            "\t-source-only      -- the compact reordering table is conditioned on\n"
+            "\t                     the source phrase only (type *-f)\n"
+#ifdef WITH_THREADS
+            "\t-threads int|all  -- number of threads used for filtering\n"
+#endif
+            "\n";
+}
+
+// Trie of the n-grams of the input text up to a maximum length.
+class NGramTrie
+{
+public:
+  NGramTrie() : m_nodes(1) {}
+
+  void AddSentence(const std::vector<std::string> &words, size_t maxLength) {
+    for(size_t start = 0; start < words.size(); ++start) {
+      size_t node = 0;
+      for(size_t end = start; end < words.size() && end - start < maxLength; ++end)
+        node = AddChild(node, words[end]);
+    }
+  }
+
+  //! whether the words, separated by white space, are an n-gram of the input
+  bool Contains(const std::string &phrase) const {
+    const std::string delimiters(" \t");
+    size_t node = 0;
+    size_t start = phrase.find_first_not_of(delimiters);
+    if(start == std::string::npos)
+      return false;
+    while(start != std::string::npos) {
+      size_t end = phrase.find_first_of(delimiters, start);
+      Children::const_iterator child =
+        m_nodes[node].find(phrase.substr(start, end - start));
+      if(child == m_nodes[node].end())
+        return false;
+      node = child->second;
+      start = phrase.find_first_not_of(delimiters, end);
+    }
+    return true;
+  }
+
+  //! all n-grams, words separated by single spaces
+  void GetPhrases(std::vector<std::string> &phrases) const {
+    GetPhrases(0, "", phrases);
+  }
+
+private:
+  typedef boost::unordered_map<std::string, size_t> Children;
+  std::vector<Children> m_nodes;
+
+  size_t AddChild(size_t node, const std::string &word) {
+    Children::const_iterator child = m_nodes[node].find(word);
+    if(child != m_nodes[node].end())
+      return child->second;
+    size_t id = m_nodes.size();
+    m_nodes[node][word] = id;
+    m_nodes.push_back(Children());
+    return id;
+  }
+
+  void GetPhrases(size_t node, const std::string &prefix,
+                  std::vector<std::string> &phrases) const {
+    for(Children::const_iterator child = m_nodes[node].begin();
+        child != m_nodes[node].end(); ++child) {
+      std::string phrase = prefix.empty() ? child->first : prefix + " " + child->first;
+      phrases.push_back(phrase);
+      GetPhrases(child->second, phrase, phrases);
+    }
+  }
+};
+
+// Projects a factored input word like "haus|NN|haus" onto the given factors.
+std::string ProjectWord(const std::string &word, const std::vector<size_t> &factors)
+{
+  std::vector<std::string> wordFactors = TokenizeMultiCharSeparator(word, "|");
+  std::string projected;
+  for(size_t i = 0; i < factors.size(); ++i) {
+    if(factors[i] >= wordFactors.size()) {
+      std::cerr << "ERROR: word " << word << " has no factor " << factors[i] << std::endl;
+      exit(1);
+    }
+    if(i)
+      projected += "|";
+    projected += wordFactors[factors[i]];
+  }
+  return projected;
+}
+
+typedef std::vector<std::pair<size_t, float> > MinScores;
+
+// Whether the phrase pair on a line of a text table is kept.
+bool KeepLine(const std::string &line, const NGramTrie &trie, const MinScores &minScores)
+{
+  size_t separator = line.find("|||");
+  if(separator == std::string::npos || !trie.Contains(line.substr(0, separator)))
+    return false;
+
+  if(minScores.size()) {
+    std::vector<std::string> fields;
+    TokenizeMultiCharSeparator(fields, line, "|||");
+    // do not filter reordering tables
+    if(fields.size() > 3) {
+      std::vector<std::string> scores = Tokenize(fields[2]);
+      for(MinScores::const_iterator it = minScores.begin(); it != minScores.end(); ++it) {
+        // missing scores count as 0 like in filter-model-given-input.pl
+        float score = it->first < scores.size() ? Scan<float>(scores[it->first]) : 0;
+        if(score < it->second)
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Consecutive lines of a text table and the ones of them that are kept.
+struct LineBlock {
+  LineBlock() : kept(0), done(false) {}
+
+  std::vector<std::string> lines;
+  std::string out;
+  size_t kept;
+  bool done;
+#ifdef WITH_THREADS
+  boost::mutex mutex;
+  boost::condition_variable cond;
+#endif
+};
+
+class FilterTask : public Task
+{
+public:
+  FilterTask(LineBlock &block, const NGramTrie &trie, const MinScores &minScores)
+    : m_block(block), m_trie(trie), m_minScores(minScores) {}
+
+  void Run() {
+    for(size_t i = 0; i < m_block.lines.size(); ++i) {
+      if(KeepLine(m_block.lines[i], m_trie, m_minScores)) {
+        m_block.out += m_block.lines[i];
+        m_block.out += '\n';
+        ++m_block.kept;
+      }
+    }
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_block.mutex);
+    m_block.done = true;
+    m_block.cond.notify_all();
+#else
+    m_block.done = true;
+#endif
+  }
+
+private:
+  LineBlock &m_block;
+  const NGramTrie &m_trie;
+  const MinScores &m_minScores;
+};
+
+// Filters a text table in blocks of lines. With several threads the blocks
+// are filtered by a thread pool and written in input order.
+void FilterTextTable(const std::string &inFilePath, const std::string &outFilePath,
+                     const NGramTrie &trie, const MinScores &minScores, size_t threads)
+{
+  InputFileStream in(inFilePath);
+
+  boost::iostreams::filtering_ostream out;
+  if(boost::algorithm::ends_with(outFilePath, ".gz"))
+    out.push(boost::iostreams::gzip_compressor());
+  out.push(boost::iostreams::file_sink(outFilePath, std::ios_base::out | std::ios_base::binary));
+
+#ifdef WITH_THREADS
+  std::auto_ptr<ThreadPool> pool;
+  if(threads > 1)
+    pool.reset(new ThreadPool(threads));
+#endif
+  const size_t maxPending = 2 * threads;
+  std::deque<LineBlock*> pending;
+
+  size_t used = 0, total = 0;
+  bool eof = false;
+  while(!eof || !pending.empty()) {
+    if(!eof) {
+      LineBlock *block = new LineBlock();
+      block->lines.reserve(kBlockLines);
+      std::string line;
+      while(block->lines.size() < kBlockLines) {
+        if(!std::getline(in, line)) {
+          eof = true;
+          break;
+        }
+        block->lines.push_back(line);
+      }
+      total += block->lines.size();
+      pending.push_back(block);
+      bool submitted = false;
+#ifdef WITH_THREADS
+      if(pool.get()) {
+        pool->Submit(new FilterTask(*block, trie, minScores));
+        submitted = true;
+      }
+#endif
+      if(!submitted) {
+        FilterTask task(*block, trie, minScores);
+        task.Run();
+      }
+      if(pending.size() < maxPending && !eof)
+        continue;
+    }
+
+    // Write the oldest block.
+    std::auto_ptr<LineBlock> block(pending.front());
+    pending.pop_front();
+#ifdef WITH_THREADS
+    {
+      boost::mutex::scoped_lock lock(block->mutex);
+      while(!block->done)
+        block->cond.wait(lock);
+    }
+#endif
+    out << block->out;
+    used += block->kept;
+  }
+
+  if(total == 0) {
+    std::cerr << "ERROR: No phrases found in " << inFilePath << std::endl;
+    exit(1);
+  }
+  std::cerr << used << " of " << total << " phrases pairs used ("
+            << 100.0 * used / total << "%)" << std::endl;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::string inputFilePath;
+  std::string inFilePath;
+  std::string outFilePath;
+  std::vector<size_t> factors(1, 0);
+  size_t maxLength = 10;
+  MinScores minScores;
+  bool sourceOnly = false;
+  size_t threads = 1;
+
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if("-input" == arg && i+1 < argc) {
+      inputFilePath = argv[++i];
+    } else if("-in" == arg && i+1 < argc) {
+      inFilePath = argv[++i];
+    } else if("-out" == arg && i+1 < argc) {
+      outFilePath = argv[++i];
+    } else if("-factors" == arg && i+1 < argc) {
+      factors = Tokenize<size_t>(argv[++i], ",");
+    } else if("-max-length" == arg && i+1 < argc) {
+      maxLength = atoi(argv[++i]);
+    } else if("-min-score" == arg && i+1 < argc) {
+      std::vector<std::string> minScore = Tokenize(argv[++i], ",");
+      for(size_t j = 0; j < minScore.size(); ++j) {
+        std::vector<std::string> idScore = Tokenize(minScore[j], ":");
+        if(idScore.size() != 2) {
+          printHelp(argv);
+          return 1;
+        }
+        minScores.push_back(std::make_pair(Scan<size_t>(idScore[0]), Scan<float>(idScore[1])));
+        std::cerr << "score " << idScore[0] << " must be at least " << idScore[1] << std::endl;
+      }
+    } else if("-source-only" == arg) {
+      sourceOnly = true;
+    } else if("-threads" == arg && i+1 < argc) {
+      std::string value(argv[++i]);
+#ifdef WITH_THREADS
+      if(value == "all") {
+        threads = boost::thread::hardware_concurrency();
+        if(!threads) {
+          std::cerr << "Could not determine number of hardware threads, setting to 1" << std::endl;
+          threads = 1;
+        }
+      } else {
+        int n = atoi(value.c_str());
+        if(n < 1) {
+          std::cerr << "Number of threads must be at least 1" << std::endl;
+          return 1;
+        }
+        threads = n;
+      }
+#else
+      if(value != "1") {
+        std::cerr << "Thread support not compiled in" << std::endl;
+        exit(1);
+      }
+#endif
+    } else {
+      printHelp(argv);
+      return 1;
+    }
+  }
+  if(inputFilePath.empty() || inFilePath.empty() || outFilePath.empty() || factors.empty()) {
+    printHelp(argv);
+    return 1;
+  }
+
+  const bool compactPhraseTable = boost::algorithm::ends_with(inFilePath, ".minphr");
+  const bool compactReorderingTable = boost::algorithm::ends_with(inFilePath, ".minlexr");
+  if(compactReorderingTable && !sourceOnly) {
+    std::cerr << "ERROR: keys of compact reordering tables contain the target phrase "
+              "unless the model is conditioned on the source only (-source-only), "
+              "filter the text table instead" << std::endl;
+    return 1;
+  }
+  if(minScores.size() && (compactPhraseTable || compactReorderingTable)) {
+    std::cerr << "ERROR: -min-score requires a text phrase table" << std::endl;
+    return 1;
+  }
+
+  // n-grams of the input
+  NGramTrie trie;
+  {
+    InputFileStream input(inputFilePath);
+    std::string line;
+    std::vector<std::string> words;
+    while(std::getline(input, line)) {
+      words = Tokenize(line);
+      for(size_t i = 0; i < words.size(); ++i)
+        words[i] = ProjectWord(words[i], factors);
+      trie.AddSentence(words, maxLength);
+    }
+  }
+
+  try {
+    if(compactPhraseTable || compactReorderingTable) {
+      const std::string suffix = compactPhraseTable ? ".minphr" : ".minlexr";
+      if(!boost::algorithm::ends_with(outFilePath, suffix))
+        outFilePath += suffix;
+
+      std::vector<std::string> phrases;
+      trie.GetPhrases(phrases);
+
+      CompactTableFilter filter(compactPhraseTable ? CompactTableFilter::PhraseTable
+                                : CompactTableFilter::ReorderingTable, threads);
+      size_t found = filter.Filter(inFilePath, outFilePath, phrases);
+      std::cerr << found << " of " << phrases.size()
+                << " source phrases of the input found" << std::endl;
+    } else {
+      FilterTextTable(inFilePath, outFilePath, trie, minScores, threads);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -1,4 +1,7 @@
+#include <cerrno>
+#include <cstdlib>
 #include <iostream>
+#include <limits>
 
 #ifdef WITH_THREADS
 #include <boost/thread/thread.hpp>
@@ -20,6 +23,8 @@ void printHelp(char **argv)
             "\t-T string         -- path to temporary directory (uses /tmp by default)\n"
             "\t-nscores int      -- number of score components in phrase table\n"
             "\t-no-alignment-info   -- do not include alignment info in the binary phrase table\n"
+            "\t-memory int       -- memory budget in MB for intermediate data, the rest is kept\n"
+            "\t                     in the temporary directory (default 0 = unlimited)\n"
 #ifdef WITH_THREADS
             "\t-threads int|all  -- number of threads used for conversion\n"
 #endif
@@ -67,6 +72,7 @@ int main(int argc, char **argv)
   bool sortScoreIndexSet = false;
   size_t sortScoreIndex = 2;
   bool warnMe = true;
+  size_t memoryBudget = 0;
   size_t threads = 1;
 
   if(1 >= argc) {
@@ -120,6 +126,17 @@ int main(int argc, char **argv)
       quantize = atoi(argv[i]);
     } else if("-no-warnings" == arg) {
       warnMe = false;
+    } else if("-memory" == arg && i+1 < argc) {
+      ++i;
+      std::string val(argv[i]);
+      errno = 0;
+      unsigned long megabytes = strtoul(argv[i], NULL, 10);
+      if(val.empty() || val.find_first_not_of("0123456789") != std::string::npos
+          || errno == ERANGE || megabytes > (std::numeric_limits<size_t>::max() >> 20)) {
+        std::cerr << "Invalid memory budget: " << val << std::endl;
+        return 1;
+      }
+      memoryBudget = size_t(megabytes) << 20;
     } else if("-threads" == arg && i+1 < argc) {
 #ifdef WITH_THREADS
       ++i;
@@ -162,7 +179,7 @@ int main(int argc, char **argv)
                      numScoreComponent, sortScoreIndex,
                      coding, orderBits, fingerprintBits,
                      useAlignmentInfo, multipleScoreTrees,
-                     quantize, maxRank, warnMe
+                     quantize, maxRank, warnMe, memoryBudget
 #ifdef WITH_THREADS
                      , threads
 #endif
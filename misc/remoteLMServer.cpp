@@ -0,0 +1,225 @@
+// Answers batched n-gram queries from the RemoteLM feature with a KenLM model.
+// See moses/LM/RemoteProtocol.h for the wire format.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
+#include "lm/model.hh"
+#include "lm/state.hh"
+#include "util/string_piece.hh"
+#include "moses/LM/RemoteProtocol.h"
+
+using namespace Moses::RemoteLMProtocol;
+
+namespace
+{
+
+void printHelp()
+{
+  std::cerr << "Usage:\n"
+            "options: \n"
+            "\t-lm   string -- KenLM model, ARPA or binary\n"
+            "\t-port int    -- TCP port to listen on\n"
+            "Each connection is served by its own thread. Point the decoder at it with\n"
+            "\tRemoteLM factor=0 order=N path=host:port\n"
+            "\n";
+}
+
+bool ReadFully(int fd, char *to, size_t size)
+{
+  while (size) {
+    ssize_t n = read(fd, to, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    to += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool WriteFully(int fd, const char *from, size_t size)
+{
+  while (size) {
+    ssize_t n = write(fd, from, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    from += n;
+    size -= n;
+  }
+  return true;
+}
+
+template <class Model> class Server
+{
+public:
+  Server(const char *file) : m_model(file) {}
+
+  //! answer requests until the client hangs up
+  void Serve(int fd) const {
+    char header[kRequestHeaderSize];
+    std::vector<char> body;
+    std::string response;
+    while (ReadFully(fd, header, sizeof(header))) {
+      const uint32_t count = ReadUint32(header);
+      const uint32_t size = ReadUint32(header + 4);
+      if (size > kMaxRequestBodySize) {
+        std::cerr << "Request of " << size << " bytes is too large, closing connection" << std::endl;
+        break;
+      }
+      body.resize(size);
+      if (!body.empty() && !ReadFully(fd, &body[0], body.size())) break;
+
+      response.clear();
+      AppendUint32(response, count);
+      const char *at = body.empty() ? NULL : &body[0];
+      const char *end = at + body.size();
+      bool good = true;
+      for (uint32_t i = 0; i < count && good; ++i) {
+        good = ScoreNgram(at, end, response);
+      }
+      if (!good) {
+        std::cerr << "Malformed request, closing connection" << std::endl;
+        break;
+      }
+      if (!WriteFully(fd, response.data(), response.size())) break;
+    }
+    close(fd);
+  }
+
+private:
+  Model m_model;
+
+  //! decode one n-gram at at, append its record to response
+  bool ScoreNgram(const char *&at, const char *end, std::string &response) const {
+    const typename Model::Vocabulary &vocab = m_model.GetVocabulary();
+    if (at >= end) return false;
+    size_t length = static_cast<unsigned char>(*at++);
+    if (length == 0) return false;
+
+    lm::WordIndex words[256];
+    for (size_t i = 0; i < length; ++i) {
+      if (end - at < 2) return false;
+      size_t size = ReadUint16(at);
+      at += 2;
+      if (static_cast<size_t>(end - at) < size) return false;
+      words[i] = vocab.Index(StringPiece(at, size));
+      at += size;
+    }
+
+    // KenLM wants the context most recent word first, and no more of it
+    // than the model can use
+    lm::WordIndex context[256];
+    size_t contextSize = 0;
+    for (size_t i = length - 1; i > 0 && contextSize + 1 < m_model.Order(); --i) {
+      context[contextSize++] = words[i - 1];
+    }
+    lm::ngram::State state;
+    lm::FullScoreReturn ret = m_model.FullScoreForgotState(context, context + contextSize, words[length - 1], state);
+
+    AppendFloat(response, ret.prob);
+    AppendUint32(response, words[length - 1] == vocab.NotFound() ? kFlagUnknown : 0);
+    AppendUint64(response, lm::ngram::hash_value(state));
+    return true;
+  }
+};
+
+template <class Model> int Run(const char *file, int listener)
+{
+  Server<Model> server(file);
+  std::cerr << "Loaded " << file << ", waiting for connections" << std::endl;
+  while (true) {
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR) continue;
+      perror("accept");
+      return 1;
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef WITH_THREADS
+    boost::thread(boost::bind(&Server<Model>::Serve, &server, fd)).detach();
+#else
+    server.Serve(fd);
+#endif
+  }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::string lmFile;
+  int port = 0;
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if("-lm" == arg && i+1 < argc) {
+      lmFile = argv[++i];
+    } else if("-port" == arg && i+1 < argc) {
+      port = atoi(argv[++i]);
+    } else {
+      printHelp();
+      return 1;
+    }
+  }
+  if (lmFile.empty() || port <= 0) {
+    printHelp();
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  if (listener < 0
+      || bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0
+      || listen(listener, 64) < 0) {
+    perror("Cannot listen");
+    return 1;
+  }
+
+  try {
+    using namespace lm::ngram;
+    ModelType modelType;
+    if (!RecognizeBinary(lmFile.c_str(), modelType)) modelType = PROBING;
+    switch (modelType) {
+    case PROBING:
+      return Run<ProbingModel>(lmFile.c_str(), listener);
+    case REST_PROBING:
+      return Run<RestProbingModel>(lmFile.c_str(), listener);
+    case TRIE:
+      return Run<TrieModel>(lmFile.c_str(), listener);
+    case QUANT_TRIE:
+      return Run<QuantTrieModel>(lmFile.c_str(), listener);
+    case ARRAY_TRIE:
+      return Run<ArrayTrieModel>(lmFile.c_str(), listener);
+    case QUANT_ARRAY_TRIE:
+      return Run<QuantArrayTrieModel>(lmFile.c_str(), listener);
+    default:
+      std::cerr << "Unrecognized kenlm model type " << modelType << std::endl;
+      return 1;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
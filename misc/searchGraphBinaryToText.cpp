@@ -0,0 +1,72 @@
+// Converts a search graph written with -output-search-graph-binary to the
+// text format of -output-search-graph or -output-search-graph-extended.
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include "moses/SearchGraphBinary.h"
+
+using namespace Moses;
+
+namespace
+{
+
+void printHelp()
+{
+  std::cerr << "Usage:\n"
+            "options: \n"
+            "\t-in        file -- binary search graph, may be gzipped (default stdin)\n"
+            "\t-extended       -- print the format of -output-search-graph-extended\n"
+            "\t-precision int  -- digits after the decimal point (default 3)\n"
+            "\n";
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::string inFilePath;
+  bool extended = false;
+  int precision = 3;
+  for(int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if("-in" == arg && i+1 < argc) {
+      inFilePath = argv[++i];
+    } else if("-extended" == arg) {
+      extended = true;
+    } else if("-precision" == arg && i+1 < argc) {
+      precision = atoi(argv[++i]);
+    } else {
+      printHelp();
+      return 1;
+    }
+  }
+
+  std::cout.setf(std::ios::fixed);
+  std::cout.precision(precision);
+
+  try {
+    boost::iostreams::filtering_istream file;
+    if (!inFilePath.empty()) {
+      if (boost::algorithm::ends_with(inFilePath, ".gz")) {
+        file.push(boost::iostreams::gzip_decompressor());
+      }
+      file.push(boost::iostreams::file_source(inFilePath, std::ios_base::in | std::ios_base::binary));
+    }
+    SearchGraphBinaryReader reader(inFilePath.empty() ? std::cin : file);
+    SearchGraphBinaryRecord record;
+    while (reader.Read(record)) {
+      PrintSearchGraphBinaryRecord(record, extended, std::cout);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -59,6 +59,7 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "moses/ChartTrellisPath.h"
 #include "moses/ChartTrellisPathList.h"
 #include "moses/Incremental.h"
+#include "moses/DecoderProfile.h"
 
 #include "util/usage.hh"
 
@@ -88,6 +89,11 @@ public:
     delete m_source;
   }
 
+  //! longer sentences take longer, see -thread-read-ahead
+  size_t GetCost() const {
+    return m_source->GetSize();
+  }
+
   void Run() {
     const StaticData &staticData = StaticData::Instance();
     const size_t translationId = m_source->GetTranslationId();
@@ -262,7 +268,8 @@ int main(int argc, char* argv[])
       return EXIT_FAILURE;
 
 #ifdef WITH_THREADS
-    ThreadPool pool(staticData.ThreadCount());
+    ThreadPool pool(staticData.ThreadCount(), staticData.GetThreadPinning());
+    pool.SetReadAhead(staticData.GetThreadReadAhead());
 #endif
 
     // read each sentence & decode
@@ -284,6 +291,8 @@ int main(int argc, char* argv[])
     pool.Stop(true);  // flush remaining jobs
 #endif
 
+    DecoderProfile::Instance().Flush();
+
     delete ioWrapper;
 
     IFVERBOSE(1)
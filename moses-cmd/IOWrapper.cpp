@@ -35,6 +35,9 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <iostream>
 #include <stack>
 #include <boost/algorithm/string.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
 
 #include "moses/TypeDef.h"
 #include "moses/Util.h"
@@ -44,6 +47,8 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "moses/StaticData.h"
 #include "moses/FeatureVector.h"
 #include "moses/InputFileStream.h"
+#include "moses/SearchGraphBinary.h"
+#include "moses/FF/FeatureFunction.h"
 #include "IOWrapper.h"
 
 using namespace std;
@@ -66,6 +71,7 @@ IOWrapper::IOWrapper(
   ,m_nBestStream(NULL)
   ,m_outputWordGraphStream(NULL)
   ,m_outputSearchGraphStream(NULL)
+  ,m_outputSearchGraphBinaryStream(NULL)
   ,m_detailedTranslationReportingStream(NULL)
   ,m_alignmentOutputStream(NULL)
 {
@@ -88,6 +94,7 @@ IOWrapper::IOWrapper(const std::vector<FactorType>	&inputFactorOrder
   ,m_nBestStream(NULL)
   ,m_outputWordGraphStream(NULL)
   ,m_outputSearchGraphStream(NULL)
+  ,m_outputSearchGraphBinaryStream(NULL)
   ,m_detailedTranslationReportingStream(NULL)
   ,m_alignmentOutputStream(NULL)
 {
@@ -112,6 +119,7 @@ IOWrapper::~IOWrapper()
   if (m_outputSearchGraphStream != NULL) {
     delete m_outputSearchGraphStream;
   }
+  delete m_outputSearchGraphBinaryStream;
   delete m_detailedTranslationReportingStream;
   delete m_alignmentOutputStream;
 }
@@ -159,6 +167,24 @@ void IOWrapper::Initialization(const std::vector<FactorType>	&/*inputFactorOrder
     file->open(fileName.c_str());
   }
 
+  // binary search graph output
+  if (staticData.GetOutputSearchGraphBinary()) {
+    const string &fileName = staticData.GetParam("output-search-graph-binary")[0];
+    boost::iostreams::filtering_ostream *file = new boost::iostreams::filtering_ostream;
+    if (boost::algorithm::ends_with(fileName, ".gz")) {
+      file->push(boost::iostreams::gzip_compressor());
+    }
+    file->push(boost::iostreams::file_sink(fileName, ios_base::out | ios_base::binary));
+    m_outputSearchGraphBinaryStream = file;
+
+    SearchGraphBinaryFeatures features;
+    const vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+    for (size_t i = 0; i < ffs.size(); ++i) {
+      features.push_back(make_pair(ffs[i]->GetScoreProducerDescription(), ffs[i]->GetNumScoreComponents()));
+    }
+    WriteSearchGraphBinaryHeader(*file, features);
+  }
+
   // detailed translation reporting
   if (staticData.IsDetailedTranslationReportingEnabled()) {
     const std::string &path = staticData.GetDetailedTranslationReportingFilePath();
@@ -52,6 +52,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/Util.h"
 #include "moses/Timer.h"
 #include "moses/ThreadPool.h"
+#include "moses/DecoderProfile.h"
 #include "moses/OutputCollector.h"
 
 #ifdef HAVE_PROTOBUF
@@ -88,6 +89,7 @@ public:
                   InputType* source, OutputCollector* outputCollector, OutputCollector* nbestCollector,
                   OutputCollector* latticeSamplesCollector,
                   OutputCollector* wordGraphCollector, OutputCollector* searchGraphCollector,
+                  OutputCollector* searchGraphBinaryCollector,
                   OutputCollector* detailedTranslationCollector,
                   OutputCollector* alignmentInfoCollector,
                   OutputCollector* unknownsCollector,
@@ -97,6 +99,7 @@ public:
     m_outputCollector(outputCollector), m_nbestCollector(nbestCollector),
     m_latticeSamplesCollector(latticeSamplesCollector),
     m_wordGraphCollector(wordGraphCollector), m_searchGraphCollector(searchGraphCollector),
+    m_searchGraphBinaryCollector(searchGraphBinaryCollector),
     m_detailedTranslationCollector(detailedTranslationCollector),
     m_alignmentInfoCollector(alignmentInfoCollector),
     m_unknownsCollector(unknownsCollector),
@@ -152,6 +155,13 @@ public:
 #endif
     }
 
+    // output search graph in binary format
+    if (m_searchGraphBinaryCollector) {
+      ostringstream out;
+      manager.OutputSearchGraphBinary(m_lineNumber, out);
+      m_searchGraphBinaryCollector->Write(m_lineNumber, out.str());
+    }
+
     // Output search graph in HTK standard lattice format (SLF)
     if (m_outputSearchGraphSLF) {
       stringstream fileName;
@@ -424,6 +434,11 @@ public:
     delete m_source;
   }
 
+  //! longer sentences take longer, see -thread-read-ahead
+  size_t GetCost() const {
+    return m_source->GetSize();
+  }
+
 private:
   InputType* m_source;
   size_t m_lineNumber;
@@ -432,6 +447,7 @@ private:
   OutputCollector* m_latticeSamplesCollector;
   OutputCollector* m_wordGraphCollector;
   OutputCollector* m_searchGraphCollector;
+  OutputCollector* m_searchGraphBinaryCollector;
   OutputCollector* m_detailedTranslationCollector;
   OutputCollector* m_alignmentInfoCollector;
   OutputCollector* m_unknownsCollector;
@@ -681,6 +697,11 @@ int main(int argc, char** argv)
       searchGraphCollector.reset(new OutputCollector(&(ioWrapper->GetOutputSearchGraphStream())));
     }
 
+    auto_ptr<OutputCollector> searchGraphBinaryCollector;
+    if (staticData.GetOutputSearchGraphBinary()) {
+      searchGraphBinaryCollector.reset(new OutputCollector(&(ioWrapper->GetOutputSearchGraphBinaryStream())));
+    }
+
     // initialize stram for details about the decoder run
     auto_ptr<OutputCollector> detailedTranslationCollector;
     if (staticData.IsDetailedTranslationReportingEnabled()) {
@@ -706,7 +727,8 @@ int main(int argc, char** argv)
     }
 
 #ifdef WITH_THREADS
-    ThreadPool pool(staticData.ThreadCount());
+    ThreadPool pool(staticData.ThreadCount(), staticData.GetThreadPinning());
+    pool.SetReadAhead(staticData.GetThreadReadAhead());
 #endif
 
     // main loop over set of input sentences
@@ -723,6 +745,7 @@ int main(int argc, char** argv)
                             latticeSamplesCollector.get(),
                             wordGraphCollector.get(),
                             searchGraphCollector.get(),
+                            searchGraphBinaryCollector.get(),
                             detailedTranslationCollector.get(),
                             alignmentInfoCollector.get(),
                             unknownsCollector.get(),
@@ -745,6 +768,8 @@ int main(int argc, char** argv)
     pool.Stop(true); //flush remaining jobs
 #endif
 
+    DecoderProfile::Instance().Flush();
+
     delete ioWrapper;
 
   } catch (const std::exception &e) {
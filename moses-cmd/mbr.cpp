@@ -12,8 +12,14 @@
 #include "moses/TrellisPath.h"
 #include "moses/StaticData.h"
 #include "moses/Util.h"
+#include "util/murmur_hash.hh"
 #include "mbr.h"
 
+#ifdef WITH_THREADS
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#endif
+
 using namespace std ;
 using namespace Moses;
 
@@ -35,21 +41,34 @@ using namespace Moses;
 int BLEU_ORDER = 4;
 int SMOOTH = 1;
 float min_interval = 1e-4;
-void extract_ngrams(const vector<const Factor* >& sentence, map < vector < const Factor* >, int >  & allngrams)
+void extract_ngrams(const vector<const Factor* >& sentence, NgramCounts &allngrams)
 {
-  vector< const Factor* > ngram;
+  allngrams.clear();
   for (int k = 0; k < BLEU_ORDER; k++) {
     for(int i =0; i < max((int)sentence.size()-k,0); i++) {
-      for ( int j = i; j<= i+k; j++) {
-        ngram.push_back(sentence[j]);
-      }
-      ++allngrams[ngram];
-      ngram.clear();
+      NgramCount ngram;
+      ngram.hash = util::MurmurHashNative(&sentence[i], (k + 1) * sizeof(const Factor*), k);
+      ngram.order = k;
+      ngram.count = 1;
+      allngrams.push_back(ngram);
     }
   }
+
+  // sort once and collapse duplicates so that pairwise matching is a merge
+  std::sort(allngrams.begin(), allngrams.end());
+  size_t out = 0;
+  for (size_t i = 0; i < allngrams.size(); ++i) {
+    if (out > 0 && allngrams[out-1].hash == allngrams[i].hash
+        && allngrams[out-1].order == allngrams[i].order) {
+      ++allngrams[out-1].count;
+    } else {
+      allngrams[out++] = allngrams[i];
+    }
+  }
+  allngrams.resize(out);
 }
 
-float calculate_score(const vector< vector<const Factor*> > & sents, int ref, int hyp,  vector < map < vector < const Factor *>, int > > & ngram_stats )
+float calculate_score(const vector< vector<const Factor*> > & sents, int ref, int hyp, const vector<NgramCounts> &ngram_stats )
 {
   int comps_n = 2*BLEU_ORDER+1;
   vector<int> comps(comps_n);
@@ -62,14 +81,20 @@ float calculate_score(const vector< vector<const Factor*> > & sents, int ref, in
     comps[2*i+1] = max(hyp_length-i,0);
   }
 
-  map< vector < const Factor * > ,int > & hyp_ngrams = ngram_stats[hyp] ;
-  map< vector < const Factor * >, int > & ref_ngrams = ngram_stats[ref] ;
-
-  for (map< vector< const Factor * >, int >::iterator it = hyp_ngrams.begin();
-       it != hyp_ngrams.end(); it++) {
-    map< vector< const Factor * >, int >::iterator ref_it = ref_ngrams.find(it->first);
-    if(ref_it != ref_ngrams.end()) {
-      comps[2* (it->first.size()-1)] += min(ref_it->second,it->second);
+  // clipped counts by intersecting the two sorted count vectors
+  const NgramCounts &hyp_ngrams = ngram_stats[hyp];
+  const NgramCounts &ref_ngrams = ngram_stats[ref];
+  NgramCounts::const_iterator hyp_it = hyp_ngrams.begin();
+  NgramCounts::const_iterator ref_it = ref_ngrams.begin();
+  while (hyp_it != hyp_ngrams.end() && ref_it != ref_ngrams.end()) {
+    if (*hyp_it < *ref_it) {
+      ++hyp_it;
+    } else if (*ref_it < *hyp_it) {
+      ++ref_it;
+    } else {
+      comps[2 * hyp_it->order] += min(ref_it->count, hyp_it->count);
+      ++hyp_it;
+      ++ref_it;
     }
   }
   comps[comps_n-1] = sents[ref].size();
@@ -89,6 +114,43 @@ float calculate_score(const vector< vector<const Factor*> > & sents, int ref, in
   return exp(logbleu);
 }
 
+namespace
+{
+
+/** Expected loss of candidates [begin, end), stopping early on rows that
+ * cannot beat the best loss seen so far in this range */
+void CalcMBRLoss(const vector< vector<const Factor*> > &translations,
+                 const vector<NgramCounts> &ngram_stats,
+                 const vector<float> &joint_prob_vec, float marginal,
+                 size_t begin, size_t end, float *minLoss, int *minLossIdx)
+{
+  float bleu, weightedLoss;
+  float weightedLossCumul = 0;
+  float minMBRLoss = 1000000;
+  int minMBRLossIdx = -1;
+
+  for (size_t i = begin; i < end; i++) {
+    weightedLossCumul = 0;
+    for (size_t j = 0; j < translations.size(); j++) {
+      if ( i != j) {
+        bleu = calculate_score(translations, j, i,ngram_stats );
+        weightedLoss = ( 1 - bleu) * ( joint_prob_vec[j]/marginal);
+        weightedLossCumul += weightedLoss;
+        if (weightedLossCumul > minMBRLoss)
+          break;
+      }
+    }
+    if (weightedLossCumul < minMBRLoss) {
+      minMBRLoss = weightedLossCumul;
+      minMBRLossIdx = i;
+    }
+  }
+  *minLoss = minMBRLoss;
+  *minLossIdx = minMBRLossIdx;
+}
+
+}
+
 const TrellisPath doMBR(const TrellisPathList& nBestList)
 {
   float marginal = 0;
@@ -96,7 +158,7 @@ const TrellisPath doMBR(const TrellisPathList& nBestList)
   vector<float> joint_prob_vec;
   vector< vector<const Factor*> > translations;
   float joint_prob;
-  vector< map < vector <const Factor *>, int > > ngram_stats;
+  vector<NgramCounts> ngram_stats;
 
   TrellisPathList::const_iterator iter;
 
@@ -109,48 +171,55 @@ const TrellisPath doMBR(const TrellisPathList& nBestList)
     if (maxScore < score) maxScore = score;
   }
 
-  for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter) {
+  ngram_stats.resize(nBestList.GetSize());
+  translations.resize(nBestList.GetSize());
+  size_t idx = 0;
+  for (iter = nBestList.begin() ; iter != nBestList.end() ; ++iter, ++idx) {
     const TrellisPath &path = **iter;
     joint_prob = UntransformScore(StaticData::Instance().GetMBRScale() * path.GetScoreBreakdown().GetWeightedScore() - maxScore);
     marginal += joint_prob;
     joint_prob_vec.push_back(joint_prob);
 
     // get words in translation
-    vector<const Factor*> translation;
-    GetOutputFactors(path, translation);
+    GetOutputFactors(path, translations[idx]);
 
-    // collect n-gram counts
-    map < vector < const Factor *>, int > counts;
-    extract_ngrams(translation,counts);
-
-    ngram_stats.push_back(counts);
-    translations.push_back(translation);
+    // collect n-gram counts once per candidate
+    extract_ngrams(translations[idx], ngram_stats[idx]);
   }
 
-  vector<float> mbr_loss;
-  float bleu, weightedLoss;
-  float weightedLossCumul = 0;
+  /* Main MBR computation done here */
+  const size_t size = nBestList.GetSize();
+  size_t threads = std::min(StaticData::Instance().GetMBRThreads(), size);
+  if (threads < 1) threads = 1;
+  vector<float> minLoss(threads);
+  vector<int> minLossIdx(threads);
+  const size_t chunk = (size + threads - 1) / threads;
+
+#ifdef WITH_THREADS
+  boost::thread_group workers;
+  for (size_t t = 1; t < threads; ++t) {
+    workers.create_thread(boost::bind(&CalcMBRLoss, boost::cref(translations),
+                                      boost::cref(ngram_stats), boost::cref(joint_prob_vec), marginal,
+                                      std::min(t * chunk, size), std::min((t + 1) * chunk, size),
+                                      &minLoss[t], &minLossIdx[t]));
+  }
+  CalcMBRLoss(translations, ngram_stats, joint_prob_vec, marginal,
+              0, std::min(chunk, size), &minLoss[0], &minLossIdx[0]);
+  workers.join_all();
+#else
+  CalcMBRLoss(translations, ngram_stats, joint_prob_vec, marginal,
+              0, size, &minLoss[0], &minLossIdx[0]);
+  threads = 1;
+#endif
+
+  // ranges are visited in order so ties keep the earliest candidate
   float minMBRLoss = 1000000;
   int minMBRLossIdx = -1;
-
-  /* Main MBR computation done here */
-  iter = nBestList.begin();
-  for (unsigned int i = 0; i < nBestList.GetSize(); i++) {
-    weightedLossCumul = 0;
-    for (unsigned int j = 0; j < nBestList.GetSize(); j++) {
-      if ( i != j) {
-        bleu = calculate_score(translations, j, i,ngram_stats );
-        weightedLoss = ( 1 - bleu) * ( joint_prob_vec[j]/marginal);
-        weightedLossCumul += weightedLoss;
-        if (weightedLossCumul > minMBRLoss)
-          break;
-      }
-    }
-    if (weightedLossCumul < minMBRLoss) {
-      minMBRLoss = weightedLossCumul;
-      minMBRLossIdx = i;
+  for (size_t t = 0; t < threads; ++t) {
+    if (minLossIdx[t] != -1 && minLoss[t] < minMBRLoss) {
+      minMBRLoss = minLoss[t];
+      minMBRLossIdx = minLossIdx[t];
     }
-    iter++;
   }
   /* Find sentence that minimises Bayes Risk under 1- BLEU loss */
   return nBestList.at(minMBRLossIdx);
@@ -22,7 +22,26 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_cmd_mbr_h
 #define moses_cmd_mbr_h
 
+#include <vector>
+#include <stdint.h>
+
+/** count of one n-gram in a candidate, keyed by a hash of its factors */
+struct NgramCount {
+  uint64_t hash;
+  int order; //! n-gram length minus one
+  int count;
+
+  bool operator<(const NgramCount &other) const {
+    if (hash != other.hash) return hash < other.hash;
+    return order < other.order;
+  }
+};
+
+//! n-gram counts of a candidate, sorted by (hash, order) with no duplicates
+typedef std::vector<NgramCount> NgramCounts;
+
 const Moses::TrellisPath doMBR(const Moses::TrellisPathList& nBestList);
 void GetOutputFactors(const Moses::TrellisPath &path, std::vector <const Moses::Factor*> &translation);
-float calculate_score(const std::vector< std::vector<const Moses::Factor*> > & sents, int ref, int hyp,  std::vector < std::map < std::vector < const Moses::Factor *>, int > > & ngram_stats );
+void extract_ngrams(const std::vector<const Moses::Factor* >& sentence, NgramCounts &allngrams);
+float calculate_score(const std::vector< std::vector<const Moses::Factor*> > & sents, int ref, int hyp, const std::vector<NgramCounts> &ngram_stats );
 #endif
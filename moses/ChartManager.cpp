@@ -30,6 +30,7 @@
 #include "ChartTrellisPathList.h"
 #include "StaticData.h"
 #include "DecodeStep.h"
+#include "DecoderProfile.h"
 #include "TreeInput.h"
 #include "moses/FF/WordPenaltyProducer.h"
 
@@ -69,6 +70,7 @@ void ChartManager::ProcessSentence()
   VERBOSE(1,"Translating: " << m_source << endl);
 
   ResetSentenceStats(m_source);
+  const uint64_t start = MonotonicNanoTime();
 
   VERBOSE(2,"Decoding: " << endl);
   //ChartHypothesis::ResetHypoCount();
@@ -83,20 +85,26 @@ void ChartManager::ProcessSentence()
       WordsRange range(startPos, endPos);
 
       // create trans opt
+      uint64_t t = MonotonicNanoTime();
       m_translationOptionList.Clear();
       m_parser.Create(range, m_translationOptionList);
       m_translationOptionList.ApplyThreshold();
+      GetSentenceStats().AddTimeCollectOpts(MonotonicNanoTime() - t);
 
       // decode
       ChartCell &cell = m_hypoStackColl.Get(range);
 
       cell.ProcessSentence(m_translationOptionList, m_hypoStackColl);
       m_translationOptionList.Clear();
+      t = MonotonicNanoTime();
       cell.PruneToSize();
       cell.CleanupArcList();
       cell.SortHypotheses();
+      GetSentenceStats().AddTimeStack(MonotonicNanoTime() - t);
     }
   }
+  GetSentenceStats().SetTimeTotal(MonotonicNanoTime() - start);
+  DecoderProfile::Instance().Record(m_source.GetTranslationId(), GetSentenceStats());
 
   IFVERBOSE(1) {
 
@@ -63,6 +63,12 @@ public:
   bool IsUseable(const FactorMask &mask) const;
   void SetParameter(const std::string& key, const std::string& value);
 
+  /** whether lookups for a sentence may also run on threads other than the
+   * one that called InitializeForInput(), see translation-option-threads */
+  virtual bool SupportsParallelLookup() const {
+    return false;
+  }
+
 protected:
   std::vector<FactorType> m_input;
   std::vector<FactorType> m_output;
@@ -96,6 +96,11 @@ public:
     return m_conflictFactors;
   }
 
+  /*! returns the phrase or generation table consulted by this step */
+  const DecodeFeature* GetDecodeFeature() const {
+    return m_decodeFeature;
+  }
+
   /*! returns phrase table feature for translation step */
   const PhraseDictionary* GetPhraseDictionaryFeature() const;
 
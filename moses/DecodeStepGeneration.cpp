@@ -38,11 +38,11 @@ DecodeStepGeneration::DecodeStepGeneration(const GenerationDictionary* dict,
 }
 
 // helpers
-typedef pair<Word, ScoreComponentCollection> WordPair;
-typedef list< WordPair > WordList;
+typedef OutputWordCollection::value_type WordPair;
+typedef OutputWordCollection WordList;
 // 1st = word
-// 2nd = score
-typedef list< WordPair >::const_iterator WordListIterator;
+// 2nd = scores, owned by the generation dictionary
+typedef WordList::const_iterator WordListIterator;
 
 /** used in generation: increases iterators when looping through the exponential number of generation expansions */
 inline void IncrementIterators(vector< WordListIterator > &wordListIterVector
@@ -93,23 +93,13 @@ void DecodeStepGeneration::Process(const TranslationOption &inputPartialTranslOp
     WordList &wordList = wordListVector[wordListVectorPos];
     const Word &word = targetPhrase.GetWord(currPos);
 
-    // consult dictionary for possible generations for this word
-    const OutputWordCollection *wordColl = generationDictionary->FindWord(word);
-
-    if (wordColl == NULL) {
+    // consult dictionary for possible generations for this word,
+    // entering generated factor(s) and its(their) score(s) into word list
+    if (!generationDictionary->FindWord(word, wordList)) {
       // word not found in generation dictionary
       //toc->ProcessUnknownWord(sourceWordsRange.GetStartPos(), factorCollection);
       return; // can't be part of a phrase, special handling
     } else {
-      // sort(*wordColl, CompareWordCollScore);
-      OutputWordCollection::const_iterator iterWordColl;
-      for (iterWordColl = wordColl->begin() ; iterWordColl != wordColl->end(); ++iterWordColl) {
-        const Word &outputWord = (*iterWordColl).first;
-        const ScoreComponentCollection& score = (*iterWordColl).second;
-        // enter into word list generated factor(s) and its(their) score(s)
-        wordList.push_back(WordPair(outputWord, score));
-      }
-
       wordListVectorPos++; // done, next word
     }
   }
@@ -125,14 +115,18 @@ void DecodeStepGeneration::Process(const TranslationOption &inputPartialTranslOp
   }
 
   // go thru each possible factor for each word & create hypothesis
+  const size_t numScores = generationDictionary->GetNumScoreComponents();
+  vector<float> generationScore(numScores); // total score for this string of words
   for (size_t currIter = 0 ; currIter < numIteration ; currIter++) {
-    ScoreComponentCollection generationScore; // total score for this string of words
+    fill(generationScore.begin(), generationScore.end(), 0.0f);
 
     // create vector of words with new factors for last phrase
     for (size_t currPos = 0 ; currPos < targetLength ; currPos++) {
       const WordPair &wordPair = *wordListIterVector[currPos];
       mergeWords[currPos] = &(wordPair.first);
-      generationScore.PlusEquals(wordPair.second);
+      for (size_t i = 0 ; i < numScores ; i++) {
+        generationScore[i] += wordPair.second[i];
+      }
     }
 
     // merge with existing trans opt
@@ -145,7 +139,7 @@ void DecodeStepGeneration::Process(const TranslationOption &inputPartialTranslOp
 
     const TargetPhrase &inPhrase = inputPartialTranslOpt.GetTargetPhrase();
     TargetPhrase outPhrase(inPhrase);
-    outPhrase.GetScoreBreakdown().PlusEquals(generationScore);
+    outPhrase.GetScoreBreakdown().PlusEquals(generationDictionary, generationScore);
 
     outPhrase.MergeFactors(genPhrase, m_newOutputFactors);
     outPhrase.Evaluate(src, m_featuresToApply);
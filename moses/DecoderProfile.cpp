@@ -0,0 +1,240 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <sstream>
+#include "DecoderProfile.h"
+#include "SentenceStats.h"
+#include "UserMessage.h"
+#include "moses/FF/StatelessFeatureFunction.h"
+#include "moses/FF/StatefulFeatureFunction.h"
+
+#ifdef WITH_THREADS
+#include <boost/thread.hpp>
+#endif
+
+using namespace std;
+
+namespace Moses
+{
+
+DecoderProfile DecoderProfile::s_instance;
+
+namespace
+{
+
+string CurrentThreadName()
+{
+#ifdef WITH_THREADS
+  ostringstream name;
+  name << boost::this_thread::get_id();
+  return name.str();
+#else
+  return "main";
+#endif
+}
+
+void WriteJSONString(ostream &out, const string &str)
+{
+  out << '"';
+  for (size_t i = 0; i < str.size(); ++i) {
+    if (str[i] == '"' || str[i] == '\\') out << '\\';
+    out << str[i];
+  }
+  out << '"';
+}
+
+void AddTo(vector<uint64_t> &sum, const vector<uint64_t> &add)
+{
+  if (sum.size() < add.size()) sum.resize(add.size(), 0);
+  for (size_t i = 0; i < add.size(); ++i) {
+    sum[i] += add[i];
+  }
+}
+
+}
+
+DecoderProfile::Totals::Totals()
+  : sentences(0), sourceWords(0)
+  , hyposCreated(0), hyposNotBuilt(0), hyposEarlyDiscarded(0), hyposDiscarded(0), hyposRecombined(0), hyposPruned(0)
+  , timeTotal(0), timeCollectOpts(0), timeBuildHyp(0), timeCalcLM(0), timeEstimateScore(0), timeOtherScore(0), timeStack(0)
+{}
+
+void DecoderProfile::Totals::Add(const SentenceStats &stats)
+{
+  ++sentences;
+  sourceWords += stats.GetTotalSourceWords();
+  hyposCreated += stats.GetTotalHypos() - stats.GetNumHyposNotBuilt();
+  hyposNotBuilt += stats.GetNumHyposNotBuilt();
+  hyposEarlyDiscarded += stats.GetNumHyposEarlyDiscarded();
+  hyposDiscarded += stats.GetNumHyposDiscarded();
+  hyposRecombined += stats.GetNumHyposRecombined();
+  hyposPruned += stats.GetNumHyposPruned();
+  timeTotal += stats.GetNanoTimeTotal();
+  timeCollectOpts += stats.GetNanoTimeCollectOpts();
+  timeBuildHyp += stats.GetNanoTimeBuildHyp();
+  timeCalcLM += stats.GetNanoTimeCalcLM();
+  timeEstimateScore += stats.GetNanoTimeEstimateScore();
+  timeOtherScore += stats.GetNanoTimeOtherScore();
+  timeStack += stats.GetNanoTimeStack();
+  AddTo(statelessTime, stats.GetStatelessFeatureTimes());
+  AddTo(statelessCalls, stats.GetStatelessFeatureCalls());
+  AddTo(statefulTime, stats.GetStatefulFeatureTimes());
+  AddTo(statefulCalls, stats.GetStatefulFeatureCalls());
+}
+
+bool DecoderProfile::Open(const string &path, size_t interval)
+{
+  m_interval = interval;
+  if (path == "-") {
+    m_out = &cerr;
+    return true;
+  }
+  m_file.reset(new ofstream(path.c_str()));
+  if (!m_file->good()) {
+    UserMessage::Add("Unable to open profile output file " + path);
+    m_file.reset();
+    return false;
+  }
+  m_out = m_file.get();
+  return true;
+}
+
+void DecoderProfile::Record(long translationId, const SentenceStats &stats)
+{
+  if (!IsEnabled()) return;
+
+  const string thread = CurrentThreadName();
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  m_total.Add(stats);
+  m_threadTotals[thread].Add(stats);
+
+  if (m_interval == 0) {
+    // flushed right away: mosesserver is ended by a signal and would lose
+    // whatever is still buffered
+    WriteSentence(translationId, thread, stats);
+    m_out->flush();
+  } else if (m_total.sentences % m_interval == 0) {
+    FlushLocked();
+  }
+}
+
+void DecoderProfile::Flush()
+{
+  if (!IsEnabled()) return;
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  FlushLocked();
+}
+
+void DecoderProfile::FlushLocked()
+{
+  map<string, Totals>::const_iterator iter;
+  for (iter = m_threadTotals.begin(); iter != m_threadTotals.end(); ++iter) {
+    WriteTotals(iter->first, iter->second);
+  }
+  WriteTotals("all", m_total);
+  m_out->flush();
+}
+
+void DecoderProfile::WriteSentence(long translationId, const string &thread, const SentenceStats &stats) const
+{
+  ostream &out = *m_out;
+  out << "{\"type\":\"sentence\",\"id\":" << translationId
+      << ",\"thread\":";
+  WriteJSONString(out, thread);
+  out << ",\"source_words\":" << stats.GetTotalSourceWords()
+      << ",\"hypotheses\":{\"created\":" << (stats.GetTotalHypos() - stats.GetNumHyposNotBuilt())
+      << ",\"not_built\":" << stats.GetNumHyposNotBuilt()
+      << ",\"discarded_early\":" << stats.GetNumHyposEarlyDiscarded()
+      << ",\"discarded\":" << stats.GetNumHyposDiscarded()
+      << ",\"recombined\":" << stats.GetNumHyposRecombined()
+      << ",\"pruned\":" << stats.GetNumHyposPruned()
+      << "},\"time_ns\":{\"total\":" << stats.GetNanoTimeTotal()
+      << ",\"collect_opts\":" << stats.GetNanoTimeCollectOpts()
+      << ",\"build_hyp\":" << stats.GetNanoTimeBuildHyp()
+      << ",\"calc_lm\":" << stats.GetNanoTimeCalcLM()
+      << ",\"future_cost\":" << stats.GetNanoTimeEstimateScore()
+      << ",\"other_score\":" << stats.GetNanoTimeOtherScore()
+      << ",\"stack\":" << stats.GetNanoTimeStack()
+      << "}";
+  WriteFeatures(stats.GetStatelessFeatureTimes(), stats.GetStatelessFeatureCalls(),
+                stats.GetStatefulFeatureTimes(), stats.GetStatefulFeatureCalls());
+  out << "}\n";
+}
+
+void DecoderProfile::WriteTotals(const string &thread, const Totals &totals) const
+{
+  ostream &out = *m_out;
+  out << "{\"type\":\"totals\",\"thread\":";
+  WriteJSONString(out, thread);
+  out << ",\"sentences\":" << totals.sentences
+      << ",\"source_words\":" << totals.sourceWords
+      << ",\"hypotheses\":{\"created\":" << totals.hyposCreated
+      << ",\"not_built\":" << totals.hyposNotBuilt
+      << ",\"discarded_early\":" << totals.hyposEarlyDiscarded
+      << ",\"discarded\":" << totals.hyposDiscarded
+      << ",\"recombined\":" << totals.hyposRecombined
+      << ",\"pruned\":" << totals.hyposPruned
+      << "},\"time_ns\":{\"total\":" << totals.timeTotal
+      << ",\"collect_opts\":" << totals.timeCollectOpts
+      << ",\"build_hyp\":" << totals.timeBuildHyp
+      << ",\"calc_lm\":" << totals.timeCalcLM
+      << ",\"future_cost\":" << totals.timeEstimateScore
+      << ",\"other_score\":" << totals.timeOtherScore
+      << ",\"stack\":" << totals.timeStack
+      << "}";
+  WriteFeatures(totals.statelessTime, totals.statelessCalls,
+                totals.statefulTime, totals.statefulCalls);
+  out << "}\n";
+}
+
+void DecoderProfile::WriteFeatures(const vector<uint64_t> &statelessTime, const vector<uint64_t> &statelessCalls,
+                                   const vector<uint64_t> &statefulTime, const vector<uint64_t> &statefulCalls) const
+{
+  ostream &out = *m_out;
+  const vector<const StatelessFeatureFunction*> &sfs =
+    StatelessFeatureFunction::GetStatelessFeatureFunctions();
+  const vector<const StatefulFeatureFunction*> &ffs =
+    StatefulFeatureFunction::GetStatefulFeatureFunctions();
+
+  out << ",\"features\":[";
+  bool first = true;
+  for (size_t i = 0; i < statelessTime.size() && i < sfs.size(); ++i) {
+    if (!first) out << ",";
+    first = false;
+    out << "{\"name\":";
+    WriteJSONString(out, sfs[i]->GetScoreProducerDescription());
+    out << ",\"time_ns\":" << statelessTime[i] << ",\"calls\":" << statelessCalls[i] << "}";
+  }
+  for (size_t i = 0; i < statefulTime.size() && i < ffs.size(); ++i) {
+    if (!first) out << ",";
+    first = false;
+    out << "{\"name\":";
+    WriteJSONString(out, ffs[i]->GetScoreProducerDescription());
+    out << ",\"time_ns\":" << statefulTime[i] << ",\"calls\":" << statefulCalls[i] << "}";
+  }
+  out << "]";
+}
+
+}
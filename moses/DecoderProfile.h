@@ -0,0 +1,119 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_DecoderProfile_h
+#define moses_DecoderProfile_h
+
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+namespace Moses
+{
+
+class SentenceStats;
+
+/** Wall-clock time in nanoseconds from a monotonic source. Unlike clock(),
+ * which measures CPU time of the whole process, this is meaningful per thread.
+ */
+inline uint64_t MonotonicNanoTime()
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<uint64_t>(tv.tv_sec) * 1000000000ULL + tv.tv_usec * 1000ULL;
+#endif
+}
+
+/** Collects the per-sentence timings in SentenceStats and writes them as
+ * JSON lines: either one object per sentence, or per-thread and overall
+ * totals every n sentences (and at Flush()).
+ */
+class DecoderProfile
+{
+public:
+  static DecoderProfile &Instance() {
+    return s_instance;
+  }
+
+  /** start writing to path ("-" for stderr). interval 0 reports every
+   * sentence, otherwise totals are reported every interval sentences */
+  bool Open(const std::string &path, size_t interval);
+
+  bool IsEnabled() const {
+    return m_out != NULL;
+  }
+
+  //! add stats of a finished sentence, called once per sentence by each worker
+  void Record(long translationId, const SentenceStats &stats);
+
+  //! write the totals accumulated so far
+  void Flush();
+
+protected:
+  //! aggregated counts and times of a set of sentences
+  struct Totals {
+    Totals();
+    void Add(const SentenceStats &stats);
+
+    size_t sentences, sourceWords;
+    uint64_t hyposCreated, hyposNotBuilt, hyposEarlyDiscarded, hyposDiscarded, hyposRecombined, hyposPruned;
+    uint64_t timeTotal, timeCollectOpts, timeBuildHyp, timeCalcLM, timeEstimateScore, timeOtherScore, timeStack;
+    std::vector<uint64_t> statelessTime, statelessCalls, statefulTime, statefulCalls;
+  };
+
+  static DecoderProfile s_instance;
+
+  std::ostream *m_out;
+  std::auto_ptr<std::ofstream> m_file;
+  size_t m_interval;
+  Totals m_total;
+  std::map<std::string, Totals> m_threadTotals;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+
+  DecoderProfile() : m_out(NULL), m_interval(0) {}
+
+  void WriteSentence(long translationId, const std::string &thread, const SentenceStats &stats) const;
+  void WriteTotals(const std::string &thread, const Totals &totals) const;
+  void WriteFeatures(const std::vector<uint64_t> &statelessTime, const std::vector<uint64_t> &statelessCalls,
+                     const std::vector<uint64_t> &statefulTime, const std::vector<uint64_t> &statefulCalls) const;
+  void FlushLocked();
+};
+
+}
+
+#endif
@@ -1,26 +1,64 @@
 #include <fstream>
+#include <algorithm>
+#include <boost/unordered_map.hpp>
 #include "GlobalLexicalModel.h"
 #include "moses/StaticData.h"
 #include "moses/InputFileStream.h"
 #include "moses/TranslationOption.h"
 #include "moses/UserMessage.h"
+#include "util/murmur_hash.hh"
 
 using namespace std;
 
 namespace Moses
 {
+void GlobalLexicalModel::WordIds::Build(const std::vector<uint64_t> &keys)
+{
+  // load factor of at most 3/4
+  size_t numSlots = 1;
+  while(numSlots * 3 < keys.size() * 4 + 4) {
+    numSlots *= 2;
+  }
+  m_keys.assign(numSlots, 0);
+  m_ids.assign(numSlots, NOT_FOUND);
+  const size_t mask = numSlots - 1;
+  for (size_t id = 0; id < keys.size(); ++id) {
+    const uint64_t key = keys[id] ? keys[id] : 1;
+    size_t slot = key & mask;
+    while (m_keys[slot]) {
+      slot = (slot + 1) & mask;
+    }
+    m_keys[slot] = key;
+    m_ids[slot] = id;
+  }
+}
+
+size_t GlobalLexicalModel::WordIds::Find(uint64_t key) const
+{
+  if (!key) {
+    key = 1;
+  }
+  const size_t mask = m_keys.size() - 1;
+  for (size_t slot = key & mask; m_keys[slot]; slot = (slot + 1) & mask) {
+    if (m_keys[slot] == key) {
+      return m_ids[slot];
+    }
+  }
+  return NOT_FOUND;
+}
+
 GlobalLexicalModel::GlobalLexicalModel(const std::string &line)
   : StatelessFeatureFunction("GlobalLexicalModel",1, line)
+  , m_numOutputWords(0)
+  , m_bias(NOT_FOUND)
 {
   std::cerr << "Creating global lexical model...\n";
   ReadParameters();
 
-  // define bias word
-  FactorCollection &factorCollection = FactorCollection::Instance();
-  m_bias = new Word();
-  const Factor* factor = factorCollection.AddFactor( Input, m_inputFactorsVec[0], "**BIAS**" );
-  m_bias->SetFactor( m_inputFactorsVec[0], factor );
-
+  float sum = 0;
+  m_unknownScore = FloorScore( log(1/(1+exp(-sum))) );
+  m_outputWords.Build(std::vector<uint64_t>());
+  m_inputWords.Build(std::vector<uint64_t>());
 }
 
 void GlobalLexicalModel::SetParameter(const std::string& key, const std::string& value)
@@ -38,15 +76,18 @@ void GlobalLexicalModel::SetParameter(const std::string& key, const std::string&
 
 GlobalLexicalModel::~GlobalLexicalModel()
 {
-  // delete words in the hash data structure
-  DoubleHash::const_iterator iter;
-  for(iter = m_hash.begin(); iter != m_hash.end(); iter++ ) {
-    map< const Word*, float, WordComparer >::const_iterator iter2;
-    for(iter2 = iter->second.begin(); iter2 != iter->second.end(); iter2++ ) {
-      delete iter2->first; // delete input word
-    }
-    delete iter->first; // delete output word
+}
+
+//! hash of the factor ids of the given factors of a word
+uint64_t GlobalLexicalModel::HashWord(const Word &word, const std::vector<FactorType> &factors) const
+{
+  uint64_t ids[MAX_NUM_FACTORS];
+  const size_t numFactors = std::min(factors.size(), (size_t) MAX_NUM_FACTORS);
+  for (size_t i = 0; i < numFactors; ++i) {
+    const Factor *factor = word[factors[i]];
+    ids[i] = factor ? factor->GetId() + 1 : 0;
   }
+  return util::MurmurHashNative(ids, numFactors * sizeof(uint64_t));
 }
 
 void GlobalLexicalModel::Load()
@@ -60,6 +101,13 @@ void GlobalLexicalModel::Load()
   m_outputFactors = FactorMask(m_outputFactorsVec);
   InputFileStream inFile(m_filePath);
 
+  // number the words in order of appearance
+  boost::unordered_map<uint64_t, size_t> outputIds, inputIds;
+  std::vector<uint64_t> outputKeys, inputKeys;
+  // weight of each (input word, output word) pair, later lines replace earlier ones
+  typedef boost::unordered_map<std::pair<size_t, size_t>, float> WeightMap;
+  WeightMap weights;
+
   // reading in data one line at a time
   size_t lineNum = 0;
   string line;
@@ -75,94 +123,120 @@ void GlobalLexicalModel::Load()
     }
 
     // create the output word
-    Word *outWord = new Word();
+    Word outWord;
     vector<string> factorString = Tokenize( token[0], factorDelimiter );
     for (size_t i=0 ; i < m_outputFactorsVec.size() ; i++) {
       const FactorDirection& direction = Output;
       const FactorType& factorType = m_outputFactorsVec[i];
       const Factor* factor = factorCollection.AddFactor( direction, factorType, factorString[i] );
-      outWord->SetFactor( factorType, factor );
+      outWord.SetFactor( factorType, factor );
     }
 
     // create the input word
-    Word *inWord = new Word();
+    Word inWord;
     factorString = Tokenize( token[1], factorDelimiter );
     for (size_t i=0 ; i < m_inputFactorsVec.size() ; i++) {
       const FactorDirection& direction = Input;
       const FactorType& factorType = m_inputFactorsVec[i];
       const Factor* factor = factorCollection.AddFactor( direction, factorType, factorString[i] );
-      inWord->SetFactor( factorType, factor );
+      inWord.SetFactor( factorType, factor );
     }
 
     // maximum entropy feature score
     float score = Scan<float>(token[2]);
 
-    // std::cerr << "storing word " << *outWord << " " << *inWord << " " << score << endl;
-
-    // store feature in hash
-    DoubleHash::iterator keyOutWord = m_hash.find( outWord );
-    if( keyOutWord == m_hash.end() ) {
-      m_hash[outWord][inWord] = score;
-    } else { // already have hash for outword, delete the word to avoid leaks
-      (keyOutWord->second)[inWord] = score;
-      delete outWord;
+    const uint64_t outKey = HashWord(outWord, m_outputFactorsVec);
+    const size_t outId = outputIds.insert(make_pair(outKey, outputKeys.size())).first->second;
+    if (outId == outputKeys.size()) {
+      outputKeys.push_back(outKey);
     }
+    const uint64_t inKey = HashWord(inWord, m_inputFactorsVec);
+    const size_t inId = inputIds.insert(make_pair(inKey, inputKeys.size())).first->second;
+    if (inId == inputKeys.size()) {
+      inputKeys.push_back(inKey);
+    }
+    weights[make_pair(inId, outId)] = score;
+  }
+
+  m_outputWords.Build(outputKeys);
+  m_numOutputWords = outputKeys.size();
+  m_inputWords.Build(inputKeys);
+
+  // group the weights by input word
+  m_weightsBegin.assign(inputKeys.size() + 1, 0);
+  for (WeightMap::const_iterator iter = weights.begin(); iter != weights.end(); ++iter) {
+    ++m_weightsBegin[iter->first.first + 1];
+  }
+  for (size_t i = 1; i < m_weightsBegin.size(); ++i) {
+    m_weightsBegin[i] += m_weightsBegin[i - 1];
   }
+  m_weightOutputWord.resize(weights.size());
+  m_weights.resize(weights.size());
+  std::vector<size_t> next(m_weightsBegin.begin(), m_weightsBegin.end() - 1);
+  for (WeightMap::const_iterator iter = weights.begin(); iter != weights.end(); ++iter) {
+    const size_t pos = next[iter->first.first]++;
+    m_weightOutputWord[pos] = iter->first.second;
+    m_weights[pos] = iter->second;
+  }
+
+  // define bias word
+  Word bias;
+  bias.SetFactor( m_inputFactorsVec[0], factorCollection.AddFactor( Input, m_inputFactorsVec[0], "**BIAS**" ) );
+  m_bias = m_inputWords.Find(HashWord(bias, m_inputFactorsVec));
 }
 
-void GlobalLexicalModel::InitializeForInput( Sentence const& in )
+void GlobalLexicalModel::InitializeForInput( InputType const& in )
 {
   m_local.reset(new ThreadLocalStorage);
   m_local->input = &in;
 }
 
-float GlobalLexicalModel::ScorePhrase( const TargetPhrase& targetPhrase ) const
+//! score of every output word for the current input, computed on first use
+const std::vector<float> &GlobalLexicalModel::GetScores() const
 {
-  const Sentence& input = *(m_local->input);
-  float score = 0;
-  for(size_t targetIndex = 0; targetIndex < targetPhrase.GetSize(); targetIndex++ ) {
-    float sum = 0;
-    const Word& targetWord = targetPhrase.GetWord( targetIndex );
-    VERBOSE(2,"glm " << targetWord << ": ");
-    const DoubleHash::const_iterator targetWordHash = m_hash.find( &targetWord );
-    if( targetWordHash != m_hash.end() ) {
-      SingleHash::const_iterator inputWordHash = targetWordHash->second.find( m_bias );
-      if( inputWordHash != targetWordHash->second.end() ) {
-        VERBOSE(2,"*BIAS* " << inputWordHash->second);
-        sum += inputWordHash->second;
-      }
+  ThreadLocalStorage &local = *m_local;
+  std::vector<float> &scores = local.scores;
+  if (!scores.empty() || m_numOutputWords == 0) {
+    return scores;
+  }
 
-      set< const Word*, WordComparer > alreadyScored; // do not score a word twice
-      for(size_t inputIndex = 0; inputIndex < input.GetSize(); inputIndex++ ) {
-        const Word& inputWord = input.GetWord( inputIndex );
-        if ( alreadyScored.find( &inputWord ) == alreadyScored.end() ) {
-          SingleHash::const_iterator inputWordHash = targetWordHash->second.find( &inputWord );
-          if( inputWordHash != targetWordHash->second.end() ) {
-            VERBOSE(2," " << inputWord << " " << inputWordHash->second);
-            sum += inputWordHash->second;
-          }
-          alreadyScored.insert( &inputWord );
-        }
-      }
+  // sum the weights of the bias and of each distinct input word, in this order
+  std::vector<size_t> inputWords;
+  if (m_bias != NOT_FOUND) {
+    inputWords.push_back(m_bias);
+  }
+  const InputType &input = *local.input;
+  for(size_t inputIndex = 0; inputIndex < input.GetSize(); inputIndex++ ) {
+    const size_t id = m_inputWords.Find(HashWord(input.GetWord(inputIndex), m_inputFactorsVec));
+    if (id != NOT_FOUND && id != m_bias
+        && std::find(inputWords.begin(), inputWords.end(), id) == inputWords.end()) {
+      inputWords.push_back(id);
     }
-    // Hal Daume says: 1/( 1 + exp [ - sum_i w_i * f_i ] )
-    VERBOSE(2," p=" << FloorScore( log(1/(1+exp(-sum))) ) << endl);
-    score += FloorScore( log(1/(1+exp(-sum))) );
   }
-  return score;
+
+  scores.assign(m_numOutputWords, 0);
+  for (size_t i = 0; i < inputWords.size(); ++i) {
+    for (size_t pos = m_weightsBegin[inputWords[i]]; pos < m_weightsBegin[inputWords[i] + 1]; ++pos) {
+      scores[m_weightOutputWord[pos]] += m_weights[pos];
+    }
+  }
+
+  // Hal Daume says: 1/( 1 + exp [ - sum_i w_i * f_i ] )
+  for (size_t i = 0; i < scores.size(); ++i) {
+    const float sum = scores[i];
+    scores[i] = (sum == 0) ? m_unknownScore : FloorScore( log(1/(1+exp(-sum))) );
+  }
+  return scores;
 }
 
-float GlobalLexicalModel::GetFromCacheOrScorePhrase( const TargetPhrase& targetPhrase ) const
+float GlobalLexicalModel::ScorePhrase( const TargetPhrase& targetPhrase ) const
 {
-  LexiconCache& m_cache = m_local->cache;
-  const LexiconCache::const_iterator query = m_cache.find( &targetPhrase );
-  if ( query != m_cache.end() ) {
-    return query->second;
+  const std::vector<float> &scores = GetScores();
+  float score = 0;
+  for(size_t targetIndex = 0; targetIndex < targetPhrase.GetSize(); targetIndex++ ) {
+    const size_t id = m_outputWords.Find(HashWord(targetPhrase.GetWord( targetIndex ), m_outputFactorsVec));
+    score += (id == NOT_FOUND) ? m_unknownScore : scores[id];
   }
-
-  float score = ScorePhrase( targetPhrase );
-  m_cache.insert( pair<const TargetPhrase*, float>(&targetPhrase, score) );
-  //VERBOSE(2, "add to cache " << targetPhrase << ": " << score << endl);
   return score;
 }
 
@@ -170,8 +244,7 @@ void GlobalLexicalModel::Evaluate
 (const PhraseBasedFeatureContext& context,
  ScoreComponentCollection* accumulator) const
 {
-  accumulator->PlusEquals( this,
-                           GetFromCacheOrScorePhrase(context.GetTargetPhrase()) );
+  accumulator->PlusEquals( this, ScorePhrase(context.GetTargetPhrase()) );
 }
 
 bool GlobalLexicalModel::IsUseable(const FactorMask &mask) const
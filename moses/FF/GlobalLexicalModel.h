@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <stdint.h>
 #include "StatelessFeatureFunction.h"
 #include "moses/Factor.h"
 #include "moses/Phrase.h"
@@ -30,26 +31,48 @@ class InputType;
  * This is a implementation of Mauser et al., 2009's model that predicts
  * each output word from _all_ the input words. The intuition behind this
  * feature is that it uses context words for disambiguation
+ *
+ * Input and output words are numbered when the model is loaded, and the
+ * weights are stored per input word. The score of every output word only
+ * depends on the input sentence, so it is computed for all output words
+ * the first time the sentence is scored, and scoring a target phrase
+ * takes one table lookup per word.
  */
 class GlobalLexicalModel : public StatelessFeatureFunction
 {
-  typedef std::map< const Word*, std::map< const Word*, float, WordComparer >, WordComparer > DoubleHash;
-  typedef std::map< const Word*, float, WordComparer > SingleHash;
-  typedef std::map< const TargetPhrase*, float > LexiconCache;
+  //! open addressing table from the hashed factors of a word to its number
+  class WordIds
+  {
+  public:
+    //! keys[i] is the key of word i
+    void Build(const std::vector<uint64_t> &keys);
+    size_t Find(uint64_t key) const;
+
+  private:
+    std::vector<uint64_t> m_keys; //! key per slot, 0 marks an empty slot
+    std::vector<size_t> m_ids;
+  };
 
   struct ThreadLocalStorage {
-    LexiconCache cache;
-    const Sentence *input;
+    const InputType *input;
+    std::vector<float> scores; //! per output word, empty until first use
   };
 
 private:
-  DoubleHash m_hash;
+  WordIds m_outputWords, m_inputWords;
+  size_t m_numOutputWords;
+  //! weights of input word i are m_weights[m_weightsBegin[i]..m_weightsBegin[i+1])
+  std::vector<size_t> m_weightsBegin;
+  std::vector<size_t> m_weightOutputWord;
+  std::vector<float> m_weights;
+  size_t m_bias; //! number of the input word **BIAS**, or NOT_FOUND
+  float m_unknownScore; //! score of a word without weights
+
 #ifdef WITH_THREADS
   boost::thread_specific_ptr<ThreadLocalStorage> m_local;
 #else
   std::auto_ptr<ThreadLocalStorage> m_local;
 #endif
-  Word *m_bias;
 
   FactorMask m_inputFactors, m_outputFactors;
   std::vector<FactorType> m_inputFactorsVec, m_outputFactorsVec;
@@ -57,14 +80,15 @@ private:
 
   void Load();
 
+  uint64_t HashWord(const Word &word, const std::vector<FactorType> &factors) const;
+  const std::vector<float> &GetScores() const;
   float ScorePhrase( const TargetPhrase& targetPhrase ) const;
-  float GetFromCacheOrScorePhrase( const TargetPhrase& targetPhrase ) const;
 
 public:
   GlobalLexicalModel(const std::string &line);
   virtual ~GlobalLexicalModel();
 
-  void InitializeForInput( Sentence const& in );
+  void InitializeForInput( InputType const& in );
 
   bool IsUseable(const FactorMask &mask) const;
 
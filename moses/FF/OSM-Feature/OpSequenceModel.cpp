@@ -40,9 +40,49 @@ void OpSequenceModel :: readLanguageModel(const char *lmFile)
   // Code to load KenLM
 
   OSM = new Model(m_lmPath.c_str());
+  m_operationIds.Load(*OSM);
   State startState = OSM->NullContextState();
   State endState;
-  unkOpProb = OSM->Score(startState,OSM->GetVocabulary().Index(unkOp),endState);
+  unkOpProb = OSM->Score(startState,m_operationIds.translateSelf,endState);
+}
+
+void OpSequenceModel::InitializeForInput(InputType const& source)
+{
+  m_local.reset(new ThreadLocalStorage);
+}
+
+const osmPhraseOperations &OpSequenceModel::GetOperations(const TranslationOption &option, const InputType &source) const
+{
+  OperationCache &cache = m_local->cache;
+  std::pair<OperationCache::iterator, bool> inserted = cache.insert(make_pair(&option, osmPhraseOperations()));
+  if (!inserted.second) {
+    return inserted.first->second;
+  }
+
+  const TargetPhrase &target = option.GetTargetPhrase();
+  vector <string> mySourcePhrase;
+  vector <string> myTargetPhrase;
+  vector <int> alignments;
+
+  const AlignmentInfo &align = target.GetAlignTerm();
+  for (AlignmentInfo::const_iterator iter = align.begin(); iter != align.end(); ++iter) {
+    alignments.push_back(iter->first);
+    alignments.push_back(iter->second);
+  }
+
+  for (size_t i = option.GetStartPos(); i <= option.GetEndPos(); i++) {
+    mySourcePhrase.push_back(source.GetWord(i).GetFactor(0)->GetString().as_string());
+  }
+
+  for (size_t i = 0; i < target.GetSize(); i++) {
+    if (target.GetWord(i).IsOOV())
+      myTargetPhrase.push_back("_TRANS_SLF_");
+    else
+      myTargetPhrase.push_back(target.GetWord(i).GetFactor(0)->GetString().as_string());
+  }
+
+  inserted.first->second.Construct(*OSM, m_operationIds, mySourcePhrase, myTargetPhrase, alignments);
+  return inserted.first->second;
 }
 
 
@@ -91,7 +131,7 @@ void OpSequenceModel:: Evaluate(const Phrase &source
                                 , ScoreComponentCollection &estimatedFutureScore) const
 {
 
-  osmHypothesis obj;
+  osmHypothesis obj(m_operationIds);
   obj.setState(OSM->NullContextState());
   WordsBitmap myBitmap(source.GetSize());
   vector <string> mySourcePhrase;
@@ -99,7 +139,6 @@ void OpSequenceModel:: Evaluate(const Phrase &source
   vector<float> scores(5);
   vector <int> alignments;
   int startIndex = 0;
-  int endIndex = source.GetSize();
 
   const AlignmentInfo &align = targetPhrase.GetAlignTerm();
   AlignmentInfo::const_iterator iter;
@@ -121,9 +160,9 @@ void OpSequenceModel:: Evaluate(const Phrase &source
     mySourcePhrase.push_back(source.GetWord(i).GetFactor(0)->GetString().as_string());
   }
 
-  obj.setPhrases(mySourcePhrase , myTargetPhrase);
-  obj.constructCepts(alignments,startIndex,endIndex-1,targetPhrase.GetSize());
-  obj.computeOSMFeature(startIndex,myBitmap);
+  osmPhraseOperations operations;
+  operations.Construct(*OSM, m_operationIds, mySourcePhrase, myTargetPhrase, alignments);
+  obj.computeOSMFeature(startIndex,myBitmap,operations);
   obj.calculateOSMProb(*OSM);
   obj.populateScores(scores);
   estimatedFutureScore.PlusEquals(this, scores);
@@ -136,112 +175,31 @@ FFState* OpSequenceModel::Evaluate(
   const FFState* prev_state,
   ScoreComponentCollection* accumulator) const
 {
-  const TargetPhrase &target = cur_hypo.GetCurrTargetPhrase();
-  const WordsBitmap &bitmap = cur_hypo.GetWordsBitmap();
-  WordsBitmap myBitmap = bitmap;
-  const Manager &manager = cur_hypo.GetManager();
-  const InputType &source = manager.GetSource();
-  const Sentence &sourceSentence = static_cast<const Sentence&>(source);
-  osmHypothesis obj;
-  vector <string> mySourcePhrase;
-  vector <string> myTargetPhrase;
+  WordsBitmap myBitmap = cur_hypo.GetWordsBitmap();
+  const InputType &source = cur_hypo.GetManager().GetSource();
+  osmHypothesis obj(m_operationIds);
   vector<float> scores(5);
 
-
-  //target.GetWord(0)
-
-  //cerr << target <<" --- "<<target.GetSourcePhrase()<< endl;  // English ...
-
-  //cerr << align << endl;   // Alignments ...
-  //cerr << cur_hypo.GetCurrSourceWordsRange() << endl;
-
-  //cerr << source <<endl;
-
-// int a = sourceRange.GetStartPos();
-// cerr << source.GetWord(a);
-  //cerr <<a<<endl;
-
-  //const Sentence &sentence = static_cast<const Sentence&>(curr_hypo.GetManager().GetSource());
-
-
   const WordsRange & sourceRange = cur_hypo.GetCurrSourceWordsRange();
   int startIndex  = sourceRange.GetStartPos();
   int endIndex = sourceRange.GetEndPos();
-  const AlignmentInfo &align = cur_hypo.GetCurrTargetPhrase().GetAlignTerm();
-  osmState * statePtr;
-
-  vector <int> alignments;
-
-
-
-  AlignmentInfo::const_iterator iter;
-
-  for (iter = align.begin(); iter != align.end(); ++iter) {
-    //cerr << iter->first << "----" << iter->second << " ";
-    alignments.push_back(iter->first);
-    alignments.push_back(iter->second);
-  }
-
-
-  //cerr<<bitmap<<endl;
-  //cerr<<startIndex<<" "<<endIndex<<endl;
-
 
   for (int i = startIndex; i <= endIndex; i++) {
     myBitmap.SetValue(i,0); // resetting coverage of this phrase ...
-    mySourcePhrase.push_back(source.GetWord(i).GetFactor(0)->GetString().as_string());
-    // cerr<<mySourcePhrase[i]<<endl;
-  }
-
-  for (int i = 0; i < target.GetSize(); i++) {
-
-    if (target.GetWord(i).IsOOV())
-      myTargetPhrase.push_back("_TRANS_SLF_");
-    else
-      myTargetPhrase.push_back(target.GetWord(i).GetFactor(0)->GetString().as_string());
-
   }
 
-
-  //cerr<<myBitmap<<endl;
+  // the operations that only depend on the phrase pair are computed once
+  // per translation option
+  const osmPhraseOperations &operations = GetOperations(cur_hypo.GetTranslationOption(), source);
 
   obj.setState(prev_state);
-  obj.constructCepts(alignments,startIndex,endIndex,target.GetSize());
-  obj.setPhrases(mySourcePhrase , myTargetPhrase);
-  obj.computeOSMFeature(startIndex,myBitmap);
+  obj.computeOSMFeature(startIndex,myBitmap,operations);
   obj.calculateOSMProb(*OSM);
   obj.populateScores(scores);
 
-  /*
-    if (bitmap.GetFirstGapPos() == NOT_FOUND)
-    {
-
-      int xx;
-  	 cerr<<bitmap<<endl;
-  	 int a = bitmap.GetFirstGapPos();
-  	 obj.print();
-      cin>>xx;
-    }
-    */
-
-  /*
-    vector<float> scores(5);
-    scores[0] = 0.343423f;
-    scores[1] = 1.343423f;
-    scores[2] = 2.343423f;
-    scores[3] = 3.343423f;
-    scores[4] = 4.343423f;
-    */
-
   accumulator->PlusEquals(this, scores);
 
   return obj.saveState();
-
-
-
-
-  //return statePtr;
-// return NULL;
 }
 
 FFState* OpSequenceModel::EvaluateChart(
@@ -2,12 +2,18 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <vector>
+#include <boost/unordered_map.hpp>
 #include "moses/FF/StatefulFeatureFunction.h"
 #include "moses/Manager.h"
 #include "moses/FF/OSM-Feature/osmHyp.h"
 #include "lm/model.hh"
 
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#endif
+
 
 namespace Moses
 {
@@ -24,6 +30,8 @@ public:
 
   OpSequenceModel(const std::string &line);
 
+  void InitializeForInput(InputType const& source);
+
   void readLanguageModel(const char *);
   void Load();
 
@@ -54,12 +62,27 @@ public:
   }
 
 protected:
+  //! operations of the translation options of the current sentence
+  typedef boost::unordered_map<const TranslationOption*, osmPhraseOperations> OperationCache;
+
+  struct ThreadLocalStorage {
+    OperationCache cache;
+  };
+
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<ThreadLocalStorage> m_local;
+#else
+  mutable std::auto_ptr<ThreadLocalStorage> m_local;
+#endif
+
+  osmOperationIds m_operationIds;
+
+  const osmPhraseOperations &GetOperations(const TranslationOption &option, const InputType &source) const;
+
   typedef std::pair<Phrase, Phrase> ParallelPhrase;
   typedef std::vector<float> Scores;
   std::map<ParallelPhrase, Scores> m_futureCost;
 
-  std::vector < std::pair < std::set <int> , std::set <int> > > ceptsInPhrase;
-  std::set <int> targetNullWords;
   std::string m_featurePath, m_lmPath;
 
 
@@ -1,4 +1,5 @@
 #include "osmHyp.h"
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
@@ -14,9 +15,8 @@ osmState::osmState(const State & val)
 
 }
 
-void osmState::saveState(int jVal, int eVal, map <int , string> & gapVal)
+void osmState::saveState(int jVal, int eVal, const osmGaps & gapVal)
 {
-  gap.clear();
   gap = gapVal;
   j = jVal;
   E = eVal;
@@ -48,125 +48,250 @@ std::string osmState :: getName() const
 
 //////////////////////////////////////////////////
 
-osmHypothesis :: osmHypothesis()
+void osmOperationIds::Load(const Model &model)
 {
-  opProb = 0;
-  gapWidth = 0;
-  gapCount = 0;
-  openGapCount = 0;
-  deletionCount = 0;
-  gapCount = 0;
-  j = 0;
-  E = 0;
-  gap.clear();
+  const Vocabulary &vocab = model.GetVocabulary();
+  m_model = &model;
+  insertGap = vocab.Index("_INS_GAP_");
+  jumpForward = vocab.Index("_JMP_FWD_");
+  continueCept = vocab.Index("_CONT_CEPT_");
+  translateSelf = vocab.Index("_TRANS_SLF_");
+
+  // jumps back over more gaps than this are rare enough to be looked up
+  m_jumpBack.clear();
+  for (int gaps = 0; gaps < 64; ++gaps) {
+    m_jumpBack.push_back(vocab.Index("_JMP_BCK_" + SPrint(gaps)));
+  }
 }
 
-void osmHypothesis :: setState(const FFState* prev_state)
+//////////////////////////////////////////////////
+
+void osmPhraseOperations :: getMeCepts ( set <int> & eSide , set <int> & fSide , map <int , vector <int> > & tS , map <int , vector <int> > & sT)
 {
+  set <int> :: iterator iter;
 
-  if(prev_state != NULL) {
+  int sz = eSide.size();
+
+  for (iter = eSide.begin(); iter != eSide.end(); iter++) {
+    const vector <int> &t = tS[*iter];
+
+    for (int i = 0; i < t.size(); i++) {
+      fSide.insert(t[i]);
+    }
 
-    j = static_cast <const osmState *> (prev_state)->getJ();
-    E =  static_cast <const osmState *> (prev_state)->getE();
-    gap = static_cast <const osmState *> (prev_state)->getGap();
-    lmState = static_cast <const osmState *> (prev_state)->getLMState();
   }
+
+  for (iter = fSide.begin(); iter != fSide.end(); iter++) {
+
+    const vector <int> &t = sT[*iter];
+
+    for (int i = 0 ; i<t.size(); i++) {
+      eSide.insert(t[i]);
+    }
+
+  }
+
+  if (eSide.size () > sz) {
+    getMeCepts(eSide,fSide,tS,sT);
+  }
+
 }
 
-osmState * osmHypothesis :: saveState()
+void osmPhraseOperations :: generateDeleteOperations(const Model &model, const vector<string> &currE, const set<int> &sourceNullWords, int currTargetIndex, const set <int> &doneTargetIndexes, vector<lm::WordIndex> &deletions)
 {
+  // a run of unaligned target words, skipping those already covered by a cept
+  do {
+    deletions.push_back(model.GetVocabulary().Index("_DEL_" + currE[currTargetIndex]));
+    currTargetIndex++;
 
-  osmState * statePtr = new osmState(lmState);
-  statePtr->saveState(j,E,gap);
-  return statePtr;
+    while(doneTargetIndexes.find(currTargetIndex) != doneTargetIndexes.end()) {
+      currTargetIndex++;
+    }
+  } while (sourceNullWords.find(currTargetIndex) != sourceNullWords.end());
 }
 
-int osmHypothesis :: isTranslationOperation(int x)
+void osmPhraseOperations :: Construct(const Model &model
+                                      , const osmOperationIds &ids
+                                      , const vector<string> &currF
+                                      , const vector<string> &currE
+                                      , const vector<int> &align)
 {
-  if (operations[x].find("_JMP_BCK_") != -1)
-    return 0;
+  const Vocabulary &vocab = model.GetVocabulary();
+  std::map <int , vector <int> > sT;
+  std::map <int , vector <int> > tS;
+  std::set <int> eSide;
+  std::set <int> fSide;
+  std::set <int> sourceNullWords; // unaligned target words
+  std::set <int> :: iterator iter;
+  std :: map <int , vector <int> > :: iterator iter2;
 
-  if (operations[x].find("_JMP_FWD_") != -1)
-    return 0;
+  for (int i = 0;  i < align.size(); i+=2) {
+    tS[align[i+1]].push_back(align[i]);
+    sT[align[i]].push_back(align[i+1]);
+  }
 
-  if (operations[x].find("_CONT_CEPT_") != -1)
-    return 0;
+  insertions.assign(currF.size(), 0);
+  unalignedSource.assign(currF.size(), false);
+  for (int i = 0; i < currF.size(); i++) { // What are unaligned source words in this phrase ...
+    if (sT.find(i) == sT.end()) {
+      unalignedSource[i] = true;
+      insertions[i] = vocab.Index("_INS_" + currF[i]);
+    }
+  }
 
-  if (operations[x].find("_INS_GAP_") != -1)
-    return 0;
+  for (int i = 0; i < currE.size(); i++) { // What are unaligned target words in this phrase ...
+    if (tS.find(i) == tS.end()) {
+      sourceNullWords.insert(i);
+    }
+  }
 
-  return 1;
+  vector < pair < set <int> , set <int> > > ceptsInPhrase;
+  while (tS.size() != 0 && sT.size() != 0) {
 
-}
+    iter2 = tS.begin();
 
-void osmHypothesis :: removeReorderingOperations()
-{
-  gapCount = 0;
-  deletionCount = 0;
-  openGapCount = 0;
-  gapWidth = 0;
-  //cout<<"I came here"<<endl;
+    eSide.clear();
+    fSide.clear();
+    eSide.insert (iter2->first);
 
-  std::vector <std::string> tupleSequence;
+    getMeCepts(eSide, fSide, tS , sT);
 
-  for (int x = 0; x < operations.size(); x++) {
-    // cout<<operations[x]<<endl;
+    for (iter = eSide.begin(); iter != eSide.end(); iter++) {
+      iter2 = tS.find(*iter);
+      tS.erase(iter2);
+    }
 
-    if(isTranslationOperation(x) == 1) {
-      tupleSequence.push_back(operations[x]);
+    for (iter = fSide.begin(); iter != fSide.end(); iter++) {
+      iter2 = sT.find(*iter);
+      sT.erase(iter2);
     }
 
+    ceptsInPhrase.push_back(make_pair (fSide , eSide));
   }
 
-  operations.clear();
-  operations = tupleSequence;
-}
+  // operations in the order computeOSMFeature issues them
+  set <int> doneTargetIndexes;
+  int targetIndex = 0;
+  initialDeletions.clear();
+  if (sourceNullWords.find(targetIndex) != sourceNullWords.end()) { // first word has to be deleted ...
+    generateDeleteOperations(model, currE, sourceNullWords, targetIndex, doneTargetIndexes, initialDeletions);
+  }
 
-void osmHypothesis :: calculateOSMProb(Model & ptrOp)
-{
+  cepts.resize(ceptsInPhrase.size());
+  for (int i = 0; i < ceptsInPhrase.size(); i++) {
+    const set <int> &fSide = ceptsInPhrase[i].first;
+    const set <int> &eSide = ceptsInPhrase[i].second;
+    Cept &cept = cepts[i];
+    string english;
+    string source;
 
-  opProb = 0;
-  State currState = lmState;
-  State temp;
+    iter = eSide.begin();
+    targetIndex = *iter;
+    english += currE[*iter];
+    iter++;
 
-  for (int i = 0; i<operations.size(); i++) {
-    temp = currState;
-    opProb += ptrOp.Score(temp,ptrOp.GetVocabulary().Index(operations[i]),currState);
-  }
+    for (; iter != eSide.end(); iter++) {
+      if(*iter == targetIndex+1)
+        targetIndex++;
+      else
+        doneTargetIndexes.insert(*iter);
 
-  lmState = currState;
+      english += "^_^";
+      english += currE[*iter];
+    }
 
-  //print();
+    iter = fSide.begin();
+    source += currF[*iter];
+    iter++;
+
+    for (; iter != fSide.end(); iter++) {
+      source += "^_^";
+      source += currF[*iter];
+    }
+
+    cept.source.assign(fSide.begin(), fSide.end());
+    if(english == "_TRANS_SLF_") { // Unknown word ...
+      cept.translation = ids.translateSelf;
+    } else {
+      cept.translation = vocab.Index("_TRANS_" + english + "_TO_" + source);
+    }
+
+    targetIndex++; // Check whether the next target word is unaligned ...
+
+    while(doneTargetIndexes.find(targetIndex) != doneTargetIndexes.end()) {
+      targetIndex++;
+    }
+
+    cept.deletions.clear();
+    if(sourceNullWords.find(targetIndex) != sourceNullWords.end()) {
+      generateDeleteOperations(model, currE, sourceNullWords, targetIndex, doneTargetIndexes, cept.deletions);
+    }
+  }
 }
 
+//////////////////////////////////////////////////
 
-int osmHypothesis :: firstOpenGap(vector <int> & coverageVector)
+osmHypothesis :: osmHypothesis(const osmOperationIds &operationIds)
+  :ids(operationIds)
 {
+  opProb = 0;
+  gapWidth = 0;
+  gapCount = 0;
+  openGapCount = 0;
+  deletionCount = 0;
+  gapCount = 0;
+  j = 0;
+  E = 0;
+}
 
-  int firstOG =-1;
+void osmHypothesis :: setState(const FFState* prev_state)
+{
 
-  for(int nd = 0; nd < coverageVector.size(); nd++) {
-    if(coverageVector[nd]==0) {
-      firstOG = nd;
-      return firstOG;
-    }
+  if(prev_state != NULL) {
+    const osmState &state = *static_cast <const osmState *> (prev_state);
+    j = state.getJ();
+    E = state.getE();
+    gap = state.getGap();
+    lmState = state.getLMState();
   }
+}
 
-  return firstOG;
+osmState * osmHypothesis :: saveState()
+{
 
+  osmState * statePtr = new osmState(lmState);
+  statePtr->saveState(j,E,gap);
+  return statePtr;
 }
 
-string osmHypothesis :: intToString(int num)
+void osmHypothesis :: calculateOSMProb(const Model & ptrOp)
 {
 
-  std::ostringstream stm;
-  stm<<num;
+  opProb = 0;
+  State currState = lmState;
+  State temp;
+
+  for (int i = 0; i<operations.size(); i++) {
+    temp = currState;
+    opProb += ptrOp.Score(temp,operations[i],currState);
+  }
+
+  lmState = currState;
 
-  return stm.str();
+  //print();
+}
 
+void osmHypothesis :: setGap(int position, bool unfilled)
+{
+  osmGaps::iterator iter = lower_bound(gap.begin(), gap.end(), 2 * position);
+  if (iter != gap.end() && (*iter >> 1) == position) {
+    *iter = 2 * position + unfilled;
+  } else {
+    gap.insert(iter, 2 * position + unfilled);
+  }
 }
 
-void osmHypothesis :: generateOperations(int & startIndex , int j1 , int contFlag , WordsBitmap & coverageVector , string english , string german , set <int> & targetNullWords , vector <string> & currF)
+void osmHypothesis :: generateOperations(int startIndex , int j1 , int contFlag , WordsBitmap & coverageVector , lm::WordIndex operation , const osmPhraseOperations & phrase)
 {
 
   int gFlag = 0;
@@ -175,54 +300,43 @@ void osmHypothesis :: generateOperations(int & startIndex , int j1 , int contFla
 
 
   if ( j < j1) { // j1 is the index of the source word we are about to generate ...
-    //if(coverageVector[j]==0) // if source word at j is not generated yet ...
     if(coverageVector.GetValue(j)==0) { // if source word at j is not generated yet ...
-      operations.push_back("_INS_GAP_");
+      operations.push_back(ids.insertGap);
       gFlag++;
-      gap[j]="Unfilled";
+      setGap(j, true);
     }
     if (j == E) {
       j = j1;
     } else {
-      operations.push_back("_JMP_FWD_");
+      operations.push_back(ids.jumpForward);
       j=E;
     }
   }
 
   if (j1 < j) {
-    // if(j < E && coverageVector[j]==0)
     if(j < E && coverageVector.GetValue(j)==0) {
-      operations.push_back("_INS_GAP_");
+      operations.push_back(ids.insertGap);
       gFlag++;
-      gap[j]="Unfilled";
+      setGap(j, true);
     }
 
-    j=closestGap(gap,j1,gp);
-    operations.push_back("_JMP_BCK_"+ intToString(gp));
-
-    //cout<<"I am j "<<j<<endl;
-    //cout<<"I am j1 "<<j1<<endl;
+    j=closestGap(j1,gp);
+    operations.push_back(ids.JumpBack(gp));
 
     if(j==j1)
-      gap[j]="Filled";
+      setGap(j, false);
   }
 
   if (j < j1) {
-    operations.push_back("_INS_GAP_");
-    gap[j] = "Unfilled";
+    operations.push_back(ids.insertGap);
+    setGap(j, true);
     gFlag++;
     j=j1;
   }
 
   if(contFlag == 0) { // First words of the multi-word cept ...
 
-    if(english == "_TRANS_SLF_") { // Unknown word ...
-      operations.push_back("_TRANS_SLF_");
-    } else {
-      operations.push_back("_TRANS_" + english + "_TO_" + german);
-    }
-
-    //ans = firstOpenGap(coverageVector);
+    operations.push_back(operation);
     ans = coverageVector.GetFirstGapPos();
 
     if (ans != -1)
@@ -230,17 +344,16 @@ void osmHypothesis :: generateOperations(int & startIndex , int j1 , int contFla
 
   } else if (contFlag == 2) {
 
-    operations.push_back("_INS_" + german);
+    operations.push_back(operation);
     ans = coverageVector.GetFirstGapPos();
 
     if (ans != -1)
       gapWidth += j - ans;
     deletionCount++;
   } else {
-    operations.push_back("_CONT_CEPT_");
+    operations.push_back(ids.continueCept);
   }
 
-  //coverageVector[j]=1;
   coverageVector.SetValue(j,1);
   j+=1;
 
@@ -252,12 +365,9 @@ void osmHypothesis :: generateOperations(int & startIndex , int j1 , int contFla
 
   openGapCount += getOpenGaps();
 
-  //if (coverageVector[j] == 0 && targetNullWords.find(j) != targetNullWords.end())
-  if (coverageVector.GetValue(j) == 0 && targetNullWords.find(j) != targetNullWords.end()) {
-    j1 = j;
-    german = currF[j1-startIndex];
-    english = "_INS_";
-    generateOperations(startIndex, j1, 2 , coverageVector , english , german , targetNullWords , currF);
+  const int next = j - startIndex;
+  if (next < (int) phrase.unalignedSource.size() && phrase.unalignedSource[next] && coverageVector.GetValue(j) == 0) {
+    generateOperations(startIndex, j, 2 , coverageVector , phrase.insertions[next] , phrase);
   }
 
 }
@@ -280,7 +390,7 @@ void osmHypothesis :: print()
   cerr<<"_______________"<<endl;
 }
 
-int osmHypothesis :: closestGap(map <int,string> gap, int j1, int & gp)
+int osmHypothesis :: closestGap(int j1, int & gp) const
 {
 
   int dist=1172;
@@ -289,50 +399,40 @@ int osmHypothesis :: closestGap(map <int,string> gap, int j1, int & gp)
   gp=0;
   int opGap=0;
 
-  map <int,string> :: iterator iter;
-
-  iter=gap.end();
-
-  do {
-    iter--;
-    //cout<<"Trapped "<<iter->first<<endl;
+  // from the right-most gap leftwards
+  for (osmGaps::const_reverse_iterator iter = gap.rbegin(); iter != gap.rend(); ++iter) {
+    if (!(*iter & 1))
+      continue;
+    const int position = *iter >> 1;
+    opGap++;
 
-    if(iter->first==j1 && iter->second== "Unfilled") {
-      opGap++;
+    if(position==j1) {
       gp = opGap;
       return j1;
-
     }
 
-    if(iter->second =="Unfilled") {
-      opGap++;
-      temp = iter->first - j1;
+    temp = position - j1;
 
-      if(temp<0)
-        temp=temp * -1;
+    if(temp<0)
+      temp=temp * -1;
 
-      if(dist>temp && iter->first < j1) {
-        dist=temp;
-        value=iter->first;
-        gp=opGap;
-      }
+    if(dist>temp && position < j1) {
+      dist=temp;
+      value=position;
+      gp=opGap;
     }
-
-
-  } while(iter!=gap.begin());
+  }
 
   return value;
 }
 
 
 
-int osmHypothesis :: getOpenGaps()
+int osmHypothesis :: getOpenGaps() const
 {
-  map <int,string> :: iterator iter;
-
   int nd = 0;
-  for (iter = gap.begin(); iter!=gap.end(); iter++) {
-    if(iter->second == "Unfilled")
+  for (osmGaps::const_iterator iter = gap.begin(); iter!=gap.end(); iter++) {
+    if(*iter & 1)
       nd++;
   }
 
@@ -340,247 +440,30 @@ int osmHypothesis :: getOpenGaps()
 
 }
 
-void osmHypothesis :: generateDeleteOperations(std::string english, int currTargetIndex, std::set <int> doneTargetIndexes)
-{
-
-  operations.push_back("_DEL_" + english);
-  currTargetIndex++;
-
-  while(doneTargetIndexes.find(currTargetIndex) != doneTargetIndexes.end()) {
-    currTargetIndex++;
-  }
-
-  if (sourceNullWords.find(currTargetIndex) != sourceNullWords.end()) {
-    english = currE[currTargetIndex];
-    generateDeleteOperations(english,currTargetIndex,doneTargetIndexes);
-  }
-
-}
-
-void osmHypothesis :: computeOSMFeature(int startIndex , WordsBitmap & coverageVector)
+void osmHypothesis :: computeOSMFeature(int startIndex , WordsBitmap & coverageVector, const osmPhraseOperations & phrase)
 {
-
-  set <int> doneTargetIndexes;
-  set <int> eSide;
-  set <int> fSide;
-  set <int> :: iterator iter;
-  string english;
-  string source;
-  int j1;
-  int start = 0;
-  int targetIndex = 0;
-  doneTargetIndexes.clear();
-
-
-  if (targetNullWords.size() != 0) { // Source words to be deleted in the start of this phrase ...
-    iter = targetNullWords.begin();
-
-    if (*iter == startIndex) {
-
-      j1 = startIndex;
-      source = currF[j1-startIndex];
-      english = "_INS_";
-      generateOperations(startIndex, j1, 2 , coverageVector , english , source , targetNullWords , currF);
-    }
-  }
-
-  if (sourceNullWords.find(targetIndex) != sourceNullWords.end()) { // first word has to be deleted ...
-    english = currE[targetIndex];
-    generateDeleteOperations(english,targetIndex, doneTargetIndexes);
+  if (!phrase.unalignedSource.empty() && phrase.unalignedSource[0]) { // Source words to be deleted in the start of this phrase ...
+    generateOperations(startIndex, startIndex, 2 , coverageVector , phrase.insertions[0] , phrase);
   }
 
+  operations.insert(operations.end(), phrase.initialDeletions.begin(), phrase.initialDeletions.end());
 
-  for (int i = 0; i < ceptsInPhrase.size(); i++) {
-    source = "";
-    english = "";
-
-    fSide = ceptsInPhrase[i].first;
-    eSide = ceptsInPhrase[i].second;
-
-    iter = eSide.begin();
-    targetIndex = *iter;
-    english += currE[*iter];
-    iter++;
-
-    for (; iter != eSide.end(); iter++) {
-      if(*iter == targetIndex+1)
-        targetIndex++;
-      else
-        doneTargetIndexes.insert(*iter);
-
-      english += "^_^";
-      english += currE[*iter];
-    }
-
-    iter = fSide.begin();
-    source += currF[*iter];
-    iter++;
-
-    for (; iter != fSide.end(); iter++) {
-      source += "^_^";
-      source += currF[*iter];
-    }
-
-    iter = fSide.begin();
-    j1 = *iter + startIndex;
-    iter++;
-
-    generateOperations(startIndex, j1, 0 , coverageVector , english , source , targetNullWords , currF);
-
-
-    for (; iter != fSide.end(); iter++) {
-      j1 = *iter + startIndex;
-      generateOperations(startIndex, j1, 1 , coverageVector , english , source , targetNullWords , currF);
-    }
+  for (size_t i = 0; i < phrase.cepts.size(); i++) {
+    const osmPhraseOperations::Cept &cept = phrase.cepts[i];
 
-    targetIndex++; // Check whether the next target word is unaligned ...
+    generateOperations(startIndex, cept.source[0] + startIndex, 0 , coverageVector , cept.translation , phrase);
 
-    while(doneTargetIndexes.find(targetIndex) != doneTargetIndexes.end()) {
-      targetIndex++;
+    for (size_t k = 1; k < cept.source.size(); k++) {
+      generateOperations(startIndex, cept.source[k] + startIndex, 1 , coverageVector , ids.continueCept , phrase);
     }
 
-    if(sourceNullWords.find(targetIndex) != sourceNullWords.end()) {
-      english = currE[targetIndex];
-      generateDeleteOperations(english,targetIndex, doneTargetIndexes);
-    }
+    operations.insert(operations.end(), cept.deletions.begin(), cept.deletions.end());
   }
 
-  //removeReorderingOperations();
-
   //print();
 
 }
 
-void osmHypothesis :: getMeCepts ( set <int> & eSide , set <int> & fSide , map <int , vector <int> > & tS , map <int , vector <int> > & sT)
-{
-  set <int> :: iterator iter;
-
-  int sz = eSide.size();
-  vector <int> t;
-
-  for (iter = eSide.begin(); iter != eSide.end(); iter++) {
-    t = tS[*iter];
-
-    for (int i = 0; i < t.size(); i++) {
-      fSide.insert(t[i]);
-    }
-
-  }
-
-  for (iter = fSide.begin(); iter != fSide.end(); iter++) {
-
-    t = sT[*iter];
-
-    for (int i = 0 ; i<t.size(); i++) {
-      eSide.insert(t[i]);
-    }
-
-  }
-
-  if (eSide.size () > sz) {
-    getMeCepts(eSide,fSide,tS,sT);
-  }
-
-}
-
-void osmHypothesis :: constructCepts(vector <int> & align , int startIndex , int endIndex, int targetPhraseLength)
-{
-
-  std::map <int , vector <int> > sT;
-  std::map <int , vector <int> > tS;
-  std::set <int> eSide;
-  std::set <int> fSide;
-  std::set <int> :: iterator iter;
-  std :: map <int , vector <int> > :: iterator iter2;
-  std :: pair < set <int> , set <int> > cept;
-  int src;
-  int tgt;
-
-
-  for (int i = 0;  i < align.size(); i+=2) {
-    src = align[i];
-    tgt = align[i+1];
-    tS[tgt].push_back(src);
-    sT[src].push_back(tgt);
-  }
-
-  for (int i = startIndex; i<= endIndex; i++) { // What are unaligned source words in this phrase ...
-    if (sT.find(i-startIndex) == sT.end()) {
-      targetNullWords.insert(i);
-    }
-  }
-
-  for (int i = 0; i < targetPhraseLength; i++) { // What are unaligned target words in this phrase ...
-    if (tS.find(i) == tS.end()) {
-      sourceNullWords.insert(i);
-    }
-  }
-
-
-  while (tS.size() != 0 && sT.size() != 0) {
-
-    iter2 = tS.begin();
-
-    eSide.clear();
-    fSide.clear();
-    eSide.insert (iter2->first);
-
-    getMeCepts(eSide, fSide, tS , sT);
-
-    for (iter = eSide.begin(); iter != eSide.end(); iter++) {
-      iter2 = tS.find(*iter);
-      tS.erase(iter2);
-    }
-
-    for (iter = fSide.begin(); iter != fSide.end(); iter++) {
-      iter2 = sT.find(*iter);
-      sT.erase(iter2);
-    }
-
-    cept = make_pair (fSide , eSide);
-    ceptsInPhrase.push_back(cept);
-  }
-
-
-
-  /*
-
-  	  cerr<<"Extracted Cepts "<<endl;
-  		for (int i = 0; i < ceptsInPhrase.size(); i++)
-  			{
-
-  				fSide = ceptsInPhrase[i].first;
-  				eSide = ceptsInPhrase[i].second;
-
-  				for (iter = eSide.begin(); iter != eSide.end(); iter++)
-  				{
-  			   		cerr<<*iter<<" ";
-  				}
-  			    	cerr<<"<---> ";
-
-  				for (iter = fSide.begin(); iter != fSide.end(); iter++)
-  				{
-  					cerr<<*iter<<" ";
-  				}
-
-  				cerr<<endl;
-  			}
-  			cerr<<endl;
-
-  		cerr<<"Unaligned Target Words"<<endl;
-
-  		for (iter = sourceNullWords.begin(); iter != sourceNullWords.end(); iter++)
-  			cerr<<*iter<<"<--->"<<endl;
-
-  		cerr<<"Unaligned Source Words"<<endl;
-
-  		for (iter = targetNullWords.begin(); iter != targetNullWords.end(); iter++)
-  			cerr<<*iter<<"<--->"<<endl;
-
-  */
-
-}
-
 void osmHypothesis :: populateScores(vector <float> & scores)
 {
   scores.clear();
@@ -593,4 +476,3 @@ void osmHypothesis :: populateScores(vector <float> & scores)
 
 
 } // namespace
-
@@ -2,6 +2,7 @@
 
 # include "moses/FF/FFState.h"
 # include "moses/Manager.h"
+# include "moses/Util.h"
 #include "lm/model.hh"
 # include <set>
 # include <map>
@@ -11,23 +12,29 @@
 namespace Moses
 {
 
+/** Gap history: sorted positions of the gaps, each stored as 2*position
+ * plus 1 if the gap is still unfilled. Sorting and comparing these ints
+ * orders gap histories like a map from position to filled/unfilled would.
+ */
+typedef std::vector<int> osmGaps;
+
 class osmState : public FFState
 {
 public:
   osmState(const lm::ngram::State & val);
   int Compare(const FFState& other) const;
-  void saveState(int jVal, int eVal, std::map <int , std::string> & gapVal);
+  void saveState(int jVal, int eVal, const osmGaps & gapVal);
   int getJ()const {
     return j;
   }
   int getE()const {
     return E;
   }
-  std::map <int , std::string> getGap() const {
+  const osmGaps &getGap() const {
     return gap;
   }
 
-  lm::ngram::State getLMState() const {
+  const lm::ngram::State &getLMState() const {
     return lmState;
   }
 
@@ -36,18 +43,68 @@ public:
 
 protected:
   int j, E;
-  std::map <int,std::string> gap;
+  osmGaps gap;
   lm::ngram::State lmState;
 };
 
+//! vocabulary ids of the operations that do not contain words
+class osmOperationIds
+{
+public:
+  void Load(const lm::ngram::Model &model);
+
+  lm::WordIndex insertGap, jumpForward, continueCept, translateSelf;
+
+  //! id of _JMP_BCK_ over the given number of gaps
+  lm::WordIndex JumpBack(int gaps) const {
+    return gaps < (int) m_jumpBack.size() ? m_jumpBack[gaps] : m_model->GetVocabulary().Index("_JMP_BCK_" + SPrint(gaps));
+  }
+
+private:
+  const lm::ngram::Model *m_model;
+  std::vector<lm::WordIndex> m_jumpBack;
+};
+
+/** The part of the operation sequence of a translation option that does
+ * not depend on the hypothesis it extends: its cepts, unaligned words and
+ * the vocabulary ids of their operations. Positions are relative to the
+ * start of the source phrase.
+ */
+class osmPhraseOperations
+{
+public:
+  struct Cept {
+    std::vector<int> source; //! sorted source positions
+    lm::WordIndex translation; //! _TRANS_ operation
+    std::vector<lm::WordIndex> deletions; //! _DEL_ operations that follow the cept
+  };
+
+  void Construct(const lm::ngram::Model &model
+                 , const osmOperationIds &ids
+                 , const std::vector<std::string> &currF
+                 , const std::vector<std::string> &currE
+                 , const std::vector<int> &align);
+
+  //! _DEL_ operations before the first cept
+  std::vector<lm::WordIndex> initialDeletions;
+  std::vector<Cept> cepts;
+  //! _INS_ operation of each unaligned source word, 0 for aligned ones
+  std::vector<lm::WordIndex> insertions;
+  std::vector<bool> unalignedSource;
+
+private:
+  void getMeCepts ( std::set <int> & eSide , std::set <int> & fSide , std::map <int , std::vector <int> > & tS , std::map <int , std::vector <int> > & sT);
+  void generateDeleteOperations(const lm::ngram::Model &model, const std::vector<std::string> &currE, const std::set<int> &sourceNullWords, int currTargetIndex, const std::set <int> &doneTargetIndexes, std::vector<lm::WordIndex> &deletions);
+};
+
 class osmHypothesis
 {
 
 private:
 
 
-  std::vector <std::string> operations;	// List of operations required to generated this hyp ...
-  std::map <int,std::string> gap;	// Maintains gap history ...
+  std::vector <lm::WordIndex> operations;	// List of operations required to generated this hyp ...
+  osmGaps gap;	// Maintains gap history ...
   int j;	// Position after the last source word generated ...
   int E; // Position after the right most source word so far generated ...
   lm::ngram::State lmState; // KenLM's Model State ...
@@ -58,34 +115,19 @@ private:
   int gapWidth;
   double opProb;
 
-  std::vector <std::string> currE;
-  std::vector <std::string> currF;
-  std::vector < std::pair < std::set <int> , std::set <int> > > ceptsInPhrase;
-  std::set <int> targetNullWords;
-  std::set <int> sourceNullWords;
+  const osmOperationIds &ids;
 
-  int closestGap(std::map <int,std::string> gap,int j1, int & gp);
-  int firstOpenGap(std::vector <int> & coverageVector);
-  std::string intToString(int);
-  int  getOpenGaps();
-  int isTranslationOperation(int j);
-  void removeReorderingOperations();
-
-  void getMeCepts ( std::set <int> & eSide , std::set <int> & fSide , std::map <int , std::vector <int> > & tS , std::map <int , std::vector <int> > & sT);
+  int closestGap(int j1, int & gp) const;
+  void setGap(int position, bool unfilled);
+  int  getOpenGaps() const;
+  void generateOperations(int startIndex, int j1 , int contFlag , WordsBitmap & coverageVector , lm::WordIndex operation , const osmPhraseOperations & phrase);
 
 public:
 
-  osmHypothesis();
+  osmHypothesis(const osmOperationIds &operationIds);
   ~osmHypothesis() {};
-  void generateOperations(int & startIndex, int j1 , int contFlag , WordsBitmap & coverageVector , std::string english , std::string german , std::set <int> & targetNullWords , std::vector <std::string> & currF);
-  void generateDeleteOperations(std::string english, int currTargetIndex, std::set <int> doneTargetIndexes);
-  void calculateOSMProb(lm::ngram::Model & ptrOp);
-  void computeOSMFeature(int startIndex , WordsBitmap & coverageVector);
-  void constructCepts(std::vector <int> & align , int startIndex , int endIndex, int targetPhraseLength);
-  void setPhrases(std::vector <std::string> & val1 , std::vector <std::string> & val2) {
-    currF = val1;
-    currE = val2;
-  }
+  void calculateOSMProb(const lm::ngram::Model & ptrOp);
+  void computeOSMFeature(int startIndex , WordsBitmap & coverageVector, const osmPhraseOperations & phrase);
   void setState(const FFState* prev_state);
   osmState * saveState();
   void print();
@@ -97,6 +139,3 @@ public:
 };
 
 } // namespace
-
-
-
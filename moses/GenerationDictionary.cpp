@@ -21,6 +21,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include <fstream>
 #include <string>
+#include <algorithm>
+#include <cstring>
 #include "GenerationDictionary.h"
 #include "FactorCollection.h"
 #include "Word.h"
@@ -29,101 +31,375 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "StaticData.h"
 #include "UserMessage.h"
 #include "util/exception.hh"
+#include "util/file.hh"
 
 using namespace std;
 
 namespace Moses
 {
 
+namespace
+{
+
+const char BINARY_MAGIC[8] = {'M', 'o', 's', 'e', 's', 'G', 'e', 'n'};
+const uint32_t BINARY_VERSION = 1;
+
+/** start of a binary generation table. It is followed by the arrays
+ * targetBegin (uint64, numSource+1), stringBegin (uint64, numStrings+1),
+ * sourceKeys (uint32, numSource*numInput), targetWords (uint32,
+ * numTarget*numOutput), scores (float, numTarget*numScores) and the
+ * characters of the factor strings, so every array is aligned.
+ */
+struct BinaryHeader {
+  char magic[8];
+  uint32_t version, numInput, numOutput, numScores;
+  uint64_t numSource, numTarget, numStrings, stringBytes;
+};
+
+int CompareKeys(const uint32_t *a, const uint32_t *b, size_t size)
+{
+  for (size_t i = 0; i < size; ++i) {
+    if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+  }
+  return 0;
+}
+
+/** reads the lines of a text generation table, mapping factor strings
+ * to dense ids, and sorts them into the arrays of GenerationDictionary
+ */
+class TableBuilder
+{
+public:
+  TableBuilder(size_t numInput, size_t numOutput, size_t numScores)
+    : m_numInput(numInput), m_numOutput(numOutput), m_numScores(numScores) {
+  }
+
+  void AddLine(const string &line, size_t lineNum, const string &filePath) {
+    vector<string> token = Tokenize( line );
+    if (token.empty()) return;
+    if (token.size() < 2) {
+      stringstream strme;
+      strme << filePath << ":" << lineNum << ": expected input word, output word and scores" << std::endl;
+      throw strme.str();
+    }
+    AddFactors(token[0], m_numInput, m_keys, lineNum, filePath);
+    AddFactors(token[1], m_numOutput, m_targets, lineNum, filePath);
+
+    size_t numFeaturesInFile = token.size() - 2;
+    if (numFeaturesInFile < m_numScores) {
+      stringstream strme;
+      strme << filePath << ":" << lineNum << ": expected " << m_numScores
+            << " feature values, but found " << numFeaturesInFile << std::endl;
+      throw strme.str();
+    }
+    for (size_t i = 0; i < m_numScores; i++)
+      m_scores.push_back(FloorScore(TransformScore(Scan<float>(token[2+i]))));
+  }
+
+  /** sorts the entries by input word. When an input/output pair occurs
+   * more than once the last line wins, as in the original map-based table.
+   */
+  void Finish(vector<uint32_t> &sourceKeys, vector<uint64_t> &targetBegin,
+              vector<uint32_t> &targetWords, vector<float> &scores) const {
+    size_t numLines = m_keys.size() / m_numInput;
+    vector<size_t> order(numLines);
+    for (size_t i = 0; i < numLines; ++i) order[i] = i;
+    sort(order.begin(), order.end(), LineOrder(*this));
+
+    sourceKeys.clear();
+    targetBegin.clear();
+    targetWords.clear();
+    scores.clear();
+    for (size_t i = 0; i < order.size(); ++i) {
+      size_t line = order[i];
+      if (i + 1 < order.size() && CompareKeys(Key(line), Key(order[i+1]), m_numInput) == 0
+          && CompareKeys(Target(line), Target(order[i+1]), m_numOutput) == 0) {
+        continue; // overwritten by a later line
+      }
+      if (targetBegin.empty() || CompareKeys(Key(line), &sourceKeys[sourceKeys.size() - m_numInput], m_numInput) != 0) {
+        targetBegin.push_back(targetWords.size() / m_numOutput);
+        sourceKeys.insert(sourceKeys.end(), Key(line), Key(line) + m_numInput);
+      }
+      targetWords.insert(targetWords.end(), Target(line), Target(line) + m_numOutput);
+      scores.insert(scores.end(), m_scores.begin() + line*m_numScores, m_scores.begin() + (line+1)*m_numScores);
+    }
+    targetBegin.push_back(targetWords.size() / m_numOutput);
+  }
+
+  const vector<string> &GetStrings() const {
+    return m_strings;
+  }
+
+private:
+  struct LineOrder {
+    const TableBuilder &m_builder;
+    LineOrder(const TableBuilder &builder) : m_builder(builder) {}
+    bool operator()(size_t a, size_t b) const {
+      int cmp = CompareKeys(m_builder.Key(a), m_builder.Key(b), m_builder.m_numInput);
+      if (cmp == 0) cmp = CompareKeys(m_builder.Target(a), m_builder.Target(b), m_builder.m_numOutput);
+      return cmp == 0 ? a < b : cmp < 0;
+    }
+  };
+
+  const uint32_t *Key(size_t line) const {
+    return &m_keys[line * m_numInput];
+  }
+  const uint32_t *Target(size_t line) const {
+    return &m_targets[line * m_numOutput];
+  }
+
+  void AddFactors(const string &word, size_t numFactors, vector<uint32_t> &ids, size_t lineNum, const string &filePath) {
+    vector<string> factorString = Tokenize( word, "|" );
+    if (factorString.size() < numFactors) {
+      stringstream strme;
+      strme << filePath << ":" << lineNum << ": expected " << numFactors
+            << " factors in " << word << std::endl;
+      throw strme.str();
+    }
+    for (size_t i = 0; i < numFactors; ++i) {
+      pair<boost::unordered_map<string, uint32_t>::iterator, bool> added =
+        m_ids.insert(make_pair(factorString[i], static_cast<uint32_t>(m_strings.size())));
+      if (added.second) m_strings.push_back(factorString[i]);
+      ids.push_back(added.first->second);
+    }
+  }
+
+  size_t m_numInput, m_numOutput, m_numScores;
+  boost::unordered_map<string, uint32_t> m_ids;
+  vector<string> m_strings;
+  vector<uint32_t> m_keys, m_targets;
+  vector<float> m_scores;
+};
+
+template <class T> void WriteArray(ostream &out, const vector<T> &data)
+{
+  if (!data.empty()) out.write(reinterpret_cast<const char*>(&data[0]), data.size() * sizeof(T));
+}
+
+}
+
 GenerationDictionary::GenerationDictionary(const std::string &line)
   : DecodeFeature("Generation", line)
+  , m_numSource(0)
+  , m_scoreStride(0)
+  , m_sourceKeys(NULL)
+  , m_targetBegin(NULL)
+  , m_targetWords(NULL)
+  , m_scores(NULL)
 {
   ReadParameters();
 }
 
 void GenerationDictionary::Load()
 {
-  FactorCollection &factorCollection = FactorCollection::Instance();
+  char magic[sizeof(BINARY_MAGIC)] = {0};
+  {
+    ifstream probe(m_filePath.c_str(), ios::in | ios::binary);
+    UTIL_THROW_IF(!probe.good(), util::Exception, "Couldn't read " << m_filePath);
+    probe.read(magic, sizeof(magic));
+  }
+  if (memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0) {
+    LoadBinary();
+  } else {
+    LoadText();
+  }
 
-  const size_t numFeatureValuesInConfig = this->GetNumScoreComponents();
+  // dense ids of the factor strings
+  for (size_t i = 0; i < m_factors.size(); ++i) {
+    m_factorIds[m_factors[i]] = i;
+  }
+}
 
+void GenerationDictionary::LoadText()
+{
+  FactorCollection &factorCollection = FactorCollection::Instance();
 
   // data from file
   InputFileStream inFile(m_filePath);
   UTIL_THROW_IF(!inFile.good(), util::Exception, "Couldn't read " << m_filePath);
 
+  TableBuilder builder(GetInput().size(), GetOutput().size(), GetNumScoreComponents());
   string line;
   size_t lineNum = 0;
   while(getline(inFile, line)) {
     ++lineNum;
-    vector<string> token = Tokenize( line );
+    builder.AddLine(line, lineNum, m_filePath);
+  }
+  inFile.Close();
 
-    // add each line in generation file into class
-    Word *inputWord = new Word();  // deleted in destructor
-    Word outputWord;
+  builder.Finish(m_sourceKeysStore, m_targetBeginStore, m_targetWordsStore, m_scoresStore);
+  const vector<string> &strings = builder.GetStrings();
+  m_factors.resize(strings.size());
+  for (size_t i = 0; i < strings.size(); ++i) {
+    m_factors[i] = factorCollection.AddFactor(strings[i]);
+  }
 
-    // create word with certain factors filled out
+  m_numSource = m_targetBeginStore.size() - 1;
+  m_scoreStride = GetNumScoreComponents();
+  m_sourceKeys = m_sourceKeysStore.empty() ? NULL : &m_sourceKeysStore[0];
+  m_targetBegin = &m_targetBeginStore[0];
+  m_targetWords = m_targetWordsStore.empty() ? NULL : &m_targetWordsStore[0];
+  m_scores = m_scoresStore.empty() ? NULL : &m_scoresStore[0];
+}
 
-    // inputs
-    vector<string> factorString = Tokenize( token[0], "|" );
-    for (size_t i = 0 ; i < GetInput().size() ; i++) {
-      FactorType factorType = GetInput()[i];
-      const Factor *factor = factorCollection.AddFactor( Output, factorType, factorString[i]);
-      inputWord->SetFactor(factorType, factor);
-    }
+void GenerationDictionary::LoadBinary()
+{
+  util::scoped_fd file(util::OpenReadOrThrow(m_filePath.c_str()));
+  uint64_t size = util::SizeOrThrow(file.get());
+  UTIL_THROW_IF(size < sizeof(BinaryHeader), util::Exception, "Binary generation table " << m_filePath << " is truncated");
+  util::MapRead(util::LAZY, file.get(), 0, size, m_mapped);
 
-    factorString = Tokenize( token[1], "|" );
-    for (size_t i = 0 ; i < GetOutput().size() ; i++) {
-      FactorType factorType = GetOutput()[i];
+  const char *data = static_cast<const char*>(m_mapped.get());
+  const BinaryHeader &header = *reinterpret_cast<const BinaryHeader*>(data);
+  UTIL_THROW_IF(header.version != BINARY_VERSION, util::Exception,
+                m_filePath << " has binary format version " << header.version << ", expected " << BINARY_VERSION);
+  UTIL_THROW_IF(header.numInput != GetInput().size() || header.numOutput != GetOutput().size(), util::Exception,
+                m_filePath << " maps " << header.numInput << " to " << header.numOutput
+                << " factors, but the configuration expects " << GetInput().size() << " to " << GetOutput().size());
+  UTIL_THROW_IF(header.numScores < GetNumScoreComponents(), util::Exception,
+                m_filePath << " has " << header.numScores << " feature values, but the configuration expects "
+                << GetNumScoreComponents());
+  uint64_t expected = sizeof(BinaryHeader)
+                      + (header.numSource + 1 + header.numStrings + 1) * sizeof(uint64_t)
+                      + (header.numSource * header.numInput + header.numTarget * header.numOutput) * sizeof(uint32_t)
+                      + header.numTarget * header.numScores * sizeof(float)
+                      + header.stringBytes;
+  UTIL_THROW_IF(size < expected, util::Exception, "Binary generation table " << m_filePath << " is truncated");
 
-      const Factor *factor = factorCollection.AddFactor( Output, factorType, factorString[i]);
-      outputWord.SetFactor(factorType, factor);
-    }
+  m_numSource = header.numSource;
+  m_scoreStride = header.numScores;
+  data += sizeof(BinaryHeader);
+  m_targetBegin = reinterpret_cast<const uint64_t*>(data);
+  data += (header.numSource + 1) * sizeof(uint64_t);
+  const uint64_t *stringBegin = reinterpret_cast<const uint64_t*>(data);
+  data += (header.numStrings + 1) * sizeof(uint64_t);
+  m_sourceKeys = reinterpret_cast<const uint32_t*>(data);
+  data += header.numSource * header.numInput * sizeof(uint32_t);
+  m_targetWords = reinterpret_cast<const uint32_t*>(data);
+  data += header.numTarget * header.numOutput * sizeof(uint32_t);
+  m_scores = reinterpret_cast<const float*>(data);
+  data += header.numTarget * header.numScores * sizeof(float);
 
-    size_t numFeaturesInFile = token.size() - 2;
-    if (numFeaturesInFile < numFeatureValuesInConfig) {
-      stringstream strme;
-      strme << m_filePath << ":" << lineNum << ": expected " << numFeatureValuesInConfig
-            << " feature values, but found " << numFeaturesInFile << std::endl;
-      throw strme.str();
-    }
-    std::vector<float> scores(numFeatureValuesInConfig, 0.0f);
-    for (size_t i = 0; i < numFeatureValuesInConfig; i++)
-      scores[i] = FloorScore(TransformScore(Scan<float>(token[2+i])));
+  // only the vocabulary is decoded up front
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  m_factors.resize(header.numStrings);
+  for (size_t i = 0; i < header.numStrings; ++i) {
+    m_factors[i] = factorCollection.AddFactor(StringPiece(data + stringBegin[i], stringBegin[i+1] - stringBegin[i]));
+  }
+}
 
-    Collection::iterator iterWord = m_collection.find(inputWord);
-    if (iterWord == m_collection.end()) {
-      m_collection[inputWord][outputWord].Assign(this, scores);
-    } else {
-      // source word already in there. delete input word to avoid mem leak
-      (iterWord->second)[outputWord].Assign(this, scores);
-      delete inputWord;
+bool GenerationDictionary::CreateBinary(istream &in, const string &outPath)
+{
+  string line;
+  if (!getline(in, line)) {
+    UserMessage::Add("Empty generation table");
+    return false;
+  }
+
+  // the number of factors and scores is taken from the first line
+  vector<string> token = Tokenize( line );
+  if (token.size() < 2) {
+    UserMessage::Add("Malformed first line of generation table: " + line);
+    return false;
+  }
+  size_t numInput = Tokenize( token[0], "|" ).size();
+  size_t numOutput = Tokenize( token[1], "|" ).size();
+  size_t numScores = token.size() - 2;
+  TableBuilder builder(numInput, numOutput, numScores);
+
+  vector<uint32_t> sourceKeys, targetWords;
+  vector<uint64_t> targetBegin;
+  vector<float> scores;
+  try {
+    size_t lineNum = 1;
+    builder.AddLine(line, lineNum, "input");
+    while (getline(in, line)) {
+      builder.AddLine(line, ++lineNum, "input");
     }
+    builder.Finish(sourceKeys, targetBegin, targetWords, scores);
+  } catch (const string &error) {
+    UserMessage::Add(error);
+    return false;
   }
 
-  inFile.Close();
+  const vector<string> &strings = builder.GetStrings();
+  vector<uint64_t> stringBegin(1, 0);
+  for (size_t i = 0; i < strings.size(); ++i) {
+    stringBegin.push_back(stringBegin.back() + strings[i].size());
+  }
+
+  BinaryHeader header;
+  memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+  header.version = BINARY_VERSION;
+  header.numInput = numInput;
+  header.numOutput = numOutput;
+  header.numScores = numScores;
+  header.numSource = targetBegin.size() - 1;
+  header.numTarget = targetWords.size() / numOutput;
+  header.numStrings = strings.size();
+  header.stringBytes = stringBegin.back();
+
+  ofstream out(outPath.c_str(), ios::out | ios::binary);
+  if (!out.good()) {
+    UserMessage::Add("Couldn't write " + outPath);
+    return false;
+  }
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  WriteArray(out, targetBegin);
+  WriteArray(out, stringBegin);
+  WriteArray(out, sourceKeys);
+  WriteArray(out, targetWords);
+  WriteArray(out, scores);
+  for (size_t i = 0; i < strings.size(); ++i) {
+    out.write(strings[i].data(), strings[i].size());
+  }
+  out.close();
+  return out.good();
 }
 
 GenerationDictionary::~GenerationDictionary()
 {
-  Collection::const_iterator iter;
-  for (iter = m_collection.begin() ; iter != m_collection.end() ; ++iter) {
-    delete iter->first;
-  }
 }
 
-const OutputWordCollection *GenerationDictionary::FindWord(const Word &word) const
+bool GenerationDictionary::FindWord(const Word &word, OutputWordCollection &ret) const
 {
-  const OutputWordCollection *ret;
+  ret.clear();
 
-  Collection::const_iterator iter = m_collection.find(&word);
-  if (iter == m_collection.end()) {
-    // can't find source phrase
-    ret = NULL;
-  } else {
-    ret = &iter->second;
+  const FactorList &input = GetInput();
+  uint32_t key[MAX_NUM_FACTORS];
+  for (size_t i = 0; i < input.size(); ++i) {
+    boost::unordered_map<const Factor*, uint32_t>::const_iterator id = m_factorIds.find(word[input[i]]);
+    if (id == m_factorIds.end()) {
+      // can't find source word
+      return false;
+    }
+    key[i] = id->second;
+  }
+
+  // lower bound of the key among the sorted input words
+  size_t first = 0, last = m_numSource;
+  while (first < last) {
+    size_t middle = first + (last - first) / 2;
+    if (CompareKeys(m_sourceKeys + middle * input.size(), key, input.size()) < 0) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
   }
-  return ret;
+  if (first == m_numSource || CompareKeys(m_sourceKeys + first * input.size(), key, input.size()) != 0) {
+    return false;
+  }
+
+  const FactorList &output = GetOutput();
+  for (uint64_t entry = m_targetBegin[first]; entry < m_targetBegin[first + 1]; ++entry) {
+    Word outputWord;
+    const uint32_t *ids = m_targetWords + entry * output.size();
+    for (size_t i = 0; i < output.size(); ++i) {
+      outputWord.SetFactor(output[i], m_factors[ids[i]]);
+    }
+    ret.push_back(make_pair(outputWord, m_scores + entry * m_scoreStride));
+  }
+  return true;
 }
 
 void GenerationDictionary::SetParameter(const std::string& key, const std::string& value)
@@ -136,4 +412,3 @@ void GenerationDictionary::SetParameter(const std::string& key, const std::strin
 }
 
 }
-
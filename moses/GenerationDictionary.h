@@ -26,6 +26,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <map>
 #include <stdexcept>
 #include <vector>
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+#include "util/mmap.hh"
 #include "ScoreComponentCollection.h"
 #include "Phrase.h"
 #include "TypeDef.h"
@@ -36,21 +39,41 @@ namespace Moses
 
 class FactorCollection;
 
-typedef std::map < Word , ScoreComponentCollection > OutputWordCollection;
-// 1st = output phrase
-// 2nd = log probability (score)
+/** generated words for one input word.
+ * 1st = output word
+ * 2nd = its scores, GetNumScoreComponents() values owned by the dictionary
+ */
+typedef std::vector< std::pair<Word, const float*> > OutputWordCollection;
 
-/** Implementation of a generation table in a trie.
+/** Implementation of a generation table as sorted arrays of dense factor ids.
+ * The text format is converted into these arrays when loading; the binary
+ * format (created by processGenerationTable) stores them as they are, so
+ * it is memory mapped and entries are only decoded when they are looked up.
  */
 class GenerationDictionary : public DecodeFeature
 {
-  typedef std::map<const Word* , OutputWordCollection, WordComparer> Collection;
 protected:
-  Collection m_collection;
-  // 1st = source
-  // 2nd = target
   std::string						m_filePath;
 
+  size_t m_numSource; //!< number of unique input words
+  size_t m_scoreStride; //!< number of scores stored per entry, >= GetNumScoreComponents()
+  const uint32_t *m_sourceKeys; //!< ids of input factors, GetInput().size() per input word, sorted
+  const uint64_t *m_targetBegin; //!< m_numSource+1 offsets into the entry arrays
+  const uint32_t *m_targetWords; //!< ids of output factors, GetOutput().size() per entry
+  const float *m_scores; //!< m_scoreStride scores per entry
+
+  std::vector<const Factor*> m_factors; //!< dense id -> factor
+  boost::unordered_map<const Factor*, uint32_t> m_factorIds;
+
+  // backing store of the arrays, either loaded from text or mapped
+  std::vector<uint32_t> m_sourceKeysStore, m_targetWordsStore;
+  std::vector<uint64_t> m_targetBeginStore;
+  std::vector<float> m_scoresStore;
+  util::scoped_memory m_mapped;
+
+  void LoadText();
+  void LoadBinary();
+
 public:
   GenerationDictionary(const std::string &line);
   virtual ~GenerationDictionary();
@@ -62,14 +85,20 @@ public:
   * NOT the number of lines in the generation table
   */
   size_t GetSize() const {
-    return m_collection.size();
+    return m_numSource;
   }
-  /** returns a bag of output words, OutputWordCollection, for a particular input word.
-  *	Or NULL if the input word isn't found. The search function used is the WordComparer functor
+  /** fills ret with the output words for a particular input word (only its input factors are compared).
+  *	Returns false if the input word isn't found.
   */
-  const OutputWordCollection *FindWord(const Word &word) const;
+  bool FindWord(const Word &word, OutputWordCollection &ret) const;
+  bool SupportsParallelLookup() const {
+    return true;
+  }
   void SetParameter(const std::string& key, const std::string& value);
 
+  //! convert a text generation table into the binary format, returns false on error
+  static bool CreateBinary(std::istream &in, const std::string &outPath);
+
 };
 
 
@@ -276,7 +276,8 @@ void Hypothesis::EvaluateWith(const StatelessFeatureFunction& slff)
  */
 void Hypothesis::Evaluate(const SquareMatrix &futureScore)
 {
-  clock_t t=0; // used to track time
+  SentenceStats &stats = m_manager.GetSentenceStats();
+  uint64_t t=0, start=MonotonicNanoTime(); // used to track time
 
   // some stateless score producers cache their values in the translation
   // option: add these here
@@ -289,8 +290,11 @@ void Hypothesis::Evaluate(const SquareMatrix &futureScore)
     StatelessFeatureFunction::GetStatelessFeatureFunctions();
   for (unsigned i = 0; i < sfs.size(); ++i) {
     const StatelessFeatureFunction &ff = *sfs[i];
+    t = MonotonicNanoTime();
     EvaluateWith(ff);
+    stats.AddTimeStatelessFeature(i, MonotonicNanoTime()-t);
   }
+  stats.AddTimeOtherScore( MonotonicNanoTime()-start );
 
   const vector<const StatefulFeatureFunction*>& ffs =
     StatefulFeatureFunction::GetStatefulFeatureFunctions();
@@ -298,15 +302,24 @@ void Hypothesis::Evaluate(const SquareMatrix &futureScore)
     const StatefulFeatureFunction &ff = *ffs[i];
     const StaticData &staticData = StaticData::Instance();
     if (! staticData.IsFeatureFunctionIgnored(ff)) {
+      t = MonotonicNanoTime();
       m_ffStates[i] = ff.Evaluate(*this,
                                   m_prevHypo ? m_prevHypo->m_ffStates[i] : NULL,
                                   &m_scoreBreakdown);
+      stats.AddTimeStatefulFeature(i, MonotonicNanoTime()-t);
     }
   }
 
-  IFVERBOSE(2) {
-    t = clock();  // track time excluding LM
-  }
+  CalcTotalScore(futureScore);
+}
+
+/***
+ * add the future cost estimate to the feature scores computed so far
+ */
+void Hypothesis::CalcTotalScore(const SquareMatrix &futureScore)
+{
+  SentenceStats &stats = m_manager.GetSentenceStats();
+  uint64_t t = MonotonicNanoTime();  // track time of future cost estimate
 
   // FUTURE COST
   m_futureScore = futureScore.CalcFutureScore( m_sourceCompleted );
@@ -314,9 +327,7 @@ void Hypothesis::Evaluate(const SquareMatrix &futureScore)
   // TOTAL
   m_totalScore = m_scoreBreakdown.GetWeightedScore() + m_futureScore;
 
-  IFVERBOSE(2) {
-    m_manager.GetSentenceStats().AddTimeOtherScore( clock()-t );
-  }
+  stats.AddTimeEstimateScore( MonotonicNanoTime()-t );
 }
 
 const Hypothesis* Hypothesis::GetPrevHypo()const
@@ -374,7 +385,7 @@ void Hypothesis::CleanupArcList()
    */
   const StaticData &staticData = StaticData::Instance();
   size_t nBestSize = staticData.GetNBestSize();
-  bool distinctNBest = staticData.GetDistinctNBest() || staticData.UseMBR() || staticData.GetOutputSearchGraph() || staticData.GetOutputSearchGraphSLF() || staticData.GetOutputSearchGraphHypergraph() || staticData.UseLatticeMBR() ;
+  bool distinctNBest = staticData.GetDistinctNBest() || staticData.UseMBR() || staticData.GetOutputSearchGraph() || staticData.GetOutputSearchGraphBinary() || staticData.GetOutputSearchGraphSLF() || staticData.GetOutputSearchGraphHypergraph() || staticData.UseLatticeMBR() ;
 
   if (!distinctNBest && m_arcList->size() > nBestSize * 5) {
     // prune arc list only if there too many arcs
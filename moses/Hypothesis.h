@@ -144,6 +144,7 @@ public:
   }
 
   void Evaluate(const SquareMatrix &futureScore);
+  void CalcTotalScore(const SquareMatrix &futureScore);
 
   int GetId()const {
     return m_id;
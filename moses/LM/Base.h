@@ -82,6 +82,10 @@ public:
   }
   virtual void SetFFStateIdx(int state_idx) {
   }
+  //! whether SearchNormalBatch should collect this LM's requests with IssueRequestsFor() and sync()
+  virtual bool UsesBatchedRequests() const {
+    return false;
+  }
 
   // KenLM only (others throw an exception): call incremental search with the model and mapping.
   virtual void IncrementalCallback(Incremental::Manager &manager) const;
@@ -129,10 +129,7 @@ FFState *LanguageModelImplementation::Evaluate(const Hypothesis &hypo, const FFS
   if(GetNGramOrder() <= 1)
     return NULL;
 
-  clock_t t = 0;
-  IFVERBOSE(2) {
-    t = clock();  // track time
-  }
+  uint64_t t = MonotonicNanoTime();  // track time
 
   // Empty phrase added? nothing to be done
   if (hypo.GetCurrTargetLength() == 0)
@@ -202,9 +199,7 @@ FFState *LanguageModelImplementation::Evaluate(const Hypothesis &hypo, const FFS
   }
 
 
-  IFVERBOSE(2) {
-    hypo.GetManager().GetSentenceStats().AddTimeCalcLM( clock()-t );
-  }
+  hypo.GetManager().GetSentenceStats().AddTimeCalcLM( MonotonicNanoTime()-t );
   return res;
 }
 
@@ -39,6 +39,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/Phrase.h"
 #include "moses/InputFileStream.h"
 #include "moses/StaticData.h"
+#include "moses/Manager.h"
 #include "moses/ChartHypothesis.h"
 #include "moses/Incremental.h"
 #include "moses/UserMessage.h"
@@ -230,6 +231,8 @@ template <class Model> FFState *LanguageModelKen<Model>::Evaluate(const Hypothes
     return ret.release();
   }
 
+  uint64_t t = MonotonicNanoTime();  // track time
+
   const std::size_t begin = hypo.GetCurrTargetWordsRange().GetStartPos();
   //[begin, end) in STL-like fashion.
   const std::size_t end = hypo.GetCurrTargetWordsRange().GetEndPos() + 1;
@@ -272,6 +275,7 @@ template <class Model> FFState *LanguageModelKen<Model>::Evaluate(const Hypothes
     out->PlusEquals(this, score);
   }
 
+  hypo.GetManager().GetSentenceStats().AddTimeCalcLM( MonotonicNanoTime()-t );
   return ret.release();
 }
 
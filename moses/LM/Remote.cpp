@@ -1,144 +1,429 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+
+#include <boost/unordered_set.hpp>
+
 #include "Remote.h"
+#include "RemoteProtocol.h"
 #include "moses/Factor.h"
+#include "moses/FactorCollection.h"
+#include "moses/Hypothesis.h"
+#include "moses/Util.h"
+#include "util/exception.hh"
+
+using namespace std;
 
 namespace Moses
 {
 
-const Factor* LanguageModelRemote::BOS = NULL;
-const Factor* LanguageModelRemote::EOS = (LanguageModelRemote::BOS + 1);
+namespace
+{
+
+//! append a request for count n-grams encoded in body, and clear body
+void AppendRequest(string &out, size_t count, string &body)
+{
+  RemoteLMProtocol::AppendUint32(out, static_cast<uint32_t>(count));
+  RemoteLMProtocol::AppendUint32(out, static_cast<uint32_t>(body.size()));
+  out += body;
+  body.clear();
+}
+
+}
+
+LanguageModelRemote::LanguageModelRemote(const std::string &line)
+  :LanguageModelSingleFactor("RemoteLM", line)
+  ,m_port(0)
+  ,m_batchSize(1024)
+  ,m_cacheSize(500000)
+{
+  m_factorType = 0;
+  m_nGramOrder = 0;
+  ReadParameters();
+
+  UTIL_THROW_IF(m_host.empty() || m_port <= 0, util::Exception,
+                "RemoteLM needs path=host:port");
+  UTIL_THROW_IF(m_nGramOrder == 0, util::Exception, "RemoteLM needs order");
+  UTIL_THROW_IF(m_batchSize == 0 || m_cacheSize == 0, util::Exception,
+                "RemoteLM batch-size and cache-size must be positive");
+  m_cache.SetCapacity(m_cacheSize);
+
+  FactorCollection &factorCollection = FactorCollection::Instance();
+  m_sentenceStart = factorCollection.AddFactor(Output, m_factorType, BOS_);
+  m_sentenceStartWord[m_factorType] = m_sentenceStart;
+  m_sentenceEnd = factorCollection.AddFactor(Output, m_factorType, EOS_);
+  m_sentenceEndWord[m_factorType] = m_sentenceEnd;
+}
+
+LanguageModelRemote::~LanguageModelRemote()
+{
+}
+
+void LanguageModelRemote::SetParameter(const std::string& key, const std::string& value)
+{
+  if (key == "factor") {
+    m_factorType = Scan<FactorType>(value);
+  } else if (key == "order") {
+    m_nGramOrder = Scan<size_t>(value);
+  } else if (key == "path") {
+    m_filePath = value;
+    size_t cutAt = value.rfind(':');
+    if (cutAt != string::npos) {
+      m_host = value.substr(0, cutAt);
+      m_port = Scan<int>(value.substr(cutAt + 1));
+    }
+  } else if (key == "batch-size") {
+    m_batchSize = Scan<size_t>(value);
+  } else if (key == "cache-size") {
+    m_cacheSize = Scan<size_t>(value);
+  } else {
+    LanguageModelSingleFactor::SetParameter(key, value);
+  }
+}
+
+void LanguageModelRemote::Load()
+{
+  // connect now so that a missing server is reported at start-up
+  GetConnection();
+}
+
+LanguageModelRemote::Connection::~Connection()
+{
+  if (sock >= 0) close(sock);
+}
+
+LanguageModelRemote::Connection &LanguageModelRemote::GetConnection() const
+{
+  if (m_connection.get() == NULL) {
+    m_connection.reset(new Connection());
+  }
+  if (m_connection->sock < 0) {
+    m_connection->sock = Connect();
+  }
+  return *m_connection;
+}
 
-bool LanguageModelRemote::Load(const std::string &filePath
-                               , FactorType factorType
-                               , size_t nGramOrder)
+int LanguageModelRemote::Connect() const
 {
-  m_factorType    = factorType;
-  m_nGramOrder    = nGramOrder;
+  struct addrinfo hints, *addresses;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  int ret = getaddrinfo(m_host.c_str(), SPrint(m_port).c_str(), &hints, &addresses);
+  UTIL_THROW_IF(ret != 0, util::Exception,
+                "Cannot resolve LM server " << m_host << ": " << gai_strerror(ret));
 
-  int cutAt = filePath.find(':',0);
-  std::string host = filePath.substr(0,cutAt);
-  //std::cerr << "port string = '" << filePath.substr(cutAt+1,filePath.size()-cutAt) << "'\n";
-  int port = atoi(filePath.substr(cutAt+1,filePath.size()-cutAt).c_str());
-  bool good = start(host,port);
-  if (!good) {
-    std::cerr << "failed to connect to lm server on " << host << " on port " << port << std::endl;
+  // the server may still be loading its model, so retry for a few seconds
+  int sock = -1;
+  for (size_t attempt = 0; sock < 0 && attempt < 6; ++attempt) {
+    if (attempt) sleep(1);
+    for (struct addrinfo *address = addresses; address; address = address->ai_next) {
+      sock = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+      if (sock < 0) continue;
+      if (connect(sock, address->ai_addr, address->ai_addrlen) == 0) break;
+      close(sock);
+      sock = -1;
+    }
   }
-  ClearSentenceCache();
-  return good;
+  freeaddrinfo(addresses);
+  UTIL_THROW_IF(sock < 0, util::ErrnoException,
+                "Failed to connect to LM server on " << m_host << " port " << m_port);
+
+  // requests are small and pipelined; don't let Nagle hold them back
+  int one = 1;
+  setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+  return sock;
 }
 
+void LanguageModelRemote::MakeKey(const std::vector<const Word*> &contextFactor, NgramKey &key) const
+{
+  // only the last order words matter, and nothing before the last <s>
+  size_t begin = contextFactor.size() > m_nGramOrder ? contextFactor.size() - m_nGramOrder : 0;
+  for (size_t i = contextFactor.size() - 1; i > begin; --i) {
+    if (contextFactor[i - 1]->GetFactor(m_factorType) == m_sentenceStart) {
+      begin = i - 1;
+      break;
+    }
+  }
+  key.clear();
+  for (size_t i = begin; i < contextFactor.size(); ++i) {
+    key.push_back(contextFactor[i]->GetFactor(m_factorType));
+  }
+}
 
-bool LanguageModelRemote::start(const std::string& host, int port)
+void LanguageModelRemote::CollectNgrams(const Phrase &phrase, std::vector<NgramKey> &keys) const
 {
-  //std::cerr << "host = " << host << ", port = " << port << "\n";
-  sock = socket(AF_INET, SOCK_STREAM, 0);
-  hp = gethostbyname(host.c_str());
-  if (hp==NULL) {
-    herror("gethostbyname failed");
-    exit(1);
+  // the n-grams LanguageModelImplementation::CalcScore() asks for
+  vector<const Word*> contextFactor;
+  for (size_t pos = 0; pos < phrase.GetSize(); ++pos) {
+    const Word &word = phrase.GetWord(pos);
+    if (word.IsNonTerminal()) {
+      contextFactor.clear();
+      continue;
+    }
+    if (contextFactor.size() == m_nGramOrder) {
+      contextFactor.erase(contextFactor.begin());
+    }
+    contextFactor.push_back(&word);
+    if (word != GetSentenceStartWord()) {
+      keys.push_back(NgramKey());
+      MakeKey(contextFactor, keys.back());
+    }
   }
+}
+
+void LanguageModelRemote::CollectNgrams(const Hypothesis &hypo, std::vector<NgramKey> &keys) const
+{
+  // the n-grams LanguageModelImplementation::Evaluate() asks for
+  if (m_nGramOrder <= 1 || hypo.GetCurrTargetLength() == 0) return;
 
-  bzero((char *)&server, sizeof(server));
-  bcopy(hp->h_addr, (char *)&server.sin_addr, hp->h_length);
-  server.sin_family = hp->h_addrtype;
-  server.sin_port = htons(port);
+  const int order = (int) m_nGramOrder;
+  const int startPos = (int) hypo.GetCurrTargetWordsRange().GetStartPos();
+  const int currEndPos = (int) hypo.GetCurrTargetWordsRange().GetEndPos();
+  const int endPos = std::min(startPos + order - 2, currEndPos);
 
-  int errors = 0;
-  while (connect(sock, (struct sockaddr *)&server, sizeof(server)) < 0) {
-    //std::cerr << "Error: connect()\n";
-    sleep(1);
-    errors++;
-    if (errors > 5) return false;
+  vector<const Word*> contextFactor(m_nGramOrder);
+  for (int lastPos = startPos; lastPos <= currEndPos; ++lastPos) {
+    if (lastPos > endPos && lastPos != currEndPos) continue;
+    if (lastPos == currEndPos && lastPos > endPos && hypo.IsSourceCompleted()) continue;
+    for (int i = 0; i < order; ++i) {
+      int currPos = lastPos - order + 1 + i;
+      contextFactor[i] = currPos < 0 ? &GetSentenceStartWord() : &hypo.GetWord(currPos);
+    }
+    keys.push_back(NgramKey());
+    MakeKey(contextFactor, keys.back());
+  }
+
+  if (hypo.IsSourceCompleted()) {
+    const int size = (int) hypo.GetSize();
+    for (int i = 0; i < order - 1; ++i) {
+      int currPos = size - order + i + 1;
+      contextFactor[i] = currPos < 0 ? &GetSentenceStartWord() : &hypo.GetWord(currPos);
+    }
+    contextFactor.back() = &GetSentenceEndWord();
+    keys.push_back(NgramKey());
+    MakeKey(contextFactor, keys.back());
+  }
+}
+
+void LanguageModelRemote::Prefetch(const std::vector<NgramKey> &keys) const
+{
+  vector<NgramKey> missing;
+  boost::unordered_set<NgramKey, boost::hash<NgramKey> > seen;
+  Answer answer;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (seen.insert(keys[i]).second && !m_cache.Find(keys[i], answer)) {
+      missing.push_back(keys[i]);
+    }
+  }
+  if (missing.empty()) return;
+
+  vector<Answer> answers;
+  Request(missing, answers);
+  for (size_t i = 0; i < missing.size(); ++i) {
+    m_cache.Insert(missing[i], answers[i]);
+  }
+}
+
+void LanguageModelRemote::Request(const std::vector<NgramKey> &keys, std::vector<Answer> &answers) const
+{
+  using namespace RemoteLMProtocol;
+
+  // encode every batch up front; they are written back to back and the
+  // answers are read while later batches are still being sent
+  string out, body, ngram;
+  size_t count = 0;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const NgramKey &key = keys[i];
+    ngram.clear();
+    ngram += static_cast<char>(key.size());
+    for (size_t j = 0; j < key.size(); ++j) {
+      if (key[j] == NULL) {
+        AppendUint16(ngram, 5);
+        ngram += "<unk>";
+      } else {
+        const StringPiece str = key[j]->GetString();
+        AppendUint16(ngram, static_cast<uint16_t>(str.size()));
+        ngram.append(str.data(), str.size());
+      }
+    }
+    if (count == m_batchSize || body.size() + ngram.size() > kMaxRequestBodySize) {
+      AppendRequest(out, count, body);
+      count = 0;
+    }
+    body += ngram;
+    ++count;
+  }
+  AppendRequest(out, count, body);
+
+  answers.resize(keys.size());
+  Connection &connection = GetConnection();
+  try {
+    Exchange(connection.sock, out, answers);
+  } catch (...) {
+    // the connection may hold part of a request or unread answers, so
+    // the next request starts on a new one
+    close(connection.sock);
+    connection.sock = -1;
+    throw;
   }
-  return true;
+}
+
+void LanguageModelRemote::Exchange(int sock, const std::string &out, std::vector<Answer> &answers) const
+{
+  using namespace RemoteLMProtocol;
+
+  size_t written = 0, answered = 0, parsed = 0;
+  string in;
+  char buffer[65536];
+  while (answered < answers.size()) {
+    struct pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLIN | (written < out.size() ? POLLOUT : 0);
+    pfd.revents = 0;
+    if (poll(&pfd, 1, -1) < 0) {
+      UTIL_THROW_IF(errno != EINTR, util::ErrnoException, "poll on LM server connection");
+      continue;
+    }
+
+    if (written < out.size() && (pfd.revents & POLLOUT)) {
+      ssize_t n = send(sock, out.data() + written, out.size() - written, MSG_NOSIGNAL);
+      UTIL_THROW_IF(n < 0 && errno != EAGAIN && errno != EINTR, util::ErrnoException,
+                    "Writing to LM server");
+      if (n > 0) written += n;
+    }
+
+    if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+      ssize_t n = recv(sock, buffer, sizeof(buffer), 0);
+      UTIL_THROW_IF(n == 0, util::Exception, "LM server closed the connection");
+      UTIL_THROW_IF(n < 0 && errno != EAGAIN && errno != EINTR, util::ErrnoException,
+                    "Reading from LM server");
+      if (n > 0) in.append(buffer, n);
+    }
+
+    // decode every complete response received so far
+    while (in.size() - parsed >= kResponseHeaderSize) {
+      size_t count = ReadUint32(in.data() + parsed);
+      if (in.size() - parsed < kResponseHeaderSize + count * kResponseRecordSize) break;
+      UTIL_THROW_IF(answered + count > answers.size(), util::Exception,
+                    "LM server sent more answers than requested");
+      const char *record = in.data() + parsed + kResponseHeaderSize;
+      for (size_t i = 0; i < count; ++i, record += kResponseRecordSize) {
+        Answer &answer = answers[answered++];
+        answer.score = FloorScore(TransformLMScore(ReadFloat(record)));
+        answer.unknown = (ReadUint32(record + 4) & kFlagUnknown) != 0;
+        answer.state = ReadUint64(record + 8);
+      }
+      parsed += kResponseHeaderSize + count * kResponseRecordSize;
+    }
+    if (parsed == in.size()) {
+      in.clear();
+      parsed = 0;
+    }
+  }
+  // bytes beyond the last answer would be read as the next request's answers
+  UTIL_THROW_IF(!in.empty(), util::Exception, "LM server sent more than was requested");
 }
 
 LMResult LanguageModelRemote::GetValue(const std::vector<const Word*> &contextFactor, State* finalState) const
 {
   LMResult ret;
   ret.unknown = false;
-  size_t count = contextFactor.size();
-  if (count == 0) {
+  if (contextFactor.empty()) {
     if (finalState) *finalState = NULL;
     ret.score = 0.0;
     return ret;
   }
-  //std::cerr << "contextFactor.size() = " << count << "\n";
-  size_t max = m_nGramOrder;
-  const FactorType factor = GetFactorType();
-  if (max > count) max = count;
-
-  Cache* cur = &m_cache;
-  int pc = static_cast<int>(count) - 1;
-  for (int i = 0; i < pc; ++i) {
-    const Factor* f = contextFactor[i]->GetFactor(factor);
-    cur = &cur->tree[f ? f : BOS];
-  }
-  const Factor* event_word = contextFactor[pc]->GetFactor(factor);
-  cur = &cur->tree[event_word ? event_word : EOS];
-  if (cur->prob) {
-    if (finalState) *finalState = cur->boState;
-    ret.score = cur->prob;
-    return ret;
-  }
-  cur->boState = *reinterpret_cast<const State*>(&m_curId);
-  ++m_curId;
 
-  std::ostringstream os;
-  os << "prob ";
-  if (event_word == NULL) {
-    os << "</s>";
-  } else {
-    os << event_word->GetString();
-  }
-  for (size_t i=1; i<max; i++) {
-    const Factor* f = contextFactor[count-1-i]->GetFactor(factor);
-    if (f == NULL) {
-      os << " <s>";
-    } else {
-      os << ' ' << f->GetString();
-    }
-  }
-  os << std::endl;
-  std::string out = os.str();
-  write(sock, out.c_str(), out.size());
-  char res[6];
-  int r = read(sock, res, 6);
-  int errors = 0;
-  int cnt = 0;
-  while (1) {
-    if (r < 0) {
-      errors++;
-      sleep(1);
-      //std::cerr << "Error: read()\n";
-      if (errors > 5) exit(1);
-    } else if (r==0 || res[cnt] == '\n') {
-      break;
-    } else {
-      cnt += r;
-      if (cnt==6) break;
-      read(sock, &res[cnt], 6-cnt);
-    }
+  NgramKey key;
+  MakeKey(contextFactor, key);
+  Answer answer;
+  if (!m_cache.Find(key, answer)) {
+    vector<NgramKey> keys(1, key);
+    vector<Answer> answers;
+    Request(keys, answers);
+    answer = answers[0];
+    m_cache.Insert(key, answer);
   }
-  cur->prob = FloorScore(TransformLMScore(*reinterpret_cast<float*>(res)));
-  if (finalState) {
-    *finalState = cur->boState;
-  }
-  ret.score = cur->prob;
+
+  // the server's state hash identifies the LM context for recombination
+  if (finalState) *finalState = reinterpret_cast<State>(static_cast<uintptr_t>(answer.state));
+  ret.score = answer.score;
+  ret.unknown = answer.unknown;
   return ret;
 }
 
-LanguageModelRemote::~LanguageModelRemote()
+void LanguageModelRemote::CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const
+{
+  vector<NgramKey> keys;
+  CollectNgrams(phrase, keys);
+  Prefetch(keys);
+  LanguageModelSingleFactor::CalcScore(phrase, fullScore, ngramScore, oovCount);
+}
+
+FFState *LanguageModelRemote::Evaluate(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const
+{
+  vector<NgramKey> keys;
+  CollectNgrams(hypo, keys);
+  Prefetch(keys);
+  return LanguageModelSingleFactor::Evaluate(hypo, ps, out);
+}
+
+void LanguageModelRemote::IssueRequestsFor(Hypothesis& hypo, const FFState* /*input_state*/)
+{
+  CollectNgrams(hypo, GetConnection().pending);
+}
+
+void LanguageModelRemote::sync()
+{
+  Connection &connection = GetConnection();
+  Prefetch(connection.pending);
+  connection.pending.clear();
+}
+
+bool LanguageModelRemote::Cache::Find(const NgramKey &key, Answer &answer)
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  Map::const_iterator iter = m_current.find(key);
+  if (iter != m_current.end()) {
+    answer = iter->second;
+    return true;
+  }
+  iter = m_previous.find(key);
+  if (iter == m_previous.end()) return false;
+  answer = iter->second;
+  InsertLocked(key, answer);
+  return true;
+}
+
+void LanguageModelRemote::Cache::Insert(const NgramKey &key, const Answer &answer)
 {
-  // Step 8 When finished send all lingering transmissions and close the connection
-  close(sock);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  InsertLocked(key, answer);
+}
+
+void LanguageModelRemote::Cache::InsertLocked(const NgramKey &key, const Answer &answer)
+{
+  if (m_current.size() >= (m_capacity + 1) / 2) {
+    m_previous.swap(m_current);
+    m_current.clear();
+  }
+  m_current[key] = answer;
 }
 
 }
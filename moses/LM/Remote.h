@@ -1,46 +1,122 @@
 #ifndef moses_LanguageModelRemote_h
 #define moses_LanguageModelRemote_h
 
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <boost/functional/hash.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#endif
+
 #include "SingleFactor.h"
 #include "moses/TypeDef.h"
 #include "moses/Factor.h"
-#include <sys/socket.h>
-#include <sys/types.h>
-#include <netinet/in.h>
 
 namespace Moses
 {
 
-/** @todo ask miles
+/** Language model queried over TCP from a server such as misc/remoteLMServer.
+ *
+ * N-grams are sent in batches (see RemoteProtocol.h): all n-grams of a phrase
+ * or hypothesis go out in one message, and with search-algorithm 4 the
+ * n-grams of a whole batch of hypotheses are collected by IssueRequestsFor()
+ * and sent by sync(). Large batches are split into several requests which
+ * are pipelined on the connection. Each decoding thread has its own
+ * connection; answers go into a bounded cache shared by all threads.
  */
 class LanguageModelRemote : public LanguageModelSingleFactor
 {
+public:
+  LanguageModelRemote(const std::string &line);
+  ~LanguageModelRemote();
+
+  void SetParameter(const std::string& key, const std::string& value);
+  void Load();
+
+  virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = 0) const;
+
+  void CalcScore(const Phrase &phrase, float &fullScore, float &ngramScore, size_t &oovCount) const;
+  FFState *Evaluate(const Hypothesis &hypo, const FFState *ps, ScoreComponentCollection *out) const;
+
+  void IssueRequestsFor(Hypothesis& hypo, const FFState* input_state);
+  void sync();
+  bool UsesBatchedRequests() const {
+    return true;
+  }
+
 private:
-  struct Cache {
-    std::map<const Factor*, Cache> tree;
-    float prob;
-    State boState;
-    Cache() : prob(0) {}
+  //! factors of the words of an n-gram, oldest first
+  typedef std::vector<const Factor*> NgramKey;
+
+  struct Answer {
+    float score;
+    bool unknown;
+    uint64_t state;
   };
 
-  int sock, port;
-  struct hostent *hp;
-  struct sockaddr_in server;
-  mutable size_t m_curId;
+  /** Thread-safe cache of at most capacity answers. Entries live in two
+   * generations; when the current one is full it replaces the previous one,
+   * and hits in the previous generation are moved back into the current.
+   */
+  class Cache
+  {
+  public:
+    Cache() : m_capacity(0) {}
+    void SetCapacity(size_t capacity) {
+      m_capacity = capacity;
+    }
+    bool Find(const NgramKey &key, Answer &answer);
+    void Insert(const NgramKey &key, const Answer &answer);
+  private:
+    typedef boost::unordered_map<NgramKey, Answer, boost::hash<NgramKey> > Map;
+    void InsertLocked(const NgramKey &key, const Answer &answer);
+
+    Map m_current, m_previous;
+    size_t m_capacity;
+#ifdef WITH_THREADS
+    boost::mutex m_mutex;
+#endif
+  };
+
+  //! a socket to the server and the n-grams waiting for sync()
+  struct Connection {
+    Connection() : sock(-1) {}
+    ~Connection();
+    int sock;
+    std::vector<NgramKey> pending;
+  };
+
+  std::string m_host;
+  int m_port;
+  size_t m_batchSize;
+  size_t m_cacheSize;
   mutable Cache m_cache;
-  bool start(const std::string& host, int port);
-  static const Factor* BOS;
-  static const Factor* EOS;
-public:
-  ~LanguageModelRemote();
-  void ClearSentenceCache() {
-    m_cache.tree.clear();
-    m_curId = 1000;
-  }
-  virtual LMResult GetValue(const std::vector<const Word*> &contextFactor, State* finalState = 0) const;
-  bool Load(const std::string &filePath
-            , FactorType factorType
-            , size_t nGramOrder);
+
+#ifdef WITH_THREADS
+  mutable boost::thread_specific_ptr<Connection> m_connection;
+#else
+  mutable boost::scoped_ptr<Connection> m_connection;
+#endif
+
+  Connection &GetConnection() const;
+  int Connect() const;
+
+  void MakeKey(const std::vector<const Word*> &contextFactor, NgramKey &key) const;
+  void CollectNgrams(const Phrase &phrase, std::vector<NgramKey> &keys) const;
+  void CollectNgrams(const Hypothesis &hypo, std::vector<NgramKey> &keys) const;
+
+  //! ask the server for all keys not in the cache and cache the answers
+  void Prefetch(const std::vector<NgramKey> &keys) const;
+  //! ask the server for keys, answers[i] belongs to keys[i]
+  void Request(const std::vector<NgramKey> &keys, std::vector<Answer> &answers) const;
+  //! write the encoded requests out to sock and read answers.size() answers
+  void Exchange(int sock, const std::string &out, std::vector<Answer> &answers) const;
 };
 
 }
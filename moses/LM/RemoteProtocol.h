@@ -0,0 +1,94 @@
+#ifndef moses_LM_RemoteProtocol_h
+#define moses_LM_RemoteProtocol_h
+
+#include <string>
+#include <cstring>
+#include <stdint.h>
+#include <arpa/inet.h>
+
+namespace Moses
+{
+
+/** Wire format spoken between LanguageModelRemote and remoteLMServer.
+ *
+ * A connection carries a stream of requests, each answered by exactly one
+ * response in the same order, so a client may write several requests before
+ * reading the first answer. All integers are in network byte order.
+ *
+ * request:  uint32 n-gram count, uint32 body size in bytes, then per n-gram
+ *           uint8 word count followed by the words, oldest first, each as
+ *           uint16 length and the bytes of the word.
+ *           The body is at most kMaxRequestBodySize bytes.
+ * response: uint32 n-gram count, then per n-gram a 16 byte record: float
+ *           log10 probability, uint32 flags, uint64 hash of the LM state
+ *           reached after the last word.
+ */
+namespace RemoteLMProtocol
+{
+
+const size_t kRequestHeaderSize = 8;
+const size_t kResponseHeaderSize = 4;
+const size_t kResponseRecordSize = 16;
+//! larger requests are rejected by the server; one n-gram is at most 16.7MB
+const uint32_t kMaxRequestBodySize = 64 << 20;
+
+//! flag bit set when the predicted word is not in the LM vocabulary
+const uint32_t kFlagUnknown = 1;
+
+inline void AppendUint16(std::string &out, uint16_t value)
+{
+  value = htons(value);
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void AppendUint32(std::string &out, uint32_t value)
+{
+  value = htonl(value);
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+inline void AppendUint64(std::string &out, uint64_t value)
+{
+  AppendUint32(out, static_cast<uint32_t>(value >> 32));
+  AppendUint32(out, static_cast<uint32_t>(value));
+}
+
+inline void AppendFloat(std::string &out, float value)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  AppendUint32(out, bits);
+}
+
+inline uint16_t ReadUint16(const char *in)
+{
+  uint16_t value;
+  std::memcpy(&value, in, sizeof(value));
+  return ntohs(value);
+}
+
+inline uint32_t ReadUint32(const char *in)
+{
+  uint32_t value;
+  std::memcpy(&value, in, sizeof(value));
+  return ntohl(value);
+}
+
+inline uint64_t ReadUint64(const char *in)
+{
+  return (static_cast<uint64_t>(ReadUint32(in)) << 32) | ReadUint32(in + 4);
+}
+
+inline float ReadFloat(const char *in)
+{
+  uint32_t bits = ReadUint32(in);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+}
+
+}
+
+#endif
@@ -64,7 +64,7 @@ void LexicalReordering::Load()
 
 Scores LexicalReordering::GetProb(const Phrase& f, const Phrase& e) const
 {
-  return m_table->GetScore(f, e, Phrase(ARRAY_SIZE_INCR));
+  return m_table->GetScore(f, e, Phrase());
 }
 
 FFState* LexicalReordering::Evaluate(const Hypothesis& hypo,
@@ -39,6 +39,10 @@ public:
     m_table->InitializeForInput(i);
   }
 
+  bool SupportsParallelLookup() const {
+    return m_table->SupportsParallelLookup();
+  }
+
   Scores GetProb(const Phrase& f, const Phrase& e) const;
 
   virtual FFState* Evaluate(const Hypothesis& cur_hypo,
@@ -7,6 +7,9 @@
 #include "GenerationDictionary.h"
 #include "TargetPhrase.h"
 #include "TargetPhraseCollection.h"
+#include "FactorCollection.h"
+#include "ThreadPool.h"
+#include "util/tokenize_piece.hh"
 
 #ifndef WIN32
 #include "TranslationModel/CompactPT/LexicalReorderingTableCompact.h"
@@ -68,12 +71,59 @@ LexicalReorderingTable* LexicalReorderingTable::LoadAvailable(const std::string&
 /*
  * functions for LexicalReorderingTableMemory
  */
+namespace
+{
+//markers mixed into the key after each word and after each of f, e and c
+const uint64_t kWordEnd = 1;
+const uint64_t kPhraseEnd = 2;
+
+//64 bit hash combination from CityHash (Hash128to64)
+inline uint64_t HashCombine(uint64_t hash, uint64_t value)
+{
+  const uint64_t kMul = 0x9ddfea08eb382d69ULL;
+  uint64_t a = (value ^ hash) * kMul;
+  a ^= (a >> 47);
+  uint64_t b = (hash ^ a) * kMul;
+  b ^= (b >> 47);
+  return b * kMul;
+}
+
+inline uint64_t HashFactor(uint64_t hash, const Factor* factor)
+{
+  return HashCombine(hash, factor->GetId() + 3);
+}
+
+const size_t kLinesPerBlock = 10000;
+}
+
+#ifdef WITH_THREADS
+//parses one block of lines on a worker thread
+class LexicalReorderingTableLoader : public Task
+{
+public:
+  LexicalReorderingTableLoader(const LexicalReorderingTableMemory& table,
+                               std::vector<std::string>* lines,
+                               LexicalReorderingTableMemory::Block* block)
+    : m_table(table), m_lines(lines), m_block(block) {
+  }
+  void Run() {
+    m_table.ParseLines(*m_lines, *m_block);
+    delete m_lines;
+  }
+private:
+  const LexicalReorderingTableMemory& m_table;
+  std::vector<std::string>* m_lines;
+  LexicalReorderingTableMemory::Block* m_block;
+};
+#endif
+
 LexicalReorderingTableMemory::LexicalReorderingTableMemory(
   const std::string& filePath,
   const std::vector<FactorType>& f_factors,
   const std::vector<FactorType>& e_factors,
   const std::vector<FactorType>& c_factors)
   : LexicalReorderingTable(f_factors, e_factors, c_factors)
+  , m_numScores(0)
 {
   LoadFromFile(filePath);
 }
@@ -86,131 +136,229 @@ std::vector<float>  LexicalReorderingTableMemory::GetScore(const Phrase& f,
     const Phrase& e,
     const Phrase& c)
 {
-  //rather complicated because of const can't use []... as [] might enter new things into std::map
-  //also can't have to be careful with words range if c is empty can't use c.GetSize()-1 will underflow and be large
-  TableType::const_iterator r;
-  std::string key;
-  if(0 == c.GetSize()) {
-    key = MakeKey(f,e,c);
-    r = m_Table.find(key);
-    if(m_Table.end() != r) {
-      return r->second;
-    }
+  uint64_t key = 0;
+  if(!m_FactorsF.empty()) {
+    key = HashCombine(HashPhrase(key, f, 0, m_FactorsF), kPhraseEnd);
+  }
+  if(!m_FactorsE.empty()) {
+    key = HashCombine(HashPhrase(key, e, 0, m_FactorsE), kPhraseEnd);
+  }
+  const float* scores = NULL;
+  if(m_FactorsC.empty()) {
+    scores = Find(key);
   } else {
-    //right try from large to smaller context
-    for(size_t i = 0; i <= c.GetSize(); ++i) {
-      Phrase sub_c(c.GetSubString(WordsRange(i,c.GetSize()-1)));
-      key = MakeKey(f,e,sub_c);
-      r = m_Table.find(key);
-      if(m_Table.end() != r) {
-        return r->second;
-      }
+    //try from large to smaller context, down to the empty one
+    for(size_t i = 0; i <= c.GetSize() && !scores; ++i) {
+      scores = Find(HashCombine(HashPhrase(key, c, i, m_FactorsC), kPhraseEnd));
     }
   }
-  return Scores();
+  return scores ? Scores(scores, scores + m_numScores) : Scores();
 }
 
 void LexicalReorderingTableMemory::DbgDump(std::ostream* out) const
 {
-  TableType::const_iterator i;
-  for(i = m_Table.begin(); i != m_Table.end(); ++i) {
-    *out << " key: '" << i->first << "' score: ";
-    *out << "(num scores: " << (i->second).size() << ")";
-    for(size_t j = 0; j < (i->second).size(); ++j) {
-      *out << (i->second)[j] << " ";
+  for(size_t slot = 0; slot < m_keys.size(); ++slot) {
+    if(!m_keys[slot]) {
+      continue;
+    }
+    *out << " key: " << std::hex << m_keys[slot] << std::dec << " score: ";
+    *out << "(num scores: " << m_numScores << ")";
+    for(size_t j = 0; j < m_numScores; ++j) {
+      *out << m_scores[slot * m_numScores + j] << " ";
     }
     *out << "\n";
   }
 };
 
-std::string  LexicalReorderingTableMemory::MakeKey(const Phrase& f,
-    const Phrase& e,
-    const Phrase& c) const
+//hash of the given factors of the words phrase[begin..], skipping factors
+//the words don't have, just like Phrase::GetStringRep() does
+uint64_t LexicalReorderingTableMemory::HashPhrase(uint64_t hash,
+    const Phrase& phrase,
+    size_t begin,
+    const FactorList& factors) const
 {
-  /*
-  std::string key;
-  if(!m_FactorsF.empty()){
-    key += f.GetStringRep(m_FactorsF);
+  for(size_t pos = begin; pos < phrase.GetSize(); ++pos) {
+    const Word& word = phrase.GetWord(pos);
+    for(size_t i = 0; i < factors.size(); ++i) {
+      const Factor* factor = word[factors[i]];
+      if(factor) {
+        hash = HashFactor(hash, factor);
+      }
+    }
+    hash = HashCombine(hash, kWordEnd);
   }
-  if(!m_FactorsE.empty()){
-    if(!key.empty()){
-      key += " ||| ";
+  return hash;
+}
+
+//same hash as HashPhrase() for the string representation of a phrase
+uint64_t LexicalReorderingTableMemory::HashString(uint64_t hash,
+    const std::string& phrase,
+    const FactorList& factors) const
+{
+  FactorCollection& factorCollection = FactorCollection::Instance();
+  const std::string& factorDelimiter = StaticData::Instance().GetFactorDelimiter();
+  for(util::TokenIter<util::AnyCharacter, true> word(phrase, util::AnyCharacter(" \t")); word; ++word) {
+    size_t numFactors = 0;
+    for(util::TokenIter<util::MultiCharacter, false> factor(*word, util::MultiCharacter(factorDelimiter)); factor; ++factor) {
+      if(++numFactors > factors.size()) {
+        break;
+      }
+      hash = HashFactor(hash, factorCollection.AddFactor(*factor));
     }
-    key += e.GetStringRep(m_FactorsE);
+    hash = HashCombine(hash, kWordEnd);
   }
-  */
-  return MakeKey(auxClearString(f.GetStringRep(m_FactorsF)),
-                 auxClearString(e.GetStringRep(m_FactorsE)),
-                 auxClearString(c.GetStringRep(m_FactorsC)));
+  return hash;
 }
 
-std::string  LexicalReorderingTableMemory::MakeKey(const std::string& f,
-    const std::string& e,
-    const std::string& c) const
+const float* LexicalReorderingTableMemory::Find(uint64_t key) const
 {
-  std::string key;
-  if(!f.empty()) {
-    key += f;
+  if(m_keys.empty()) {
+    return NULL;
   }
-  if(!m_FactorsE.empty()) {
-    if(!key.empty()) {
-      key += "|||";
-    }
-    key += e;
+  if(!key) {
+    key = 1;
   }
-  if(!m_FactorsC.empty()) {
-    if(!key.empty()) {
-      key += "|||";
+  const size_t mask = m_keys.size() - 1;
+  for(size_t slot = key & mask; m_keys[slot]; slot = (slot + 1) & mask) {
+    if(m_keys[slot] == key) {
+      return &m_scores[slot * m_numScores];
     }
-    key += c;
   }
-  return key;
+  return NULL;
 }
 
-void  LexicalReorderingTableMemory::LoadFromFile(const std::string& filePath)
+void LexicalReorderingTableMemory::Insert(uint64_t key, const float* scores)
 {
-  std::string fileName = filePath;
-  if(!FileExists(fileName) && FileExists(fileName+".gz")) {
-    fileName += ".gz";
+  if(!key) {
+    key = 1;
   }
-  InputFileStream file(fileName);
-  std::string line(""), key("");
-  int numScores = -1;
-  std::cerr << "Loading table into memory...";
-  while(!getline(file, line).eof()) {
-    std::vector<std::string> tokens = TokenizeMultiCharSeparator(line, "|||");
-    int t = 0 ;
-    std::string f(""),e(""),c("");
+  const size_t mask = m_keys.size() - 1;
+  size_t slot = key & mask;
+  while(m_keys[slot] && m_keys[slot] != key) {
+    slot = (slot + 1) & mask;
+  }
+  //later lines replace earlier ones with the same key
+  m_keys[slot] = key;
+  std::copy(scores, scores + m_numScores, m_scores.begin() + slot * m_numScores);
+}
 
+void LexicalReorderingTableMemory::ParseLines(const std::vector<std::string>& lines, Block& block) const
+{
+  block.numScores = 0;
+  block.consistent = true;
+  block.keys.reserve(lines.size());
+  std::vector<float> p;
+  for(size_t i = 0; i < lines.size(); ++i) {
+    if(lines[i].empty()) {
+      continue;
+    }
+    std::vector<std::string> tokens = TokenizeMultiCharSeparator(lines[i], "|||");
+    size_t t = 0;
+    uint64_t key = 0;
     if(!m_FactorsF.empty()) {
       //there should be something for f
-      f = auxClearString(tokens.at(t));
+      key = HashCombine(HashString(key, tokens.at(t), m_FactorsF), kPhraseEnd);
       ++t;
     }
     if(!m_FactorsE.empty()) {
       //there should be something for e
-      e = auxClearString(tokens.at(t));
+      key = HashCombine(HashString(key, tokens.at(t), m_FactorsE), kPhraseEnd);
       ++t;
     }
     if(!m_FactorsC.empty()) {
       //there should be something for c
-      c = auxClearString(tokens.at(t));
+      key = HashCombine(HashString(key, tokens.at(t), m_FactorsC), kPhraseEnd);
       ++t;
     }
     //last token are the probs
-    std::vector<float> p = Scan<float>(Tokenize(tokens.at(t)));
+    p.clear();
+    for(util::TokenIter<util::AnyCharacter, true> score(tokens.at(t), util::AnyCharacter(" \t")); score; ++score) {
+      //the token is followed by whitespace or the end of the line
+      p.push_back(FloorScore(TransformScore(strtod(score->data(), NULL))));
+    }
     //sanity check: all lines must have equall number of probs
-    if(-1 == numScores) {
-      numScores = (int)p.size(); //set in first line
+    if(block.keys.empty()) {
+      block.numScores = p.size();
+    } else if(p.size() != block.numScores) {
+      block.consistent = false;
+      return;
+    }
+    block.keys.push_back(key);
+    block.scores.insert(block.scores.end(), p.begin(), p.end());
+  }
+}
+
+void  LexicalReorderingTableMemory::LoadFromFile(const std::string& filePath)
+{
+  std::string fileName = filePath;
+  if(!FileExists(fileName) && FileExists(fileName+".gz")) {
+    fileName += ".gz";
+  }
+  InputFileStream file(fileName);
+  std::cerr << "Loading table into memory...";
+
+  //parse blocks of lines, in parallel when the decoder runs several threads
+  std::vector<Block*> blocks;
+  std::string line;
+#ifdef WITH_THREADS
+  const size_t numThreads = std::max(1, StaticData::Instance().ThreadCount());
+  std::auto_ptr<ThreadPool> pool;
+  if(numThreads > 1) {
+    pool.reset(new ThreadPool(numThreads));
+    pool->SetQueueLimit(2 * numThreads);
+  }
+#endif
+  while(file.good()) {
+    std::vector<std::string>* lines = new std::vector<std::string>();
+    lines->reserve(kLinesPerBlock);
+    while(lines->size() < kLinesPerBlock && getline(file, line)) {
+      lines->push_back(line);
+    }
+    if(lines->empty()) {
+      delete lines;
+      break;
     }
-    if((int)p.size() != numScores) {
-      TRACE_ERR( "found inconsistent number of probabilities... found " << p.size() << " expected " << numScores << std::endl);
-      exit(0);
+    blocks.push_back(new Block());
+#ifdef WITH_THREADS
+    if(pool.get()) {
+      pool->Submit(new LexicalReorderingTableLoader(*this, lines, blocks.back()));
+      continue;
+    }
+#endif
+    ParseLines(*lines, *blocks.back());
+    delete lines;
+  }
+#ifdef WITH_THREADS
+  if(pool.get()) {
+    pool->Stop(true);
+  }
+#endif
+
+  //size the table for a load factor of at most 3/4 and fill it in file order
+  size_t numEntries = 0;
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    const Block& block = *blocks[i];
+    if(0 == i) {
+      m_numScores = block.numScores;
+    }
+    if(!block.consistent || (!block.keys.empty() && block.numScores != m_numScores)) {
+      TRACE_ERR( "found inconsistent number of probabilities in " << fileName << std::endl);
+      exit(1);
+    }
+    numEntries += block.keys.size();
+  }
+  size_t numSlots = 1;
+  while(numSlots * 3 < numEntries * 4 + 4) {
+    numSlots *= 2;
+  }
+  m_keys.assign(numSlots, 0);
+  m_scores.assign(numSlots * m_numScores, 0);
+  for(size_t i = 0; i < blocks.size(); ++i) {
+    const Block& block = *blocks[i];
+    for(size_t j = 0; j < block.keys.size(); ++j) {
+      Insert(block.keys[j], &block.scores[j * m_numScores]);
     }
-    std::transform(p.begin(),p.end(),p.begin(),TransformScore);
-    std::transform(p.begin(),p.end(),p.begin(),FloorScore);
-    //save it all into our map
-    m_Table[MakeKey(f,e,c)] = p;
+    delete blocks[i];
   }
   std::cerr << "done.\n";
 }
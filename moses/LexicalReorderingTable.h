@@ -7,6 +7,7 @@
 #include <memory>
 #include <string>
 #include <iostream>
+#include <stdint.h>
 
 #ifdef WITH_THREADS
 #include <boost/thread/tss.hpp>
@@ -26,6 +27,7 @@ namespace Moses
 class Phrase;
 class InputType;
 class ConfusionNet;
+class LexicalReorderingTableLoader;
 
 //! additional types
 class LexicalReorderingTable
@@ -45,6 +47,10 @@ public:
   };
   virtual void InitializeForInputPhrase(const Phrase&) {
   };
+  //! whether GetScore() may be called from several threads at once
+  virtual bool SupportsParallelLookup() const {
+    return false;
+  }
   /*
   int GetNumScoreComponents() const {
     return m_NumScores;
@@ -68,11 +74,13 @@ protected:
   FactorList m_FactorsC;
 };
 
-//! @todo what is this?
+/** Plain text table held in memory. Entries are stored in an open
+ * addressing hash table keyed by a 64 bit hash of the factor ids of f, e
+ * and c, so lookups neither build strings nor allocate. The table is parsed
+ * by the decoder threads in parallel.
+ */
 class LexicalReorderingTableMemory : public LexicalReorderingTable
 {
-  //implements LexicalReorderingTable saving all scores in one large std::map<> thingy
-  //to be used for non binary tables... uses a LOT of memory
 public:
   LexicalReorderingTableMemory( const std::string& filePath,
                                 const std::vector<FactorType>& f_factors,
@@ -81,15 +89,34 @@ public:
   virtual ~LexicalReorderingTableMemory();
 public:
   virtual std::vector<float> GetScore(const Phrase& f, const Phrase& e, const Phrase& c);
+  bool SupportsParallelLookup() const {
+    return true;
+  }
   void DbgDump(std::ostream* out) const;
+
 private:
-  std::string MakeKey(const Phrase& f, const Phrase& e, const Phrase& c) const;
-  std::string MakeKey(const std::string& f, const std::string& e, const std::string& c) const;
+  friend class LexicalReorderingTableLoader;
+
+  //! parsed entries of a block of lines
+  struct Block {
+    std::vector<uint64_t> keys;
+    std::vector<float> scores;
+    size_t numScores;
+    bool consistent;
+  };
+  void ParseLines(const std::vector<std::string>& lines, Block& block) const;
+
+  uint64_t HashPhrase(uint64_t hash, const Phrase& phrase, size_t begin, const FactorList& factors) const;
+  uint64_t HashString(uint64_t hash, const std::string& phrase, const FactorList& factors) const;
+
+  const float* Find(uint64_t key) const;
+  void Insert(uint64_t key, const float* scores);
 
   void LoadFromFile(const std::string& filePath);
 private:
-  typedef std::map< std::string, std::vector<float> > TableType;
-  TableType m_Table;
+  size_t m_numScores;
+  std::vector<uint64_t> m_keys; //! hash per slot, 0 marks an empty slot
+  std::vector<float> m_scores; //! m_numScores per slot
 };
 
 class LexicalReorderingTableTree : public LexicalReorderingTable
@@ -30,16 +30,21 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <limits>
 #include <map>
 #include <set>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
 #include "Manager.h"
 #include "TypeDef.h"
 #include "Util.h"
 #include "TargetPhrase.h"
 #include "TrellisPath.h"
 #include "TrellisPathCollection.h"
+#include "TrellisPathExtractor.h"
+#include "SearchGraphBinary.h"
 #include "TranslationOption.h"
 #include "LexicalReordering.h"
 #include "TranslationOptionCollection.h"
 #include "Timer.h"
+#include "DecoderProfile.h"
 #include "moses/FF/DistortionScoreProducer.h"
 
 #ifdef HAVE_PROTOBUF
@@ -54,7 +59,8 @@ using namespace std;
 namespace Moses
 {
 Manager::Manager(size_t lineNumber, InputType const& source, SearchAlgorithm searchAlgorithm)
-  :m_transOptColl(source.CreateTranslationOptionCollection())
+  :m_deadline(StaticData::Instance().GetTimeoutThreshold())
+  ,m_transOptColl(source.CreateTranslationOptionCollection())
   ,m_search(Search::CreateSearch(*this, source, searchAlgorithm, *m_transOptColl))
   ,interrupted_flag(0)
   ,m_hypoId(0)
@@ -95,20 +101,18 @@ void Manager::ProcessSentence()
   // get translation options
   Timer getOptionsTime;
   getOptionsTime.start();
+  uint64_t t = MonotonicNanoTime();
   m_transOptColl->CreateTranslationOptions();
+  GetSentenceStats().AddTimeCollectOpts(MonotonicNanoTime() - t);
   VERBOSE(1, "Line "<< m_lineNumber << ": Collecting options took " << getOptionsTime << " seconds" << endl);
 
-  // some reporting on how long this took
-  IFVERBOSE(2) {
-    // TODO: XXX: Hack: SentenceStats.h currently requires all values to be of type clock_t
-    GetSentenceStats().AddTimeCollectOpts((clock_t) (getOptionsTime.get_elapsed_time() * CLOCKS_PER_SEC));
-  }
-
   // search for best translation with the specified algorithm
   Timer searchTime;
   searchTime.start();
   m_search->ProcessSentence();
   VERBOSE(1, "Line " << m_lineNumber << ": Search took " << searchTime << " seconds" << endl);
+
+  DecoderProfile::Instance().Record(m_lineNumber, GetSentenceStats());
 }
 
 /**
@@ -201,7 +205,7 @@ void Manager::printThisHypothesis(long translationId, const Hypothesis* hypo, co
 /**
  * After decoding, the hypotheses in the stacks and additional arcs
  * form a search graph that can be mined for n-best lists.
- * The heavy lifting is done in the TrellisPath and TrellisPathCollection
+ * The heavy lifting is done in TrellisPathExtractor and TrellisPath,
  * this function controls this for one sentence.
  *
  * \param count the number of n-best translations to produce
@@ -219,48 +223,24 @@ void Manager::CalcNBest(size_t count, TrellisPathList &ret,bool onlyDistinct) co
   if (sortedPureHypo.size() == 0)
     return;
 
-  TrellisPathCollection contenders;
+  TrellisPathExtractor contenders(sortedPureHypo);
 
-  set<Phrase> distinctHyps;
-
-  // add all pure paths
-  vector<const Hypothesis*>::const_iterator iterBestHypo;
-  for (iterBestHypo = sortedPureHypo.begin()
-                      ; iterBestHypo != sortedPureHypo.end()
-       ; ++iterBestHypo) {
-    contenders.Add(new TrellisPath(*iterBestHypo));
-  }
+  boost::unordered_set<Phrase> distinctHyps;
 
   // factor defines stopping point for distinct n-best list if too many candidates identical
   size_t nBestFactor = StaticData::Instance().GetNBestFactor();
   if (nBestFactor < 1) nBestFactor = 1000; // 0 = unlimited
 
   // MAIN loop
-  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && contenders.GetSize() > 0 && (iteration < count * nBestFactor) ; iteration++) {
+  for (size_t iteration = 0 ; (onlyDistinct ? distinctHyps.size() : ret.GetSize()) < count && !contenders.Empty() && (iteration < count * nBestFactor) ; iteration++) {
     // get next best from list of contenders
-    TrellisPath *path = contenders.pop();
-    CHECK(path);
-    // create deviations from current best
-    path->CreateDeviantPaths(contenders);
+    size_t path = contenders.Pop();
     if(onlyDistinct) {
-      Phrase tgtPhrase = path->GetSurfacePhrase();
-      if (distinctHyps.insert(tgtPhrase).second) {
-        ret.Add(path);
-      } else {
-        delete path;
-        path = NULL;
+      if (distinctHyps.insert(TrellisPath::GetSurfacePhrase(contenders.GetEdges(path))).second) {
+        contenders.Extract(path, ret);
       }
     } else {
-      ret.Add(path);
-    }
-
-
-    if(onlyDistinct) {
-      const size_t nBestFactor = StaticData::Instance().GetNBestFactor();
-      if (nBestFactor > 0)
-        contenders.Prune(count * nBestFactor);
-    } else {
-      contenders.Prune(count);
+      contenders.Extract(path, ret);
     }
   }
 }
@@ -1349,6 +1329,85 @@ void Manager::OutputSearchGraph(long translationId, std::ostream &outputSearchGr
   }
 }
 
+void Manager::OutputSearchGraphBinary(long translationId, std::ostream &outputSearchGraphStream) const
+{
+  const vector<FactorType> &outputFactorOrder = StaticData::Instance().GetOutputFactorOrder();
+  vector<SearchGraphNode> searchGraph;
+  GetSearchGraph(searchGraph);
+
+  // the same count as in the header written by the IOWrapper
+  size_t numDenseScores = 0;
+  const vector<FeatureFunction*> &ffs = FeatureFunction::GetFeatureFunctions();
+  for (size_t i = 0; i < ffs.size(); ++i) {
+    numDenseScores += ffs[i]->GetNumScoreComponents();
+  }
+
+  SearchGraphBinaryRecord record;
+  record.translationId = translationId;
+  record.nodes.resize(searchGraph.size());
+
+  // phrases and sparse feature names are stored once per sentence
+  boost::unordered_map<string, size_t> stringIds;
+  stringIds[""] = 0;
+  record.strings.push_back("");
+
+  for (size_t i = 0; i < searchGraph.size(); ++i) {
+    const SearchGraphNode &searchNode = searchGraph[i];
+    const Hypothesis *hypo = searchNode.hypo;
+    const Hypothesis *prevHypo = hypo->GetPrevHypo();
+    SearchGraphBinaryNode &node = record.nodes[i];
+
+    node.id = hypo->GetId();
+    node.back = prevHypo ? prevHypo->GetId() : -1;
+    node.forward = searchNode.forward;
+    node.recombined = searchNode.recombinationHypo ? searchNode.recombinationHypo->GetId() : -1;
+    node.stack = hypo->GetWordsBitmap().GetNumWordsCovered();
+    node.score = hypo->GetScore();
+    node.forwardScore = searchNode.fscore;
+
+    ScoreComponentCollection scoreBreakdown = hypo->GetScoreBreakdown();
+    if (prevHypo == NULL) {
+      // initial hypothesis
+      node.coveredStart = node.coveredEnd = 0;
+      node.sourcePhrase = node.targetPhrase = 0;
+    } else {
+      node.coveredStart = hypo->GetCurrSourceWordsRange().GetStartPos();
+      node.coveredEnd = hypo->GetCurrSourceWordsRange().GetEndPos();
+      const string phrases[2] = { hypo->GetSourcePhraseStringRep()
+                                  , hypo->GetCurrTargetPhrase().GetStringRep(outputFactorOrder)
+                                };
+      size_t ids[2];
+      for (size_t j = 0; j < 2; ++j) {
+        std::pair<boost::unordered_map<string, size_t>::iterator, bool> inserted
+        = stringIds.insert(make_pair(phrases[j], record.strings.size()));
+        if (inserted.second) record.strings.push_back(phrases[j]);
+        ids[j] = inserted.first->second;
+      }
+      node.sourcePhrase = ids[0];
+      node.targetPhrase = ids[1];
+      scoreBreakdown.MinusEquals(prevHypo->GetScoreBreakdown());
+    }
+
+    const FVector &scores = scoreBreakdown.GetScoresVector();
+    const std::valarray<FValue> &dense = scores.getCoreFeatures();
+    if (dense.size()) {
+      node.denseScores.assign(&dense[0], &dense[0] + dense.size());
+    } else {
+      // a collection without any scores has no core features allocated yet
+      node.denseScores.assign(numDenseScores, 0);
+    }
+    for (FVector::const_iterator iter = scores.cbegin(); iter != scores.cend(); ++iter) {
+      const string &name = iter->first.name();
+      std::pair<boost::unordered_map<string, size_t>::iterator, bool> inserted
+      = stringIds.insert(make_pair(name, record.strings.size()));
+      if (inserted.second) record.strings.push_back(name);
+      node.sparseScores.push_back(make_pair(inserted.first->second, iter->second));
+    }
+  }
+
+  WriteSearchGraphBinaryRecord(outputSearchGraphStream, numDenseScores, record);
+}
+
 void Manager::GetForwardBackwardSearchGraph(std::map< int, bool >* pConnected,
     std::vector< const Hypothesis* >* pConnectedList, std::map < const Hypothesis*, set< const Hypothesis* > >* pOutgoingHyps, vector< float>* pFwdBwdScores) const
 {
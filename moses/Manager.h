@@ -34,6 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "WordsBitmap.h"
 #include "Search.h"
 #include "SearchCubePruning.h"
+#include "SearchDeadline.h"
 
 namespace Moses
 {
@@ -112,6 +113,7 @@ private:
 protected:
   // data
 //	InputType const& m_source; /**< source sentence to be translated */
+  SearchDeadline m_deadline; /**< time budget of this sentence, started on construction */
   TranslationOptionCollection *m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
   Search *m_search;
 
@@ -152,6 +154,8 @@ public:
   void OutputSearchGraph(long translationId, std::ostream &outputSearchGraphStream) const;
   void OutputSearchGraphAsSLF(long translationId, std::ostream &outputSearchGraphStream) const;
   void OutputSearchGraphAsHypergraph(long translationId, std::ostream &outputSearchGraphStream) const;
+  //! append one record of the format in SearchGraphBinary.h
+  void OutputSearchGraphBinary(long translationId, std::ostream &outputSearchGraphStream) const;
   void GetSearchGraph(std::vector<SearchGraphNode>& searchGraph) const;
   const InputType& GetSource() const {
     return m_source;
@@ -164,6 +168,14 @@ public:
   void ResetSentenceStats(const InputType& source);
   SentenceStats& GetSentenceStats() const;
 
+  //! time budget of this sentence (-time-out), may be reset for a request
+  SearchDeadline& GetDeadline() {
+    return m_deadline;
+  }
+  const SearchDeadline& GetDeadline() const {
+    return m_deadline;
+  }
+
   /***
    *For Lattice MBR
   */
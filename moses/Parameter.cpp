@@ -76,6 +76,9 @@ Parameter::Parameter()
   AddParam("stack", "s", "maximum stack size for histogram pruning");
   AddParam("stack-diversity", "sd", "minimum number of hypothesis of each coverage in stack (default 0)");
   AddParam("threads","th", "number of threads to use in decoding (defaults to single-threaded)");
+  AddParam("thread-read-ahead", "number of input sentences read ahead of the decoder threads and started longest first (default 0 = in input order)");
+  AddParam("thread-pinning", "pin each decoder thread to one cpu (Linux only, default false)");
+  AddParam("translation-option-threads", "number of threads that collect and score the translation options of each sentence (default 1 = the decoder thread alone)");
   AddParam("translation-details", "T", "for each best hypothesis, report translation details to the given file");
   AddParam("ttable-file", "location and properties of the translation tables");
   AddParam("translation-option-threshold", "tot", "threshold for translation options relative to best for input phrase");
@@ -97,6 +100,7 @@ Parameter::Parameter()
   AddParam("consensus-decoding", "con", "use consensus decoding (De Nero et. al. 2009)");
   AddParam("mbr-size", "number of translation candidates considered in MBR decoding (default 200)");
   AddParam("mbr-scale", "scaling factor to convert log linear score probability in MBR decoding (default 1.0)");
+  AddParam("mbr-threads", "number of threads computing pairwise losses in n-best MBR decoding (default 1)");
   AddParam("lmbr-thetas", "theta(s) for lattice mbr calculation");
   AddParam("lmbr-pruning-factor", "average number of nodes/word wanted in pruned lattice");
   AddParam("lmbr-p", "unigram precision value for lattice mbr");
@@ -108,9 +112,12 @@ Parameter::Parameter()
   AddParam("persistent-cache-size", "maximum size of cache for translation options (default 10,000 input phrases)");
   AddParam("recover-input-path", "r", "(conf net/word lattice only) - recover input path corresponding to the best translation");
   AddParam("output-word-graph", "owg", "Output stack info as word graph. Takes filename, 0=only hypos in stack, 1=stack + nbest hypos");
-  AddParam("time-out", "seconds after which is interrupted (-1=no time-out, default is -1)");
+  AddParam("time-out", "seconds per sentence; from half of it on, search limits shrink so that it finishes in time with a complete translation (-1=no time-out, default is -1)");
+  AddParam("profile-output", "write per-phase and per-feature decoding times as JSON lines to the given file (- for stderr)");
+  AddParam("profile-interval", "with profile-output, write per-thread totals every n sentences instead of per-sentence records (default 0); totals are also written at the end of the run, except by mosesserver, which does not end normally");
   AddParam("output-search-graph", "osg", "Output connected hypotheses of search into specified filename");
   AddParam("output-search-graph-extended", "osgx", "Output connected hypotheses of search into specified filename, in extended format");
+  AddParam("output-search-graph-binary", "osgb", "Output connected hypotheses of search into specified filename, in a compact binary format (gzipped if the name ends in .gz, phrase-based decoding only); misc/searchGraphBinaryToText converts it to text");
   AddParam("unpruned-search-graph", "usg", "When outputting chart search graph, do not exclude dead ends. Note: stack pruning may have eliminated some hypotheses");
   AddParam("output-search-graph-slf", "slf", "Output connected hypotheses of search into specified directory, one file per sentence, in HTK standard lattice format (SLF)");
   AddParam("output-search-graph-hypergraph", "Output connected hypotheses of search into specified directory, one file per sentence, in a hypergraph format (see Kenneth Heafield's lazy hypergraph decoder)");
@@ -671,6 +678,9 @@ void Parameter::ConvertWeightArgsLM()
       case 1:
         newFeatureName = "IRSTLM";
         break;
+      case 6:
+        newFeatureName = "RemoteLM";
+        break;
       case 8:
       case 9:
         newFeatureName = "KENLM";
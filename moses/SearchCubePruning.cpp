@@ -42,7 +42,8 @@ SearchCubePruning::SearchCubePruning(Manager& manager, const InputType &source,
   ,m_source(source)
   ,m_hypoStackColl(source.GetSize() + 1)
   ,m_initialTargetPhrase(source.m_initialTargetPhrase)
-  ,m_start(clock())
+  ,m_start(MonotonicNanoTime())
+  ,m_narrowed(false)
   ,m_transOptColl(transOptColl)
 {
   const StaticData &staticData = StaticData::Instance();
@@ -94,11 +95,29 @@ void SearchCubePruning::ProcessSentence()
   size_t stackNo = 1;
   std::vector < HypothesisStack* >::iterator iterStack;
   for (iterStack = ++m_hypoStackColl.begin() ; iterStack != m_hypoStackColl.end() ; ++iterStack) {
-    // check if decoding ran out of time
-    double _elapsed_time = GetUserTime();
-    if (_elapsed_time > staticData.GetTimeoutThreshold()) {
-      VERBOSE(1,"Decoding is out of time (" << _elapsed_time << "," << staticData.GetTimeoutThreshold() << ")" << std::endl);
-      return;
+    // narrow the search if the sentence is running out of time: fewer pops,
+    // less diversity and smaller, narrower stacks from this one on
+    size_t popLimit = PopLimit;
+    size_t diversity = Diversity;
+    size_t maxHypoStackSize = staticData.GetMaxHypoStackSize();
+    const SearchDeadline &deadline = m_manager.GetDeadline();
+    const float factor = deadline.GetLimitFactor();
+    if (factor < 1) {
+      popLimit = deadline.ScaleLimit(PopLimit, factor);
+      diversity = (Diversity > 0) ? deadline.ScaleLimit(Diversity, factor) : 0;
+      maxHypoStackSize = deadline.ScaleLimit(maxHypoStackSize, factor);
+      const float beamWidth = deadline.ScaleBeamWidth(staticData.GetBeamWidth(), factor);
+      for (std::vector < HypothesisStack* >::iterator iter = iterStack ; iter != m_hypoStackColl.end() ; ++iter) {
+        HypothesisStackCubePruning &hypoColl = *static_cast<HypothesisStackCubePruning*>(*iter);
+        hypoColl.SetMaxHypoStackSize(maxHypoStackSize);
+        hypoColl.SetBeamWidth(beamWidth);
+      }
+      if (!m_narrowed) {
+        VERBOSE(1, "Translation " << m_source.GetTranslationId() << " used "
+                << (int) (deadline.GetElapsedFraction() * 100) << "% of its time-out at stack " << stackNo
+                << ", narrowing search" << std::endl);
+        m_narrowed = true;
+      }
     }
     HypothesisStackCubePruning &sourceHypoColl = *static_cast<HypothesisStackCubePruning*>(*iterStack);
 
@@ -117,7 +136,7 @@ void SearchCubePruning::ProcessSentence()
     }
 
     // main search loop, pop k best hyps
-    for (size_t numpops = 1; numpops <= PopLimit && !BCQueue.empty(); numpops++) {
+    for (size_t numpops = 1; numpops <= popLimit && !BCQueue.empty(); numpops++) {
       BitmapContainer *bc = BCQueue.top();
       BCQueue.pop();
       bc->ProcessBestHypothesis();
@@ -127,16 +146,16 @@ void SearchCubePruning::ProcessSentence()
 
     // ensure diversity, a minimum number of inserted hyps for each bitmap container;
     //    NOTE: diversity doesn't ensure they aren't pruned at some later point
-    if (Diversity > 0) {
+    if (diversity > 0) {
       for(bmIter = accessor.begin(); bmIter != accessor.end(); ++bmIter) {
-        bmIter->second->EnsureMinStackHyps(Diversity);
+        bmIter->second->EnsureMinStackHyps(diversity);
       }
     }
 
     // the stack is pruned before processing (lazy pruning):
     VERBOSE(3,"processing hypothesis from next stack");
     // VERBOSE("processing next stack at ");
-    sourceHypoColl.PruneToSize(staticData.GetMaxHypoStackSize());
+    sourceHypoColl.PruneToSize(maxHypoStackSize);
     VERBOSE(3,std::endl);
     sourceHypoColl.CleanupArcList();
 
@@ -148,9 +167,7 @@ void SearchCubePruning::ProcessSentence()
   //PrintBitmapContainerGraph();
 
   // some more logging
-  IFVERBOSE(2) {
-    m_manager.GetSentenceStats().SetTimeTotal( clock()-m_start );
-  }
+  m_manager.GetSentenceStats().SetTimeTotal( MonotonicNanoTime()-m_start );
   VERBOSE(2, m_manager.GetSentenceStats());
 }
 
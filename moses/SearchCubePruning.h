@@ -21,7 +21,8 @@ protected:
   std::vector < HypothesisStack* > m_hypoStackColl; /**< stacks to store hypotheses (partial translations) */
   // no of elements = no of words in source + 1
   TargetPhrase m_initialTargetPhrase; /**< used to seed 1st hypo */
-  clock_t m_start; /**< used to track time spend on translation */
+  uint64_t m_start; /**< used to track time spend on translation */
+  bool m_narrowed; /**< search limits were shrunk because the sentence ran short of time (see switch -time-out) */
   const TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
 
   //! go thru all bitmaps in 1 stack & create backpointers to bitmaps in the stack
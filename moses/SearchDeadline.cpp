@@ -0,0 +1,77 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <limits>
+
+#include "SearchDeadline.h"
+#include "DecoderProfile.h"
+
+namespace Moses
+{
+
+const float SearchDeadline::DEGRADE_START = 0.5f;
+const float SearchDeadline::MIN_BEAM_WIDTH = -0.001f;
+
+SearchDeadline::SearchDeadline(float seconds)
+{
+  Reset(seconds);
+}
+
+void SearchDeadline::Reset(float seconds)
+{
+  m_start = MonotonicNanoTime();
+  m_budget = (seconds > 0) ? static_cast<uint64_t>(seconds * 1e9) : 0;
+}
+
+float SearchDeadline::GetElapsedFraction() const
+{
+  if (!IsSet()) return 0;
+  return static_cast<float>(MonotonicNanoTime() - m_start) / m_budget;
+}
+
+float SearchDeadline::GetLimitFactor() const
+{
+  const float elapsed = GetElapsedFraction();
+  if (elapsed <= DEGRADE_START) return 1;
+  if (elapsed >= 1) return 0;
+  return (1 - elapsed) / (1 - DEGRADE_START);
+}
+
+size_t SearchDeadline::ScaleLimit(size_t limit, float factor) const
+{
+  const double scaled = static_cast<double>(limit) * factor;
+  if (scaled >= limit) return limit;
+  return (scaled >= 1) ? static_cast<size_t>(scaled) : 1;
+}
+
+float SearchDeadline::ScaleBeamWidth(float beamWidth, float factor) const
+{
+  // an unbounded beam stays unbounded (-inf * 0 would be NaN), and a beam
+  // that is already narrower than the minimum is left alone
+  if (factor >= 1 || beamWidth >= MIN_BEAM_WIDTH
+      || beamWidth == -std::numeric_limits<float>::infinity()) {
+    return beamWidth;
+  }
+  return std::min(beamWidth * factor, MIN_BEAM_WIDTH);
+}
+
+}
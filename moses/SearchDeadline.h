@@ -0,0 +1,75 @@
+// $Id$
+
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_SearchDeadline_h
+#define moses_SearchDeadline_h
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace Moses
+{
+
+/** Wall-clock time budget of one sentence (or request), started when its
+ * Manager is created. Instead of aborting when the time is up, search asks
+ * for a limit factor and narrows its stacks, beam and cube pruning pop limit
+ * with it, so it still completes with the best translation it can afford.
+ */
+class SearchDeadline
+{
+public:
+  //! seconds <= 0: no deadline
+  explicit SearchDeadline(float seconds = -1);
+
+  //! restart the clock with a new budget, e.g. one sent with a request
+  void Reset(float seconds);
+
+  bool IsSet() const {
+    return m_budget > 0;
+  }
+
+  //! fraction of the budget spent so far, 0 if there is no deadline
+  float GetElapsedFraction() const;
+
+  /** 1 until DEGRADE_START of the budget is spent, then falling linearly
+   * to 0 at the deadline (and staying there) */
+  float GetLimitFactor() const;
+
+  //! limit scaled by the limit factor, but at least 1
+  size_t ScaleLimit(size_t limit, float factor) const;
+
+  /** beam width (log of the threshold, <= 0) scaled by the limit factor,
+   * but never so narrow that the best hypothesis itself is pruned */
+  float ScaleBeamWidth(float beamWidth, float factor) const;
+
+  //! share of the budget after which limits start to shrink
+  static const float DEGRADE_START;
+  //! narrowest beam ScaleBeamWidth() returns
+  static const float MIN_BEAM_WIDTH;
+
+protected:
+  uint64_t m_start; //!< nanoseconds, see MonotonicNanoTime()
+  uint64_t m_budget; //!< nanoseconds, 0 = no deadline
+};
+
+}
+
+#endif
@@ -0,0 +1,366 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <cstring>
+#include <map>
+#include <stdint.h>
+#include "SearchGraphBinary.h"
+#include "util/exception.hh"
+
+using namespace std;
+
+namespace Moses
+{
+
+namespace
+{
+
+const char kMagic[] = "MosesSG\n";
+const size_t kMagicSize = 8;
+const uint64_t kVersion = 1;
+
+//! recombined is set
+const uint64_t kFlagRecombined = 1;
+
+void AppendVarint(string &out, uint64_t value)
+{
+  while (value >= 0x80) {
+    out += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+void AppendSigned(string &out, int64_t value)
+{
+  AppendVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void AppendString(string &out, const string &value)
+{
+  AppendVarint(out, value.size());
+  out += value;
+}
+
+void AppendFixed(string &out, uint64_t bits, size_t bytes)
+{
+  for (size_t i = 0; i < bytes; ++i) {
+    out += static_cast<char>(bits & 0xff);
+    bits >>= 8;
+  }
+}
+
+void AppendFloat(string &out, float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  AppendFixed(out, bits, sizeof(bits));
+}
+
+void AppendDouble(string &out, double value)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  AppendFixed(out, bits, sizeof(bits));
+}
+
+//! reads the fields of a record, which has been read into memory in full
+class Decoder
+{
+public:
+  Decoder(const char *begin, const char *end) : m_at(begin), m_end(end) {}
+
+  uint64_t Varint() {
+    uint64_t value = 0;
+    for (size_t shift = 0; ; shift += 7) {
+      UTIL_THROW_IF(m_at == m_end || shift > 63, util::Exception, "Truncated or corrupt binary search graph");
+      const unsigned char byte = *m_at++;
+      value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) return value;
+    }
+  }
+
+  int64_t Signed() {
+    const uint64_t value = Varint();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  }
+
+  string String() {
+    const uint64_t size = Varint();
+    Need(size);
+    string value(m_at, size);
+    m_at += size;
+    return value;
+  }
+
+  float Float() {
+    uint32_t bits = static_cast<uint32_t>(Fixed(4));
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  double Double() {
+    uint64_t bits = Fixed(8);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  bool AtEnd() const {
+    return m_at == m_end;
+  }
+
+private:
+  const char *m_at;
+  const char *m_end;
+
+  void Need(uint64_t bytes) const {
+    UTIL_THROW_IF(static_cast<uint64_t>(m_end - m_at) < bytes, util::Exception, "Truncated or corrupt binary search graph");
+  }
+
+  uint64_t Fixed(size_t bytes) {
+    Need(bytes);
+    uint64_t bits = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+      bits |= static_cast<uint64_t>(static_cast<unsigned char>(*m_at++)) << (8 * i);
+    }
+    return bits;
+  }
+};
+
+//! reads a varint directly from a stream, false at a clean end of file
+bool ReadVarint(istream &in, uint64_t &value)
+{
+  value = 0;
+  for (size_t shift = 0; ; shift += 7) {
+    const int byte = in.get();
+    if (byte == istream::traits_type::eof()) {
+      UTIL_THROW_IF(shift > 0, util::Exception, "Truncated binary search graph");
+      return false;
+    }
+    UTIL_THROW_IF(shift > 63, util::Exception, "Corrupt binary search graph");
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+}
+
+void ReadBlock(istream &in, uint64_t size, string &to)
+{
+  to.resize(size);
+  if (size) in.read(&to[0], size);
+  UTIL_THROW_IF(static_cast<uint64_t>(in.gcount()) != size && size, util::Exception, "Truncated binary search graph");
+}
+
+}
+
+void WriteSearchGraphBinaryHeader(ostream &out, const SearchGraphBinaryFeatures &features)
+{
+  string header(kMagic, kMagicSize);
+  AppendVarint(header, kVersion);
+  size_t numDenseScores = 0;
+  for (size_t i = 0; i < features.size(); ++i) {
+    numDenseScores += features[i].second;
+  }
+  AppendVarint(header, numDenseScores);
+  AppendVarint(header, features.size());
+  for (size_t i = 0; i < features.size(); ++i) {
+    AppendString(header, features[i].first);
+    AppendVarint(header, features[i].second);
+  }
+  out.write(header.data(), header.size());
+}
+
+void WriteSearchGraphBinaryRecord(ostream &out, size_t numDenseScores, const SearchGraphBinaryRecord &record)
+{
+  string body;
+  AppendVarint(body, record.translationId);
+  AppendVarint(body, record.strings.size());
+  for (size_t i = 0; i < record.strings.size(); ++i) {
+    AppendString(body, record.strings[i]);
+  }
+
+  AppendVarint(body, record.nodes.size());
+  int prevId = 0;
+  for (size_t i = 0; i < record.nodes.size(); ++i) {
+    const SearchGraphBinaryNode &node = record.nodes[i];
+    AppendSigned(body, node.id - prevId);
+    prevId = node.id;
+    AppendVarint(body, node.stack);
+    AppendVarint(body, node.recombined >= 0 ? kFlagRecombined : 0);
+    AppendSigned(body, node.back - node.id);
+    AppendSigned(body, node.forward - node.id);
+    if (node.recombined >= 0) {
+      AppendSigned(body, node.recombined - node.id);
+    }
+    AppendFloat(body, node.score);
+    AppendDouble(body, node.forwardScore);
+    AppendVarint(body, node.coveredStart);
+    AppendVarint(body, node.coveredEnd - node.coveredStart);
+    AppendVarint(body, node.sourcePhrase);
+    AppendVarint(body, node.targetPhrase);
+    UTIL_THROW_IF(node.denseScores.size() != numDenseScores, util::Exception
+                  , "Hypothesis " << node.id << " has " << node.denseScores.size()
+                  << " dense scores, the search graph header declares " << numDenseScores);
+    for (size_t j = 0; j < numDenseScores; ++j) {
+      AppendFloat(body, node.denseScores[j]);
+    }
+    AppendVarint(body, node.sparseScores.size());
+    for (size_t j = 0; j < node.sparseScores.size(); ++j) {
+      AppendVarint(body, node.sparseScores[j].first);
+      AppendFloat(body, node.sparseScores[j].second);
+    }
+  }
+
+  string size;
+  AppendVarint(size, body.size());
+  out.write(size.data(), size.size());
+  out.write(body.data(), body.size());
+}
+
+SearchGraphBinaryReader::SearchGraphBinaryReader(istream &in)
+  : m_in(in)
+  , m_numDenseScores(0)
+{
+  char magic[kMagicSize];
+  m_in.read(magic, kMagicSize);
+  UTIL_THROW_IF(m_in.gcount() != static_cast<streamsize>(kMagicSize) || memcmp(magic, kMagic, kMagicSize)
+                , util::Exception, "Not a binary search graph");
+
+  uint64_t version, numDenseScores, numFeatures;
+  UTIL_THROW_IF(!ReadVarint(m_in, version) || version != kVersion
+                , util::Exception, "Unsupported binary search graph version");
+  UTIL_THROW_IF(!ReadVarint(m_in, numDenseScores) || !ReadVarint(m_in, numFeatures)
+                , util::Exception, "Truncated binary search graph");
+  m_numDenseScores = numDenseScores;
+  for (uint64_t i = 0; i < numFeatures; ++i) {
+    uint64_t size, numScores;
+    UTIL_THROW_IF(!ReadVarint(m_in, size), util::Exception, "Truncated binary search graph");
+    string name;
+    ReadBlock(m_in, size, name);
+    UTIL_THROW_IF(!ReadVarint(m_in, numScores), util::Exception, "Truncated binary search graph");
+    m_features.push_back(make_pair(name, static_cast<size_t>(numScores)));
+  }
+}
+
+bool SearchGraphBinaryReader::Read(SearchGraphBinaryRecord &record)
+{
+  uint64_t size;
+  if (!ReadVarint(m_in, size)) return false;
+  ReadBlock(m_in, size, m_buffer);
+  Decoder decoder(m_buffer.data(), m_buffer.data() + m_buffer.size());
+
+  record.translationId = decoder.Varint();
+  record.strings.resize(decoder.Varint());
+  for (size_t i = 0; i < record.strings.size(); ++i) {
+    record.strings[i] = decoder.String();
+  }
+
+  record.nodes.resize(decoder.Varint());
+  int prevId = 0;
+  for (size_t i = 0; i < record.nodes.size(); ++i) {
+    SearchGraphBinaryNode &node = record.nodes[i];
+    node.id = prevId + decoder.Signed();
+    prevId = node.id;
+    node.stack = decoder.Varint();
+    const uint64_t flags = decoder.Varint();
+    node.back = node.id + decoder.Signed();
+    node.forward = node.id + decoder.Signed();
+    node.recombined = (flags & kFlagRecombined) ? node.id + decoder.Signed() : -1;
+    node.score = decoder.Float();
+    node.forwardScore = decoder.Double();
+    node.coveredStart = decoder.Varint();
+    node.coveredEnd = node.coveredStart + decoder.Varint();
+    node.sourcePhrase = decoder.Varint();
+    node.targetPhrase = decoder.Varint();
+    UTIL_THROW_IF(node.sourcePhrase >= record.strings.size() || node.targetPhrase >= record.strings.size()
+                  , util::Exception, "Corrupt binary search graph");
+    node.denseScores.resize(m_numDenseScores);
+    for (size_t j = 0; j < m_numDenseScores; ++j) {
+      node.denseScores[j] = decoder.Float();
+    }
+    node.sparseScores.resize(decoder.Varint());
+    for (size_t j = 0; j < node.sparseScores.size(); ++j) {
+      node.sparseScores[j].first = decoder.Varint();
+      UTIL_THROW_IF(node.sparseScores[j].first >= record.strings.size(), util::Exception, "Corrupt binary search graph");
+      node.sparseScores[j].second = decoder.Float();
+    }
+  }
+  UTIL_THROW_IF(!decoder.AtEnd(), util::Exception, "Corrupt binary search graph");
+  return true;
+}
+
+void PrintSearchGraphBinaryRecord(const SearchGraphBinaryRecord &record, bool extended, ostream &out)
+{
+  // transitions are printed as differences of scores, as Manager::OutputSearchGraph() does
+  map<int, float> scores;
+  for (size_t i = 0; i < record.nodes.size(); ++i) {
+    scores[record.nodes[i].id] = record.nodes[i].score;
+  }
+
+  for (size_t i = 0; i < record.nodes.size(); ++i) {
+    const SearchGraphBinaryNode &node = record.nodes[i];
+    out << record.translationId;
+
+    // special case: initial hypothesis
+    if (node.id == 0) {
+      out << " hyp=0 stack=0";
+      if (extended) {
+        out << " forward=" << node.forward << " fscore=" << node.forwardScore;
+      }
+      out << endl;
+      continue;
+    }
+
+    map<int, float>::const_iterator back = scores.find(node.back);
+    UTIL_THROW_IF(back == scores.end(), util::Exception
+                  , "Hypothesis " << node.back << " missing from search graph " << record.translationId);
+    out << " hyp=" << node.id
+        << " stack=" << node.stack
+        << " back=" << node.back
+        << " score=" << node.score
+        << " transition=" << (node.score - back->second);
+    if (node.recombined >= 0) {
+      out << " recombined=" << node.recombined;
+    }
+    out << " forward=" << node.forward << " fscore=" << node.forwardScore
+        << " covered=" << node.coveredStart << "-" << node.coveredEnd;
+
+    if (!extended) {
+      out << " out=" << record.strings[node.targetPhrase] << endl;
+      continue;
+    }
+
+    // same layout as the FVector in ScoreComponentCollection's operator<<
+    out << " scores=\"core=(";
+    for (size_t j = 0; j < node.denseScores.size(); ++j) {
+      if (j) out << ",";
+      out << node.denseScores[j];
+    }
+    out << ") ";
+    for (size_t j = 0; j < node.sparseScores.size(); ++j) {
+      if (j) out << " ";
+      out << record.strings[node.sparseScores[j].first] << "=" << node.sparseScores[j].second;
+    }
+    out << "\"";
+    out << " out=\"" << record.strings[node.sourcePhrase] << "|" << record.strings[node.targetPhrase] << "\"" << endl;
+  }
+}
+
+}
@@ -0,0 +1,119 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_SearchGraphBinary_h
+#define moses_SearchGraphBinary_h
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Moses
+{
+
+/** Binary search graph, as written by -output-search-graph-binary.
+ *
+ * A file is a header followed by one record per sentence. Unsigned integers
+ * are varints (7 bits per byte, low bits first), signed ones are zigzag
+ * encoded varints, floats and doubles are IEEE little endian.
+ *
+ * header: the 8 bytes "MosesSG\n", varint version, varint number of dense
+ *         scores, varint number of features, then per feature its name
+ *         (varint length and bytes) and varint number of dense scores.
+ *         Dense scores of the features follow each other in this order.
+ * record: varint size of the rest of the record in bytes, varint
+ *         translation id, varint number of strings and the strings, varint
+ *         number of nodes and the nodes.
+ * node:   signed hypothesis id relative to the previous node; varint
+ *         stack; varint flags; signed back, forward and (if flag 1 is set)
+ *         recombined hypothesis ids relative to the hypothesis id; float
+ *         score; double forward score; varint first covered source position
+ *         and number of further positions; string indices of the source and
+ *         the target phrase; the dense scores of the transition as floats;
+ *         varint number of sparse scores and per sparse score the string
+ *         index of its name and a float.
+ *
+ * Ids that do not exist (the back pointer of the initial hypothesis, the
+ * forward pointer of final ones) are -1.
+ */
+struct SearchGraphBinaryNode {
+  int id;
+  int back;
+  int forward;
+  int recombined;
+  size_t stack;
+  float score;
+  double forwardScore;
+  size_t coveredStart, coveredEnd;
+  size_t sourcePhrase, targetPhrase;
+  std::vector<float> denseScores;
+  std::vector<std::pair<size_t, float> > sparseScores;
+};
+
+//! search graph of one sentence, strings are referred to by their index
+struct SearchGraphBinaryRecord {
+  long translationId;
+  std::vector<std::string> strings;
+  std::vector<SearchGraphBinaryNode> nodes;
+};
+
+//! name and number of dense scores of each feature
+typedef std::vector<std::pair<std::string, size_t> > SearchGraphBinaryFeatures;
+
+void WriteSearchGraphBinaryHeader(std::ostream &out, const SearchGraphBinaryFeatures &features);
+/** numDenseScores is the count written in the header. Throws util::Exception
+ * if a node does not have exactly that many dense scores, since the reader
+ * relies on the count to find the fields that follow them.
+ */
+void WriteSearchGraphBinaryRecord(std::ostream &out, size_t numDenseScores, const SearchGraphBinaryRecord &record);
+
+/** Reads a file written with WriteSearchGraphBinaryHeader() and
+ * WriteSearchGraphBinaryRecord(). Throws util::Exception on malformed input.
+ */
+class SearchGraphBinaryReader
+{
+public:
+  //! reads the header
+  SearchGraphBinaryReader(std::istream &in);
+
+  const SearchGraphBinaryFeatures &GetFeatures() const {
+    return m_features;
+  }
+  size_t GetNumDenseScores() const {
+    return m_numDenseScores;
+  }
+
+  //! next record, false at the end of the file
+  bool Read(SearchGraphBinaryRecord &record);
+
+private:
+  std::istream &m_in;
+  SearchGraphBinaryFeatures m_features;
+  size_t m_numDenseScores;
+  std::string m_buffer;
+};
+
+/** print record in the text format of -output-search-graph, or of
+ * -output-search-graph-extended if extended */
+void PrintSearchGraphBinaryRecord(const SearchGraphBinaryRecord &record, bool extended, std::ostream &out);
+
+}
+
+#endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "Manager.h"
 #include "Timer.h"
 #include "SearchNormal.h"
@@ -17,8 +18,8 @@ SearchNormal::SearchNormal(Manager& manager, const InputType &source, const Tran
   ,m_source(source)
   ,m_hypoStackColl(source.GetSize() + 1)
   ,m_initialTargetPhrase(source.m_initialTargetPhrase)
-  ,m_start(clock())
-  ,interrupted_flag(0)
+  ,m_start(MonotonicNanoTime())
+  ,m_narrowed(false)
   ,m_transOptColl(transOptColl)
 {
   VERBOSE(1, "Translating: " << m_source << endl);
@@ -57,9 +58,8 @@ SearchNormal::~SearchNormal()
  */
 void SearchNormal::ProcessSentence()
 {
-  const StaticData &staticData = StaticData::Instance();
   SentenceStats &stats = m_manager.GetSentenceStats();
-  clock_t t=0; // used to track time for steps
+  uint64_t t=0; // used to track time for steps
 
   // initial seed hypothesis: nothing translated, no words produced
   Hypothesis *hypo = Hypothesis::Create(m_manager,m_source, m_initialTargetPhrase);
@@ -68,26 +68,17 @@ void SearchNormal::ProcessSentence()
   // go through each stack
   std::vector < HypothesisStack* >::iterator iterStack;
   for (iterStack = m_hypoStackColl.begin() ; iterStack != m_hypoStackColl.end() ; ++iterStack) {
-    // check if decoding ran out of time
-    double _elapsed_time = GetUserTime();
-    if (_elapsed_time > staticData.GetTimeoutThreshold()) {
-      VERBOSE(1,"Decoding is out of time (" << _elapsed_time << "," << staticData.GetTimeoutThreshold() << ")" << std::endl);
-      interrupted_flag = 1;
-      return;
-    }
+    // narrow the search if the sentence is running out of time
+    size_t maxHypoStackSize = ApplyDeadline(iterStack - m_hypoStackColl.begin());
     HypothesisStackNormal &sourceHypoColl = *static_cast<HypothesisStackNormal*>(*iterStack);
 
     // the stack is pruned before processing (lazy pruning):
     VERBOSE(3,"processing hypothesis from next stack");
-    IFVERBOSE(2) {
-      t = clock();
-    }
-    sourceHypoColl.PruneToSize(staticData.GetMaxHypoStackSize());
+    t = MonotonicNanoTime();
+    sourceHypoColl.PruneToSize(maxHypoStackSize);
     VERBOSE(3,std::endl);
     sourceHypoColl.CleanupArcList();
-    IFVERBOSE(2) {
-      stats.AddTimeStack( clock()-t );
-    }
+    stats.AddTimeStack( MonotonicNanoTime()-t );
 
     // go through each hypothesis on the stack and try to expand it
     HypothesisStackNormal::const_iterator iterHypo;
@@ -99,19 +90,49 @@ void SearchNormal::ProcessSentence()
     IFVERBOSE(2) {
       OutputHypoStackSize();
     }
-
-    // this stack is fully expanded;
-    actual_hypoStack = &sourceHypoColl;
   }
 
   // some more logging
-  IFVERBOSE(2) {
-    m_manager.GetSentenceStats().SetTimeTotal( clock()-m_start );
-  }
+  m_manager.GetSentenceStats().SetTimeTotal( MonotonicNanoTime()-m_start );
   VERBOSE(2, m_manager.GetSentenceStats());
 }
 
 
+/**
+ * As the deadline of the sentence approaches, shrink the stack size, stack
+ * diversity and beam of the stacks from this one on, so that search still
+ * reaches the last stack in time. Returns the size to prune this stack to.
+ */
+size_t SearchNormal::ApplyDeadline(size_t stack)
+{
+  const StaticData &staticData = StaticData::Instance();
+  const SearchDeadline &deadline = m_manager.GetDeadline();
+  const float factor = deadline.GetLimitFactor();
+  if (factor >= 1) {
+    return staticData.GetMaxHypoStackSize();
+  }
+
+  const size_t maxHypoStackSize = deadline.ScaleLimit(staticData.GetMaxHypoStackSize(), factor);
+  size_t minHypoStackDiversity = staticData.GetMinHypoStackDiversity();
+  if (minHypoStackDiversity > 0) {
+    minHypoStackDiversity = std::min(deadline.ScaleLimit(minHypoStackDiversity, factor), maxHypoStackSize);
+  }
+  const float beamWidth = deadline.ScaleBeamWidth(staticData.GetBeamWidth(), factor);
+  for (size_t ind = stack ; ind < m_hypoStackColl.size() ; ++ind) {
+    HypothesisStackNormal &hypoColl = *static_cast<HypothesisStackNormal*>(m_hypoStackColl[ind]);
+    hypoColl.SetMaxHypoStackSize(maxHypoStackSize, minHypoStackDiversity);
+    hypoColl.SetBeamWidth(beamWidth);
+  }
+
+  if (!m_narrowed) {
+    VERBOSE(1, "Translation " << m_source.GetTranslationId() << " used "
+            << (int) (deadline.GetElapsedFraction() * 100) << "% of its time-out at stack " << stack
+            << ", narrowing search" << std::endl);
+    m_narrowed = true;
+  }
+  return maxHypoStackSize;
+}
+
 /** Find all translation options to expand one hypothesis, trigger expansion
  * this is mostly a check for overlap with already covered words, and for
  * violation of reordering limits.
@@ -289,18 +310,14 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
 {
   const StaticData &staticData = StaticData::Instance();
   SentenceStats &stats = m_manager.GetSentenceStats();
-  clock_t t=0; // used to track time for steps
+  uint64_t t=0; // used to track time for steps
 
   Hypothesis *newHypo;
   if (! staticData.UseEarlyDiscarding()) {
     // simple build, no questions asked
-    IFVERBOSE(2) {
-      t = clock();
-    }
+    t = MonotonicNanoTime();
     newHypo = hypothesis.CreateNext(transOpt, m_constraint);
-    IFVERBOSE(2) {
-      stats.AddTimeBuildHyp( clock()-t );
-    }
+    stats.AddTimeBuildHyp( MonotonicNanoTime()-t );
     if (newHypo==NULL) return;
     newHypo->Evaluate(m_transOptColl.GetFutureScore());
   } else
@@ -322,27 +339,19 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
 
     // check if transOpt score push it already below limit
     if (expectedScore < allowedScore) {
-      IFVERBOSE(2) {
-        stats.AddNotBuilt();
-      }
+      stats.AddNotBuilt();
       return;
     }
 
     // build the hypothesis without scoring
-    IFVERBOSE(2) {
-      t = clock();
-    }
+    t = MonotonicNanoTime();
     newHypo = hypothesis.CreateNext(transOpt, m_constraint);
     if (newHypo==NULL) return;
-    IFVERBOSE(2) {
-      stats.AddTimeBuildHyp( clock()-t );
-    }
+    stats.AddTimeBuildHyp( MonotonicNanoTime()-t );
 
     // ... and check if that is below the limit
     if (expectedScore < allowedScore) {
-      IFVERBOSE(2) {
-        stats.AddEarlyDiscarded();
-      }
+      stats.AddEarlyDiscarded();
       FREEHYPO( newHypo );
       return;
     }
@@ -356,13 +365,9 @@ void SearchNormal::ExpandHypothesis(const Hypothesis &hypothesis, const Translat
 
   // add to hypothesis stack
   size_t wordsTranslated = newHypo->GetWordsBitmap().GetNumWordsCovered();
-  IFVERBOSE(2) {
-    t = clock();
-  }
+  t = MonotonicNanoTime();
   m_hypoStackColl[wordsTranslated]->AddPrune(newHypo);
-  IFVERBOSE(2) {
-    stats.AddTimeStack( clock()-t );
-  }
+  stats.AddTimeStack( MonotonicNanoTime()-t );
 }
 
 const std::vector < HypothesisStack* >& SearchNormal::GetHypothesisStacks() const
@@ -376,13 +381,8 @@ const std::vector < HypothesisStack* >& SearchNormal::GetHypothesisStacks() cons
  */
 const Hypothesis *SearchNormal::GetBestHypothesis() const
 {
-  if (interrupted_flag == 0) {
-    const HypothesisStackNormal &hypoColl = *static_cast<HypothesisStackNormal*>(m_hypoStackColl.back());
-    return hypoColl.GetBestHypothesis();
-  } else {
-    const HypothesisStackNormal &hypoColl = *actual_hypoStack;
-    return hypoColl.GetBestHypothesis();
-  }
+  const HypothesisStackNormal &hypoColl = *static_cast<HypothesisStackNormal*>(m_hypoStackColl.back());
+  return hypoColl.GetBestHypothesis();
 }
 
 /**
@@ -24,11 +24,12 @@ protected:
   std::vector < HypothesisStack* > m_hypoStackColl; /**< stacks to store hypotheses (partial translations) */
   // no of elements = no of words in source + 1
   TargetPhrase m_initialTargetPhrase; /**< used to seed 1st hypo */
-  clock_t m_start; /**< starting time, used for logging */
-  size_t interrupted_flag; /**< flag indicating that decoder ran out of time (see switch -time-out) */
-  HypothesisStackNormal* actual_hypoStack; /**actual (full expanded) stack of hypotheses*/
+  uint64_t m_start; /**< starting time, used for logging */
+  bool m_narrowed; /**< search limits were shrunk because the sentence ran short of time (see switch -time-out) */
   const TranslationOptionCollection &m_transOptColl; /**< pre-computed list of translation options for the phrases in this sentence */
 
+  size_t ApplyDeadline(size_t stack);
+
   // functions for creating hypotheses
   void ProcessOneHypothesis(const Hypothesis &hypothesis);
   void ExpandAllHypotheses(const Hypothesis &hypothesis, size_t startPos, size_t endPos);
@@ -20,8 +20,10 @@ SearchNormalBatch::SearchNormalBatch(Manager& manager, const InputType &source,
   const vector<const StatefulFeatureFunction*>& ffs =
     StatefulFeatureFunction::GetStatefulFeatureFunctions();
   for (unsigned i = 0; i < ffs.size(); ++i) {
-    if (ffs[i]->GetScoreProducerDescription() == "DLM_5gram") { // TODO WFT
-      m_dlm_ffs[i] = const_cast<LanguageModel*>(static_cast<const LanguageModel* const>(ffs[i]));
+    const LanguageModel *lm = dynamic_cast<const LanguageModel*>(ffs[i]);
+    if (ffs[i]->GetScoreProducerDescription() == "DLM_5gram" // TODO WFT
+        || (lm && lm->UsesBatchedRequests())) {
+      m_dlm_ffs[i] = const_cast<LanguageModel*>(lm);
       m_dlm_ffs[i]->SetFFStateIdx(i);
     } else {
       m_stateful_ffs[i] = const_cast<StatefulFeatureFunction*>(ffs[i]);
@@ -41,9 +43,8 @@ SearchNormalBatch::~SearchNormalBatch()
  */
 void SearchNormalBatch::ProcessSentence()
 {
-  const StaticData &staticData = StaticData::Instance();
   SentenceStats &stats = m_manager.GetSentenceStats();
-  clock_t t=0; // used to track time for steps
+  uint64_t t=0; // used to track time for steps
 
   // initial seed hypothesis: nothing translated, no words produced
   Hypothesis *hypo = Hypothesis::Create(m_manager,m_source, m_initialTargetPhrase);
@@ -52,26 +53,17 @@ void SearchNormalBatch::ProcessSentence()
   // go through each stack
   std::vector < HypothesisStack* >::iterator iterStack;
   for (iterStack = m_hypoStackColl.begin() ; iterStack != m_hypoStackColl.end() ; ++iterStack) {
-    // check if decoding ran out of time
-    double _elapsed_time = GetUserTime();
-    if (_elapsed_time > staticData.GetTimeoutThreshold()) {
-      VERBOSE(1,"Decoding is out of time (" << _elapsed_time << "," << staticData.GetTimeoutThreshold() << ")" << std::endl);
-      interrupted_flag = 1;
-      return;
-    }
+    // narrow the search if the sentence is running out of time
+    size_t maxHypoStackSize = ApplyDeadline(iterStack - m_hypoStackColl.begin());
     HypothesisStackNormal &sourceHypoColl = *static_cast<HypothesisStackNormal*>(*iterStack);
 
     // the stack is pruned before processing (lazy pruning):
     VERBOSE(3,"processing hypothesis from next stack");
-    IFVERBOSE(2) {
-      t = clock();
-    }
-    sourceHypoColl.PruneToSize(staticData.GetMaxHypoStackSize());
+    t = MonotonicNanoTime();
+    sourceHypoColl.PruneToSize(maxHypoStackSize);
     VERBOSE(3,std::endl);
     sourceHypoColl.CleanupArcList();
-    IFVERBOSE(2) {
-      stats.AddTimeStack( clock()-t );
-    }
+    stats.AddTimeStack( MonotonicNanoTime()-t );
 
     // go through each hypothesis on the stack and try to expand it
     HypothesisStackNormal::const_iterator iterHypo;
@@ -85,17 +77,12 @@ void SearchNormalBatch::ProcessSentence()
     IFVERBOSE(2) {
       OutputHypoStackSize();
     }
-
-    // this stack is fully expanded;
-    actual_hypoStack = &sourceHypoColl;
   }
 
   EvalAndMergePartialHypos();
 
   // some more logging
-  IFVERBOSE(2) {
-    m_manager.GetSentenceStats().SetTimeTotal( clock()-m_start );
-  }
+  m_manager.GetSentenceStats().SetTimeTotal( MonotonicNanoTime()-m_start );
   VERBOSE(2, m_manager.GetSentenceStats());
 }
 
@@ -117,18 +104,14 @@ void SearchNormalBatch::ExpandHypothesis(const Hypothesis &hypothesis, const Tra
 
   const StaticData &staticData = StaticData::Instance();
   SentenceStats &stats = m_manager.GetSentenceStats();
-  clock_t t=0; // used to track time for steps
+  uint64_t t=0; // used to track time for steps
 
   Hypothesis *newHypo;
   if (! staticData.UseEarlyDiscarding()) {
     // simple build, no questions asked
-    IFVERBOSE(2) {
-      t = clock();
-    }
+    t = MonotonicNanoTime();
     newHypo = hypothesis.CreateNext(transOpt, m_constraint);
-    IFVERBOSE(2) {
-      stats.AddTimeBuildHyp( clock()-t );
-    }
+    stats.AddTimeBuildHyp( MonotonicNanoTime()-t );
     if (newHypo==NULL) return;
     //newHypo->Evaluate(m_transOptColl.GetFutureScore());
 
@@ -196,6 +179,7 @@ void SearchNormalBatch::EvalAndMergePartialHypos()
       LanguageModel &lm = *(dlm_iter->second);
       hypo->EvaluateWith(lm, (*dlm_iter).first);
     }
+    hypo->CalcTotalScore(m_transOptColl.GetFutureScore());
 
     // Put completed hypothesis onto its stack.
     size_t wordsTranslated = hypo->GetWordsBitmap().GetNumWordsCovered();
@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 using std::cout;
 using std::endl;
 #include "SentenceStats.h"
+#include "moses/FF/StatelessFeatureFunction.h"
+#include "moses/FF/StatefulFeatureFunction.h"
 
 namespace Moses
 {
@@ -37,6 +39,16 @@ void SentenceStats::CalcFinalStats(const Hypothesis& bestHypo)
   //inserted words--not implemented yet 8/1 TODO
 }
 
+void SentenceStats::InitializeFeatureTimes()
+{
+  size_t numStateless = StatelessFeatureFunction::GetStatelessFeatureFunctions().size();
+  size_t numStateful = StatefulFeatureFunction::GetStatefulFeatureFunctions().size();
+  m_statelessTime.assign(numStateless, 0);
+  m_statelessCalls.assign(numStateless, 0);
+  m_statefulTime.assign(numStateful, 0);
+  m_statefulCalls.assign(numStateful, 0);
+}
+
 void SentenceStats::AddDeletedWords(const Hypothesis& hypo)
 {
   //don't check either a null pointer or the empty initial hypothesis (if we were given the empty hypo, the null check will save us)
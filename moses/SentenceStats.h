@@ -25,12 +25,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include <iostream>
 #include <string>
 #include <vector>
-#include <time.h>
+#include <stdint.h>
 #include "Phrase.h"
 #include "Hypothesis.h"
 #include "TypeDef.h" //FactorArray
 #include "InputType.h"
 #include "Util.h" //Join()
+#include "DecoderProfile.h" //MonotonicNanoTime()
 
 namespace Moses
 {
@@ -70,6 +71,8 @@ public:
     m_timeCalcLM = 0;
     m_timeOtherScore = 0;
     m_timeStack = 0;
+    m_timeTotal = 0;
+    InitializeFeatureTimes();
     m_totalSourceWords = source.GetSize();
     m_recombinationInfos.clear();
     m_deletedWords.clear();
@@ -100,25 +103,61 @@ public:
     return m_numHyposNotBuilt;
   }
   float GetTimeCollectOpts() const {
-    return m_timeCollectOpts/(float)CLOCKS_PER_SEC;
+    return m_timeCollectOpts * 1e-9f;
   }
   float GetTimeBuildHyp() const {
-    return m_timeBuildHyp/(float)CLOCKS_PER_SEC;
+    return m_timeBuildHyp * 1e-9f;
   }
   float GetTimeCalcLM() const {
-    return m_timeCalcLM/(float)CLOCKS_PER_SEC;
+    return m_timeCalcLM * 1e-9f;
   }
   float GetTimeEstimateScore() const {
-    return m_timeEstimateScore/(float)CLOCKS_PER_SEC;
+    return m_timeEstimateScore * 1e-9f;
   }
   float GetTimeOtherScore() const {
-    return m_timeOtherScore/(float)CLOCKS_PER_SEC;
+    return m_timeOtherScore * 1e-9f;
   }
   float GetTimeStack() const {
-    return m_timeStack/(float)CLOCKS_PER_SEC;
+    return m_timeStack * 1e-9f;
   }
   float GetTimeTotal() const {
-    return m_timeTotal/(float)CLOCKS_PER_SEC;
+    return m_timeTotal * 1e-9f;
+  }
+  //! raw times in nanoseconds, for machine-readable output
+  uint64_t GetNanoTimeCollectOpts() const {
+    return m_timeCollectOpts;
+  }
+  uint64_t GetNanoTimeBuildHyp() const {
+    return m_timeBuildHyp;
+  }
+  uint64_t GetNanoTimeCalcLM() const {
+    return m_timeCalcLM;
+  }
+  uint64_t GetNanoTimeEstimateScore() const {
+    return m_timeEstimateScore;
+  }
+  uint64_t GetNanoTimeOtherScore() const {
+    return m_timeOtherScore;
+  }
+  uint64_t GetNanoTimeStack() const {
+    return m_timeStack;
+  }
+  uint64_t GetNanoTimeTotal() const {
+    return m_timeTotal;
+  }
+  //! evaluation time and number of calls of each feature function, indexed
+  //! like StatelessFeatureFunction/StatefulFeatureFunction::Get*FeatureFunctions()
+  const std::vector<uint64_t>& GetStatelessFeatureTimes() const {
+    return m_statelessTime;
+  }
+  const std::vector<uint64_t>& GetStatelessFeatureCalls() const {
+    return m_statelessCalls;
+  }
+  const std::vector<uint64_t>& GetStatefulFeatureTimes() const {
+    return m_statefulTime;
+  }
+  const std::vector<uint64_t>& GetStatefulFeatureCalls() const {
+    return m_statefulCalls;
   }
   size_t GetTotalSourceWords() const {
     return m_totalSourceWords;
@@ -156,27 +195,35 @@ public:
     m_numHyposDiscarded++;
   }
 
-  void AddTimeCollectOpts( clock_t t ) {
+  void AddTimeCollectOpts( uint64_t t ) {
     m_timeCollectOpts += t;
   }
-  void AddTimeBuildHyp( clock_t t ) {
+  void AddTimeBuildHyp( uint64_t t ) {
     m_timeBuildHyp += t;
   }
-  void AddTimeCalcLM( clock_t t ) {
+  void AddTimeCalcLM( uint64_t t ) {
     m_timeCalcLM += t;
   }
-  void AddTimeEstimateScore( clock_t t ) {
+  void AddTimeEstimateScore( uint64_t t ) {
     m_timeEstimateScore += t;
   }
-  void AddTimeOtherScore( clock_t t ) {
+  void AddTimeOtherScore( uint64_t t ) {
     m_timeOtherScore += t;
   }
-  void AddTimeStack( clock_t t ) {
+  void AddTimeStack( uint64_t t ) {
     m_timeStack += t;
   }
-  void SetTimeTotal( clock_t t ) {
+  void SetTimeTotal( uint64_t t ) {
     m_timeTotal = t;
   }
+  void AddTimeStatelessFeature( size_t i, uint64_t t ) {
+    m_statelessTime[i] += t;
+    ++m_statelessCalls[i];
+  }
+  void AddTimeStatefulFeature( size_t i, uint64_t t ) {
+    m_statefulTime[i] += t;
+    ++m_statefulCalls[i];
+  }
 
 protected:
 
@@ -185,23 +232,28 @@ protected:
    */
   void AddDeletedWords(const Hypothesis& hypo);
 
+  /***
+   * size per-feature timings to the registered feature functions
+   */
+  void InitializeFeatureTimes();
+
   //hypotheses
-  // TODO: Move away from clock_t in favor of just storing doubles of the number of seconds
-  // since clock seconds aren't reliable in a multi-threaded environment -Jon
-  // (see Manager.cpp for some initial work moving in this direction)
   std::vector<RecombinationInfo> m_recombinationInfos;
   unsigned int m_numHyposCreated;
   unsigned int m_numHyposPruned;
   unsigned int m_numHyposDiscarded;
   unsigned int m_numHyposEarlyDiscarded;
   unsigned int m_numHyposNotBuilt;
-  clock_t m_timeCollectOpts;
-  clock_t m_timeBuildHyp;
-  clock_t m_timeEstimateScore;
-  clock_t m_timeCalcLM;
-  clock_t m_timeOtherScore;
-  clock_t m_timeStack;
-  clock_t m_timeTotal;
+  // times are monotonic wall-clock nanoseconds (see MonotonicNanoTime)
+  uint64_t m_timeCollectOpts;
+  uint64_t m_timeBuildHyp;
+  uint64_t m_timeEstimateScore;
+  uint64_t m_timeCalcLM;
+  uint64_t m_timeOtherScore;
+  uint64_t m_timeStack;
+  uint64_t m_timeTotal;
+  std::vector<uint64_t> m_statelessTime, m_statelessCalls;
+  std::vector<uint64_t> m_statefulTime, m_statefulCalls;
 
   //words
   size_t m_totalSourceWords;
@@ -223,9 +275,9 @@ inline std::ostream& operator<<(std::ostream& os, const SentenceStats& ss)
 
          << "time to collect opts    " << ss.GetTimeCollectOpts()   << " (" << (int)(100 * ss.GetTimeCollectOpts()/totalTime) << "%)" << std::endl
          << "        create hyps     " << ss.GetTimeBuildHyp()      << " (" << (int)(100 * ss.GetTimeBuildHyp()/totalTime) << "%)" << std::endl
-         << "        estimate score  " << ss.GetTimeEstimateScore() << " (" << (int)(100 * ss.GetTimeEstimateScore()/totalTime) << "%)" << std::endl
+         << "        future cost     " << ss.GetTimeEstimateScore() << " (" << (int)(100 * ss.GetTimeEstimateScore()/totalTime) << "%)" << std::endl
          << "        calc lm         " << ss.GetTimeCalcLM()        << " (" << (int)(100 * ss.GetTimeCalcLM()/totalTime) << "%)" << std::endl
-         << "        other hyp score " << ss.GetTimeOtherScore()    << " (" << (int)(100 * ss.GetTimeOtherScore()/totalTime) << "%)" << std::endl
+         << "        stateless score " << ss.GetTimeOtherScore()    << " (" << (int)(100 * ss.GetTimeOtherScore()/totalTime) << "%)" << std::endl
          << "        manage stacks   " << ss.GetTimeStack()         << " (" << (int)(100 * ss.GetTimeStack()/totalTime) << "%)" << std::endl
          << "        other           " << otherTime                 << " (" << (int)(100 * otherTime/totalTime) << "%)" << std::endl
 
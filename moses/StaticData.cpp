@@ -40,6 +40,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "Timer.h"
 #include "LexicalReordering.h"
 #include "SentenceStats.h"
+#include "DecoderProfile.h"
 #include "UserMessage.h"
 #include "TranslationOption.h"
 #include "DecodeGraph.h"
@@ -65,6 +66,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/FF/OSM-Feature/OpSequenceModel.h"
 
 #include "LM/Ken.h"
+#include "LM/Remote.h"
 #ifdef LM_IRST
 #include "LM/IRST.h"
 #endif
@@ -113,14 +115,6 @@ StaticData::~StaticData()
 {
   RemoveAllInColl(m_decodeGraphs);
 
-  typedef std::map<std::pair<std::pair<size_t, std::string>, Phrase>, std::pair<TranslationOptionList*,clock_t> > Coll;
-  Coll::iterator iter;
-  for (iter = m_transOptCache.begin(); iter != m_transOptCache.end(); ++iter) {
-    std::pair<TranslationOptionList*,clock_t> &valuePair =iter->second;
-    TranslationOptionList *transOptList = valuePair.first;
-    delete transOptList;
-  }
-
   /*
   const std::vector<FeatureFunction*> &producers = FeatureFunction::GetFeatureFunctions();
   for(size_t i=0;i<producers.size();++i) {
@@ -262,6 +256,19 @@ bool StaticData::LoadData(Parameter *parameter)
   } else {
     m_outputSearchGraph = false;
   }
+  if (m_parameter->GetParam("output-search-graph-binary").size() > 0) {
+    if (m_parameter->GetParam("output-search-graph-binary").size() != 1) {
+      UserMessage::Add(string("ERROR: wrong format for switch -output-search-graph-binary file"));
+      return false;
+    }
+    if (IsChart()) {
+      UserMessage::Add(string("ERROR: -output-search-graph-binary is only supported by phrase-based decoding"));
+      return false;
+    }
+    m_outputSearchGraphBinary = true;
+  } else {
+    m_outputSearchGraphBinary = false;
+  }
   if (m_parameter->GetParam("output-search-graph-slf").size() > 0) {
     m_outputSearchGraphSLF = true;
   } else {
@@ -313,8 +320,8 @@ bool StaticData::LoadData(Parameter *parameter)
   // caching of translation options
   if (m_inputType == SentenceInput) {
     SetBooleanParameter( &m_useTransOptCache, "use-persistent-cache", true );
-    m_transOptCacheMaxSize = (m_parameter->GetParam("persistent-cache-size").size() > 0)
-                             ? Scan<size_t>(m_parameter->GetParam("persistent-cache-size")[0]) : DEFAULT_MAX_TRANS_OPT_CACHE_SIZE;
+    m_transOptCache.SetMaxSize((m_parameter->GetParam("persistent-cache-size").size() > 0)
+                               ? Scan<size_t>(m_parameter->GetParam("persistent-cache-size")[0]) : DEFAULT_MAX_TRANS_OPT_CACHE_SIZE);
   } else {
     m_useTransOptCache = false;
   }
@@ -423,6 +430,9 @@ bool StaticData::LoadData(Parameter *parameter)
               Scan<size_t>(m_parameter->GetParam("mbr-size")[0]) : 200;
   m_mbrScale = (m_parameter->GetParam("mbr-scale").size() > 0) ?
                Scan<float>(m_parameter->GetParam("mbr-scale")[0]) : 1.0f;
+  m_mbrThreads = (m_parameter->GetParam("mbr-threads").size() > 0) ?
+                 Scan<size_t>(m_parameter->GetParam("mbr-threads")[0]) : 1;
+  if (m_mbrThreads < 1) m_mbrThreads = 1;
 
   //lattice mbr
   SetBooleanParameter( &m_useLatticeMBR, "lminimum-bayes-risk", false );
@@ -461,8 +471,8 @@ bool StaticData::LoadData(Parameter *parameter)
   SetBooleanParameter( &m_minlexrMemory, "minlexr-memory", false );
 
   m_timeout_threshold = (m_parameter->GetParam("time-out").size() > 0) ?
-                        Scan<size_t>(m_parameter->GetParam("time-out")[0]) : -1;
-  m_timeout = (GetTimeoutThreshold() == (size_t)-1) ? false : true;
+                        Scan<float>(m_parameter->GetParam("time-out")[0]) : -1;
+  m_timeout = (GetTimeoutThreshold() > 0);
 
 
   m_lmcache_cleanup_threshold = (m_parameter->GetParam("clean-lm-cache").size() > 0) ?
@@ -497,6 +507,26 @@ bool StaticData::LoadData(Parameter *parameter)
     }
   }
 
+  m_threadReadAhead = (m_parameter->GetParam("thread-read-ahead").size() > 0) ?
+                      Scan<size_t>(m_parameter->GetParam("thread-read-ahead")[0]) : 0;
+  SetBooleanParameter( &m_threadPinning, "thread-pinning", false );
+  m_transOptThreads = (m_parameter->GetParam("translation-option-threads").size() > 0) ?
+                      Scan<size_t>(m_parameter->GetParam("translation-option-threads")[0]) : 1;
+#ifndef WITH_THREADS
+  if (m_transOptThreads > 1) {
+    UserMessage::Add("Error: translation-option-threads > 1 but moses not built with thread support");
+    return false;
+  }
+#endif
+
+  if (m_parameter->GetParam("profile-output").size() > 0) {
+    size_t interval = (m_parameter->GetParam("profile-interval").size() > 0) ?
+                      Scan<size_t>(m_parameter->GetParam("profile-interval")[0]) : 0;
+    if (!DecoderProfile::Instance().Open(m_parameter->GetParam("profile-output")[0], interval)) {
+      return false;
+    }
+  }
+
   m_startTranslationId = (m_parameter->GetParam("start-translation-id").size() > 0) ?
                          Scan<long>(m_parameter->GetParam("start-translation-id")[0]) : 0;
 
@@ -619,6 +649,10 @@ bool StaticData::LoadData(Parameter *parameter)
       LanguageModel *model = ConstructKenLM(feature, line);
       vector<float> weights = m_parameter->GetWeights(model->GetScoreProducerDescription());
       SetWeights(model, weights);
+    } else if (feature == "RemoteLM") {
+      LanguageModelRemote *model = new LanguageModelRemote(line);
+      vector<float> weights = m_parameter->GetWeights(model->GetScoreProducerDescription());
+      SetWeights(model, weights);
     }
 #ifdef LM_IRST
     else if (feature == "IRSTLM") {
@@ -776,12 +810,14 @@ void StaticData::SetWeight(const FeatureFunction* sp, float weight)
 {
   m_allWeights.Resize();
   m_allWeights.Assign(sp,weight);
+  ClearTransOptionCache();
 }
 
 void StaticData::SetWeights(const FeatureFunction* sp, const std::vector<float>& weights)
 {
   m_allWeights.Resize();
   m_allWeights.Assign(sp,weights);
+  ClearTransOptionCache();
 }
 
 void StaticData::LoadNonTerminals()
@@ -940,70 +976,14 @@ bool StaticData::LoadDecodeGraphs()
   return true;
 }
 
-const TranslationOptionList* StaticData::FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const
-{
-  std::pair<size_t, std::string> cacheKey(decodeGraph.GetPosition(), m_currentWeightSetting);
-  std::pair<std::pair<size_t, std::string>, Phrase> key(cacheKey, sourcePhrase);
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_transOptCacheMutex);
-#endif
-  std::map<std::pair<std::pair<size_t, std::string>, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iter
-  = m_transOptCache.find(key);
-  if (iter == m_transOptCache.end())
-    return NULL;
-  iter->second.second = clock(); // update last used time
-  return iter->second.first;
-}
-
-void StaticData::ReduceTransOptCache() const
+TranslationOptionCache::Entry StaticData::FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const
 {
-  if (m_transOptCache.size() <= m_transOptCacheMaxSize) return; // not full
-  clock_t t = clock();
-
-  // find cutoff for last used time
-  priority_queue< clock_t > lastUsedTimes;
-
-  std::map<std::pair<std::pair<size_t, std::string>, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iter;
-  iter = m_transOptCache.begin();
-  while( iter != m_transOptCache.end() ) {
-    lastUsedTimes.push( iter->second.second );
-    iter++;
-  }
-  for( size_t i=0; i < lastUsedTimes.size()-m_transOptCacheMaxSize/2; i++ )
-    lastUsedTimes.pop();
-  clock_t cutoffLastUsedTime = lastUsedTimes.top();
-
-  // remove all old entries
-  iter = m_transOptCache.begin();
-  while( iter != m_transOptCache.end() ) {
-    if (iter->second.second < cutoffLastUsedTime) {
-      std::map<std::pair<std::pair<size_t, std::string>, Phrase>, std::pair<TranslationOptionList*,clock_t> >::iterator iterRemove = iter++;
-      delete iterRemove->second.first;
-      m_transOptCache.erase(iterRemove);
-    } else iter++;
-  }
-  VERBOSE(2,"Reduced persistent translation option cache in " << ((clock()-t)/(float)CLOCKS_PER_SEC) << " seconds." << std::endl);
+  return m_transOptCache.Find(decodeGraph.GetPosition(), m_currentWeightSetting, sourcePhrase);
 }
 
-void StaticData::AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList) const
-{
-  if (m_transOptCacheMaxSize == 0) return;
-  std::pair<size_t, std::string> cacheKey(decodeGraph.GetPosition(), m_currentWeightSetting);
-  std::pair<std::pair<size_t, std::string>, Phrase> key(cacheKey, sourcePhrase);
-  TranslationOptionList* storedTransOptList = new TranslationOptionList(transOptList);
-#ifdef WITH_THREADS
-  boost::mutex::scoped_lock lock(m_transOptCacheMutex);
-#endif
-  m_transOptCache[key] = make_pair( storedTransOptList, clock() );
-  ReduceTransOptCache();
-}
-void StaticData::ClearTransOptionCache() const
+void StaticData::AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const std::vector<TranslationOption*> &transOpts) const
 {
-  map<std::pair<std::pair<size_t, std::string>, Phrase>, std::pair< TranslationOptionList*, clock_t > >::iterator iterCache;
-  for (iterCache = m_transOptCache.begin() ; iterCache != m_transOptCache.end() ; ++iterCache) {
-    TranslationOptionList *transOptList = iterCache->second.first;
-    delete transOptList;
-  }
+  m_transOptCache.Add(decodeGraph.GetPosition(), m_currentWeightSetting, sourcePhrase, transOpts);
 }
 
 void StaticData::ReLoadParameter()
@@ -45,6 +45,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "SentenceStats.h"
 #include "DecodeGraph.h"
 #include "TranslationOptionList.h"
+#include "TranslationOptionCache.h"
 #include "ScoreComponentCollection.h"
 #include "moses/TranslationModel/PhraseDictionary.h"
 
@@ -153,6 +154,7 @@ protected:
   bool m_useConsensusDecoding; //! Use Consensus decoding  (DeNero et al 2009)
   size_t m_mbrSize; //! number of translation candidates considered
   float m_mbrScale; //! scaling factor for computing marginal probability of candidate translation
+  size_t m_mbrThreads; //! number of threads computing pairwise losses in n-best MBR
   size_t m_lmbrPruning; //! average number of nodes per word wanted in pruned lattice
   std::vector<float> m_lmbrThetas; //! theta(s) for lattice mbr calculation
   bool m_useLatticeHypSetForLatticeMBR; //! to use nbest as hypothesis set during lattice MBR
@@ -164,22 +166,17 @@ protected:
   bool m_lmEnableOOVFeature;
 
   bool m_timeout; //! use timeout
-  size_t m_timeout_threshold; //! seconds after which time out is activated
+  float m_timeout_threshold; //! seconds each sentence may take before search is narrowed to finish
 
   bool m_useTransOptCache; //! flag indicating, if the persistent translation option cache should be used
-  mutable std::map<std::pair<std::pair<size_t, std::string>, Phrase>, std::pair<TranslationOptionList*,clock_t> > m_transOptCache; //! persistent translation option cache
-  size_t m_transOptCacheMaxSize; //! maximum size for persistent translation option cache
-  //FIXME: Single lock for cache not most efficient. However using a
-  //reader-writer for LRU cache is tricky - how to record last used time?
-#ifdef WITH_THREADS
-  mutable boost::mutex m_transOptCacheMutex;
-#endif
+  mutable TranslationOptionCache m_transOptCache; //! persistent translation option cache
   bool m_isAlwaysCreateDirectTranslationOption;
   //! constructor. only the 1 static variable can be created
 
   bool m_outputWordGraph; //! whether to output word graph
   bool m_outputSearchGraph; //! whether to output search graph
   bool m_outputSearchGraphExtended; //! ... in extended format
+  bool m_outputSearchGraphBinary; //! ... in binary format
   bool m_outputSearchGraphSLF; //! whether to output search graph in HTK standard lattice format (SLF)
   bool m_outputSearchGraphHypergraph; //! whether to output search graph in hypergraph
 #ifdef HAVE_PROTOBUF
@@ -206,6 +203,9 @@ protected:
   WordAlignmentSort m_wordAlignmentSort;
 
   int m_threadCount;
+  size_t m_threadReadAhead; //! sentences reordered by length before decoding, 0 = none
+  bool m_threadPinning; //! pin decoder threads to cpus
+  size_t m_transOptThreads; //! threads collecting the translation options of a sentence
   long m_startTranslationId;
 
   // alternate weight settings
@@ -225,7 +225,6 @@ protected:
   //! load decoding steps
   bool LoadDecodeGraphs();
 
-  void ReduceTransOptCache() const;
   bool m_continuePartialTranslation;
 
   std::string m_binPath;
@@ -390,7 +389,7 @@ public:
     return m_nBestFilePath;
   }
   bool IsNBestEnabled() const {
-    return (!m_nBestFilePath.empty()) || m_mbr || m_useLatticeMBR || m_mira || m_outputSearchGraph || m_outputSearchGraphSLF || m_outputSearchGraphHypergraph || m_useConsensusDecoding || !m_latticeSamplesFilePath.empty()
+    return (!m_nBestFilePath.empty()) || m_mbr || m_useLatticeMBR || m_mira || m_outputSearchGraph || m_outputSearchGraphBinary || m_outputSearchGraphSLF || m_outputSearchGraphHypergraph || m_useConsensusDecoding || !m_latticeSamplesFilePath.empty()
 #ifdef HAVE_PROTOBUF
            || m_outputSearchGraphPB
 #endif
@@ -445,6 +444,7 @@ public:
 
   void SetAllWeights(const ScoreComponentCollection& weights) {
     m_allWeights = weights;
+    ClearTransOptionCache();
   }
 
   //Weight for a single-valued feature
@@ -495,6 +495,9 @@ public:
   void SetMBRScale(float scale) {
     m_mbrScale = scale;
   }
+  size_t GetMBRThreads() const {
+    return m_mbrThreads;
+  }
   size_t GetLatticeMBRPruningFactor() const {
     return m_lmbrPruning;
   }
@@ -527,7 +530,7 @@ public:
   bool UseTimeout() const {
     return m_timeout;
   }
-  size_t GetTimeoutThreshold() const {
+  float GetTimeoutThreshold() const {
     return m_timeout_threshold;
   }
 
@@ -548,6 +551,9 @@ public:
   bool GetOutputSearchGraphExtended() const {
     return m_outputSearchGraphExtended;
   }
+  bool GetOutputSearchGraphBinary() const {
+    return m_outputSearchGraphBinary;
+  }
   bool GetOutputSearchGraphSLF() const {
     return m_outputSearchGraphSLF;
   }
@@ -583,12 +589,14 @@ public:
     return m_useTransOptCache;
   }
 
-  void AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const TranslationOptionList &transOptList) const;
-
-  void ClearTransOptionCache() const;
+  void AddTransOptListToCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase, const std::vector<TranslationOption*> &transOpts) const;
 
+  //! called whenever the weights change, as the cached options are scored with them
+  void ClearTransOptionCache() const {
+    m_transOptCache.Clear();
+  }
 
-  const TranslationOptionList* FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const;
+  TranslationOptionCache::Entry FindTransOptListInCache(const DecodeGraph &decodeGraph, const Phrase &sourcePhrase) const;
 
   bool PrintAllDerivations() const {
     return m_printAllDerivations;
@@ -633,6 +641,15 @@ public:
   int ThreadCount() const {
     return m_threadCount;
   }
+  size_t GetThreadReadAhead() const {
+    return m_threadReadAhead;
+  }
+  bool GetThreadPinning() const {
+    return m_threadPinning;
+  }
+  size_t GetTranslationOptionThreads() const {
+    return m_transOptThreads;
+  }
 
   long GetStartTranslationId() const {
     return m_startTranslationId;
@@ -22,6 +22,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "ThreadPool.h"
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 #ifdef WITH_THREADS
 
 using namespace std;
@@ -30,50 +34,118 @@ using namespace Moses;
 namespace Moses
 {
 
-ThreadPool::ThreadPool( size_t numThreads )
-  : m_stopped(false), m_stopping(false), m_queueLimit(0)
+ThreadPool::ThreadPool( size_t numThreads, bool pinThreads )
+  : m_submitted(0), m_queued(0), m_nextQueue(0)
+  , m_stopped(false), m_stopping(false), m_pinThreads(pinThreads)
+  , m_queueLimit(0), m_readAhead(0)
 {
   for (size_t i = 0; i < numThreads; ++i) {
-    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this));
+    m_queues.push_back(new WorkerQueue());
+  }
+  for (size_t i = 0; i < numThreads; ++i) {
+    m_threads.create_thread(boost::bind(&ThreadPool::Execute,this,i));
   }
 }
 
-void ThreadPool::Execute()
+ThreadPool::~ThreadPool()
 {
+  Stop();
+  for (size_t i = 0; i < m_queues.size(); ++i) {
+    delete m_queues[i];
+  }
+}
+
+void ThreadPool::Execute(size_t worker)
+{
+  if (m_pinThreads) {
+    PinToCpu(worker);
+  }
   do {
-    Task* task = NULL;
-    {
-      // Find a job to perform
+    // Find a job to perform
+    Task* task = TakeTask(worker);
+    if (!task) {
       boost::mutex::scoped_lock lock(m_mutex);
-      if (m_tasks.empty() && !m_stopped) {
+      while (m_queued == 0 && !m_stopped) {
         m_threadNeeded.wait(lock);
       }
-      if (!m_stopped && !m_tasks.empty()) {
-        task = m_tasks.front();
-        m_tasks.pop();
-      }
+      continue;
     }
     //Execute job
-    if (task) {
-      task->Run();
-      if (task->DeleteAfterExecution()) {
-        delete task;
-      }
+    task->Run();
+    if (task->DeleteAfterExecution()) {
+      delete task;
     }
     m_threadAvailable.notify_all();
   } while (!m_stopped);
 }
 
+Task *ThreadPool::TakeTask(size_t worker)
+{
+  {
+    boost::mutex::scoped_lock lock(m_mutex);
+    if (m_stopped) {
+      // stopped without processing the remaining jobs
+      return NULL;
+    }
+  }
+
+  // a task taken here is run even if the pool stops in the meantime
+  Task *task = NULL;
+  for (size_t i = 0; i < m_queues.size() && !task; ++i) {
+    WorkerQueue &queue = *m_queues[(worker + i) % m_queues.size()];
+    boost::mutex::scoped_lock lock(queue.mutex);
+    if (queue.tasks.empty()) continue;
+    if (i == 0) {
+      task = queue.tasks.front();
+      queue.tasks.pop_front();
+    } else {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+    }
+  }
+
+  boost::mutex::scoped_lock lock(m_mutex);
+  if (!task && !m_stopped && !m_window.empty()) {
+    task = m_window.top().task;
+    m_window.pop();
+  }
+  if (task) {
+    --m_queued;
+  }
+  return task;
+}
+
+void ThreadPool::Deal(Task *task)
+{
+  WorkerQueue &queue = *m_queues[m_nextQueue];
+  m_nextQueue = (m_nextQueue + 1) % m_queues.size();
+  boost::mutex::scoped_lock lock(queue.mutex);
+  queue.tasks.push_back(task);
+}
+
 void ThreadPool::Submit( Task* task )
 {
   boost::mutex::scoped_lock lock(m_mutex);
   if (m_stopping) {
     throw runtime_error("ThreadPool stopping - unable to accept new jobs");
   }
-  while (m_queueLimit > 0 && m_tasks.size() >= m_queueLimit) {
+  while (m_queueLimit > 0 && m_queued >= m_queueLimit) {
     m_threadAvailable.wait(lock);
   }
-  m_tasks.push(task);
+  ++m_queued;
+  if (m_readAhead > 0) {
+    WindowEntry entry;
+    entry.task = task;
+    entry.cost = task->GetCost();
+    entry.order = m_submitted++;
+    m_window.push(entry);
+    while (m_window.size() > m_readAhead) {
+      Deal(m_window.top().task);
+      m_window.pop();
+    }
+  } else {
+    Deal(task);
+  }
   m_threadNeeded.notify_all();
 }
 
@@ -88,7 +160,7 @@ void ThreadPool::Stop(bool processRemainingJobs)
   if (processRemainingJobs) {
     boost::mutex::scoped_lock lock(m_mutex);
     //wait for queue to drain.
-    while (!m_tasks.empty() && !m_stopped) {
+    while (m_queued > 0 && !m_stopped) {
       m_threadAvailable.wait(lock);
     }
   }
@@ -102,6 +174,22 @@ void ThreadPool::Stop(bool processRemainingJobs)
   m_threads.join_all();
 }
 
+void ThreadPool::PinToCpu(size_t worker)
+{
+#if defined(__linux__) && defined(BOOST_HAS_PTHREADS)
+  const size_t cpus = boost::thread::hardware_concurrency();
+  if (cpus == 0) return;
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(worker % cpus, &cpuSet);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+    cerr << "Warning: unable to pin worker thread " << worker << " to cpu " << (worker % cpus) << endl;
+  }
+#else
+  cerr << "Warning: pinning of worker threads is not supported on this platform" << endl;
+#endif
+}
+
 }
 #endif //WITH_THREADS
 
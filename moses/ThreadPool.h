@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #ifndef moses_ThreadPool_h
 #define moses_ThreadPool_h
 
+#include <deque>
 #include <iostream>
 #include <queue>
 #include <vector>
@@ -54,22 +55,33 @@ public:
   virtual bool DeleteAfterExecution() {
     return true;
   }
+  /** expected relative cost, e.g. the length of a sentence. Within the
+   * read-ahead window of a ThreadPool costlier tasks are started first */
+  virtual size_t GetCost() const {
+    return 1;
+  }
   virtual ~Task() {}
 };
 
 #ifdef WITH_THREADS
 
+/** A pool of worker threads. Each worker has its own deque of tasks;
+ * submitted tasks are dealt out to the deques in turn, a worker runs the
+ * tasks of its own deque in order and steals from the back of the other
+ * deques when it runs dry. Optionally, a read-ahead window holds back the
+ * most recently submitted tasks and releases the costliest one first, so
+ * that a long sentence near the end of a batch does not finish last.
+ */
 class ThreadPool
 {
 public:
   /**
-   * Construct a thread pool of a fixed size.
+   * Construct a thread pool of a fixed size. If pinThreads is set, worker
+   * i runs on cpu i modulo the number of cpus (Linux only).
    **/
-  explicit ThreadPool(size_t numThreads);
+  explicit ThreadPool(size_t numThreads, bool pinThreads = false);
 
-  ~ThreadPool() {
-    Stop();
-  }
+  ~ThreadPool();
 
   /**
    * Add a job to the threadpool.
@@ -89,20 +101,58 @@ public:
     m_queueLimit = limit;
   }
 
+  /**
+   * Number of submitted tasks that are reordered by cost before they are
+   * dealt out to the workers (0 = run in order of submission)
+   **/
+  void SetReadAhead( size_t window ) {
+    m_readAhead = window;
+  }
+
 private:
+  //! tasks of one worker, the owner takes from the front, thieves from the back
+  struct WorkerQueue {
+    boost::mutex mutex;
+    std::deque<Task*> tasks;
+  };
+
+  //! read-ahead window entry: costliest first, then in order of submission
+  struct WindowEntry {
+    Task *task;
+    size_t cost;
+    size_t order;
+    bool operator<(const WindowEntry &other) const {
+      return cost < other.cost || (cost == other.cost && order > other.order);
+    }
+  };
+
   /**
    * The main loop executed by each thread.
    **/
-  void Execute();
+  void Execute(size_t worker);
+
+  //! next task for worker: own deque, then other deques, then the window
+  Task *TakeTask(size_t worker);
+
+  //! hand a task to the next worker deque, m_mutex must be held
+  void Deal(Task *task);
+
+  void PinToCpu(size_t worker);
 
-  std::queue<Task*> m_tasks;
+  std::vector<WorkerQueue*> m_queues;
+  std::priority_queue<WindowEntry> m_window;
+  size_t m_submitted; //!< number of tasks submitted so far
+  size_t m_queued; //!< tasks in the deques and the window, guarded by m_mutex
+  size_t m_nextQueue;
   boost::thread_group m_threads;
   boost::mutex m_mutex;
   boost::condition_variable m_threadNeeded;
   boost::condition_variable m_threadAvailable;
   bool m_stopped;
   bool m_stopping;
+  bool m_pinThreads;
   size_t m_queueLimit;
+  size_t m_readAhead;
 };
 
 class TestTask : public Task
@@ -397,6 +397,8 @@ void BlockHashIndex::CalcHash(size_t current, void* source_void)
   m_arrays[current] = pv;
   m_clocks[current] = clock();
   m_queue.push(-current);
+
+  m_numLoadedRanges++;
 #endif
 }
 
@@ -0,0 +1,209 @@
+// $Id$
+// vim:tabstop=2
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <limits>
+
+#include "CompactTableFilter.h"
+#include "PhraseTableCreator.h"
+#include "ThrowingFwrite.h"
+
+#include "util/exception.hh"
+
+namespace Moses
+{
+
+CompactTableFilter::CompactTableFilter(TableType type, size_t threads)
+  : m_type(type), m_threads(threads)
+{ }
+
+size_t CompactTableFilter::SkipPhraseTableCoder(std::FILE* in)
+{
+  // Same layout as read by PhraseDecoder::Load
+  PhraseTableCreator::Coding coding;
+  size_t numScoreComponent;
+  bool containsAlignmentInfo;
+  size_t maxRank;
+  size_t maxPhraseLength;
+
+  size_t read = 0;
+  read += std::fread(&coding, sizeof(coding), 1, in);
+  read += std::fread(&numScoreComponent, sizeof(numScoreComponent), 1, in);
+  read += std::fread(&containsAlignmentInfo, sizeof(containsAlignmentInfo), 1, in);
+  read += std::fread(&maxRank, sizeof(maxRank), 1, in);
+  read += std::fread(&maxPhraseLength, sizeof(maxPhraseLength), 1, in);
+  UTIL_THROW_IF(read != 5, util::Exception, "Truncated compact phrase table");
+
+  if(coding == PhraseTableCreator::REnc) {
+    StringVector<unsigned char, unsigned, std::allocator> sourceSymbols;
+    sourceSymbols.load(in);
+
+    size_t size;
+    read = std::fread(&size, sizeof(size_t), 1, in);
+    std::fseek(in, size * sizeof(size_t), SEEK_CUR);
+    read += std::fread(&size, sizeof(size_t), 1, in);
+    std::fseek(in, size * sizeof(std::pair<unsigned, unsigned>), SEEK_CUR);
+    UTIL_THROW_IF(read != 2, util::Exception, "Truncated compact phrase table");
+  }
+
+  StringVector<unsigned char, unsigned, std::allocator> targetSymbols;
+  targetSymbols.load(in);
+
+  CanonicalHuffman<unsigned> symbolTree(in);
+
+  bool multipleScoreTrees;
+  read = std::fread(&multipleScoreTrees, sizeof(multipleScoreTrees), 1, in);
+  UTIL_THROW_IF(read != 1, util::Exception, "Truncated compact phrase table");
+  size_t numScoreTrees = multipleScoreTrees ? numScoreComponent : 1;
+  for(size_t i = 0; i < numScoreTrees; i++)
+    CanonicalHuffman<float> scoreTree(in);
+
+  if(containsAlignmentInfo)
+    CanonicalHuffman<AlignPoint> alignTree(in);
+
+  return maxPhraseLength;
+}
+
+void CompactTableFilter::SkipReorderingTableCoder(std::FILE* in)
+{
+  // Same layout as read by LexicalReorderingTableCompact::Load
+  size_t numScoreComponent;
+  bool multipleScoreTrees;
+
+  size_t read = 0;
+  read += std::fread(&numScoreComponent, sizeof(numScoreComponent), 1, in);
+  read += std::fread(&multipleScoreTrees, sizeof(multipleScoreTrees), 1, in);
+  UTIL_THROW_IF(read != 2, util::Exception, "Truncated compact reordering table");
+
+  size_t numScoreTrees = multipleScoreTrees ? numScoreComponent : 1;
+  for(size_t i = 0; i < numScoreTrees; i++)
+    CanonicalHuffman<float> scoreTree(in);
+}
+
+size_t CompactTableFilter::Filter(const std::string &inPath,
+                                  const std::string &outPath,
+                                  const std::vector<std::string> &sourcePhrases)
+{
+  std::FILE* in = std::fopen(inPath.c_str(), "r");
+  UTIL_THROW_IF(!in, util::ErrnoException, "Could not open " << inPath);
+
+  size_t orderBits, fingerPrintBits;
+  size_t read = 0;
+  read += std::fread(&orderBits, sizeof(orderBits), 1, in);
+  read += std::fread(&fingerPrintBits, sizeof(fingerPrintBits), 1, in);
+  UTIL_THROW_IF(read != 2, util::Exception, "Truncated compact table " << inPath);
+  std::fseek(in, 0, SEEK_SET);
+
+#ifdef WITH_THREADS
+  BlockHashIndex hash(orderBits, fingerPrintBits, 1);
+#else
+  BlockHashIndex hash(orderBits, fingerPrintBits);
+#endif
+  hash.Load(in);
+
+  size_t coderStart = std::ftell(in);
+  size_t maxPhraseLength = std::numeric_limits<size_t>::max();
+  if(m_type == PhraseTable)
+    maxPhraseLength = SkipPhraseTableCoder(in);
+  else
+    SkipReorderingTableCoder(in);
+  size_t coderEnd = std::ftell(in);
+
+  // Compressed collections stay on disk, only the ones kept are read.
+  StringVector<unsigned char, unsigned long, MmapAllocator> collections;
+  collections.load(in, true);
+
+  // The entries of the filtered table are in the order of their keys.
+  std::vector<std::string> keys;
+  keys.reserve(sourcePhrases.size());
+  for(std::vector<std::string>::const_iterator it = sourcePhrases.begin();
+      it != sourcePhrases.end(); it++) {
+    size_t length = std::count(it->begin(), it->end(), ' ') + 1;
+    if(length <= maxPhraseLength)
+      keys.push_back(*it + " ||| ");
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  std::vector<std::string> foundKeys;
+  std::vector<size_t> foundIndexes;
+  for(std::vector<std::string>::iterator it = keys.begin(); it != keys.end(); it++) {
+    size_t index = hash[*it];
+    if(index != hash.GetSize()) {
+      foundKeys.push_back(*it);
+      foundIndexes.push_back(index);
+    }
+  }
+  UTIL_THROW_IF(foundKeys.empty(), util::Exception,
+                "None of the source phrases occurs in " << inPath);
+
+  std::FILE* out = std::fopen(outPath.c_str(), "w");
+  UTIL_THROW_IF(!out, util::ErrnoException, "Could not open " << outPath);
+
+  // Source phrase index, hashed in ranges of 2^orderBits keys like
+  // PhraseTableCreator does. Ranges are hashed on m_threads threads.
+#ifdef WITH_THREADS
+  BlockHashIndex filteredHash(orderBits, fingerPrintBits, m_threads);
+#else
+  BlockHashIndex filteredHash(orderBits, fingerPrintBits);
+#endif
+  filteredHash.BeginSave(out);
+  std::vector<std::string> range;
+  for(size_t i = 0; i < foundKeys.size(); i++) {
+    range.push_back(foundKeys[i]);
+    if(range.size() == (1ul << orderBits) || i + 1 == foundKeys.size()) {
+      filteredHash.AddRange(range);
+      filteredHash.SaveLastRange();
+      filteredHash.DropLastRange();
+      range.clear();
+    }
+  }
+#ifdef WITH_THREADS
+  filteredHash.WaitAll();
+#endif
+  filteredHash.SaveLastRange();
+  filteredHash.DropLastRange();
+  filteredHash.FinalizeSave();
+
+  // Symbol tables and Huffman codes, unchanged
+  std::fseek(in, coderStart, SEEK_SET);
+  std::vector<char> buffer(1 << 16);
+  for(size_t left = coderEnd - coderStart; left > 0;) {
+    size_t n = std::fread(&buffer[0], 1, std::min(left, buffer.size()), in);
+    UTIL_THROW_IF(n == 0, util::Exception, "Truncated compact table " << inPath);
+    ThrowingFwrite(&buffer[0], 1, n, out);
+    left -= n;
+  }
+
+  // Compressed collections of the source phrases found
+  StringVector<unsigned char, unsigned long, std::allocator> filteredCollections;
+  for(std::vector<size_t>::iterator it = foundIndexes.begin();
+      it != foundIndexes.end(); it++)
+    filteredCollections.push_back(collections[*it].str());
+  filteredCollections.save(out);
+
+  std::fclose(out);
+  std::fclose(in);
+
+  return foundKeys.size();
+}
+
+}
@@ -0,0 +1,72 @@
+// $Id$
+// vim:tabstop=2
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_CompactTableFilter_h
+#define moses_CompactTableFilter_h
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Moses
+{
+
+/** Filters a compact phrase table (.minphr) or a compact lexical reordering
+ * table (.minlexr) to a given set of source phrases and writes the result
+ * as a table of the same kind.
+ *
+ * Source phrases are looked up in the source phrase index of the table.
+ * The compressed target phrase collections (or scores) of the phrases found
+ * are copied as they are, together with the Huffman codes and symbol tables
+ * they were compressed with, so nothing is decompressed. Only the source
+ * phrase index is rebuilt. The filtered table answers every lookup of one of
+ * the given source phrases like the original one, including the target
+ * phrases of PREnc-encoded tables that refer to sub-phrases of the source.
+ *
+ * Reordering tables can only be filtered if their keys consist of the source
+ * phrase alone, i.e. for models conditioned on the source phrase ("-f").
+ */
+class CompactTableFilter
+{
+public:
+  enum TableType { PhraseTable, ReorderingTable };
+
+  CompactTableFilter(TableType type, size_t threads = 1);
+
+  /** Filter the table at inPath to the given source phrases (words separated
+   * by single spaces, factors joined with '|' as in the text table) and
+   * write it to outPath. Returns the number of source phrases found. */
+  size_t Filter(const std::string &inPath, const std::string &outPath,
+                const std::vector<std::string> &sourcePhrases);
+
+private:
+  // Reads the part of the file between the source phrase index and the
+  // compressed collections, returns the maximum source phrase length.
+  size_t SkipPhraseTableCoder(std::FILE* in);
+  void SkipReorderingTableCoder(std::FILE* in);
+
+  TableType m_type;
+  size_t m_threads;
+};
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+// $Id$
+// vim:tabstop=2
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include <vector>
+
+#include "ExternalStringVector.h"
+#include "ThrowingFwrite.h"
+
+#include "util/file.hh"
+
+namespace Moses
+{
+
+ExternalStringVector::ExternalStringVector(std::FILE* tempFile, size_t blockSize)
+  : m_file(tempFile), m_blockSize(blockSize), m_spilled(0),
+    m_sorted(true), m_committed(false)
+{
+  UTIL_THROW_IF(!m_file, util::Exception, "Could not create temporary file");
+}
+
+ExternalStringVector::~ExternalStringVector()
+{
+  std::fclose(m_file);
+}
+
+void ExternalStringVector::Spill()
+{
+  if(m_block.size())
+    ThrowingFwrite(m_block.data(), 1, m_block.size(), m_file);
+  m_spilled += m_block.size();
+  m_block.clear();
+}
+
+void ExternalStringVector::push_back(const std::string& s)
+{
+  assert(!m_committed);
+
+  // Same as StringVector::push_back
+  if(m_sorted && size() && !(m_last < s))
+    m_sorted = false;
+  m_last = s;
+
+  m_positions.push_back(size2());
+  m_block.append(s);
+
+  if(m_block.size() >= m_blockSize)
+    Spill();
+}
+
+void ExternalStringVector::Commit()
+{
+  if(m_committed)
+    return;
+
+  Spill();
+  std::string().swap(m_block);
+  std::string().swap(m_last);
+  UTIL_THROW_IF(std::fflush(m_file), util::ErrnoException,
+                "Could not flush temporary file");
+  m_positions.commit();
+  m_committed = true;
+}
+
+unsigned long ExternalStringVector::size() const
+{
+  return m_positions.size();
+}
+
+size_t ExternalStringVector::size2() const
+{
+  return m_spilled + m_block.size();
+}
+
+std::string ExternalStringVector::operator[](unsigned long i) const
+{
+  assert(m_committed);
+
+  unsigned long begin = m_positions[i];
+  unsigned long end = i + 1 < size() ? m_positions[i + 1] : size2();
+
+  std::string s(end - begin, 0);
+  if(s.size())
+    util::PReadOrThrow(fileno(m_file), &s[0], s.size(), begin);
+  return s;
+}
+
+size_t ExternalStringVector::save(std::FILE* out)
+{
+  Commit();
+
+  size_t byteSize = 0;
+  byteSize += ThrowingFwrite(&m_sorted, sizeof(bool), 1, out) * sizeof(bool);
+
+  byteSize += m_positions.save(out);
+
+  size_t valSize = size2();
+  byteSize += ThrowingFwrite(&valSize, sizeof(size_t), 1, out) * sizeof(size_t);
+
+  // Merge the spilled blocks
+  std::vector<char> buffer(std::min(valSize, size_t(1) << 20));
+  for(size_t pos = 0; pos < valSize;) {
+    size_t n = std::min(buffer.size(), valSize - pos);
+    util::PReadOrThrow(fileno(m_file), &buffer[0], n, pos);
+    byteSize += ThrowingFwrite(&buffer[0], 1, n, out);
+    pos += n;
+  }
+
+  return byteSize;
+}
+
+}
@@ -0,0 +1,75 @@
+// $Id$
+// vim:tabstop=2
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_ExternalStringVector_h
+#define moses_ExternalStringVector_h
+
+#include <cstdio>
+#include <string>
+
+#include "MonotonicVector.h"
+
+namespace Moses
+{
+
+/** Append-only string vector for intermediate data of the table creators.
+ *
+ * Strings are collected in a block of at most blockSize bytes that is
+ * appended to a temporary file when it is full, only the compressed start
+ * positions of the strings are kept in memory. After Commit() the strings
+ * can be read back by several threads at the same time. save() writes the
+ * same layout as StringVector<unsigned char, unsigned long>::save(), the
+ * blocks are copied from the temporary file.
+ */
+class ExternalStringVector
+{
+private:
+  std::FILE* m_file;
+  size_t m_blockSize;
+  std::string m_block;
+  size_t m_spilled;
+
+  MonotonicVector<unsigned long, unsigned int, 32> m_positions;
+  bool m_sorted;
+  std::string m_last;
+  bool m_committed;
+
+  void Spill();
+
+public:
+  // Takes ownership of tempFile which has to be opened for reading and writing
+  ExternalStringVector(std::FILE* tempFile, size_t blockSize);
+  ~ExternalStringVector();
+
+  void push_back(const std::string& s);
+  void Commit();
+
+  unsigned long size() const;
+  size_t size2() const;
+
+  std::string operator[](unsigned long i) const;
+
+  size_t save(std::FILE* out);
+};
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#define BOOST_TEST_MODULE ExternalStringVector
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ExternalStringVector.h"
+#include "StringVector.h"
+
+using namespace Moses;
+
+namespace
+{
+
+std::string ReadAll(std::FILE* file)
+{
+  std::string bytes;
+  std::rewind(file);
+  char buffer[4096];
+  size_t n;
+  while((n = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    bytes.append(buffer, n);
+  return bytes;
+}
+
+// Saves strings through ExternalStringVector and StringVector and checks
+// that both write the same bytes and return the same strings.
+void CheckSameAsStringVector(const std::vector<std::string>& strings, size_t blockSize)
+{
+  ExternalStringVector external(std::tmpfile(), blockSize);
+  StringVector<unsigned char, unsigned long> memory;
+  for(size_t i = 0; i < strings.size(); ++i) {
+    external.push_back(strings[i]);
+    memory.push_back(strings[i]);
+  }
+
+  std::FILE* externalOut = std::tmpfile();
+  std::FILE* memoryOut = std::tmpfile();
+  size_t externalSize = external.save(externalOut);
+  size_t memorySize = memory.save(memoryOut);
+  BOOST_CHECK_EQUAL(externalSize, memorySize);
+  BOOST_CHECK(ReadAll(externalOut) == ReadAll(memoryOut));
+  std::fclose(externalOut);
+  std::fclose(memoryOut);
+
+  BOOST_REQUIRE_EQUAL(external.size(), memory.size());
+  for(size_t i = 0; i < strings.size(); ++i)
+    BOOST_CHECK_EQUAL(external[i], strings[i]);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(empty)
+{
+  CheckSameAsStringVector(std::vector<std::string>(), 16);
+}
+
+BOOST_AUTO_TEST_CASE(unsorted_across_blocks)
+{
+  // strings of up to 30 bytes with 16 byte blocks, so that strings start
+  // and end in different blocks
+  std::vector<std::string> strings;
+  for(size_t i = 0; i < 500; ++i) {
+    std::stringstream s;
+    for(size_t j = 0; j <= (i * 7) % 6; ++j)
+      s << "w" << (i * 31 + j) % 97 << " ";
+    strings.push_back(s.str());
+  }
+  CheckSameAsStringVector(strings, 16);
+  CheckSameAsStringVector(strings, 1);
+}
+
+BOOST_AUTO_TEST_CASE(sorted_across_blocks)
+{
+  std::vector<std::string> strings;
+  for(size_t i = 0; i < 300; ++i) {
+    std::stringstream s;
+    s << "phrase " << 1000 + i;
+    strings.push_back(s.str());
+  }
+  CheckSameAsStringVector(strings, 64);
+}
@@ -52,7 +52,8 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
                                        bool multipleScoreTrees,
                                        size_t quantize,
                                        size_t maxRank,
-                                       bool warnMe
+                                       bool warnMe,
+                                       size_t memoryBudget
 #ifdef WITH_THREADS
                                        , size_t threads
 #endif
@@ -63,7 +64,7 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
     m_coding(coding), m_orderBits(orderBits), m_fingerPrintBits(fingerPrintBits),
     m_useAlignmentInfo(useAlignmentInfo),
     m_multipleScoreTrees(multipleScoreTrees),
-    m_quantize(quantize), m_maxRank(maxRank),
+    m_quantize(quantize), m_maxRank(maxRank), m_memoryBudget(memoryBudget),
 #ifdef WITH_THREADS
     m_threads(threads),
     m_srcHash(m_orderBits, m_fingerPrintBits, 1),
@@ -73,6 +74,7 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
     m_rnkHash(m_orderBits, m_fingerPrintBits),
 #endif
     m_maxPhraseLength(0),
+    m_rankFile(0), m_rnkHashFile(0), m_rnkHashRatio(1),
     m_lastFlushedLine(-1), m_lastFlushedSourceNum(0),
     m_lastFlushedSourcePhrase("")
 {
@@ -110,13 +112,12 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
   std::cerr << "Pass " << cur_pass << "/" << all_passes << ": Creating source phrase index + Encoding target phrases" << std::endl;
   m_srcHash.BeginSave(m_outFile);
 
-  if(tempfilePath.size()) {
-    MmapAllocator<unsigned char> allocEncoded(util::FMakeTemp(tempfilePath));
-    m_encodedTargetPhrases = new StringVector<unsigned char, unsigned long, MmapAllocator>(allocEncoded);
-  } else {
-    m_encodedTargetPhrases = new StringVector<unsigned char, unsigned long, MmapAllocator>();
-  }
+  // Encoded and compressed target phrase collections are written to
+  // temporary files in blocks.
+  size_t blockSize = m_memoryBudget ? m_memoryBudget / 8 : 1ul << 26;
+  m_encodedTargetPhrases = new ExternalStringVector(MakeTempFile(), blockSize);
   EncodeTargetPhrases();
+  m_encodedTargetPhrases->Commit();
 
   cur_pass++;
 
@@ -126,12 +127,7 @@ PhraseTableCreator::PhraseTableCreator(std::string inPath,
   // 2nd pass
   std::cerr << "Pass " << cur_pass << "/" << all_passes << ": Compressing target phrases" << std::endl;
 
-  if(tempfilePath.size()) {
-    MmapAllocator<unsigned char> allocCompressed(util::FMakeTemp(tempfilePath));
-    m_compressedTargetPhrases = new StringVector<unsigned char, unsigned long, MmapAllocator>(allocCompressed);
-  } else {
-    m_compressedTargetPhrases = new StringVector<unsigned char, unsigned long, MmapAllocator>();
-  }
+  m_compressedTargetPhrases = new ExternalStringVector(MakeTempFile(), blockSize);
   CompressTargetPhrases();
 
   std::cerr << "Saving to " << m_outPath << std::endl;
@@ -152,6 +148,19 @@ PhraseTableCreator::~PhraseTableCreator()
 
   delete m_encodedTargetPhrases;
   delete m_compressedTargetPhrases;
+
+  m_rankMemory.reset();
+  if(m_rankFile)
+    std::fclose(m_rankFile);
+  if(m_rnkHashFile)
+    std::fclose(m_rnkHashFile);
+}
+
+std::FILE* PhraseTableCreator::MakeTempFile()
+{
+  if(m_tempfilePath.size())
+    return util::FMakeTemp(m_tempfilePath);
+  return std::tmpfile();
 }
 
 void PhraseTableCreator::PrintInfo()
@@ -179,6 +188,11 @@ void PhraseTableCreator::PrintInfo()
   else
     std::cerr << "no" << std::endl;
   std::cerr << "\tExplicitly included alignment information: " << (m_useAlignmentInfo ? "yes" : "no") << std::endl;
+  std::cerr << "\tMemory budget for intermediate data: ";
+  if(m_memoryBudget)
+    std::cerr << (m_memoryBudget >> 20) << " MB" << std::endl;
+  else
+    std::cerr << "unlimited" << std::endl;
 
 #ifdef WITH_THREADS
   std::cerr << "\tRunning with " << m_threads << " threads" << std::endl;
@@ -315,6 +329,12 @@ void PhraseTableCreator::CreateRankHash()
 {
   InputFileStream inFile(m_inPath);
 
+  if(m_memoryBudget) {
+    m_rankFile = MakeTempFile();
+    m_rnkHashFile = MakeTempFile();
+    m_rnkHash.BeginSave(m_rnkHashFile);
+  }
+
 #ifdef WITH_THREADS
   boost::thread_group threads;
   for (size_t i = 0; i < m_threads; ++i) {
@@ -477,6 +497,13 @@ unsigned PhraseTableCreator::GetRank(unsigned srcIdx, unsigned trgIdx)
     return m_lexicalTable.size();
 }
 
+inline unsigned PhraseTableCreator::GetLineRank(size_t line)
+{
+  if(m_rankFile)
+    return static_cast<const unsigned*>(m_rankMemory.get())[line];
+  return m_ranks[line];
+}
+
 unsigned PhraseTableCreator::EncodeREncSymbol1(unsigned trgIdx)
 {
   assert((~(1 << 31)) > trgIdx);
@@ -623,7 +650,7 @@ void PhraseTableCreator::EncodeTargetPhrasePREnc(std::vector<std::string>& s,
     std::string key1Str = key1.str(), key2Str = key2.str();
     size_t idx = m_rnkHash[MakeSourceTargetKey(key1Str, key2Str)];
     if(idx != m_rnkHash.GetSize())
-      rank = m_ranks[idx];
+      rank = GetLineRank(idx);
 
     if(rank >= 0 && (m_maxRank == 0 || unsigned(rank) < m_maxRank)) {
       if(unsigned(p.m) != s.size() || unsigned(rank) < ownRank) {
@@ -825,6 +852,27 @@ void PhraseTableCreator::AddRankedLine(PackedItem& pi)
   m_queue.push(pi);
 }
 
+void PhraseTableCreator::AssignRanks(size_t end)
+{
+  // Target phrases of one source phrase are on the lines before "end"
+  size_t begin = end - m_rankQueue.size();
+  std::vector<unsigned> ranks(m_rankQueue.size());
+
+  int r = 0;
+  while(!m_rankQueue.empty()) {
+    ranks[m_rankQueue.top().second - begin] = r++;
+    m_rankQueue.pop();
+  }
+
+  if(m_rankFile) {
+    if(ranks.size())
+      ThrowingFwrite(&ranks[0], sizeof(unsigned), ranks.size(), m_rankFile);
+  } else {
+    m_ranks.resize(end);
+    std::copy(ranks.begin(), ranks.end(), m_ranks.begin() + begin);
+  }
+}
+
 void PhraseTableCreator::FlushRankedQueue(bool force)
 {
   size_t step = 1ul << 10;
@@ -837,6 +885,10 @@ void PhraseTableCreator::FlushRankedQueue(bool force)
 
     if(m_lastSourceRange.size() == step) {
       m_rnkHash.AddRange(m_lastSourceRange);
+      if(m_rnkHashFile) {
+        m_rnkHash.SaveLastRange();
+        m_rnkHash.DropLastRange();
+      }
       m_lastSourceRange.clear();
     }
 
@@ -850,12 +902,7 @@ void PhraseTableCreator::FlushRankedQueue(bool force)
           std::cerr << "[" << m_lastFlushedSourceNum << "]" << std::endl;
         }
 
-        m_ranks.resize(m_lastFlushedLine + 1);
-        int r = 0;
-        while(!m_rankQueue.empty()) {
-          m_ranks[m_rankQueue.top().second] = r++;
-          m_rankQueue.pop();
-        }
+        AssignRanks(m_lastFlushedLine);
       }
     }
 
@@ -873,11 +920,23 @@ void PhraseTableCreator::FlushRankedQueue(bool force)
     m_rnkHash.WaitAll();
 #endif
 
-    m_ranks.resize(m_lastFlushedLine + 1);
-    int r = 0;
-    while(!m_rankQueue.empty()) {
-      m_ranks[m_rankQueue.top().second] = r++;
-      m_rankQueue.pop();
+    AssignRanks(m_lastFlushedLine + 1);
+
+    if(m_rnkHashFile) {
+      m_rnkHash.SaveLastRange();
+      m_rnkHash.DropLastRange();
+      size_t bytes = m_rnkHash.FinalizeSave();
+
+      // Ranges are loaded again on demand during encoding, keep as many
+      // as fit into half of the budget.
+      if(bytes)
+        m_rnkHashRatio = float(m_memoryBudget / 2) / bytes;
+
+      UTIL_THROW_IF(std::fflush(m_rankFile), util::ErrnoException,
+                    "Could not flush temporary file");
+      size_t rankBytes = (m_lastFlushedLine + 1) * sizeof(unsigned);
+      if(rankBytes)
+        util::MapRead(util::LAZY, fileno(m_rankFile), 0, rankBytes, m_rankMemory);
     }
 
     m_lastFlushedLine = -1;
@@ -895,6 +954,9 @@ void PhraseTableCreator::AddEncodedLine(PackedItem& pi)
 
 void PhraseTableCreator::FlushEncodedQueue(bool force)
 {
+  if(m_rnkHashFile)
+    m_rnkHash.KeepNLastRanges(m_rnkHashRatio, 0.1);
+
   while(!m_queue.empty() && m_lastFlushedLine + 1 == m_queue.top().GetLine()) {
     PackedItem pi = m_queue.top();
     m_queue.pop();
@@ -1141,7 +1203,7 @@ void EncodingTask::operator()()
 
       size_t ownRank = 0;
       if(m_creator.m_coding == PhraseTableCreator::PREnc)
-        ownRank = m_creator.m_ranks[lineNum + i];
+        ownRank = m_creator.GetLineRank(lineNum + i);
 
       std::string encodedLine = m_creator.EncodeLine(tokens, ownRank);
 
@@ -1181,8 +1243,7 @@ size_t CompressionTask::m_collectionNum = 0;
 boost::mutex CompressionTask::m_mutex;
 #endif
 
-CompressionTask::CompressionTask(StringVector<unsigned char, unsigned long,
-                                 MmapAllocator>& encodedCollections,
+CompressionTask::CompressionTask(ExternalStringVector& encodedCollections,
                                  PhraseTableCreator& creator)
   : m_encodedCollections(encodedCollections), m_creator(creator) {}
 
@@ -34,8 +34,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "moses/UserMessage.h"
 #include "moses/Util.h"
 
+#include "util/mmap.hh"
+
 #include "BlockHashIndex.h"
 #include "StringVector.h"
+#include "ExternalStringVector.h"
 #include "CanonicalHuffman.h"
 
 namespace Moses
@@ -198,6 +201,7 @@ private:
   bool m_multipleScoreTrees;
   size_t m_quantize;
   size_t m_maxRank;
+  size_t m_memoryBudget;
 
   static std::string m_phraseStopSymbol;
   static std::string m_separator;
@@ -214,6 +218,13 @@ private:
 
   std::vector<unsigned> m_ranks;
 
+  // With a memory budget, ranks and the rank hash are kept in temporary
+  // files and only the most recently used hash ranges stay in memory.
+  std::FILE* m_rankFile;
+  util::scoped_memory m_rankMemory;
+  std::FILE* m_rnkHashFile;
+  float m_rnkHashRatio;
+
   typedef std::pair<unsigned, unsigned> SrcTrg;
   typedef std::pair<std::string, std::string> SrcTrgString;
   typedef std::pair<SrcTrgString, float> SrcTrgProb;
@@ -238,11 +249,8 @@ private:
   std::vector<size_t> m_lexicalTableIndex;
   std::vector<SrcTrg> m_lexicalTable;
 
-  StringVector<unsigned char, unsigned long, MmapAllocator>*
-  m_encodedTargetPhrases;
-
-  StringVector<unsigned char, unsigned long, MmapAllocator>*
-  m_compressedTargetPhrases;
+  ExternalStringVector* m_encodedTargetPhrases;
+  ExternalStringVector* m_compressedTargetPhrases;
 
   boost::unordered_map<std::string, unsigned> m_targetSymbolsMap;
   boost::unordered_map<std::string, unsigned> m_sourceSymbolsMap;
@@ -275,6 +283,8 @@ private:
   void Save();
   void PrintInfo();
 
+  std::FILE* MakeTempFile();
+
   void AddSourceSymbolId(std::string& symbol);
   unsigned GetSourceSymbolId(std::string& symbol);
 
@@ -283,6 +293,7 @@ private:
   unsigned GetOrAddTargetSymbolId(std::string& symbol);
 
   unsigned GetRank(unsigned srcIdx, unsigned trgIdx);
+  unsigned GetLineRank(size_t line);
 
   unsigned EncodeREncSymbol1(unsigned symbol);
   unsigned EncodeREncSymbol2(unsigned position, unsigned rank);
@@ -318,6 +329,7 @@ private:
   void CompressTargetPhrases();
 
   void AddRankedLine(PackedItem& pi);
+  void AssignRanks(size_t end);
   void FlushRankedQueue(bool force = false);
 
   std::string EncodeLine(std::vector<std::string>& tokens, size_t ownRank);
@@ -342,7 +354,8 @@ public:
                      bool multipleScoreTrees = true,
                      size_t quantize = 0,
                      size_t maxRank = 100,
-                     bool warnMe = true
+                     bool warnMe = true,
+                     size_t memoryBudget = 0
 #ifdef WITH_THREADS
                                    , size_t threads = 2
 #endif
@@ -397,13 +410,12 @@ private:
   static boost::mutex m_mutex;
 #endif
   static size_t m_collectionNum;
-  StringVector<unsigned char, unsigned long, MmapAllocator>&
-  m_encodedCollections;
+  ExternalStringVector& m_encodedCollections;
   PhraseTableCreator& m_creator;
 
 public:
-  CompressionTask(StringVector<unsigned char, unsigned long, MmapAllocator>&
-                  encodedCollections, PhraseTableCreator& creator);
+  CompressionTask(ExternalStringVector& encodedCollections,
+                  PhraseTableCreator& creator);
   void operator()();
 };
 
@@ -84,7 +84,7 @@ PhraseDictionaryDynSuffixArray::
 insertSnt(string& source, string& target, string& alignment)
 {
   m_biSA->addSntPair(source, target, alignment); // insert sentence pair into suffix arrays
-  //StaticData::Instance().ClearTransOptionCache(); // clear translation option cache
+  StaticData::Instance().ClearTransOptionCache(); // cached options may predate the new pair
 }
 
 void
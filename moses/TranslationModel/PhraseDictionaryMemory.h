@@ -53,6 +53,11 @@ public:
     const InputType &,
     const ChartCellCollectionBase &);
 
+  //! lookups only read the trie
+  bool SupportsParallelLookup() const {
+    return true;
+  }
+
   TO_STRING();
 
 protected:
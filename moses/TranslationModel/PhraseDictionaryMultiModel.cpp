@@ -20,13 +20,133 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "moses/TranslationModel/PhraseDictionaryMultiModel.h"
 
+#ifdef WITH_THREADS
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
 using namespace std;
 
 namespace Moses
 
 {
+multiModelStatisticsMap::multiModelStatisticsMap(const std::vector<FactorType> &factors)
+{
+  PhraseHash hash = { &factors };
+  PhraseEqual equal = { &factors };
+  m_index = Index(0, hash, equal);
+}
+
+multiModelStatisticsMap::~multiModelStatisticsMap()
+{
+  RemoveAllInColl(m_statistics);
+}
+
+multiModelStatistics *multiModelStatisticsMap::Find(const Phrase &target) const
+{
+  Index::const_iterator iter = m_index.find(&target);
+  return iter == m_index.end() ? NULL : iter->second;
+}
+
+void multiModelStatisticsMap::Add(multiModelStatistics *statistics)
+{
+  m_statistics.push_back(statistics);
+  m_index[statistics->targetPhrase] = statistics;
+}
+
+size_t multiModelStatisticsMap::PhraseHash::operator()(const Phrase *phrase) const
+{
+  size_t seed = phrase->GetSize();
+  for (size_t pos = 0; pos < phrase->GetSize(); ++pos) {
+    const Word &word = phrase->GetWord(pos);
+    for (size_t i = 0; i < m_factors->size(); ++i) {
+      const Factor *factor = word[(*m_factors)[i]];
+      boost::hash_combine(seed, factor ? factor->GetId() : NOT_FOUND);
+    }
+  }
+  return seed;
+}
+
+bool multiModelStatisticsMap::PhraseEqual::operator()(const Phrase *a, const Phrase *b) const
+{
+  if (a->GetSize() != b->GetSize()) {
+    return false;
+  }
+  for (size_t pos = 0; pos < a->GetSize(); ++pos) {
+    for (size_t i = 0; i < m_factors->size(); ++i) {
+      if (a->GetWord(pos)[(*m_factors)[i]] != b->GetWord(pos)[(*m_factors)[i]]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+#ifdef WITH_THREADS
+/** components of one source phrase that are looked up on the lookup pool.
+ * The calling thread and the helper tasks take components from here until
+ * none are left; a helper that starts after that does not touch the source
+ * phrase, which may be gone by then. */
+class MultiModelLookup
+{
+public:
+  MultiModelLookup(const Phrase &src, const std::vector<PhraseDictionary*> &pd)
+    : m_src(src), m_pd(pd), m_collections(pd.size(), NULL), m_next(0), m_active(0) {}
+
+  std::vector<size_t> m_components;
+
+  void Work() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    ++m_active;
+    while (m_next < m_components.size()) {
+      const size_t i = m_components[m_next++];
+      lock.unlock();
+      const TargetPhraseCollection *collection = m_pd[i]->GetTargetPhraseCollection(m_src);
+      lock.lock();
+      m_collections[i] = collection;
+    }
+    if (--m_active == 0) {
+      m_done.notify_all();
+    }
+  }
+
+  //! wait until every component has been looked up
+  void Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_next < m_components.size() || m_active > 0) {
+      m_done.wait(lock);
+    }
+  }
+
+  const TargetPhraseCollection *GetCollection(size_t i) const {
+    return m_collections[i];
+  }
+
+private:
+  const Phrase &m_src;
+  const std::vector<PhraseDictionary*> &m_pd;
+  std::vector<const TargetPhraseCollection*> m_collections;
+  size_t m_next, m_active;
+  boost::mutex m_mutex;
+  boost::condition_variable m_done;
+};
+
+class MultiModelLookupTask : public Task
+{
+public:
+  MultiModelLookupTask(boost::shared_ptr<MultiModelLookup> lookup) : m_lookup(lookup) {}
+  void Run() {
+    m_lookup->Work();
+  }
+private:
+  boost::shared_ptr<MultiModelLookup> m_lookup;
+};
+#endif
+
 PhraseDictionaryMultiModel::PhraseDictionaryMultiModel(const std::string &line)
   :PhraseDictionary("PhraseDictionaryMultiModel", line)
+  ,m_lookupThreads(1)
 {
   ReadParameters();
 
@@ -45,6 +165,7 @@ PhraseDictionaryMultiModel::PhraseDictionaryMultiModel(const std::string &line)
 
 PhraseDictionaryMultiModel::PhraseDictionaryMultiModel(const std::string &description, const std::string &line)
   :PhraseDictionary(description, line)
+  ,m_lookupThreads(1)
 {
   if (description == "PhraseDictionaryMultiModelCounts") {
     CHECK(m_pdStr.size() == m_multimodelweights.size() || m_pdStr.size()*4 == m_multimodelweights.size());
@@ -60,6 +181,11 @@ void PhraseDictionaryMultiModel::SetParameter(const std::string& key, const std:
     m_numModels = m_pdStr.size();
   } else if (key == "lambda") {
     m_multimodelweights = Tokenize<float>(value, ",");
+  } else if (key == "lookup-threads") {
+    m_lookupThreads = Scan<size_t>(value);
+#ifndef WITH_THREADS
+    UTIL_THROW_IF(m_lookupThreads > 1, util::Exception, "lookup-threads > 1 but moses not built with thread support");
+#endif
   } else {
     PhraseDictionary::SetParameter(key, value);
   }
@@ -84,6 +210,52 @@ void PhraseDictionaryMultiModel::Load()
     CHECK(pt);
     m_pd.push_back(pt);
   }
+  CreateLookupPool();
+}
+
+void PhraseDictionaryMultiModel::CreateLookupPool()
+{
+#ifdef WITH_THREADS
+  if (m_lookupThreads > 1) {
+    // the thread that asks for a source phrase looks up components too
+    m_lookupPool.reset(new ThreadPool(m_lookupThreads - 1));
+  }
+#endif
+}
+
+void PhraseDictionaryMultiModel::LookupComponents(const Phrase& src, std::vector<const TargetPhraseCollection*> &collections) const
+{
+  collections.assign(m_numModels, NULL);
+#ifdef WITH_THREADS
+  if (m_lookupPool.get()) {
+    boost::shared_ptr<MultiModelLookup> lookup(new MultiModelLookup(src, m_pd));
+    for(size_t i = 0; i < m_numModels; ++i) {
+      if (m_pd[i]->SupportsParallelLookup()) {
+        lookup->m_components.push_back(i);
+      }
+    }
+    const size_t helpers = lookup->m_components.empty() ? 0
+                           : std::min(m_lookupThreads - 1, lookup->m_components.size() - 1);
+    for (size_t i = 0; i < helpers; ++i) {
+      m_lookupPool->Submit(new MultiModelLookupTask(lookup));
+    }
+    // models with per-thread state are looked up by this thread
+    for(size_t i = 0; i < m_numModels; ++i) {
+      if (!m_pd[i]->SupportsParallelLookup()) {
+        collections[i] = m_pd[i]->GetTargetPhraseCollection(src);
+      }
+    }
+    lookup->Work();
+    lookup->Wait();
+    for(size_t i = 0; i < lookup->m_components.size(); ++i) {
+      collections[lookup->m_components[i]] = lookup->GetCollection(lookup->m_components[i]);
+    }
+    return;
+  }
+#endif
+  for(size_t i = 0; i < m_numModels; ++i) {
+    collections[i] = m_pd[i]->GetTargetPhraseCollection(src);
+  }
 }
 
 PhraseDictionary *PhraseDictionaryMultiModel::FindPhraseDictionary(const string &ptName) const
@@ -118,33 +290,34 @@ const TargetPhraseCollection *PhraseDictionaryMultiModel::GetTargetPhraseCollect
     multimodelweights = getWeights(numWeights, true);
   }
 
-  std::map<std::string,multiModelStatistics*>* allStats = new(std::map<std::string,multiModelStatistics*>);
+  multiModelStatisticsMap allStats(m_output);
 
-  CollectSufficientStatistics(src, allStats);
+  CollectSufficientStatistics(src, &allStats);
 
   TargetPhraseCollection *ret = NULL;
   if (m_mode == "interpolate") {
-    ret = CreateTargetPhraseCollectionLinearInterpolation(src, allStats, multimodelweights);
+    ret = CreateTargetPhraseCollectionLinearInterpolation(src, &allStats, multimodelweights);
   }
 
   ret->NthElement(m_tableLimit); // sort the phrases for pruning later
   const_cast<PhraseDictionaryMultiModel*>(this)->CacheForCleanup(ret);
-  RemoveAllInMap(*allStats);
-  delete allStats;
 
   return ret;
 }
 
 
-void PhraseDictionaryMultiModel::CollectSufficientStatistics(const Phrase& src, std::map<std::string,multiModelStatistics*>* allStats) const
+void PhraseDictionaryMultiModel::CollectSufficientStatistics(const Phrase& src, multiModelStatisticsMap* allStats) const
 {
+  std::vector<const TargetPhraseCollection*> collections;
+  LookupComponents(src, collections);
+
   for(size_t i = 0; i < m_numModels; ++i) {
     const PhraseDictionary &pd = *m_pd[i];
 
-    TargetPhraseCollection *ret_raw = (TargetPhraseCollection*)  pd.GetTargetPhraseCollection( src);
+    const TargetPhraseCollection *ret_raw = collections[i];
     if (ret_raw != NULL) {
 
-      TargetPhraseCollection::iterator iterTargetPhrase, iterLast;
+      TargetPhraseCollection::const_iterator iterTargetPhrase, iterLast;
       if (m_tableLimit != 0 && ret_raw->GetSize() > m_tableLimit) {
         iterLast = ret_raw->begin() + m_tableLimit;
       } else {
@@ -152,55 +325,51 @@ void PhraseDictionaryMultiModel::CollectSufficientStatistics(const Phrase& src,
       }
 
       for (iterTargetPhrase = ret_raw->begin(); iterTargetPhrase != iterLast;  ++iterTargetPhrase) {
-        TargetPhrase * targetPhrase = *iterTargetPhrase;
+        const TargetPhrase * targetPhrase = *iterTargetPhrase;
         std::vector<float> raw_scores = targetPhrase->GetScoreBreakdown().GetScoresForProducer(&pd);
 
-        std::string targetString = targetPhrase->GetStringRep(m_output);
-        if (allStats->find(targetString) == allStats->end()) {
+        multiModelStatistics * statistics = allStats->Find(*targetPhrase);
+        if (statistics == NULL) {
 
-          multiModelStatistics * statistics = new multiModelStatistics;
+          statistics = new multiModelStatistics;
           statistics->targetPhrase = new TargetPhrase(*targetPhrase); //make a copy so that we don't overwrite the original phrase table info
 
           // zero out scores from original phrase table
           statistics->targetPhrase->GetScoreBreakdown().ZeroDenseFeatures(&pd);
 
           Scores scoreVector(m_numScoreComponents);
-          statistics->p.resize(m_numScoreComponents);
+          statistics->p.resize(m_numScoreComponents * m_numModels);
           for(size_t j = 0; j < m_numScoreComponents; ++j) {
-            statistics->p[j].resize(m_numModels);
             scoreVector[j] = -raw_scores[j];
           }
 
           statistics->targetPhrase->GetScoreBreakdown().Assign(this, scoreVector); // set scores to 0
           statistics->targetPhrase->Evaluate(src, GetFeaturesToApply());
 
-          (*allStats)[targetString] = statistics;
-
+          allStats->Add(statistics);
         }
-        multiModelStatistics * statistics = (*allStats)[targetString];
 
         for(size_t j = 0; j < m_numScoreComponents; ++j) {
-          statistics->p[j][i] = UntransformScore(raw_scores[j]);
+          statistics->p[j * m_numModels + i] = UntransformScore(raw_scores[j]);
         }
-
-        (*allStats)[targetString] = statistics;
       }
     }
   }
 }
 
 
-TargetPhraseCollection* PhraseDictionaryMultiModel::CreateTargetPhraseCollectionLinearInterpolation(const Phrase& src, std::map<std::string,multiModelStatistics*>* allStats, std::vector<std::vector<float> > &multimodelweights) const
+TargetPhraseCollection* PhraseDictionaryMultiModel::CreateTargetPhraseCollectionLinearInterpolation(const Phrase& src, multiModelStatisticsMap* allStats, std::vector<std::vector<float> > &multimodelweights) const
 {
   TargetPhraseCollection *ret = new TargetPhraseCollection();
-  for ( std::map< std::string, multiModelStatistics*>::const_iterator iter = allStats->begin(); iter != allStats->end(); ++iter ) {
+  for ( multiModelStatisticsMap::const_iterator iter = allStats->begin(); iter != allStats->end(); ++iter ) {
 
-    multiModelStatistics * statistics = iter->second;
+    multiModelStatistics * statistics = *iter;
 
     Scores scoreVector(m_numScoreComponents);
 
-    for(size_t i = 0; i < m_numScoreComponents-1; ++i) {
-      scoreVector[i] = TransformScore(std::inner_product(statistics->p[i].begin(), statistics->p[i].end(), multimodelweights[i].begin(), 0.0));
+    const float *p = &statistics->p[0];
+    for(size_t i = 0; i < m_numScoreComponents-1; ++i, p += m_numModels) {
+      scoreVector[i] = TransformScore(std::inner_product(p, p + m_numModels, multimodelweights[i].begin(), 0.0));
     }
 
     //assuming that last value is phrase penalty
@@ -318,26 +487,12 @@ void  PhraseDictionaryMultiModel::CleanUpComponentModels(const InputType &source
 
 const std::vector<float>* PhraseDictionaryMultiModel::GetTemporaryMultiModelWeightsVector() const
 {
-#ifdef WITH_THREADS
-  boost::shared_lock<boost::shared_mutex> read_lock(m_lock_weights);
-  if (m_multimodelweights_tmp.find(boost::this_thread::get_id()) != m_multimodelweights_tmp.end()) {
-    return &m_multimodelweights_tmp.find(boost::this_thread::get_id())->second;
-  } else {
-    return NULL;
-  }
-#else
-  return &m_multimodelweights_tmp;
-#endif
+  return m_multimodelweights_tmp.get();
 }
 
 void PhraseDictionaryMultiModel::SetTemporaryMultiModelWeightsVector(std::vector<float> weights)
 {
-#ifdef WITH_THREADS
-  boost::unique_lock<boost::shared_mutex> lock(m_lock_weights);
-  m_multimodelweights_tmp[boost::this_thread::get_id()] = weights;
-#else
-  m_multimodelweights_tmp = weights;
-#endif
+  m_multimodelweights_tmp.reset(new std::vector<float>(weights));
 }
 
 #ifdef WITH_DLIB
@@ -361,29 +516,26 @@ vector<float> PhraseDictionaryMultiModel::MinimizePerplexity(vector<pair<string,
     string source_string = phrase_pair.first;
     string target_string = phrase_pair.second;
 
-    vector<float> fs(m_numModels);
-    map<string,multiModelStatistics*>* allStats = new(map<string,multiModelStatistics*>);
+    multiModelStatisticsMap allStats(m_output);
 
     Phrase sourcePhrase(0);
     sourcePhrase.CreateFromString(Input, m_input, source_string, factorDelimiter, NULL);
+    Phrase targetPhrase(0);
+    targetPhrase.CreateFromString(Output, m_output, target_string, factorDelimiter, NULL);
 
-    CollectSufficientStatistics(sourcePhrase, allStats); //optimization potential: only call this once per source phrase
+    CollectSufficientStatistics(sourcePhrase, &allStats); //optimization potential: only call this once per source phrase
 
     //phrase pair not found; leave cache empty
-    if (allStats->find(target_string) == allStats->end()) {
-      RemoveAllInMap(*allStats);
-      delete allStats;
+    const multiModelStatistics *statistics = allStats.Find(targetPhrase);
+    if (statistics == NULL) {
       continue;
     }
 
     multiModelStatisticsOptimization* targetStatistics = new multiModelStatisticsOptimization();
-    targetStatistics->targetPhrase = new TargetPhrase(*(*allStats)[target_string]->targetPhrase);
-    targetStatistics->p = (*allStats)[target_string]->p;
+    targetStatistics->targetPhrase = new TargetPhrase(*statistics->targetPhrase);
+    targetStatistics->p = statistics->p;
     targetStatistics->f = iter->second;
     optimizerStats.push_back(targetStatistics);
-
-    RemoveAllInMap(*allStats);
-    delete allStats;
   }
 
   Sentence sentence;
@@ -469,8 +621,9 @@ double CrossEntropy::operator() ( const dlib::matrix<double,0,1>& arg) const
     multiModelStatisticsOptimization* statistics = *iter;
     size_t f = statistics->f;
 
+    const float *p = &statistics->p[m_iFeature * m_model->m_numModels];
     double score;
-    score = std::inner_product(statistics->p[m_iFeature].begin(), statistics->p[m_iFeature].end(), weight_vector.begin(), 0.0);
+    score = std::inner_product(p, p + m_model->m_numModels, weight_vector.begin(), 0.0);
 
     total -= (FloorScore(TransformScore(score))/TransformScore(2))*f;
     n += f;
@@ -24,12 +24,16 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 
 
 #include <boost/unordered_map.hpp>
-#include <boost/thread/shared_mutex.hpp>
 #include "moses/StaticData.h"
 #include "moses/TargetPhrase.h"
 #include "moses/Util.h"
 #include "moses/UserMessage.h"
 
+#ifdef WITH_THREADS
+#include <boost/thread/tss.hpp>
+#include "moses/ThreadPool.h"
+#endif
+
 #ifdef WITH_DLIB
 #include <dlib/optimization.h>
 #endif
@@ -39,7 +43,8 @@ namespace Moses
 
 struct multiModelStatistics {
   TargetPhrase *targetPhrase;
-  std::vector<std::vector<float> > p;
+  //! p[j * numModels + i] is score j of the phrase pair in model i
+  std::vector<float> p;
   ~multiModelStatistics() {
     delete targetPhrase;
   };
@@ -49,6 +54,45 @@ struct multiModelStatisticsOptimization: multiModelStatistics {
   size_t f;
 };
 
+/** Statistics of the target phrases of a source phrase, in the order in
+ * which the component models returned them. Target phrases are identified
+ * by the factor ids of their output factors rather than by their strings.
+ */
+class multiModelStatisticsMap
+{
+public:
+  typedef std::vector<multiModelStatistics*>::const_iterator const_iterator;
+
+  multiModelStatisticsMap(const std::vector<FactorType> &factors);
+  ~multiModelStatisticsMap();
+
+  //! statistics of target, or NULL
+  multiModelStatistics *Find(const Phrase &target) const;
+  //! takes ownership of statistics, whose target phrase must be new
+  void Add(multiModelStatistics *statistics);
+
+  const_iterator begin() const {
+    return m_statistics.begin();
+  }
+  const_iterator end() const {
+    return m_statistics.end();
+  }
+
+private:
+  struct PhraseHash {
+    const std::vector<FactorType> *m_factors;
+    size_t operator()(const Phrase *phrase) const;
+  };
+  struct PhraseEqual {
+    const std::vector<FactorType> *m_factors;
+    bool operator()(const Phrase *a, const Phrase *b) const;
+  };
+  typedef boost::unordered_map<const Phrase*, multiModelStatistics*, PhraseHash, PhraseEqual> Index;
+
+  std::vector<multiModelStatistics*> m_statistics;
+  Index m_index;
+};
+
 class OptimizationObjective;
 
 /** Implementation of a virtual phrase table constructed from multiple component phrase tables.
@@ -64,8 +108,8 @@ public:
   PhraseDictionaryMultiModel(const std::string &description, const std::string &line);
   ~PhraseDictionaryMultiModel();
   void Load();
-  virtual void CollectSufficientStatistics(const Phrase& src, std::map<std::string,multiModelStatistics*>* allStats) const;
-  virtual TargetPhraseCollection* CreateTargetPhraseCollectionLinearInterpolation(const Phrase& src, std::map<std::string,multiModelStatistics*>* allStats, std::vector<std::vector<float> > &multimodelweights) const;
+  virtual void CollectSufficientStatistics(const Phrase& src, multiModelStatisticsMap* allStats) const;
+  virtual TargetPhraseCollection* CreateTargetPhraseCollectionLinearInterpolation(const Phrase& src, multiModelStatisticsMap* allStats, std::vector<std::vector<float> > &multimodelweights) const;
   std::vector<std::vector<float> > getWeights(size_t numWeights, bool normalize) const;
   std::vector<float> normalizeWeights(std::vector<float> &weights) const;
   void CacheForCleanup(TargetPhraseCollection* tpc);
@@ -93,38 +137,39 @@ protected:
   size_t m_numModels;
   std::vector<float> m_multimodelweights;
 
+  /** collection of each component model for src, NULL if it has none.
+   * With lookup-threads > 1 the models that support parallel lookups are
+   * queried concurrently. */
+  void LookupComponents(const Phrase& src, std::vector<const TargetPhraseCollection*> &collections) const;
+  void CreateLookupPool();
+
   typedef std::vector<TargetPhraseCollection*> PhraseCache;
 #ifdef WITH_THREADS
-  boost::shared_mutex m_lock_cache;
-  typedef std::map<boost::thread::id, PhraseCache> SentenceCache;
+  typedef boost::thread_specific_ptr<PhraseCache> SentenceCache;
 #else
-  typedef PhraseCache SentenceCache;
+  typedef std::auto_ptr<PhraseCache> SentenceCache;
 #endif
   SentenceCache m_sentenceCache;
 
   PhraseCache& GetPhraseCache() {
-#ifdef WITH_THREADS
-    {
-      // first try read-only lock
-      boost::shared_lock<boost::shared_mutex> read_lock(m_lock_cache);
-      SentenceCache::iterator i = m_sentenceCache.find(boost::this_thread::get_id());
-      if (i != m_sentenceCache.end()) return i->second;
+    if (m_sentenceCache.get() == NULL) {
+      m_sentenceCache.reset(new PhraseCache);
     }
-    boost::unique_lock<boost::shared_mutex> lock(m_lock_cache);
-    return m_sentenceCache[boost::this_thread::get_id()];
-#else
-    return m_sentenceCache;
-#endif
+    return *m_sentenceCache;
   }
 
   PhraseDictionary *FindPhraseDictionary(const std::string &ptName) const;
 
+  //! weights passed with the current sentence (mosesserver), per thread
 #ifdef WITH_THREADS
-  //reader-writer lock
-  mutable boost::shared_mutex m_lock_weights;
-  std::map<boost::thread::id, std::vector<float> > m_multimodelweights_tmp;
+  boost::thread_specific_ptr<std::vector<float> > m_multimodelweights_tmp;
 #else
-  std::vector<float> m_multimodelweights_tmp;
+  std::auto_ptr<std::vector<float> > m_multimodelweights_tmp;
+#endif
+
+  size_t m_lookupThreads;
+#ifdef WITH_THREADS
+  std::auto_ptr<ThreadPool> m_lookupPool;
 #endif
 };
 
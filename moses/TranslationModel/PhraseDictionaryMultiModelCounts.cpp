@@ -139,6 +139,7 @@ void PhraseDictionaryMultiModelCounts::Load()
     m_lexTable_f2e.push_back(f2e);
 
   }
+  CreateLookupPool();
 
   /*
 
@@ -247,16 +248,19 @@ const TargetPhraseCollection *PhraseDictionaryMultiModelCounts::GetTargetPhraseC
 void PhraseDictionaryMultiModelCounts::CollectSufficientStatistics(const Phrase& src, vector<float> &fs, map<string,multiModelCountsStatistics*>* allStats) const
 //fill fs and allStats with statistics from models
 {
+  vector<const TargetPhraseCollection*> collections;
+  LookupComponents(src, collections);
+
   for(size_t i = 0; i < m_numModels; ++i) {
     const PhraseDictionary &pd = *m_pd[i];
 
-    TargetPhraseCollection *ret_raw = (TargetPhraseCollection*)  pd.GetTargetPhraseCollection( src);
+    const TargetPhraseCollection *ret_raw = collections[i];
     if (ret_raw != NULL) {
 
-      TargetPhraseCollection::iterator iterTargetPhrase;
+      TargetPhraseCollection::const_iterator iterTargetPhrase;
       for (iterTargetPhrase = ret_raw->begin(); iterTargetPhrase != ret_raw->end();  ++iterTargetPhrase) {
 
-        TargetPhrase * targetPhrase = *iterTargetPhrase;
+        const TargetPhrase * targetPhrase = *iterTargetPhrase;
         vector<float> raw_scores = targetPhrase->GetScoreBreakdown().GetScoresForProducer(&pd);
 
         string targetString = targetPhrase->GetStringRep(m_output);
@@ -0,0 +1,85 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include "TranslationOptionCache.h"
+#include "TranslationOption.h"
+
+namespace Moses
+{
+
+TranslationOptionCache::Entry TranslationOptionCache::Find(size_t graphPos
+    , const std::string &weightSetting, const Phrase &sourcePhrase)
+{
+  const Key key(graphPos, weightSetting, sourcePhrase);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  Map::iterator iter = m_map.find(key);
+  if (iter == m_map.end()) {
+    return Entry();
+  }
+  m_recency.splice(m_recency.begin(), m_recency, iter->second.m_used);
+  return iter->second.m_transOptList;
+}
+
+void TranslationOptionCache::Add(size_t graphPos, const std::string &weightSetting
+                                 , const Phrase &sourcePhrase, const std::vector<TranslationOption*> &transOpts)
+{
+  if (m_maxSize == 0) return;
+
+  const Key key(graphPos, weightSetting, sourcePhrase);
+  // copy the options before taking the lock
+  TranslationOptionList *transOptList = new TranslationOptionList;
+  std::vector<TranslationOption*>::const_iterator iter;
+  for (iter = transOpts.begin(); iter != transOpts.end(); ++iter) {
+    transOptList->Add(new TranslationOption(**iter));
+  }
+  Entry entry(transOptList);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  Map::iterator found = m_map.find(key);
+  if (found != m_map.end()) {
+    // another thread got there first
+    found->second.m_transOptList = entry;
+    m_recency.splice(m_recency.begin(), m_recency, found->second.m_used);
+    return;
+  }
+
+  m_recency.push_front(key);
+  Value &value = m_map[key];
+  value.m_transOptList = entry;
+  value.m_used = m_recency.begin();
+
+  while (m_map.size() > m_maxSize) {
+    m_map.erase(m_recency.back());
+    m_recency.pop_back();
+  }
+}
+
+void TranslationOptionCache::Clear()
+{
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_mutex);
+#endif
+  m_map.clear();
+  m_recency.clear();
+}
+
+}
@@ -0,0 +1,116 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_TranslationOptionCache_h
+#define moses_TranslationOptionCache_h
+
+#include <list>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+#ifdef WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+#include "Phrase.h"
+#include "TranslationOptionList.h"
+
+namespace Moses
+{
+
+class TranslationOption;
+
+/** Persistent (cross-sentence) cache of the translation options of source
+ * phrases, see use-persistent-cache.
+ *
+ * Entries hold the options as they come out of the decoding graph, scored
+ * by the phrase and generation tables and by the stateless features that
+ * only look at the phrase pair. Features that depend on the input sentence
+ * are applied later to every copy, so cached options can be reused in any
+ * sentence. At most max-size entries are kept; the least recently used
+ * ones are dropped first. Lookups hand out shared pointers, so an entry
+ * that is evicted or cleared stays valid for whoever is still copying it.
+ */
+class TranslationOptionCache
+{
+public:
+  typedef boost::shared_ptr<const TranslationOptionList> Entry;
+
+  TranslationOptionCache() : m_maxSize(0) {}
+
+  void SetMaxSize(size_t maxSize) {
+    m_maxSize = maxSize;
+  }
+
+  //! options of sourcePhrase in decoding graph graphPos under weightSetting, or an empty pointer
+  Entry Find(size_t graphPos, const std::string &weightSetting, const Phrase &sourcePhrase);
+  //! store copies of the options a decoding graph produced for sourcePhrase
+  void Add(size_t graphPos, const std::string &weightSetting, const Phrase &sourcePhrase
+           , const std::vector<TranslationOption*> &transOpts);
+  //! drop all entries, e.g. because the weights have changed
+  void Clear();
+
+private:
+  struct Key {
+    Key(size_t graphPos, const std::string &weightSetting, const Phrase &sourcePhrase)
+      : m_graphPos(graphPos), m_weightSetting(weightSetting), m_sourcePhrase(sourcePhrase) {}
+
+    bool operator==(const Key &other) const {
+      return m_graphPos == other.m_graphPos
+             && m_weightSetting == other.m_weightSetting
+             && m_sourcePhrase == other.m_sourcePhrase;
+    }
+
+    size_t m_graphPos;
+    std::string m_weightSetting;
+    Phrase m_sourcePhrase;
+  };
+
+  struct KeyHasher {
+    size_t operator()(const Key &key) const {
+      size_t seed = hash_value(key.m_sourcePhrase);
+      boost::hash_combine(seed, key.m_graphPos);
+      boost::hash_combine(seed, key.m_weightSetting);
+      return seed;
+    }
+  };
+
+  //! keys from most to least recently used
+  typedef std::list<Key> Recency;
+
+  struct Value {
+    Entry m_transOptList;
+    Recency::iterator m_used;
+  };
+
+  typedef boost::unordered_map<Key, Value, KeyHasher> Map;
+
+  Map m_map;
+  Recency m_recency;
+  size_t m_maxSize;
+#ifdef WITH_THREADS
+  boost::mutex m_mutex;
+#endif
+};
+
+}
+
+#endif
@@ -35,6 +35,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 #include "DecodeGraph.h"
 #include "moses/FF/UnknownWordPenaltyProducer.h"
 
+#ifdef WITH_THREADS
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include "ThreadPool.h"
+#endif
+
 using namespace std;
 
 namespace Moses
@@ -362,82 +369,181 @@ void TranslationOptionCollection::CreateTranslationOptions()
   // loop over all substrings of the source sentence, look them up
   // in the phraseDictionary (which is the- possibly filtered-- phrase
   // table loaded on initialization), generate TranslationOption objects
-  // for all phrases
+  // for all phrases. Spans are independent of each other, so with
+  // translation-option-threads they are looked up concurrently
+  const bool parallel = StaticData::Instance().GetTranslationOptionThreads() > 1;
+
+  ForEachSpan(&TranslationOptionCollection::CreateTranslationOptionsForSpan
+              , parallel && CanCreateInParallel());
+
+  VERBOSE(2,"Translation Option Collection\n " << *this << endl);
+
+  ProcessUnknownWord();
+
+  ForEachSpan(&TranslationOptionCollection::EvaluateWithSourceForSpan, parallel);
+
+  // Prune
+  Prune();
+
+  Sort();
 
+  // future score matrix
+  CalcFutureScore();
+
+  // Cached lex reodering costs
+  ForEachSpan(&TranslationOptionCollection::CacheLexReorderingForSpan
+              , parallel && CanCacheLexReorderingInParallel());
+}
+
+void TranslationOptionCollection::CreateTranslationOptionsForSpan(size_t startPos, size_t endPos)
+{
   // there may be multiple decoding graphs (factorizations of decoding)
   const vector <DecodeGraph*> &decodeGraphList = StaticData::Instance().GetDecodeGraphs();
   const vector <size_t> &decodeGraphBackoff = StaticData::Instance().GetDecodeGraphBackoff();
 
-  // length of the sentence
-  const size_t size = m_source.GetSize();
-
   // loop over all decoding graphs, each generates translation options
   for (size_t graphInd = 0 ; graphInd < decodeGraphList.size() ; graphInd++) {
-    if (decodeGraphList.size() > 1) {
-      VERBOSE(3,"Creating translation options from decoding graph " << graphInd << endl);
+    if (graphInd > 0 && // only skip subsequent graphs
+        decodeGraphBackoff[graphInd] != 0 && // use of backoff specified
+        (endPos-startPos+1 >= decodeGraphBackoff[graphInd] || // size exceeds backoff limit or ...
+         m_collection[startPos][endPos-startPos].size() > 0)) { // no phrases found so far
+      VERBOSE(3,"No backoff to graph " << graphInd << " for span [" << startPos << ";" << endPos << "]" << endl);
+      // do not create more options
+      continue;
     }
 
-    const DecodeGraph &decodeGraph = *decodeGraphList[graphInd];
-    // generate phrases that start at startPos ...
-    for (size_t startPos = 0 ; startPos < size; startPos++) {
-      size_t maxSize = size - startPos; // don't go over end of sentence
-      size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
-      maxSize = std::min(maxSize, maxSizePhrase);
-
-      // ... and that end at endPos
-      for (size_t endPos = startPos ; endPos < startPos + maxSize ; endPos++) {
-        if (graphInd > 0 && // only skip subsequent graphs
-            decodeGraphBackoff[graphInd] != 0 && // use of backoff specified
-            (endPos-startPos+1 >= decodeGraphBackoff[graphInd] || // size exceeds backoff limit or ...
-             m_collection[startPos][endPos-startPos].size() > 0)) { // no phrases found so far
-          VERBOSE(3,"No backoff to graph " << graphInd << " for span [" << startPos << ";" << endPos << "]" << endl);
-          // do not create more options
-          continue;
-        }
+    // create translation options for that range
+    CreateTranslationOptionsForRange(*decodeGraphList[graphInd], startPos, endPos, true, graphInd);
+  }
+}
 
-        // create translation options for that range
-        CreateTranslationOptionsForRange( decodeGraph, startPos, endPos, true, graphInd);
+bool TranslationOptionCollection::CanCreateInParallel() const
+{
+  const vector <DecodeGraph*> &decodeGraphList = StaticData::Instance().GetDecodeGraphs();
+  for (size_t graphInd = 0 ; graphInd < decodeGraphList.size() ; graphInd++) {
+    const DecodeGraph &decodeGraph = *decodeGraphList[graphInd];
+    list <const DecodeStep* >::const_iterator iterStep;
+    for (iterStep = decodeGraph.begin() ; iterStep != decodeGraph.end() ; ++iterStep) {
+      if (!(*iterStep)->GetDecodeFeature()->SupportsParallelLookup()) {
+        return false;
       }
     }
   }
+  return true;
+}
 
-  VERBOSE(2,"Translation Option Collection\n " << *this << endl);
+void TranslationOptionCollection::EvaluateWithSourceForSpan(size_t startPos, size_t endPos)
+{
+  TranslationOptionList &transOptList = GetTranslationOptionList(startPos, endPos);
 
-  ProcessUnknownWord();
+  TranslationOptionList::const_iterator iterTransOpt;
+  for(iterTransOpt = transOptList.begin() ; iterTransOpt != transOptList.end() ; ++iterTransOpt) {
+    TranslationOption &transOpt = **iterTransOpt;
+    transOpt.Evaluate(m_source);
+  }
+}
 
-  EvaluateWithSource();
+#ifdef WITH_THREADS
+/** spans not yet handed out by ForEachSpan(). The decoder thread and the
+ * helper tasks it submitted take spans from here until none are left; a
+ * helper that starts after that finds nothing to do and never touches the
+ * collection, which may be gone by then. */
+struct TranslationOptionCollection::SpanQueue {
+  SpanQueue(TranslationOptionCollection &collection, SpanFunction function)
+    : m_collection(collection), m_function(function), m_next(0), m_active(0) {}
+
+  void Work() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    ++m_active;
+    while (m_next < m_spans.size()) {
+      const WordsRange &span = m_spans[m_next++];
+      lock.unlock();
+      (m_collection.*m_function)(span.GetStartPos(), span.GetEndPos());
+      lock.lock();
+    }
+    if (--m_active == 0) {
+      m_done.notify_all();
+    }
+  }
 
-  // Prune
-  Prune();
+  //! wait until every span has been processed
+  void Wait() {
+    boost::mutex::scoped_lock lock(m_mutex);
+    while (m_next < m_spans.size() || m_active > 0) {
+      m_done.wait(lock);
+    }
+  }
 
-  Sort();
+  TranslationOptionCollection &m_collection;
+  SpanFunction m_function;
+  std::vector<WordsRange> m_spans;
+  size_t m_next, m_active;
+  boost::mutex m_mutex;
+  boost::condition_variable m_done;
+};
 
-  // future score matrix
-  CalcFutureScore();
+class TranslationOptionCollection::SpanTask : public Task
+{
+public:
+  SpanTask(boost::shared_ptr<SpanQueue> queue) : m_queue(queue) {}
+  void Run() {
+    m_queue->Work();
+  }
+private:
+  boost::shared_ptr<SpanQueue> m_queue;
+};
 
-  // Cached lex reodering costs
-  CacheLexReordering();
+namespace
+{
+boost::mutex s_spanPoolMutex;
+ThreadPool *s_spanPool = NULL;
+
+//! pool shared by all decoder threads, created on first use
+ThreadPool &GetSpanPool()
+{
+  boost::mutex::scoped_lock lock(s_spanPoolMutex);
+  if (s_spanPool == NULL) {
+    // the thread that asks for the options works on them too
+    s_spanPool = new ThreadPool(StaticData::Instance().GetTranslationOptionThreads() - 1);
+  }
+  return *s_spanPool;
+}
 }
+#endif
 
-void TranslationOptionCollection::EvaluateWithSource()
+void TranslationOptionCollection::ForEachSpan(SpanFunction function, bool parallel)
 {
   const size_t size = m_source.GetSize();
-  for (size_t startPos = 0 ; startPos < size ; ++startPos) {
-    size_t maxSize = m_source.GetSize() - startPos;
-    size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
-    maxSize = std::min(maxSize, maxSizePhrase);
-
-    for (size_t endPos = startPos ; endPos < startPos + maxSize ; ++endPos) {
-      TranslationOptionList &transOptList = GetTranslationOptionList(startPos, endPos);
-
-      TranslationOptionList::const_iterator iterTransOpt;
-      for(iterTransOpt = transOptList.begin() ; iterTransOpt != transOptList.end() ; ++iterTransOpt) {
-        TranslationOption &transOpt = **iterTransOpt;
-        transOpt.Evaluate(m_source);
+  const size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
+
+#ifdef WITH_THREADS
+  if (parallel && size > 1) {
+    boost::shared_ptr<SpanQueue> queue(new SpanQueue(*this, function));
+    for (size_t startPos = 0 ; startPos < size ; ++startPos) {
+      const size_t maxSize = std::min(size - startPos, maxSizePhrase);
+      for (size_t endPos = startPos ; endPos < startPos + maxSize ; ++endPos) {
+        queue->m_spans.push_back(WordsRange(startPos, endPos));
       }
     }
+
+    ThreadPool &pool = GetSpanPool();
+    const size_t helpers = std::min(StaticData::Instance().GetTranslationOptionThreads() - 1
+                                    , queue->m_spans.size() - 1);
+    for (size_t i = 0 ; i < helpers ; ++i) {
+      pool.Submit(new SpanTask(queue));
+    }
+    queue->Work();
+    queue->Wait();
+    return;
   }
+#endif
 
+  for (size_t startPos = 0 ; startPos < size ; ++startPos) {
+    const size_t maxSize = std::min(size - startPos, maxSizePhrase);
+    for (size_t endPos = startPos ; endPos < startPos + maxSize ; ++endPos) {
+      (this->*function)(startPos, endPos);
+    }
+  }
 }
 
 void TranslationOptionCollection::Sort()
@@ -481,9 +587,9 @@ void TranslationOptionCollection::CreateTranslationOptionsForRange(
       const WordsRange wordsRange(startPos, endPos);
       sourcePhrase = new Phrase(m_source.GetSubString(wordsRange));
 
-      const TranslationOptionList *transOptList = StaticData::Instance().FindTransOptListInCache(decodeGraph, *sourcePhrase);
+      TranslationOptionCache::Entry transOptList = StaticData::Instance().FindTransOptListInCache(decodeGraph, *sourcePhrase);
       // is phrase in cache?
-      if (transOptList != NULL) {
+      if (transOptList) {
         skipTransOptCreation = true;
         TranslationOptionList::const_iterator iterTransOpt;
         for (iterTransOpt = transOptList->begin() ; iterTransOpt != transOptList->end() ; ++iterTransOpt) {
@@ -546,10 +652,10 @@ void TranslationOptionCollection::CreateTranslationOptionsForRange(
       }
 
       // storing translation options in persistent cache (kept across sentences)
+      // (only what this graph produced, the span may already hold options of earlier graphs)
       if (useCache) {
         if (partTransOptList.size() > 0) {
-          TranslationOptionList &transOptList = GetTranslationOptionList(startPos, endPos);
-          StaticData::Instance().AddTransOptListToCache(decodeGraph, *sourcePhrase, transOptList);
+          StaticData::Instance().AddTransOptListToCache(decodeGraph, *sourcePhrase, partTransOptList);
         }
       }
 
@@ -636,41 +742,45 @@ const std::vector<Phrase*>& TranslationOptionCollection::GetUnknownSources() con
   return m_unksrcs;
 }
 
-void TranslationOptionCollection::CacheLexReordering()
+void TranslationOptionCollection::CacheLexReorderingForSpan(size_t startPos, size_t endPos)
 {
-  size_t size = m_source.GetSize();
-
   const std::vector<const StatefulFeatureFunction*> &ffs = StatefulFeatureFunction::GetStatefulFeatureFunctions();
   std::vector<const StatefulFeatureFunction*>::const_iterator iter;
   for (iter = ffs.begin(); iter != ffs.end(); ++iter) {
     const StatefulFeatureFunction &ff = **iter;
     if (typeid(ff) == typeid(LexicalReordering)) {
       const LexicalReordering &lexreordering = static_cast<const LexicalReordering&>(ff);
-      for (size_t startPos = 0 ; startPos < size ; startPos++) {
-        size_t maxSize =  size - startPos;
-        size_t maxSizePhrase = StaticData::Instance().GetMaxPhraseLength();
-        maxSize = std::min(maxSize, maxSizePhrase);
-
-        for (size_t endPos = startPos ; endPos < startPos + maxSize; endPos++) {
-          TranslationOptionList &transOptList = GetTranslationOptionList( startPos, endPos);
-          TranslationOptionList::iterator iterTransOpt;
-          for(iterTransOpt = transOptList.begin() ; iterTransOpt != transOptList.end() ; ++iterTransOpt) {
-            TranslationOption &transOpt = **iterTransOpt;
-            //Phrase sourcePhrase =  m_source.GetSubString(WordsRange(startPos,endPos));
-            const Phrase *sourcePhrase = transOpt.GetSourcePhrase();
-            if (sourcePhrase) {
-              Scores score = lexreordering.GetProb(*sourcePhrase
-                                                   , transOpt.GetTargetPhrase());
-              if (!score.empty())
-                transOpt.CacheLexReorderingScores(lexreordering, score);
-            } // if (sourcePhrase) {
-          } // for(iterTransOpt
-        } // for (size_t endPos = startPos ; endPos < startPos + maxSize; endPos++) {
-      } // for (size_t startPos = 0 ; startPos < size ; startPos++) {
+      TranslationOptionList &transOptList = GetTranslationOptionList( startPos, endPos);
+      TranslationOptionList::iterator iterTransOpt;
+      for(iterTransOpt = transOptList.begin() ; iterTransOpt != transOptList.end() ; ++iterTransOpt) {
+        TranslationOption &transOpt = **iterTransOpt;
+        //Phrase sourcePhrase =  m_source.GetSubString(WordsRange(startPos,endPos));
+        const Phrase *sourcePhrase = transOpt.GetSourcePhrase();
+        if (sourcePhrase) {
+          Scores score = lexreordering.GetProb(*sourcePhrase
+                                               , transOpt.GetTargetPhrase());
+          if (!score.empty())
+            transOpt.CacheLexReorderingScores(lexreordering, score);
+        } // if (sourcePhrase) {
+      } // for(iterTransOpt
     } // if (typeid(ff) == typeid(LexicalReordering)) {
   } // for (iter = ffs.begin(); iter != ffs.end(); ++iter) {
 }
 
+bool TranslationOptionCollection::CanCacheLexReorderingInParallel() const
+{
+  const std::vector<const StatefulFeatureFunction*> &ffs = StatefulFeatureFunction::GetStatefulFeatureFunctions();
+  std::vector<const StatefulFeatureFunction*>::const_iterator iter;
+  for (iter = ffs.begin(); iter != ffs.end(); ++iter) {
+    const StatefulFeatureFunction &ff = **iter;
+    if (typeid(ff) == typeid(LexicalReordering)
+        && !static_cast<const LexicalReordering&>(ff).SupportsParallelLookup()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 //! list of trans opt for a particular span
 TranslationOptionList &TranslationOptionCollection::GetTranslationOptionList(size_t startPos, size_t endPos)
 {
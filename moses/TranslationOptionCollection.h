@@ -92,9 +92,24 @@ protected:
   //! implemented by inherited class, called by this class
   virtual void ProcessUnknownWord(size_t sourcePos)=0;
 
-  void EvaluateWithSource();
-
-  void CacheLexReordering();
+  //! operation that ForEachSpan() applies to a span of the input
+  typedef void (TranslationOptionCollection::*SpanFunction)(size_t startPos, size_t endPos);
+  /** apply function to every span of the input. With parallel, the spans are
+   * shared out between this thread and the translation-option-threads pool;
+   * function may then only touch the translation option list of its span */
+  void ForEachSpan(SpanFunction function, bool parallel);
+  struct SpanQueue;
+  class SpanTask;
+
+  //! consult all decoding graphs for one span
+  void CreateTranslationOptionsForSpan(size_t startPos, size_t endPos);
+  void EvaluateWithSourceForSpan(size_t startPos, size_t endPos);
+  void CacheLexReorderingForSpan(size_t startPos, size_t endPos);
+
+  //! whether all tables of all decoding graphs may be consulted by several threads
+  bool CanCreateInParallel() const;
+  //! whether all lexical reordering tables may be consulted by several threads
+  bool CanCacheLexReorderingInParallel() const;
 
 public:
   virtual ~TranslationOptionCollection();
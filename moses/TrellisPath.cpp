@@ -172,14 +172,14 @@ void TrellisPath::CreateDeviantPaths(TrellisPathList &pathColl) const
   }
 }
 
-Phrase TrellisPath::GetTargetPhrase() const
+Phrase TrellisPath::GetTargetPhrase(const std::vector<const Hypothesis *> &path)
 {
   Phrase targetPhrase(ARRAY_SIZE_INCR);
 
-  int numHypo = (int) m_path.size();
+  int numHypo = (int) path.size();
   for (int node = numHypo - 2 ; node >= 0 ; --node) {
     // don't do the empty hypo - waste of time and decode step id is invalid
-    const Hypothesis &hypo = *m_path[node];
+    const Hypothesis &hypo = *path[node];
     const Phrase &currTargetPhrase = hypo.GetCurrTargetPhrase();
 
     targetPhrase.Append(currTargetPhrase);
@@ -188,10 +188,10 @@ Phrase TrellisPath::GetTargetPhrase() const
   return targetPhrase;
 }
 
-Phrase TrellisPath::GetSurfacePhrase() const
+Phrase TrellisPath::GetSurfacePhrase(const std::vector<const Hypothesis *> &path)
 {
   const std::vector<FactorType> &outputFactor = StaticData::Instance().GetOutputFactorOrder();
-  Phrase targetPhrase = GetTargetPhrase()
+  Phrase targetPhrase = GetTargetPhrase(path)
                         ,ret(targetPhrase.GetSize());
 
   for (size_t pos = 0 ; pos < targetPhrase.GetSize() ; ++pos) {
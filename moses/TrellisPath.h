@@ -43,6 +43,7 @@ class TrellisPath
 {
   friend std::ostream& operator<<(std::ostream&, const TrellisPath&);
   friend class Manager;
+  friend class TrellisPathExtractor;
 
 protected:
   std::vector<const Hypothesis *> m_path; //< list of hypotheses/arcs
@@ -53,7 +54,7 @@ protected:
   ScoreComponentCollection	m_scoreBreakdown;
   float m_totalScore;
 
-  //Used by Manager::LatticeSample()
+  //Used by Manager::LatticeSample() and TrellisPathExtractor
   TrellisPath(const std::vector<const Hypothesis*> edges);
 
   void InitScore();
@@ -98,8 +99,16 @@ public:
   //! get target words range of the hypo within n-best trellis. not necessarily the same as hypo.GetCurrTargetWordsRange()
   WordsRange GetTargetWordsRange(const Hypothesis &hypo) const;
 
-  Phrase GetTargetPhrase() const;
-  Phrase GetSurfacePhrase() const;
+  Phrase GetTargetPhrase() const {
+    return GetTargetPhrase(m_path);
+  }
+  Phrase GetSurfacePhrase() const {
+    return GetSurfacePhrase(m_path);
+  }
+
+  //! target and surface phrase of the path with edges path, final hypothesis first
+  static Phrase GetTargetPhrase(const std::vector<const Hypothesis *> &path);
+  static Phrase GetSurfacePhrase(const std::vector<const Hypothesis *> &path);
 
   TO_STRING();
 
@@ -0,0 +1,136 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#include <algorithm>
+#include "TrellisPathExtractor.h"
+#include "TrellisPath.h"
+#include "TrellisPathList.h"
+
+using namespace std;
+
+namespace Moses
+{
+
+TrellisPathExtractor::TrellisPathExtractor(const vector<const Hypothesis*> &finalHypos)
+  : m_finalHypos(finalHypos)
+  , m_queued(0)
+{
+  if (!m_finalHypos.empty()) {
+    Push(m_finalHypos[0]->GetTotalScore(), NOT_FOUND, 0, 0);
+  }
+}
+
+void TrellisPathExtractor::Push(float score, size_t parent, size_t deviation, size_t rank)
+{
+  Candidate candidate;
+  candidate.score = score;
+  candidate.order = m_queued++;
+  candidate.parent = parent;
+  candidate.deviation = deviation;
+  candidate.rank = rank;
+  m_queue.push(candidate);
+}
+
+const vector<const Hypothesis*> &TrellisPathExtractor::GetSortedArcs(const Hypothesis &hypo)
+{
+  std::pair<boost::unordered_map<const Hypothesis*, vector<const Hypothesis*> >::iterator, bool> inserted
+  = m_sortedArcs.insert(make_pair(&hypo, vector<const Hypothesis*>()));
+  vector<const Hypothesis*> &arcs = inserted.first->second;
+  if (inserted.second) {
+    const ArcList &arcList = *hypo.GetArcList();
+    arcs.assign(arcList.begin(), arcList.end());
+    stable_sort(arcs.begin(), arcs.end(), CompareHypothesisTotalScore());
+  }
+  return arcs;
+}
+
+void TrellisPathExtractor::FindDeviations(Path &path, size_t firstEdge)
+{
+  for (size_t edge = firstEdge ; edge < path.edges.size() ; ++edge) {
+    const Hypothesis &hypo = *path.edges[edge];
+    if (!hypo.GetArcList() || hypo.GetArcList()->empty()) continue;
+
+    Deviation deviation;
+    deviation.edge = edge;
+    deviation.arcs = &GetSortedArcs(hypo);
+    deviation.bestDelta = deviation.arcs->front()->GetTotalScore() - hypo.GetTotalScore();
+    path.deviations.push_back(deviation);
+  }
+  stable_sort(path.deviations.begin(), path.deviations.end());
+}
+
+size_t TrellisPathExtractor::Pop()
+{
+  const Candidate candidate = m_queue.top();
+  m_queue.pop();
+
+  const size_t index = m_paths.size();
+  m_paths.push_back(Path());
+  Path &path = m_paths.back();
+  path.score = candidate.score;
+
+  const Hypothesis *hypo;
+  size_t firstEdge;
+  if (candidate.parent == NOT_FOUND) {
+    // a final hypothesis and its back-pointers
+    hypo = m_finalHypos[candidate.deviation];
+    firstEdge = 0;
+    if (candidate.deviation + 1 < m_finalHypos.size()) {
+      Push(m_finalHypos[candidate.deviation + 1]->GetTotalScore(), NOT_FOUND, candidate.deviation + 1, 0);
+    }
+  } else {
+    // the parent up to the changed edge, then the arc and its back-pointers
+    const Path &parent = m_paths[candidate.parent];
+    const Deviation &deviation = parent.deviations[candidate.deviation];
+    path.edges.assign(parent.edges.begin(), parent.edges.begin() + deviation.edge);
+    hypo = (*deviation.arcs)[candidate.rank];
+    firstEdge = deviation.edge + 1;
+
+    // next best arc of this edge
+    const float parentScoreAtEdge = parent.score - parent.edges[deviation.edge]->GetTotalScore();
+    if (candidate.rank + 1 < deviation.arcs->size()) {
+      Push(parentScoreAtEdge + (*deviation.arcs)[candidate.rank + 1]->GetTotalScore()
+           , candidate.parent, candidate.deviation, candidate.rank + 1);
+    }
+    // best arc of the next edge
+    if (candidate.rank == 0 && candidate.deviation + 1 < parent.deviations.size()) {
+      Push(parent.score + parent.deviations[candidate.deviation + 1].bestDelta
+           , candidate.parent, candidate.deviation + 1, 0);
+    }
+  }
+
+  while (hypo != NULL) {
+    path.edges.push_back(hypo);
+    hypo = hypo->GetPrevHypo();
+  }
+
+  FindDeviations(path, firstEdge);
+  if (!path.deviations.empty()) {
+    Push(path.score + path.deviations[0].bestDelta, index, 0, 0);
+  }
+  return index;
+}
+
+void TrellisPathExtractor::Extract(size_t path, TrellisPathList &ret) const
+{
+  const vector<const Hypothesis*> &edges = m_paths[path].edges;
+  ret.Add(new TrellisPath(vector<const Hypothesis*>(edges.rbegin(), edges.rend())));
+}
+
+}
@@ -0,0 +1,115 @@
+/***********************************************************************
+Moses - factored phrase-based language decoder
+Copyright (C) 2006 University of Edinburgh
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+***********************************************************************/
+
+#ifndef moses_TrellisPathExtractor_h
+#define moses_TrellisPathExtractor_h
+
+#include <queue>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include "Hypothesis.h"
+
+namespace Moses
+{
+
+class TrellisPathList;
+
+/** Lazy k-best enumeration over the search lattice, used by
+ * Manager::CalcNBest().
+ *
+ * Paths are the same as those of TrellisPath::CreateDeviantPaths(): a path
+ * replaces one edge after the edge its parent changed by an arc of that
+ * edge, and follows back-pointers from there. Instead of creating every
+ * deviation of a popped path, only its best one is queued. A queued
+ * deviation brings in the next best arc of the same edge and, if it is the
+ * best arc, the best arc of the next edge, once it is popped. Arc lists are
+ * sorted once, candidates are a parent index, an edge and an arc rank, and
+ * TrellisPath objects with their score breakdown are only built for the
+ * paths that are returned.
+ */
+class TrellisPathExtractor
+{
+public:
+  //! finalHypos are the hypotheses of the last stack, best first
+  TrellisPathExtractor(const std::vector<const Hypothesis*> &finalHypos);
+
+  //! whether there are paths left
+  bool Empty() const {
+    return m_queue.empty();
+  }
+
+  //! remove the next best path, return its index for GetEdges() and Extract()
+  size_t Pop();
+
+  //! hypotheses and arcs of a popped path, final hypothesis first
+  const std::vector<const Hypothesis*> &GetEdges(size_t path) const {
+    return m_paths[path].edges;
+  }
+
+  //! add a popped path to ret, with its score breakdown
+  void Extract(size_t path, TrellisPathList &ret) const;
+
+private:
+  //! an edge of a popped path that can be replaced by one of arcs
+  struct Deviation {
+    size_t edge;
+    const std::vector<const Hypothesis*> *arcs;
+    float bestDelta;
+
+    bool operator<(const Deviation &other) const {
+      return bestDelta > other.bestDelta;
+    }
+  };
+
+  struct Path {
+    std::vector<const Hypothesis*> edges;
+    float score;
+    //! edges after the one this path changed, best deviation first
+    std::vector<Deviation> deviations;
+  };
+
+  /** a path not popped yet: the final hypothesis of index deviation, or
+   * parent with deviations[deviation].edge replaced by the arc of rank rank */
+  struct Candidate {
+    float score;
+    size_t order;
+    size_t parent;
+    size_t deviation;
+    size_t rank;
+
+    //! for the priority queue: best score, and first queued among equal scores, on top
+    bool operator<(const Candidate &other) const {
+      return score < other.score || (score == other.score && order > other.order);
+    }
+  };
+
+  const std::vector<const Hypothesis*> &m_finalHypos;
+  std::vector<Path> m_paths;
+  std::priority_queue<Candidate> m_queue;
+  size_t m_queued;
+  boost::unordered_map<const Hypothesis*, std::vector<const Hypothesis*> > m_sortedArcs;
+
+  void Push(float score, size_t parent, size_t deviation, size_t rank);
+  const std::vector<const Hypothesis*> &GetSortedArcs(const Hypothesis &hypo);
+  void FindDeviations(Path &path, size_t firstEdge);
+};
+
+}
+
+#endif
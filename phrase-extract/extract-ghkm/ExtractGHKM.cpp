@@ -31,11 +31,17 @@
 #include "ScfgRuleWriter.h"
 #include "Span.h"
 #include "XmlTreeParser.h"
+#include "moses/ThreadPool.h"
 
 #include <boost/program_options.hpp>
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
 
 #include <cassert>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -48,6 +54,74 @@ namespace Moses
 namespace GHKM
 {
 
+// A block of consecutive sentence pairs and everything extracted from them.
+// Blocks are processed independently and their results are written out in
+// input order.
+struct ExtractGHKM::SentenceBlock {
+  SentenceBlock(size_t lineNum) : firstLineNum(lineNum), done(false) {}
+
+  // Input
+  size_t firstLineNum;
+  std::vector<std::string> targetLines;
+  std::vector<std::string> sourceLines;
+  std::vector<std::string> alignmentLines;
+
+  // Output
+  std::ostringstream fwdExtract;
+  std::ostringstream invExtract;
+  std::ostringstream log;
+  std::string error;
+  std::set<std::string> labelSet;
+  std::map<std::string, int> topLabelSet;
+  std::map<std::string, int> wordCount;
+  std::map<std::string, std::string> wordLabel;
+
+  bool done;
+#ifdef WITH_THREADS
+  boost::mutex mutex;
+  boost::condition_variable cond;
+#endif
+};
+
+namespace
+{
+
+// Number of sentence pairs per block when extracting with several threads.
+const size_t kBlockSize = 100;
+
+// Runs ExtractGHKM::ProcessBlock on a worker thread.  The block is owned by
+// the main thread, which waits on the block's condition variable.
+class BlockTask : public Moses::Task
+{
+public:
+  BlockTask(const ExtractGHKM &extractor, const Options &options,
+            ExtractGHKM::SentenceBlock &block)
+    : m_extractor(extractor)
+    , m_options(options)
+    , m_block(block) {}
+
+  void Run();
+
+private:
+  const ExtractGHKM &m_extractor;
+  const Options &m_options;
+  ExtractGHKM::SentenceBlock &m_block;
+};
+
+}  // namespace
+
+void BlockTask::Run()
+{
+  m_extractor.ProcessBlock(m_options, m_block);
+#ifdef WITH_THREADS
+  boost::mutex::scoped_lock lock(m_block.mutex);
+  m_block.done = true;
+  m_block.cond.notify_all();
+#else
+  m_block.done = true;
+#endif
+}
+
 int ExtractGHKM::Main(int argc, char *argv[])
 {
   // Process command-line options.
@@ -87,30 +161,130 @@ int ExtractGHKM::Main(int argc, char *argv[])
   std::map<std::string, int> wordCount;
   std::map<std::string, std::string> wordLabel;
 
+  // With several threads, blocks of sentences are extracted by a thread
+  // pool while this thread reads the input and writes finished blocks in
+  // order.  At most 2 * threads blocks are in flight.
+#ifdef WITH_THREADS
+  std::auto_ptr<ThreadPool> pool;
+  if (options.threads > 1) {
+    pool.reset(new ThreadPool(options.threads));
+  }
+  const size_t blockSize = pool.get() ? kBlockSize : 1;
+  const size_t maxPending = 2 * options.threads;
+#else
+  const size_t blockSize = 1;
+  const size_t maxPending = 1;
+#endif
+  std::deque<SentenceBlock *> pending;
+
   std::string targetLine;
   std::string sourceLine;
   std::string alignmentLine;
-  XmlTreeParser xmlTreeParser(labelSet, topLabelSet);
-  ScfgRuleWriter writer(fwdExtractStream, invExtractStream, options);
   size_t lineNum = options.sentenceOffset;
-  while (true) {
-    std::getline(targetStream, targetLine);
-    std::getline(sourceStream, sourceLine);
-    std::getline(alignmentStream, alignmentLine);
+  bool eof = false;
+  while (!eof || !pending.empty()) {
+    // Read the next block.
+    if (!eof) {
+      std::auto_ptr<SentenceBlock> block(new SentenceBlock(lineNum + 1));
+      while (block->targetLines.size() < blockSize) {
+        std::getline(targetStream, targetLine);
+        std::getline(sourceStream, sourceLine);
+        std::getline(alignmentStream, alignmentLine);
+
+        if (targetStream.eof() && sourceStream.eof() && alignmentStream.eof()) {
+          eof = true;
+          break;
+        }
 
-    if (targetStream.eof() && sourceStream.eof() && alignmentStream.eof()) {
-      break;
+        if (targetStream.eof() || sourceStream.eof() || alignmentStream.eof()) {
+          Error("Files must contain same number of lines");
+        }
+
+        ++lineNum;
+        block->targetLines.push_back(targetLine);
+        block->sourceLines.push_back(sourceLine);
+        block->alignmentLines.push_back(alignmentLine);
+      }
+      if (!block->targetLines.empty()) {
+        SentenceBlock *b = block.release();
+        pending.push_back(b);
+        bool submitted = false;
+#ifdef WITH_THREADS
+        if (pool.get()) {
+          pool->Submit(new BlockTask(*this, options, *b));
+          submitted = true;
+        }
+#endif
+        if (!submitted) {
+          ProcessBlock(options, *b);
+          b->done = true;
+        }
+      }
+      if (pending.size() < maxPending && !eof) {
+        continue;
+      }
     }
 
-    if (targetStream.eof() || sourceStream.eof() || alignmentStream.eof()) {
-      Error("Files must contain same number of lines");
+    // Write the oldest block.
+    if (pending.empty()) {
+      break;
     }
+    std::auto_ptr<SentenceBlock> block(pending.front());
+    pending.pop_front();
+#ifdef WITH_THREADS
+    {
+      boost::mutex::scoped_lock lock(block->mutex);
+      while (!block->done) {
+        block->cond.wait(lock);
+      }
+    }
+#endif
+    std::cerr << block->log.str();
+    if (!block->error.empty()) {
+      Error(block->error);
+    }
+    fwdExtractStream << block->fwdExtract.str();
+    invExtractStream << block->invExtract.str();
+    labelSet.insert(block->labelSet.begin(), block->labelSet.end());
+    for (std::map<std::string, int>::const_iterator p = block->topLabelSet.begin();
+         p != block->topLabelSet.end(); ++p) {
+      topLabelSet[p->first] += p->second;
+    }
+    for (std::map<std::string, int>::const_iterator p = block->wordCount.begin();
+         p != block->wordCount.end(); ++p) {
+      wordCount[p->first] += p->second;
+    }
+    for (std::map<std::string, std::string>::const_iterator p = block->wordLabel.begin();
+         p != block->wordLabel.end(); ++p) {
+      wordLabel[p->first] = p->second;
+    }
+  }
+
+  if (!options.glueGrammarFile.empty()) {
+    WriteGlueGrammar(labelSet, topLabelSet, glueGrammarStream);
+  }
+
+  if (!options.unknownWordFile.empty()) {
+    WriteUnknownWordLabel(wordCount, wordLabel, options, unknownWordStream);
+  }
+
+  return 0;
+}
 
-    ++lineNum;
+void ExtractGHKM::ProcessBlock(const Options &options,
+                               SentenceBlock &block) const
+{
+  XmlTreeParser xmlTreeParser(block.labelSet, block.topLabelSet);
+  ScfgRuleWriter writer(block.fwdExtract, block.invExtract, options);
+  for (size_t i = 0; i < block.targetLines.size(); ++i) {
+    const size_t lineNum = block.firstLineNum + i;
+    const std::string &targetLine = block.targetLines[i];
+    const std::string &sourceLine = block.sourceLines[i];
+    const std::string &alignmentLine = block.alignmentLines[i];
 
     // Parse target tree.
     if (targetLine.size() == 0) {
-      std::cerr << "skipping line " << lineNum << " with empty target tree\n";
+      block.log << "skipping line " << lineNum << " with empty target tree\n";
       continue;
     }
     std::auto_ptr<ParseTree> t;
@@ -123,7 +297,8 @@ int ExtractGHKM::Main(int argc, char *argv[])
       if (!e.GetMsg().empty()) {
         s << ": " << e.GetMsg();
       }
-      Error(s.str());
+      block.error = s.str();
+      return;
     }
 
     // Read source tokens.
@@ -137,16 +312,17 @@ int ExtractGHKM::Main(int argc, char *argv[])
       std::ostringstream s;
       s << "Failed to read alignment at line " << lineNum << ": ";
       s << e.GetMsg();
-      Error(s.str());
+      block.error = s.str();
+      return;
     }
     if (alignment.size() == 0) {
-      std::cerr << "skipping line " << lineNum << " without alignment points\n";
+      block.log << "skipping line " << lineNum << " without alignment points\n";
       continue;
     }
 
     // Record word counts.
     if (!options.unknownWordFile.empty()) {
-      CollectWordLabelCounts(*t, options, wordCount, wordLabel);
+      CollectWordLabelCounts(*t, options, block.wordCount, block.wordLabel);
     }
 
     // Form an alignment graph from the target tree, source words, and
@@ -176,16 +352,6 @@ int ExtractGHKM::Main(int argc, char *argv[])
       }
     }
   }
-
-  if (!options.glueGrammarFile.empty()) {
-    WriteGlueGrammar(labelSet, topLabelSet, glueGrammarStream);
-  }
-
-  if (!options.unknownWordFile.empty()) {
-    WriteUnknownWordLabel(wordCount, wordLabel, options, unknownWordStream);
-  }
-
-  return 0;
 }
 
 void ExtractGHKM::OpenInputFileOrDie(const std::string &filename,
@@ -294,6 +460,9 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
   ("SentenceOffset",
    po::value(&options.sentenceOffset)->default_value(options.sentenceOffset),
    "set sentence number offset if processing split corpus")
+  ("Threads",
+   po::value(&options.threads)->default_value(options.threads),
+   "set number of extraction threads")
   ("UnknownWordLabel",
    po::value(&options.unknownWordFile),
    "write unknown word labels to named file")
@@ -388,6 +557,10 @@ void ExtractGHKM::ProcessOptions(int argc, char *argv[],
   if (vm.count("UnpairedExtractFormat")) {
     options.unpairedExtractFormat = true;
   }
+
+  if (options.threads < 1) {
+    Error("number of threads must be at least 1");
+  }
 }
 
 void ExtractGHKM::Error(const std::string &msg) const
@@ -396,7 +569,7 @@ void ExtractGHKM::Error(const std::string &msg) const
   std::exit(1);
 }
 
-std::vector<std::string> ExtractGHKM::ReadTokens(const std::string &s)
+std::vector<std::string> ExtractGHKM::ReadTokens(const std::string &s) const
 {
   std::vector<std::string> tokens;
 
@@ -462,7 +635,7 @@ void ExtractGHKM::CollectWordLabelCounts(
   ParseTree &root,
   const Options &options,
   std::map<std::string, int> &wordCount,
-  std::map<std::string, std::string> &wordLabel)
+  std::map<std::string, std::string> &wordLabel) const
 {
   std::vector<const ParseTree*> leaves;
   root.GetLeaves(std::back_inserter(leaves));
@@ -46,6 +46,13 @@ public:
     return m_name;
   }
   int Main(int argc, char *argv[]);
+
+  struct SentenceBlock;
+
+  // Extracts the rules of a block of sentence pairs.  Safe to call
+  // concurrently for different blocks.
+  void ProcessBlock(const Options &, SentenceBlock &) const;
+
 private:
   void Error(const std::string &) const;
   void OpenInputFileOrDie(const std::string &, std::ifstream &);
@@ -55,7 +62,7 @@ private:
   void CollectWordLabelCounts(ParseTree &,
                               const Options &,
                               std::map<std::string, int> &,
-                              std::map<std::string, std::string> &);
+                              std::map<std::string, std::string> &) const;
   void WriteUnknownWordLabel(const std::map<std::string, int> &,
                              const std::map<std::string, std::string> &,
                              const Options &,
@@ -63,7 +70,7 @@ private:
   void WriteGlueGrammar(const std::set<std::string> &,
                         const std::map<std::string, int> &,
                         std::ostream &);
-  std::vector<std::string> ReadTokens(const std::string &);
+  std::vector<std::string> ReadTokens(const std::string &) const;
 
   void ProcessOptions(int, char *[], Options &) const;
 
@@ -41,6 +41,7 @@ public:
     , minimal(false)
     , pcfg(false)
     , sentenceOffset(0)
+    , threads(1)
     , unpairedExtractFormat(false)
     , unknownWordMinRelFreq(0.03f)
     , unknownWordUniform(false) {}
@@ -63,6 +64,7 @@ public:
   bool minimal;
   bool pcfg;
   int sentenceOffset;
+  int threads;
   bool unpairedExtractFormat;
   std::string unknownWordFile;
   float unknownWordMinRelFreq;
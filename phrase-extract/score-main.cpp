@@ -26,8 +26,14 @@
 #include <assert.h>
 #include <cstring>
 #include <set>
+#include <deque>
 #include <algorithm>
 
+#ifdef WITH_THREADS
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#endif
+
 #include "SafeGetline.h"
 #include "ScoreFeature.h"
 #include "tables-core.h"
@@ -36,6 +42,7 @@
 #include "score.h"
 #include "InputFileStream.h"
 #include "OutputFileStream.h"
+#include "moses/ThreadPool.h"
 
 using namespace std;
 using namespace MosesTraining;
@@ -62,9 +69,22 @@ bool unalignedFWFlag = false;
 bool outputNTLengths = false;
 bool singletonFeature = false;
 bool crossedNonTerm = false;
-int countOfCounts[COC_MAX+1];
-int totalDistinct = 0;
 float minCountHierarchical = 0;
+WORD_ID nullWord = 0;
+
+// count of count statistics for Good Turing and Kneser Ney discounting
+struct CountOfCounts {
+  CountOfCounts() : totalDistinct(0) {
+    std::fill(counts, counts+COC_MAX+1, 0);
+  }
+  void add(const CountOfCounts &other) {
+    totalDistinct += other.totalDistinct;
+    for(int i=1; i<=COC_MAX; i++) counts[i] += other.counts[i];
+  }
+  int counts[COC_MAX+1];
+  int totalDistinct;
+};
+CountOfCounts countOfCounts;
 
 Vocabulary vcbT;
 Vocabulary vcbS;
@@ -74,9 +94,9 @@ Vocabulary vcbS;
 vector<string> tokenize( const char [] );
 
 void writeCountOfCounts( const string &fileNameCountOfCounts );
-void processPhrasePairs( vector< PhraseAlignment > & , ostream &phraseTableFile, bool isSingleton, const ScoreFeatureManager& featureManager, const MaybeLog& maybeLog);
+void processPhrasePairs( vector< PhraseAlignment > & , ostream &phraseTableFile, bool isSingleton, const ScoreFeatureManager& featureManager, const MaybeLog& maybeLog, CountOfCounts &coc );
 const PhraseAlignment &findBestAlignment(const PhraseAlignmentCollection &phrasePair );
-void outputPhrasePair(const PhraseAlignmentCollection &phrasePair, float, int, ostream &phraseTableFile, bool isSingleton, const ScoreFeatureManager& featureManager, const MaybeLog& maybeLog );
+void outputPhrasePair(const PhraseAlignmentCollection &phrasePair, float, int, ostream &phraseTableFile, bool isSingleton, const ScoreFeatureManager& featureManager, const MaybeLog& maybeLog, CountOfCounts &coc );
 double computeLexicalTranslation( const PHRASE &, const PHRASE &, const PhraseAlignment & );
 double computeUnalignedPenalty( const PHRASE &, const PHRASE &, const PhraseAlignment & );
 set<string> functionWordList;
@@ -88,6 +108,148 @@ void calcNTLengthProb(const vector< PhraseAlignment* > &phrasePairs
 void printSourcePhrase(const PHRASE &, const PHRASE &, const PhraseAlignment &, ostream &);
 void printTargetPhrase(const PHRASE &, const PHRASE &, const PhraseAlignment &, ostream &);
 
+namespace
+{
+
+// Number of phrase pairs after which a block is handed to a worker thread.
+const size_t BLOCK_PHRASE_PAIRS = 10000;
+
+// Consecutive groups of phrase pairs with the same source phrase, scored
+// together by one thread, and the scored phrase table lines.
+struct ScoreBlock {
+  ScoreBlock() : numPhrasePairs(0), done(false) {}
+
+  std::deque< vector< PhraseAlignment > > phrasePairs;
+  vector< bool > isSingleton;
+  size_t numPhrasePairs;
+
+  ostringstream out;
+  CountOfCounts countOfCounts;
+  bool done;
+#ifdef WITH_THREADS
+  boost::mutex mutex;
+  boost::condition_variable cond;
+#endif
+};
+
+class ScoreBlockTask : public Moses::Task
+{
+public:
+  ScoreBlockTask(ScoreBlock &block, const ScoreFeatureManager &featureManager, const MaybeLog &maybeLogProb)
+    : m_block(block), m_featureManager(featureManager), m_maybeLogProb(maybeLogProb) {}
+
+  void Run() {
+    for(size_t i=0; i<m_block.phrasePairs.size(); i++) {
+      processPhrasePairs( m_block.phrasePairs[i], m_block.out, m_block.isSingleton[i], m_featureManager, m_maybeLogProb, m_block.countOfCounts );
+    }
+#ifdef WITH_THREADS
+    boost::mutex::scoped_lock lock(m_block.mutex);
+    m_block.done = true;
+    m_block.cond.notify_all();
+#else
+    m_block.done = true;
+#endif
+  }
+
+private:
+  ScoreBlock &m_block;
+  const ScoreFeatureManager &m_featureManager;
+  const MaybeLog &m_maybeLogProb;
+};
+
+// Scores the groups of phrase pairs with the same source phrase in the order
+// they are read.  With several threads, groups are collected into blocks that
+// are scored by a thread pool, and the finished blocks are written in input
+// order, so the phrase table is the same as with one thread.
+class ScorePipeline
+{
+public:
+  ScorePipeline(int threads, ostream &phraseTableFile, const ScoreFeatureManager &featureManager, const MaybeLog &maybeLogProb)
+    : m_phraseTableFile(phraseTableFile)
+    , m_featureManager(featureManager)
+    , m_maybeLogProb(maybeLogProb)
+    , m_maxPending(2*threads) {
+#ifdef WITH_THREADS
+    if (threads > 1) {
+      m_pool.reset(new Moses::ThreadPool(threads));
+    }
+#endif
+  }
+
+  ~ScorePipeline() {
+    while (!m_pending.empty()) {
+      delete m_pending.front();
+      m_pending.pop_front();
+    }
+  }
+
+  // score a group of phrase pairs, taking over its content
+  void Add(vector< PhraseAlignment > &phrasePairs, bool isSingleton) {
+    if (phrasePairs.empty()) return;
+#ifdef WITH_THREADS
+    if (m_pool.get()) {
+      if (!m_block.get()) m_block.reset(new ScoreBlock());
+      m_block->phrasePairs.push_back(vector< PhraseAlignment >());
+      m_block->phrasePairs.back().swap(phrasePairs);
+      m_block->isSingleton.push_back(isSingleton);
+      m_block->numPhrasePairs += m_block->phrasePairs.back().size();
+      if (m_block->numPhrasePairs >= BLOCK_PHRASE_PAIRS) {
+        SubmitBlock();
+      }
+      return;
+    }
+#endif
+    processPhrasePairs( phrasePairs, m_phraseTableFile, isSingleton, m_featureManager, m_maybeLogProb, countOfCounts );
+  }
+
+  // score and write everything added so far
+  void Finish() {
+#ifdef WITH_THREADS
+    if (m_block.get()) {
+      SubmitBlock();
+    }
+    while (!m_pending.empty()) {
+      WriteOldestBlock();
+    }
+#endif
+  }
+
+private:
+#ifdef WITH_THREADS
+  void SubmitBlock() {
+    ScoreBlock *block = m_block.release();
+    m_pending.push_back(block);
+    m_pool->Submit(new ScoreBlockTask(*block, m_featureManager, m_maybeLogProb));
+    while (m_pending.size() >= m_maxPending) {
+      WriteOldestBlock();
+    }
+  }
+
+  void WriteOldestBlock() {
+    std::auto_ptr<ScoreBlock> block(m_pending.front());
+    m_pending.pop_front();
+    {
+      boost::mutex::scoped_lock lock(block->mutex);
+      while (!block->done) {
+        block->cond.wait(lock);
+      }
+    }
+    m_phraseTableFile << block->out.str();
+    countOfCounts.add(block->countOfCounts);
+  }
+
+  std::auto_ptr<Moses::ThreadPool> m_pool;
+  std::auto_ptr<ScoreBlock> m_block;
+#endif
+  std::deque<ScoreBlock*> m_pending;
+  ostream &m_phraseTableFile;
+  const ScoreFeatureManager &m_featureManager;
+  const MaybeLog &m_maybeLogProb;
+  size_t m_maxPending;
+};
+
+}
+
 int main(int argc, char* argv[])
 {
   cerr << "Score v2.0 written by Philipp Koehn\n"
@@ -95,7 +257,7 @@ int main(int argc, char* argv[])
 
   ScoreFeatureManager featureManager;
   if (argc < 4) {
-    cerr << "syntax: score extract lex phrase-table [--Inverse] [--Hierarchical] [--LogProb] [--NegLogProb] [--NoLex] [--GoodTuring] [--KneserNey] [--NoWordAlignment] [--UnalignedPenalty] [--UnalignedFunctionWordPenalty function-word-file] [--MinCountHierarchical count] [--OutputNTLengths] [--PCFG] [--UnpairedExtractFormat] [--ConditionOnTargetLHS] [--Singleton] [--CrossedNonTerm] \n";
+    cerr << "syntax: score extract lex phrase-table [--Inverse] [--Hierarchical] [--LogProb] [--NegLogProb] [--NoLex] [--GoodTuring] [--KneserNey] [--NoWordAlignment] [--UnalignedPenalty] [--UnalignedFunctionWordPenalty function-word-file] [--MinCountHierarchical count] [--OutputNTLengths] [--PCFG] [--UnpairedExtractFormat] [--ConditionOnTargetLHS] [--Singleton] [--CrossedNonTerm] [--Threads num] \n";
     cerr << featureManager.usage() << endl;
     exit(1);
   }
@@ -105,6 +267,7 @@ int main(int argc, char* argv[])
   string fileNameCountOfCounts;
   char* fileNameFunctionWords = NULL;
   vector<string> featureArgs; //all unknown args passed to feature manager
+  int threads = 1;
 
   for(int i=4; i<argc; i++) {
     if (strcmp(argv[i],"inverse") == 0 || strcmp(argv[i],"--Inverse") == 0) {
@@ -166,6 +329,18 @@ int main(int argc, char* argv[])
     } else if (strcmp(argv[i],"--CrossedNonTerm") == 0) {
       crossedNonTerm = true;
       cerr << "crossed non-term reordering feature\n";
+    } else if (strcmp(argv[i],"--Threads") == 0) {
+      if (i+1==argc) {
+        cerr << "ERROR: specify number of threads!\n";
+        exit(1);
+      }
+      threads = atoi(argv[++i]);
+#ifdef WITH_THREADS
+      cerr << "scoring with " << threads << " threads\n";
+#else
+      cerr << "WARNING: compiled without threads, scoring with one thread\n";
+      threads = 1;
+#endif
     } else {
       featureArgs.push_back(argv[i]);
       ++i;
@@ -184,16 +359,12 @@ int main(int argc, char* argv[])
   // lexical translation table
   if (lexFlag)
     lexTable.load( fileNameLex );
+  nullWord = vcbS.getWordID("NULL");
 
   // function word list
   if (unalignedFWFlag)
     loadFunctionWords( fileNameFunctionWords );
 
-  // compute count of counts for Good Turing discounting
-  if (goodTuringFlag || kneserNeyFlag) {
-    for(int i=1; i<=COC_MAX; i++) countOfCounts[i] = 0;
-  }
-
   // sorted phrase extraction file
   Moses::InputFileStream extractFile(fileNameExtract);
 
@@ -219,6 +390,8 @@ int main(int argc, char* argv[])
     phraseTableFile = outputFile;
   }
 
+  ScorePipeline pipeline(threads, *phraseTableFile, featureManager, maybeLogProb);
+
   // loop through all extracted phrase translations
   float lastCount = 0.0f;
   float lastPcfgSum = 0.0f;
@@ -260,7 +433,7 @@ int main(int argc, char* argv[])
     // if new source phrase, process last batch
     if (lastPhrasePair != NULL &&
         lastPhrasePair->GetSource() != phrasePair.GetSource()) {
-      processPhrasePairs( phrasePairsWithSameF, *phraseTableFile, isSingleton, featureManager, maybeLogProb );
+      pipeline.Add( phrasePairsWithSameF, isSingleton );
 
       phrasePairsWithSameF.clear();
       isSingleton = false;
@@ -273,7 +446,8 @@ int main(int argc, char* argv[])
     phrasePairsWithSameF.push_back( phrasePair );
     lastPhrasePair = &phrasePairsWithSameF.back();
   }
-  processPhrasePairs( phrasePairsWithSameF, *phraseTableFile, isSingleton, featureManager, maybeLogProb );
+  pipeline.Add( phrasePairsWithSameF, isSingleton );
+  pipeline.Finish();
 
   phraseTableFile->flush();
   if (phraseTableFile != &cout) {
@@ -298,16 +472,16 @@ void writeCountOfCounts( const string &fileNameCountOfCounts )
   }
 
   // Kneser-Ney needs the total number of phrase pairs
-  countOfCountsFile << totalDistinct << endl;
+  countOfCountsFile << countOfCounts.totalDistinct << endl;
 
   // write out counts
   for(int i=1; i<=COC_MAX; i++) {
-    countOfCountsFile << countOfCounts[ i ] << endl;
+    countOfCountsFile << countOfCounts.counts[ i ] << endl;
   }
   countOfCountsFile.Close();
 }
 
-void processPhrasePairs( vector< PhraseAlignment > &phrasePair, ostream &phraseTableFile, bool isSingleton, const ScoreFeatureManager& featureManager, const MaybeLog& maybeLogProb )
+void processPhrasePairs( vector< PhraseAlignment > &phrasePair, ostream &phraseTableFile, bool isSingleton, const ScoreFeatureManager& featureManager, const MaybeLog& maybeLogProb, CountOfCounts &coc )
 {
   if (phrasePair.size() == 0) return;
 
@@ -347,7 +521,7 @@ void processPhrasePairs( vector< PhraseAlignment > &phrasePair, ostream &phraseT
 
   for(iter = sortedColl.begin(); iter != sortedColl.end(); ++iter) {
     const PhraseAlignmentCollection &group = **iter;
-    outputPhrasePair( group, totalSource, phrasePairGroup.GetSize(), phraseTableFile, isSingleton, featureManager, maybeLogProb );
+    outputPhrasePair( group, totalSource, phrasePairGroup.GetSize(), phraseTableFile, isSingleton, featureManager, maybeLogProb, coc );
   }
 
 }
@@ -504,7 +678,7 @@ int calcCrossedNonTerm(const PHRASE &phraseS, const PhraseAlignment &bestAlignme
 }
 
 void outputPhrasePair(const PhraseAlignmentCollection &phrasePair, float totalCount, int distinctCount, ostream &phraseTableFile, bool isSingleton, const ScoreFeatureManager& featureManager,
-                      const MaybeLog& maybeLogProb )
+                      const MaybeLog& maybeLogProb, CountOfCounts &coc )
 {
   if (phrasePair.size() == 0) return;
 
@@ -520,10 +694,10 @@ void outputPhrasePair(const PhraseAlignmentCollection &phrasePair, float totalCo
 
   // collect count of count statistics
   if (goodTuringFlag || kneserNeyFlag) {
-    totalDistinct++;
+    coc.totalDistinct++;
     int countInt = count + 0.99999;
     if(countInt <= COC_MAX)
-      countOfCounts[ countInt ]++;
+      coc.counts[ countInt ]++;
   }
 
   // compute PCFG score
@@ -739,13 +913,12 @@ double computeLexicalTranslation( const PHRASE &phraseS, const PHRASE &phraseT,
 {
   // lexical translation probability
   double lexScore = 1.0;
-  int null = vcbS.getWordID("NULL");
   // all target words have to be explained
   for(size_t ti=0; ti<alignment.alignedToT.size(); ti++) {
     const set< size_t > & srcIndices = alignment.alignedToT[ ti ];
     if (srcIndices.empty()) {
       // explain unaligned word by NULL
-      lexScore *= lexTable.permissiveLookup( null, phraseT[ ti ] );
+      lexScore *= lexTable.permissiveLookup( nullWord, phraseT[ ti ] );
     } else {
       // go through all the aligned words to compute average
       double thisWordScore = 0;
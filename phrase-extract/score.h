@@ -17,12 +17,13 @@ class LexicalTable
 public:
   std::map< WORD_ID, std::map< WORD_ID, double > > ltable;
   void load( const std::string &filePath );
-  double permissiveLookup( WORD_ID wordS, WORD_ID wordT ) {
+  double permissiveLookup( WORD_ID wordS, WORD_ID wordT ) const {
     // cout << endl << vcbS.getWord( wordS ) << "-" << vcbT.getWord( wordT ) << ":";
-    if (ltable.find( wordS ) == ltable.end()) return 1.0;
-    if (ltable[ wordS ].find( wordT ) == ltable[ wordS ].end()) return 1.0;
-    // cout << ltable[ wordS ][ wordT ];
-    return ltable[ wordS ][ wordT ];
+    std::map< WORD_ID, std::map< WORD_ID, double > >::const_iterator s = ltable.find( wordS );
+    if (s == ltable.end()) return 1.0;
+    std::map< WORD_ID, double >::const_iterator t = s->second.find( wordT );
+    if (t == s->second.end()) return 1.0;
+    return t->second;
   }
 };
 
@@ -1,6 +1,7 @@
 // $Id$
 //#include "beammain.h"
 #include "tables-core.h"
+#include <algorithm>
 
 #define TABLE_LINE_MAX_LENGTH 1000
 #define UNKNOWNSTR	"UNK"
@@ -38,6 +39,18 @@ bool isNonTerminal( const WORD &symbol )
   return symbol.substr(0, 1) == "[" && symbol.substr(symbol.size()-1, 1) == "]";
 }
 
+Vocabulary::Vocabulary()
+  : m_size( 0 )
+{
+  std::fill( m_chunks, m_chunks + MAX_CHUNKS, static_cast<WORD*>( NULL ) );
+}
+
+Vocabulary::~Vocabulary()
+{
+  for( size_t i = 0; i < MAX_CHUNKS && m_chunks[ i ]; i++ )
+    delete [] m_chunks[ i ];
+}
+
 WORD_ID Vocabulary::storeIfNew( const WORD& word )
 {
   map<WORD, WORD_ID>::iterator i = lookup.find( word );
@@ -45,8 +58,12 @@ WORD_ID Vocabulary::storeIfNew( const WORD& word )
   if( i != lookup.end() )
     return i->second;
 
-  WORD_ID id = vocab.size();
-  vocab.push_back( word );
+  WORD_ID id = m_size;
+  WORD *&chunk = m_chunks[ id >> CHUNK_BITS ];
+  if( chunk == NULL )
+    chunk = new WORD[ CHUNK_SIZE ];
+  chunk[ id & (CHUNK_SIZE-1) ] = word;
+  ++m_size;
   lookup[ word ] = id;
   return id;
 }
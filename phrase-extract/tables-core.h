@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string>
+#include <vector>
 #include <queue>
 #include <map>
 #include <cmath>
@@ -20,16 +21,32 @@ namespace MosesTraining
 typedef std::string WORD;
 typedef unsigned int WORD_ID;
 
+// Words are stored in fixed-size chunks that are never moved, so getWord()
+// may be called from other threads for words that were stored before the
+// threads synchronised with the thread calling storeIfNew().
 class Vocabulary
 {
 public:
+  Vocabulary();
+  ~Vocabulary();
   std::map<WORD, WORD_ID>  lookup;
-  std::vector< WORD > vocab;
   WORD_ID storeIfNew( const WORD& );
   WORD_ID getWordID( const WORD& );
   inline WORD &getWord( WORD_ID id ) {
-    return vocab[ id ];
+    return m_chunks[ id >> CHUNK_BITS ][ id & (CHUNK_SIZE-1) ];
   }
+
+private:
+  static const unsigned int CHUNK_BITS = 16;
+  static const unsigned int CHUNK_SIZE = 1 << CHUNK_BITS;
+  static const unsigned int MAX_CHUNKS = 1 << (32 - CHUNK_BITS);
+
+  WORD *m_chunks[ MAX_CHUNKS ];
+  WORD_ID m_size;
+
+  // not copyable
+  Vocabulary( const Vocabulary& );
+  Vocabulary &operator=( const Vocabulary& );
 };
 
 typedef std::vector< WORD_ID > PHRASE;
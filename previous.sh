@@ -0,0 +1,2 @@
+#!/bin/sh
+./bjam --with-boost=/usr -j2 cxxflags=-std=gnu++98 moses-chart-cmd//moses_chart misc//searchGraphBinaryToText misc//remoteLMServer
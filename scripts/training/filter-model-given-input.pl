@@ -39,13 +39,17 @@ my $binarizer = undef;
 my $min_score = undef;
 my $opt_min_non_initial_rule_count = undef;
 my $opt_gzip = 1; # gzip output files (so far only phrase-based ttable until someone tests remaining models and formats)
+my $native_filter = undef; # path to misc/filterTableGivenInput
+my $opt_threads = 1;
 
 GetOptions(
     "gzip!" => \$opt_gzip,
     "Hierarchical" => \$opt_hierarchical,
     "Binarizer=s" => \$binarizer,
     "MinScore=s" => \$min_score,
-    "MinNonInitialRuleCount=i" => \$opt_min_non_initial_rule_count
+    "MinNonInitialRuleCount=i" => \$opt_min_non_initial_rule_count,
+    "NativeFilter=s" => \$native_filter,
+    "Threads=i" => \$opt_threads
 ) or exit(1);
 
 # get command line parameters
@@ -54,7 +58,7 @@ my $config = shift;
 my $input = shift;
 
 if (!defined $dir || !defined $config || !defined $input) {
-  print STDERR "usage: filter-model-given-input.pl targetdir moses.ini input.text [-Binarizer binarizer] [-Hierarchical] [-MinScore id:threshold[,id:threshold]*]\n";
+  print STDERR "usage: filter-model-given-input.pl targetdir moses.ini input.text [-Binarizer binarizer] [-Hierarchical] [-MinScore id:threshold[,id:threshold]*] [-NativeFilter filterTableGivenInput [-Threads num]]\n";
   exit 1;
 }
 $dir = ensure_full_path($dir);
@@ -94,7 +98,7 @@ if (-d $dir) {
 safesystem("mkdir -p $dir") or die "Can't mkdir $dir";
 
 # get tables to be filtered (and modify config file)
-my (@TABLE,@TABLE_FACTORS,@TABLE_NEW_NAME,%CONSIDER_FACTORS,%KNOWN_TTABLE,@TABLE_WEIGHTS,%TABLE_NUMBER);
+my (@TABLE,@TABLE_FACTORS,@TABLE_NEW_NAME,%CONSIDER_FACTORS,%KNOWN_TTABLE,%COMPACT_TTABLE,@TABLE_WEIGHTS,%TABLE_NUMBER);
 
 my %new_name_used = ();
 open(INI_OUT,">$dir/moses.ini") or die "Can't write $dir/moses.ini";
@@ -106,6 +110,7 @@ while(my $line = <INI>) {
      || $line =~ /PhraseDictionaryBinary /
      || $line =~ /PhraseDictionaryOnDisk /
      || $line =~ /PhraseDictionarySCFG /
+     || $line =~ /PhraseDictionaryCompact /
      ) {
     print STDERR "pt:$line\n";
 
@@ -132,22 +137,30 @@ while(my $line = <INI>) {
 			}
     } #for (my $i = 1; $i < scalar(@toks); ++$i) {
     
-		if (($phrase_table_impl ne "PhraseDictionaryMemory" && $phrase_table_impl ne "PhraseDictionarySCFG") || $file =~ /glue-grammar/) {
-				# Only Memory ("0") and NewFormat ("6") can be filtered.
+		my $compact = ($native_filter && !$opt_hierarchical && $phrase_table_impl eq "PhraseDictionaryCompact");
+		if (($phrase_table_impl ne "PhraseDictionaryMemory" && $phrase_table_impl ne "PhraseDictionarySCFG" && !$compact) || $file =~ /glue-grammar/) {
+				# Only Memory ("0") and NewFormat ("6") can be filtered,
+				# Compact with the native filter.
 				print INI_OUT "$line\n";
 				next;
 		}
 
+		$file .= ".minphr" if $compact && $file !~ /\.minphr$/;
 		push @TABLE, $file;
 		push @TABLE_WEIGHTS,$w;
 		$KNOWN_TTABLE{$#TABLE}++;
+		$COMPACT_TTABLE{$#TABLE}++ if $compact;
 
   	my $new_name = "$dir/phrase-table.$source_factor-$t.".(++$TABLE_NUMBER{"$source_factor-$t"});
 		my $cnt = 1;
 		$cnt ++ while (defined $new_name_used{"$new_name.$cnt"});
 		$new_name .= ".$cnt";
 		$new_name_used{$new_name} = 1;
-		if ($binarizer && $phrase_table_impl eq "PhraseDictionarySCFG") {
+		if ($compact) {
+		  @toks = set_value(\@toks, "path", "$new_name$table_flag");
+		  $new_name .= ".minphr";
+		}
+		elsif ($binarizer && $phrase_table_impl eq "PhraseDictionarySCFG") {
 		  $phrase_table_impl = "PhraseDictionaryOnDisk";
 		  @toks = set_value(\@toks, "path", "$new_name.bin$table_flag");
 		}
@@ -253,7 +266,7 @@ if ($opt_hierarchical) {
 } #if ($opt_hierarchical) {
 
 my %PHRASE_USED;
-if (!$opt_hierarchical) {
+if (!$opt_hierarchical && !$native_filter) {
     # get the phrase pairs appearing in the input text, up to the $MAX_LENGTH
     open(INPUT,mk_open_string($input)) or die "Can't read $input";
     while(my $line = <INPUT>) {
@@ -289,52 +302,67 @@ for(my $i=0;$i<=$#TABLE;$i++) {
     my $new_file = $TABLE_NEW_NAME[$i];
     print STDERR "filtering $file -> $new_file...\n";
 
-    my $openstring = mk_open_string($file);
-
-    my $new_openstring;
-    if ($new_file =~ /\.gz$/) {
-      $new_openstring = "| gzip -c > $new_file";
-    } else {
-      $new_openstring = ">$new_file";
+    if ($native_filter && !$opt_hierarchical) {
+        # n-gram trie of the input, tables streamed by a native tool
+        my $in_file = (! -e $file && -e "$file.gz") ? "$file.gz" : $file;
+        my $cmd = "$native_filter -input $input -in $in_file -out $new_file -factors $factors -max-length $MAX_LENGTH";
+        $cmd .= " -threads $opt_threads" if $opt_threads > 1;
+        if ($min_score && !$COMPACT_TTABLE{$i}) {
+            my $min_score_arg = $min_score;
+            $min_score_arg =~ s/ //g;
+            $cmd .= " -min-score $min_score_arg";
+        }
+        safesystem($cmd) or die "Can't filter $file";
+        next if $COMPACT_TTABLE{$i};
     }
+    else {
+      my $openstring = mk_open_string($file);
+
+      my $new_openstring;
+      if ($new_file =~ /\.gz$/) {
+        $new_openstring = "| gzip -c > $new_file";
+      } else {
+        $new_openstring = ">$new_file";
+      }
 
-    open(FILE_OUT,$new_openstring) or die "Can't write to $new_openstring";
-
-    if ($opt_hierarchical) {
-        my $tmp_input = $TMP_INPUT_FILENAME{$factors};
-        my $options = "";
-        $options .= "--min-non-initial-rule-count=$opt_min_non_initial_rule_count" if defined($opt_min_non_initial_rule_count);
-        open(PIPE,"$openstring $SCRIPTS_ROOTDIR/training/filter-rule-table.py $options $tmp_input |");
-        while (my $line = <PIPE>) {
-            print FILE_OUT $line
-        }
-        close(FILEHANDLE);
-    } else {
-        open(FILE,$openstring) or die "Can't open '$openstring'";
-        while(my $entry = <FILE>) {
-            my ($foreign,$rest) = split(/ \|\|\| /,$entry,2);
-            $foreign =~ s/ $//;
-            if (defined($PHRASE_USED{$factors}{$foreign})) {
-                # handle min_score thresholds
-                if ($min_score) {
-                   my @ITEM = split(/ *\|\|\| */,$rest);
-                   if(scalar (@ITEM)>2) { # do not filter reordering table
-                     my @SCORE = split(/ /,$ITEM[1]);
-                     my $okay = 1;
-                     foreach my $id (keys %MIN_SCORE) {
-                       $okay = 0 if $SCORE[$id] < $MIN_SCORE{$id};
+      open(FILE_OUT,$new_openstring) or die "Can't write to $new_openstring";
+
+      if ($opt_hierarchical) {
+          my $tmp_input = $TMP_INPUT_FILENAME{$factors};
+          my $options = "";
+          $options .= "--min-non-initial-rule-count=$opt_min_non_initial_rule_count" if defined($opt_min_non_initial_rule_count);
+          open(PIPE,"$openstring $SCRIPTS_ROOTDIR/training/filter-rule-table.py $options $tmp_input |");
+          while (my $line = <PIPE>) {
+              print FILE_OUT $line
+          }
+          close(FILEHANDLE);
+      } else {
+          open(FILE,$openstring) or die "Can't open '$openstring'";
+          while(my $entry = <FILE>) {
+              my ($foreign,$rest) = split(/ \|\|\| /,$entry,2);
+              $foreign =~ s/ $//;
+              if (defined($PHRASE_USED{$factors}{$foreign})) {
+                  # handle min_score thresholds
+                  if ($min_score) {
+                     my @ITEM = split(/ *\|\|\| */,$rest);
+                     if(scalar (@ITEM)>2) { # do not filter reordering table
+                       my @SCORE = split(/ /,$ITEM[1]);
+                       my $okay = 1;
+                       foreach my $id (keys %MIN_SCORE) {
+                         $okay = 0 if $SCORE[$id] < $MIN_SCORE{$id};
+                       }
+                       next unless $okay;
                      }
-                     next unless $okay;
-                   }
-                }
-                print FILE_OUT $entry;
-                $used++;
-            }
-            $total++;
-        }
-        close(FILE);
-        die "No phrases found in $file!" if $total == 0;
-        printf STDERR "$used of $total phrases pairs used (%.2f%s) - note: max length $MAX_LENGTH\n",(100*$used/$total),'%';
+                  }
+                  print FILE_OUT $entry;
+                  $used++;
+              }
+              $total++;
+          }
+          close(FILE);
+          die "No phrases found in $file!" if $total == 0;
+          printf STDERR "$used of $total phrases pairs used (%.2f%s) - note: max length $MAX_LENGTH\n",(100*$used/$total),'%';
+      }
     }
 
     if(defined($binarizer)) {